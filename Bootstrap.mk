@@ -12,6 +12,11 @@ CFLAGS_BOOTSTRAP = \
 # turn off debugging for bootstrap comparison
 CFLAGS_BOOTSTRAP += -g0
 
+# make bootstrap INTEGRATED_AS=1: stage2/3 objects are written by cc1, not as
+ifdef INTEGRATED_AS
+CFLAGS_BOOTSTRAP += -fintegrated-as
+endif
+
 CC_STAGE1 = ${PWD}/src/ucc/ucc
 CC_STAGE2 = ${PWD}/bootstrap/stage2/src/ucc/ucc
 CC_STAGE3 = ${PWD}/bootstrap/stage3/src/ucc/ucc
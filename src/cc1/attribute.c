@@ -175,6 +175,10 @@ void attribute_free(attribute *a)
 		case attr_always_inline:
 		case attr_noinline:
 		case attr_flatten:
+		case attr_hot:
+		case attr_cold:
+		case attr_pure:
+		case attr_const:
 		case attr_no_stack_protector:
 		case attr_stack_protect:
 		case attr_no_sanitize:
@@ -289,6 +293,10 @@ int attribute_equal(attribute *a, attribute *b)
 		case attr_always_inline:
 		case attr_noinline:
 		case attr_flatten:
+		case attr_hot:
+		case attr_cold:
+		case attr_pure:
+		case attr_const:
 		case attr_no_stack_protector:
 		case attr_stack_protect:
 		case attr_fallthrough:
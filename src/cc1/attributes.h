@@ -32,6 +32,10 @@
 		NAME(always_inline, 0)  \
 		NAME(noinline, 0)       \
 		NAME(flatten, 0)        \
+		NAME(hot, 0)            \
+		NAME(cold, 0)           \
+		NAME(pure, 0)           \
+		NAME(const, 0)          \
 		NAME(constructor, 0)    \
 		NAME(destructor, 0)     \
 		NAME(visibility, 0)     \
@@ -10,6 +10,9 @@
 
 #include <unistd.h>
 #include <signal.h>
+#include <sys/resource.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "../util/util.h"
 #include "../util/io.h"
@@ -26,6 +29,9 @@
 #include "fold.h"
 #include "out/asm.h" /* NUM_SECTIONS */
 #include "out/dbg.h" /* dbg_out_filelist() */
+#include "out/peephole.h"
+#include "out/stack.h"
+#include "out/obj.h"
 #include "gen_asm.h"
 #include "gen_dump.h"
 #include "gen_style.h"
@@ -40,6 +46,11 @@
 #include "cc1_target.h"
 #include "cc1_out.h"
 #include "sanitize_opt.h"
+#include "time_report.h"
+#include "profile.h"
+#include "inline.h"
+#include "dead_static.h"
+#include "loop.h"
 
 static const char **system_includes;
 
@@ -57,6 +68,9 @@ static struct
 	{ "align-is-p2", MOPT_ALIGN_IS_POW2 },
 	{ "fentry", MOPT_FENTRY },
 	{ "red-zone", MOPT_RED_ZONE },
+	{ "popcnt", MOPT_POPCNT },
+	{ "lzcnt", MOPT_LZCNT },
+	{ "bmi", MOPT_BMI },
 
 	{ NULL, 0 }
 };
@@ -83,6 +97,11 @@ char *cc1_first_fname;
 
 enum cc1_backend cc1_backend = BACKEND_ASM;
 
+/* -emit=obj: asm text goes to a temporary file and is assembled in-process,
+ * instructions are encoded from their records (see out/obj.h) */
+static int emit_obj;
+static FILE *obj_file;
+
 enum mopt mopt_mode = MOPT_RED_ZONE;
 
 enum visibility cc1_visibility_default;
@@ -93,7 +112,11 @@ enum debug_level cc1_gdebug = DEBUG_OFF;
 int cc1_gdebug_columninfo = 1;
 
 enum stringop_strategy cc1_mstringop_strategy = STRINGOP_STRATEGY_THRESHOLD;
-unsigned cc1_mstringop_threshold = 16;
+unsigned cc1_mstringop_threshold = 256;
+
+enum stack_reuse cc1_stack_reuse = STACK_REUSE_ALL;
+
+enum cc1_tls_model cc1_tls_model = TLS_MODEL_DEFAULT;
 
 enum c_std cc1_std = STD_C99;
 
@@ -109,6 +132,10 @@ static const char *requested_default_visibility;
 static const char *debug_compilation_dir;
 
 static FILE *infile;
+static struct
+{
+	const char *base, *pos, *end;
+} inmap;
 
 ucc_printflike(1, 2)
 ucc_noreturn
@@ -138,7 +165,7 @@ static void dump_options(void)
 	fprintf(stderr, "Output options\n");
 	fprintf(stderr, "  -g[0|1|2|3], -gline-tables-only|mlt, -g[no-]column-info\n");
 	fprintf(stderr, "  -o output-file\n");
-	fprintf(stderr, "  -emit=(dump|print|asm|style)\n");
+	fprintf(stderr, "  -emit=(dump|print|asm|obj|style)\n");
 	fprintf(stderr, "  -O[0123s]\n");
 	fprintf(stderr, "  --help\n");
 	fprintf(stderr, "\n");
@@ -152,7 +179,12 @@ static void dump_options(void)
 	fprintf(stderr, "  -f(sanitize=...|sanitize-error=...|sanitize-undefined-trap-on-error)\n");
 	fprintf(stderr, "  -fno-sanitize=all\n");
 	fprintf(stderr, "  -fvisibility=default|hidden|protected\n");
+	fprintf(stderr, "  -ftls-model=global-dynamic|local-dynamic|initial-exec|local-exec\n");
 	fprintf(stderr, "  -fdebug-compilation-dir=...\n");
+	fprintf(stderr, "  -ftime-report-json=...\n");
+	fprintf(stderr, "  -finline-limit=<number>\n");
+	fprintf(stderr, "  -fstack-reuse=all|named_vars|none\n");
+	fprintf(stderr, "  -fprofile-generate=... / -fprofile-use=...\n");
 
 #define X(flag, memb) fprintf(stderr, "  -f[no-]" flag "\n");
 #define ALIAS X
@@ -168,7 +200,7 @@ static void dump_options(void)
 
 	fprintf(stderr, "\n");
 	fprintf(stderr, "Machine options\n");
-	fprintf(stderr, "  -mstringop-strategy=(libcall|loop|libcall-threshold=<number>)\n");
+	fprintf(stderr, "  -mstringop-strategy=(libcall|loop|unrolled_loop|rep_8byte|libcall-threshold=<number>)\n");
 	for(i = 0; mopts[i].arg; i++)
 		fprintf(stderr, "  -m[no-]%s\n", mopts[i].arg);
 
@@ -248,16 +280,103 @@ static void io_fin_sections(FILE *out)
 
 static void io_fin(FILE *out)
 {
+	time_report_push(TIME_IO_FIN);
 	io_fin_sections(out);
 	io_fin_gnustack(out);
 	io_fin_macosx_version(out);
+	time_report_pop(TIME_IO_FIN);
+}
+
+static void mem_report(FILE *f)
+{
+	unsigned long total_count = 0, total_bytes = 0;
+	struct rusage usage;
+	int i;
+
+	fprintf(f, "Memory allocations\n");
+	fprintf(f, " %-14s %12s %14s\n", "subsystem", "count", "bytes");
+
+	for(i = 0; i < UALLOC_TAG_COUNT; i++){
+		unsigned long count, bytes;
+
+		ualloc_tag_counts(i, &count, &bytes);
+		total_count += count;
+		total_bytes += bytes;
+
+		fprintf(f, " %-14s %12lu %14lu\n", ualloc_tag_name(i), count, bytes);
+	}
+
+	fprintf(f, " %-14s %12lu %14lu\n", "TOTAL", total_count, total_bytes);
+
+	if(getrusage(RUSAGE_SELF, &usage) == 0){
+#ifdef __APPLE__
+		long peak_kb = usage.ru_maxrss / 1024; /* bytes on darwin */
+#else
+		long peak_kb = usage.ru_maxrss;
+#endif
+		fprintf(f, " peak RSS: %ld KiB\n", peak_kb);
+	}
 }
 
-static char *next_line(void)
+static void input_map(void)
 {
-	char *s = fline(infile, NULL);
+	/* map the input, if we can, so diagnostics can refer to lines in it
+	 * rather than the tokeniser retaining each line */
+	struct stat st;
+	void *p;
+
+	if(fstat(fileno(infile), &st) || !S_ISREG(st.st_mode) || st.st_size == 0)
+		return;
+
+	p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(infile), 0);
+	if(p == MAP_FAILED)
+		return;
+
+	/* lines must be '\n'-terminated - we can't read past the mapping */
+	if(((const char *)p)[st.st_size - 1] != '\n'){
+		munmap(p, st.st_size);
+		return;
+	}
+
+	/* left mapped for the rest of the compile */
+	inmap.base = inmap.pos = p;
+	inmap.end = inmap.base + st.st_size;
+}
+
+static char *next_line_mapped(const char **persistent)
+{
+	const char *nl;
+	size_t len;
+	char *s, *p;
+
+	if(inmap.pos == inmap.end)
+		return NULL;
+
+	nl = memchr(inmap.pos, '\n', inmap.end - inmap.pos);
+	len = nl - inmap.pos;
+
+	s = umalloc(len + 1);
+	memcpy(s, inmap.pos, len);
+
+	for(p = s; *p; p++)
+		if(*p == '\r')
+			*p = ' ';
+
+	*persistent = inmap.pos;
+	inmap.pos = nl + 1;
+
+	return s;
+}
+
+static char *next_line(const char **persistent)
+{
+	char *s;
 	char *p;
 
+	if(inmap.base)
+		return next_line_mapped(persistent);
+
+	s = fline(infile, NULL);
 	if(!s){
 		if(feof(infile))
 			return NULL;
@@ -317,6 +436,9 @@ static void gen_backend(symtable_global *globs, const char *fname, FILE *out, co
 
 			io_fin(out);
 
+			if(emit_obj && obj_end(obj_file))
+				gen_had_error = 1;
+
 			if(compdir != buf && compdir != debug_compilation_dir)
 				free(compdir);
 			break;
@@ -365,23 +487,50 @@ static int optimise(const char *argv0, const char *arg)
 
 	switch(opt){
 		case O0:
+			cc1_fopt.if_conversion = 0;
+			cc1_fopt.ivopts = 0;
+			cc1_fopt.mem2reg = 0;
+			cc1_fopt.move_loop_invariants = 0;
+			cc1_fopt.optimize_sibling_calls = 0;
+			cc1_fopt.peephole = 0;
+			cc1_fopt.reorder_blocks = 0;
 			cc1_fopt.thread_jumps = 0;
+			cc1_fopt.toplevel_reorder = 0;
+			cc1_fopt.tree_vectorize = 0;
 			break;
 
 		case Os:
 			/* same as -O2 but disable inlining and int-float-load */
 			cc1_fopt.fold_const_vlas = 1;
+			cc1_fopt.if_conversion = 1;
 			cc1_fopt.inline_functions = 0;
 			cc1_fopt.integral_float_load = 0;
+			cc1_fopt.ivopts = 1;
+			cc1_fopt.mem2reg = 1;
+			cc1_fopt.move_loop_invariants = 1;
+			cc1_fopt.optimize_sibling_calls = 1;
+			cc1_fopt.peephole = 1;
+			cc1_fopt.reorder_blocks = 1;
+			cc1_fopt.toplevel_reorder = 1;
+			cc1_fopt.tree_vectorize = 0;
 			break;
 
 		case O1:
 		case O2:
 		case O3:
 			cc1_fopt.fold_const_vlas = 1;
+			cc1_fopt.if_conversion = 1;
 			cc1_fopt.inline_functions = 1;
 			cc1_fopt.integral_float_load = 1;
+			cc1_fopt.ivopts = 1;
+			cc1_fopt.mem2reg = 1;
+			cc1_fopt.move_loop_invariants = 1;
+			cc1_fopt.optimize_sibling_calls = opt != O1;
+			cc1_fopt.peephole = 1;
+			cc1_fopt.reorder_blocks = 1;
 			cc1_fopt.thread_jumps = 1;
+			cc1_fopt.toplevel_reorder = 1;
+			cc1_fopt.tree_vectorize = opt == O3;
 			break;
 	}
 
@@ -434,9 +583,52 @@ static int parse_mf_equals(
 		}else if(!strncmp(arg_substr, "visibility=", 11)){
 			requested_default_visibility = arg_substr + 11;
 			return 1;
+		}else if(!strncmp(arg_substr, "tls-model=", 10)){
+			const char *model = arg_substr + 10;
+
+			/* local-dynamic is treated as global-dynamic */
+			if(!strcmp(model, "global-dynamic") || !strcmp(model, "local-dynamic"))
+				cc1_tls_model = TLS_MODEL_GLOBAL_DYNAMIC;
+			else if(!strcmp(model, "initial-exec"))
+				cc1_tls_model = TLS_MODEL_INITIAL_EXEC;
+			else if(!strcmp(model, "local-exec"))
+				cc1_tls_model = TLS_MODEL_LOCAL_EXEC;
+			else
+				usage(argv0, "unknown -ftls-model \"%s\"\n", model);
+			return 1;
 		}else if(!strncmp(arg_substr, "debug-compilation-dir=", 22)){
 			debug_compilation_dir = arg_substr + 22;
 			return 1;
+		}else if(!strncmp(arg_substr, "time-report-json=", 17)){
+			cc1_time_report_json = arg_substr + 17;
+			cc1_fopt.time_report = 1;
+			return 1;
+		}else if(!strncmp(arg_substr, "inline-limit=", 13)){
+			char *end;
+			cc1_inline_limit = strtoul(arg_substr + 13, &end, 0);
+			if(*end || end == arg_substr + 13)
+				usage(argv0, "-finline-limit expects a number\n");
+			return 1;
+		}else if(!strncmp(arg_substr, "stack-reuse=", 12)){
+			const char *reuse = arg_substr + 12;
+
+			if(!strcmp(reuse, "all"))
+				cc1_stack_reuse = STACK_REUSE_ALL;
+			else if(!strcmp(reuse, "named_vars"))
+				cc1_stack_reuse = STACK_REUSE_NAMED_VARS;
+			else if(!strcmp(reuse, "none"))
+				cc1_stack_reuse = STACK_REUSE_NONE;
+			else
+				usage(argv0, "-fstack-reuse expects all, named_vars or none\n");
+			return 1;
+		}else if(!strncmp(arg_substr, "profile-generate=", 17)){
+			cc1_profile_generate_path = arg_substr + 17;
+			cc1_fopt.profile_generate = 1;
+			return 1;
+		}else if(!strncmp(arg_substr, "profile-use=", 12)){
+			cc1_profile_use_path = arg_substr + 12;
+			cc1_fopt.profile_use = 1;
+			return 1;
 		}
 
 	}else if(arg_ty == 'm'){
@@ -452,6 +644,10 @@ static int parse_mf_equals(
 				cc1_mstringop_strategy = STRINGOP_STRATEGY_LIBCALL;
 			}else if(!strcmp(strategy, "loop")){
 				cc1_mstringop_strategy = STRINGOP_STRATEGY_LOOP;
+			}else if(!strcmp(strategy, "unrolled_loop")){
+				cc1_mstringop_strategy = STRINGOP_STRATEGY_UNROLLED;
+			}else if(!strcmp(strategy, "rep_8byte")){
+				cc1_mstringop_strategy = STRINGOP_STRATEGY_REP;
 			}else if(!strncmp(strategy, "libcall-threshold=", 18)){
 				const char *threshold = strategy + 18;
 				char *end;
@@ -464,7 +660,7 @@ static int parse_mf_equals(
 				usage(
 						argv0,
 						"invalid argument to for -mmemcpy-strategy=..., \"%s\", accepted values:\n"
-						"  libcall, loop, libcall-threshold=<number>\n"
+						"  libcall, loop, unrolled_loop, rep_8byte, libcall-threshold=<number>\n"
 						, strategy);
 			}
 
@@ -599,12 +795,24 @@ static int init_target(const char *target)
 
 static void output_init(const char *fname)
 {
+	FILE *f;
+
 	if(fname){
-		cc1_output.file = fopen(fname, "w");
-		if(!cc1_output.file)
+		f = fopen(fname, "w");
+		if(!f)
 			ccdie("open %s:", fname);
 	}else{
-		cc1_output.file = stdout;
+		f = stdout;
+	}
+
+	if(emit_obj){
+		obj_file = f;
+		cc1_output.file = tmpfile();
+		if(!cc1_output.file)
+			ccdie("tmpfile():");
+		obj_begin(cc1_output.file);
+	}else{
+		cc1_output.file = f;
 	}
 
 	cc1_outsections = dynmap_new(struct section *, section_cmp, section_hash);
@@ -624,6 +832,12 @@ static void output_term(const char *fname)
 	if(fclose(cc1_output.file))
 		ccdie("close output (%s):", fname);
 	cc1_output.file = NULL;
+
+	if(obj_file){
+		if(fclose(obj_file))
+			ccdie("close output (%s):", fname);
+		obj_file = NULL;
+	}
 }
 
 int main(int argc, char **argv)
@@ -638,6 +852,8 @@ int main(int argc, char **argv)
 	int werror = 0;
 	dynmap *unknown_warnings = dynmap_new(char *, strcmp, dynmap_strhash);
 
+	time_report_init();
+
 	/* defaults */
 	cc1_mstack_align = -1;
 	warning_init();
@@ -665,13 +881,15 @@ int main(int argc, char **argv)
 
 			if(!strcmp(emit, "dump") || !strcmp(emit, "print"))
 				cc1_backend = BACKEND_DUMP;
-			else if(!strcmp(emit, "asm"))
+			else if(!strcmp(emit, "asm") || !strcmp(emit, "obj"))
 				cc1_backend = BACKEND_ASM;
 			else if(!strcmp(emit, "style"))
 				cc1_backend = BACKEND_STYLE;
 			else
 				usage(argv[0], "unknown emit backend \"%s\"\n", emit);
 
+			emit_obj = !strcmp(emit, "obj");
+
 		}else if(!strncmp(argv[i], "-g", 2)){
 			const char *mode = argv[i] + 2;
 			int imode;
@@ -797,6 +1015,9 @@ dbg_unknown:
 		infile = fopen(in_fname, "r");
 		if(!infile)
 			ccdie("open %s:", in_fname);
+
+		if(cc1_fopt.show_line)
+			input_map();
 	}else{
 		infile = stdin;
 		in_fname = "-";
@@ -838,6 +1059,22 @@ dbg_unknown:
 
 	output_term(out_fname);
 
+	if(cc1_fopt.time_report){
+		time_report_print(stderr);
+		if(cc1_time_report_json)
+			time_report_json(cc1_time_report_json);
+	}
+	if(cc1_fopt.mem_report)
+		mem_report(stderr);
+	if(cc1_fopt.peephole_stats)
+		peephole_stats(stderr);
+	if(cc1_fopt.dead_static_stats)
+		dead_static_stats(stderr);
+	if(cc1_fopt.stack_reuse_stats)
+		stack_reuse_stats(stderr);
+	if(cc1_fopt.loop_opt_stats)
+		loop_stats(stderr);
+
 out:
 	dynarray_free(const char **, system_includes, NULL);
 	{
@@ -12,16 +12,38 @@ enum mopt
 	MOPT_ALIGN_IS_POW2 = 1 << 1,
 	MOPT_FENTRY = 1 << 2,
 	MOPT_RED_ZONE = 1 << 3,
+	MOPT_POPCNT = 1 << 4,
+	MOPT_LZCNT = 1 << 5,
+	MOPT_BMI = 1 << 6, /* tzcnt */
 };
 #define IS_32_BIT() (platform_word_size() == 4)
 
 enum stringop_strategy
 {
 	STRINGOP_STRATEGY_LIBCALL,
-	STRINGOP_STRATEGY_LOOP,
+	STRINGOP_STRATEGY_LOOP, /* inline, by size */
+	STRINGOP_STRATEGY_UNROLLED, /* inline moves */
+	STRINGOP_STRATEGY_REP, /* inline rep-prefixed string insns */
 	STRINGOP_STRATEGY_THRESHOLD,
 };
 
+/* -fstack-reuse= */
+enum stack_reuse
+{
+	STACK_REUSE_NONE,
+	STACK_REUSE_NAMED_VARS, /* variables in disjoint scopes */
+	STACK_REUSE_ALL, /* and temporaries, around live register values */
+};
+
+/* ordered from most general to fastest */
+enum cc1_tls_model
+{
+	TLS_MODEL_DEFAULT,
+	TLS_MODEL_GLOBAL_DYNAMIC,
+	TLS_MODEL_INITIAL_EXEC,
+	TLS_MODEL_LOCAL_EXEC
+};
+
 enum cc1_backend
 {
 	BACKEND_ASM,
@@ -37,6 +59,10 @@ extern enum visibility cc1_visibility_default;
 extern enum stringop_strategy cc1_mstringop_strategy;
 extern unsigned cc1_mstringop_threshold;
 
+extern enum stack_reuse cc1_stack_reuse;
+
+extern enum cc1_tls_model cc1_tls_model;
+
 extern enum c_std cc1_std;
 #define C99_LONGLONG() \
 	if(cc1_std < STD_C99) \
@@ -27,6 +27,7 @@ void cc1_out_ctx_free(out_ctx *octx)
 	dynmap_free((*cc1_octx)->vlamap);
 	dynmap_free((*cc1_octx)->generated_decls);
 	dynmap_free((*cc1_octx)->spel_to_fndecl);
+	dynmap_free((*cc1_octx)->loop_subst);
 
 	assert(!(*cc1_octx)->label_to_blk
 			&& "label_to_blk should be handled elsewhere");
@@ -19,6 +19,7 @@ struct cc1_out_ctx
 	{
 		struct out_blk *phi, **rets;
 		unsigned depth;
+		int sibling; /* our returns are the function's return */
 	} inline_;
 
 	struct cc1_dbg_ctx
@@ -30,6 +31,22 @@ struct cc1_out_ctx
 	struct dynmap *label_to_blk;
 
 	struct decl *current_decl;
+
+	/* callee expression of a `return f(...)` that may jump to f */
+	const struct expr *sibling_call;
+
+	/* nesting of loops around the code being generated, for the inliner */
+	unsigned loop_depth;
+
+	/* expressions precomputed before their loop, see loop.h */
+	struct dynmap *loop_subst; /* expr* => struct loop_subst* */
+
+	/* how much inlining has grown the current function */
+	struct
+	{
+		const struct decl *fn;
+		unsigned growth, max;
+	} inline_budget;
 };
 
 #define cc1_out_ctx(octx) ((struct cc1_out_ctx **)out_user_ctx(octx))
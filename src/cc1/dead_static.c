@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "../util/alloc.h"
+#include "../util/dynmap.h"
+
+#include "cc1.h"
+#include "fopt.h"
+#include "decl.h"
+#include "expr.h"
+#include "stmt.h"
+#include "type_is.h"
+#include "inline.h"
+
+#include "dead_static.h"
+
+/* rough bytes per inliner cost unit, for reporting dropped code */
+#define DEAD_STATIC_BYTES_PER_COST 4
+
+static dynmap *refs; /* const char * => unsigned * */
+
+static struct
+{
+	unsigned funcs, objs;
+	unsigned long code_bytes, data_bytes;
+} dropped;
+
+static unsigned *ref_count(const char *lbl, int create)
+{
+	unsigned *count;
+
+	if(!refs){
+		if(!create)
+			return NULL;
+		refs = dynmap_new(const char *, strcmp, dynmap_strhash);
+	}
+
+	count = dynmap_get(const char *, unsigned *, refs, lbl);
+	if(!count && create){
+		count = umalloc(sizeof *count);
+		(void)dynmap_set(const char *, unsigned *, refs, (const char *)ustrdup(lbl), count);
+	}
+
+	return count;
+}
+
+void dead_static_ref(const char *lbl)
+{
+	if(!cc1_fopt.toplevel_reorder)
+		return;
+
+	++*ref_count(lbl, 1);
+}
+
+void dead_static_unref(const char *lbl)
+{
+	unsigned *count = ref_count(lbl, 0);
+
+	if(count && *count)
+		--*count;
+}
+
+int dead_static_referenced(const char *lbl)
+{
+	unsigned *count = ref_count(lbl, 0);
+
+	return count && *count;
+}
+
+int dead_static_candidate(decl *d)
+{
+	if(!cc1_fopt.toplevel_reorder)
+		return 0;
+
+	if(decl_linkage(d) != linkage_internal)
+		return 0;
+
+	/* roots - referenced from outside the code we generate */
+	if(attribute_present(d, attr_used)
+	|| attribute_present(d, attr_constructor)
+	|| attribute_present(d, attr_destructor)
+	|| attribute_present(d, attr_alias))
+	{
+		return 0;
+	}
+
+	if(type_is(d->ref, type_func))
+		return decl_should_emit_code(d);
+
+	return d->bits.var.init.dinit && decl_should_emit_var(d);
+}
+
+void dead_static_drop(decl *d)
+{
+	if(type_is(d->ref, type_func)){
+		dropped.funcs++;
+		dropped.code_bytes += inline_cost_stmt(d->bits.func.code)
+			* DEAD_STATIC_BYTES_PER_COST;
+	}else{
+		dropped.objs++;
+		dropped.data_bytes += decl_size(d);
+	}
+}
+
+void dead_static_stats(FILE *f)
+{
+	fprintf(f, "dead statics: %u functions (~%lu bytes), %u objects (%lu bytes) removed\n",
+			dropped.funcs, dropped.code_bytes,
+			dropped.objs, dropped.data_bytes);
+}
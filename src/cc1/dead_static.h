@@ -0,0 +1,31 @@
+#ifndef DEAD_STATIC_H
+#define DEAD_STATIC_H
+
+#include <stdio.h>
+
+#include "out/forwards.h"
+
+/* -ftoplevel-reorder
+ *
+ * internal-linkage definitions are held back until emitted code or data
+ * refers to their label, and dropped if nothing does. this catches statics
+ * only used by other dropped statics, and those whose every call was inlined
+ */
+
+/* emitted code or data refers to `lbl' */
+void dead_static_ref(const char *lbl);
+
+/* a reference was discarded, e.g. the callee of an inlined call */
+void dead_static_unref(const char *lbl);
+
+int dead_static_referenced(const char *lbl);
+
+/* may `d' be held back until referenced? */
+int dead_static_candidate(struct decl *d);
+
+/* `d' was never referenced and isn't emitted */
+void dead_static_drop(struct decl *d);
+
+void dead_static_stats(FILE *);
+
+#endif
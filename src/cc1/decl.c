@@ -26,7 +26,7 @@
 
 decl *decl_new_w(const where *w)
 {
-	decl *d = umalloc(sizeof *d);
+	decl *d = umalloc_tag(sizeof *d, UALLOC_DECL);
 	memcpy_safe(&d->where, w);
 	return d;
 }
@@ -81,15 +81,19 @@ void decl_free(decl *d)
 
 const char *decl_store_to_str(const enum decl_storage s)
 {
-	static char buf[16]; /* "inline register" is the longest - just a fit */
+	static char buf[32]; /* "_Thread_local inline register" is the longest */
 
 	if(s & STORE_MASK_EXTRA){
 		char *trail_space = NULL;
 		*buf = '\0';
 
-		if((s & STORE_MASK_EXTRA) == store_inline){
-			strcpy(buf, "inline ");
-			trail_space = buf + strlen("inline");
+		if(s & store_thread){
+			strcpy(buf, "_Thread_local ");
+			trail_space = buf + strlen("_Thread_local");
+		}
+		if(s & store_inline){
+			strcat(buf, "inline ");
+			trail_space = buf + strlen(buf) - 1;
 		}
 
 		strcpy(buf + strlen(buf), decl_store_to_str(s & STORE_MASK_STORE));
@@ -102,7 +106,8 @@ const char *decl_store_to_str(const enum decl_storage s)
 
 	switch(s){
 		case store_inline:
-			ICE("inline");
+		case store_thread:
+			ICE("extra storage bits");
 		case store_default:
 			return "";
 		CASE_STR_PREFIX(store, auto);
@@ -249,6 +254,7 @@ enum linkage decl_linkage(decl *d)
 			return linkage_none;
 
 		case store_inline:
+		case store_thread:
 			ICE("bad store");
 
 		case store_default:
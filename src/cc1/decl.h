@@ -13,7 +13,8 @@ enum decl_storage
   store_extern    ,
   store_register  ,
   store_typedef   , /* 5 - next power of two is 8 */
-  store_inline = 1 << 3
+  store_inline = 1 << 3,
+  store_thread = 1 << 4 /* _Thread_local / __thread */
 };
 #define STORE_MASK_STORE 0x00007 /* include all below 4 */
 #define STORE_MASK_EXTRA 0xfff38 /* exclude  ^ */
@@ -63,7 +63,7 @@ expr *expr_new(func_mutate_expr *f,
 		func_dump *f_dump,
 		func_gen *f_gen_style)
 {
-	expr *e = umalloc(sizeof *e);
+	expr *e = umalloc_tag(sizeof *e, UALLOC_EXPR);
 	where_cc1_current(&e->where);
 	expr_mutate(e, f, f_fold, f_str, f_gen, f_dump, f_gen_style);
 	return e;
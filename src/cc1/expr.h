@@ -186,6 +186,16 @@ struct expr
 			builtin_nanf, builtin_nan, builtin_nanl
 		} builtin_nantype;
 
+		/* __builtin_{popcount,clz,ctz,ffs,bswap}* */
+		struct
+		{
+			enum out_bitop op;
+			enum type_primitive arg;
+		} builtin_bitop;
+
+		/* __atomic_* and __sync_* */
+		const struct builtin_atomic *builtin_atomic;
+
 		struct stmt *variadic_setup;
 
 		type *offsetof_ty;
@@ -971,11 +971,21 @@ static void fold_decl_var(decl *d, symtable *stab)
 	int is_static_duration = !stab->parent
 		|| (d->store & STORE_MASK_STORE) == store_static;
 
-	if((d->store & STORE_MASK_EXTRA) == store_inline){
+	if(d->store & store_inline){
 		warn_at_print_error(&d->where, "inline on non-function");
 		fold_had_error = 1;
 	}
 
+	if((d->store & store_thread)
+	&& (STORE_IS_TYPEDEF(d->store)
+		|| (stab->parent && !decl_store_static_or_extern(d->store))))
+	{
+		warn_at_print_error(&d->where, "_Thread_local on %s \"%s\"",
+				STORE_IS_TYPEDEF(d->store) ? "typedef" : "automatic variable",
+				d->spel);
+		fold_had_error = 1;
+	}
+
 	fold_decl_var_vm(d, stab, is_static_duration);
 	fold_decl_var_dinit(d, stab, is_static_duration);
 }
@@ -1188,6 +1198,10 @@ void fold_decl_maybe_member(decl *d, symtable *stab, int su_member)
 	}
 
 	if(type_is(d->ref, type_func)){
+		if(first_fold && (d->store & store_thread)){
+			warn_at_print_error(&d->where, "_Thread_local on function \"%s\"", d->spel);
+			fold_had_error = 1;
+		}
 		if(first_fold)
 			fold_decl_func(d, stab);
 	}else{
@@ -1224,6 +1238,7 @@ void fold_check_decl_complete(decl *d)
 		case store_auto:
 			break;
 		case store_inline:
+		case store_thread:
 			assert(0);
 	}
 
@@ -1359,6 +1374,9 @@ void fold_func_code(stmt *code, where *w, char *sp, symtable *arg_symtab)
 
 	/* finally, check label coherence */
 	symtab_chk_labels(symtab_func_root(arg_symtab));
+
+	if(cc1_fopt.mem2reg)
+		symtab_mark_regvars(symtab_func_root(arg_symtab));
 }
 
 void fold_global_func(decl *func_decl)
@@ -1417,6 +1435,7 @@ void fold_decl_global(decl *d, symtable *stab)
 			break;
 
 		case store_inline: /* allowed, but not accessible via STORE_MASK_STORE */
+		case store_thread:
 			ICE("inline");
 		case store_typedef: /* global typedef */
 			break;
@@ -1601,6 +1620,7 @@ void fold_funcargs(funcargs *fargs, symtable *stab, attribute **attr)
 				case store_extern:
 				case store_typedef:
 				case store_inline:
+				case store_thread:
 				{
 					const char *spel = d->spel, *quote = "\"";
 
@@ -8,6 +8,7 @@
 #include "../util/alloc.h"
 #include "../util/dynarray.h"
 #include "../util/dynmap.h"
+#include "../util/platform.h"
 
 #include "cc1.h"
 #include "sym.h"
@@ -206,6 +207,7 @@ void symtab_check_rw(symtable *tab)
 						case store_extern:
 						case store_typedef:
 						case store_inline:
+						case store_thread:
 							break;
 					}
 				}
@@ -226,6 +228,58 @@ void symtab_check_rw(symtable *tab)
 	}
 }
 
+static int sym_regvar_candidate(sym *s)
+{
+	decl *d = s->decl;
+
+	switch(s->type){
+		case sym_global:
+			return 0;
+		case sym_local:
+			switch((enum decl_storage)(d->store & STORE_MASK_STORE)){
+				case store_register:
+				case store_default:
+				case store_auto:
+					break;
+				default:
+					return 0;
+			}
+			break;
+		case sym_arg:
+			break;
+	}
+
+	if(d->flags & DECL_FLAGS_ADDRESSED)
+		return 0;
+	if(d->spel_asm || attribute_present(d, attr_cleanup))
+		return 0;
+	if(type_qual(d->ref) & (qual_volatile | qual_atomic))
+		return 0;
+	if(type_is_variably_modified(d->ref))
+		return 0;
+	if(!type_is_integral(d->ref) && !type_is_ptr(d->ref))
+		return 0;
+	if(type_size(d->ref, NULL) > platform_word_size())
+		return 0;
+
+	/* a single access gains nothing over the stack slot */
+	return s->nreads + s->nwrites > 1;
+}
+
+void symtab_mark_regvars(symtable *tab)
+{
+	decl **diter;
+
+	symtab_iter_children(tab, symtab_mark_regvars);
+
+	for(diter = symtab_decls(tab); diter && *diter; diter++){
+		decl *const d = *diter;
+
+		if(d->sym)
+			d->sym->regvar = sym_regvar_candidate(d->sym);
+	}
+}
+
 struct ident_loc
 {
 	where *w;
@@ -573,6 +627,37 @@ void symtab_fold_sues(symtable *stab)
 		fold_sue(*sit, stab);
 }
 
+void symtabg_fold_sues(symtable_global *globs)
+{
+	/* global scope only ever has sues appended, so we pick up new ones
+	 * from where we left off and keep a worklist of those not yet laid out
+	 * (i.e. forward declarations), rather than revisiting every sue */
+	struct_union_enum_st **sit, **pending, **keep;
+
+	for(sit = globs->stab.sues ? &globs->stab.sues[globs->sues_seen] : NULL;
+			sit && *sit;
+			sit++, globs->sues_seen++)
+	{
+		if((*sit)->foldprog != SUE_FOLDED_FULLY)
+			dynarray_add(&globs->sues_pending, *sit);
+	}
+
+	pending = globs->sues_pending;
+	if(!pending)
+		return;
+
+	for(sit = keep = pending; *sit; sit++){
+		fold_sue(*sit, &globs->stab);
+
+		if((*sit)->foldprog != SUE_FOLDED_FULLY)
+			*keep++ = *sit;
+	}
+	*keep = NULL;
+
+	if(!*pending)
+		dynarray_free(struct_union_enum_st **, globs->sues_pending, NULL);
+}
+
 void symtab_fold_decls_sues(symtable *stab)
 {
 	symtab_fold_sues(stab);
@@ -2,6 +2,7 @@
 #define SYM_FOLD_H
 
 void symtab_fold_sues(symtable *stab);
+void symtabg_fold_sues(symtable_global *);
 void symtab_fold_decls(symtable *tab);
 
 /* struct layout, check for duplicate decls */
@@ -11,6 +12,9 @@ void symtab_chk_labels(symtable *);
 
 void symtab_check_rw(symtable *);
 
+/* mark scalar locals and arguments which may be kept in registers */
+void symtab_mark_regvars(symtable *);
+
 void symtab_check_static_asserts(symtable *);
 
 void fold_sym_pack_decl(decl *d, unsigned *sz, unsigned *align);
@@ -19,6 +19,7 @@ void fopt_default(struct cc1_fopt *opt)
 	opt->common = 1;
 	opt->const_fold = 1;
 	opt->integral_float_load = 1;
+	opt->jump_tables = 1;
 	opt->omit_frame_pointer = 1;
 	opt->pic = 1;
 	opt->plt = 1;
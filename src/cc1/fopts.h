@@ -27,12 +27,21 @@ X("dump-record-layouts", dump_layouts)
 X("dump-symtab", dump_symtab)
 X("dump-type-tree", dump_type_tree)
 X("dump-decl-sections", dump_decl_sections)
+X("dump-regalloc", dump_regalloc)
 X("print-aka", print_aka)
 X("print-typedefs", print_typedefs)
 X("show-inlined", show_inlined)
 X("show-line", show_line)
 X("show-static-asserts", show_static_asserts)
 X("show-warning-option", show_warning_option)
+X("time-report", time_report)
+X("mem-report", mem_report)
+X("peephole-stats", peephole_stats)
+X("dead-static-stats", dead_static_stats)
+X("stack-reuse-stats", stack_reuse_stats)
+X("loop-opt-stats", loop_opt_stats)
+X("opt-info-vec", opt_info_vec)
+X("opt-info-vec-missed", opt_info_vec_missed)
 ALIAS("diagnostics-show-option", show_warning_option)
 X("track-initial-fname", track_initial_fnam)
 X("verbose-asm", verbose_asm)
@@ -46,15 +55,25 @@ X("data-sections", data_sections)
 X("finite-math-only", finite_math_only)
 X("fold-const-vlas", fold_const_vlas)
 X("function-sections", function_sections)
+X("if-conversion", if_conversion)
 X("inline-functions", inline_functions)
 X("integral-float-load", integral_float_load)
+X("ivopts", ivopts)
+X("jump-tables", jump_tables)
 X("leading-underscore", leading_underscore)
+X("mem2reg", mem2reg)
+X("move-loop-invariants", move_loop_invariants)
 X("omit-frame-pointer", omit_frame_pointer)
+X("optimize-sibling-calls", optimize_sibling_calls)
+X("peephole", peephole)
 EXCLUSIVE("pic", pic, pie)
 ALIAS_EXCLUSIVE("PIC", pic, pie)
 EXCLUSIVE("pie", pie, pic)
 ALIAS_EXCLUSIVE("PIE", pie, pic)
 X("plt", plt)
+X("profile-generate", profile_generate)
+X("profile-use", profile_use)
+X("reorder-blocks", reorder_blocks)
 X("rounding-math", rounding_math)
 X("semantic-interposition", semantic_interposition)
 X("short-enums", short_enums)
@@ -62,4 +81,6 @@ EXCLUSIVE("stack-protector", stack_protector, stack_protector_all)
 EXCLUSIVE("stack-protector-all", stack_protector_all, stack_protector)
 X("symbol-arith", symbol_arith)
 X("thread-jumps", thread_jumps)
+X("toplevel-reorder", toplevel_reorder)
 X("trapv", trapv)
+X("tree-vectorize", tree_vectorize)
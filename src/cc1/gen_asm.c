@@ -23,6 +23,7 @@
 #include "type_is.h"
 #include "out/dbg.h"
 #include "gen_asm.h"
+#include "time_report.h"
 #include "gen_asm_ctors.h"
 #include "out/out.h"
 #include "out/lbl.h"
@@ -39,6 +40,9 @@
 #include "cc1_out.h"
 #include "cc1_target.h"
 #include "sanitize.h"
+#include "profile.h"
+#include "dead_static.h"
+#include "loop.h"
 
 #include "ops/expr_funcall.h"
 
@@ -57,6 +61,10 @@ const out_val *gen_expr(const expr *e, out_ctx *octx)
 	consty k;
 	const out_val *generated;
 
+	/* hoisted out of, or strength-reduced in, an enclosing loop */
+	if((generated = loop_substitute(e, octx)))
+		return generated;
+
 	/* always const_fold functions, i.e. builtins */
 	if(expr_kind(e, funcall) || cc1_fopt.const_fold)
 		const_fold((expr *)e, &k);
@@ -120,6 +128,20 @@ void gen_stmt(const stmt *t, out_ctx *octx)
 	}
 }
 
+const out_val *gen_regvar_alloc(out_ctx *octx, sym *sym)
+{
+	struct cc1_out_ctx *cc1_octx = *cc1_out_ctx(octx);
+
+	if(!sym->regvar)
+		return NULL;
+
+	/* inlined bodies reuse their syms for each inline instance */
+	if(cc1_octx && cc1_octx->inline_.depth)
+		return NULL;
+
+	return out_aalloc_reg(octx, sym->decl->ref);
+}
+
 static void assign_arg_vals(decl **decls, const out_val *argvals[], out_ctx *octx)
 {
 	unsigned i, j;
@@ -128,7 +150,16 @@ static void assign_arg_vals(decl **decls, const out_val *argvals[], out_ctx *oct
 		sym *s = decls[i]->sym;
 
 		if(s && s->type == sym_arg){
-			gen_set_sym_outval(octx, s, argvals[j++]);
+			const out_val *argval = argvals[j++];
+			const out_val *reg = gen_regvar_alloc(octx, s);
+
+			if(reg){
+				out_val_retain(octx, reg);
+				out_store(octx, reg, out_deref(octx, argval));
+				argval = reg;
+			}
+
+			gen_set_sym_outval(octx, s, argval);
 
 			if(cc1_fopt.verbose_asm){
 				out_comment(octx, "arg %s @ %s",
@@ -280,7 +311,9 @@ static void gen_type_and_size(const struct section *section, decl *d)
 
 	asm_out_section(section, ".type %s,@%s\n",
 			spel,
-			is_code ? "function" : "object");
+			is_code ? "function"
+			: d->store & store_thread ? "tls_object"
+			: "object");
 
 	if(is_code)
 		asm_out_section(section, ".size %s, .-%s\n", spel, spel);
@@ -342,6 +375,8 @@ static void gen_asm_global(const struct section *section, decl *d, out_ctx *octx
 
 		gen_profile_mcount(octx);
 
+		profile_func_entry(d, d->bits.func.code, octx);
+
 		allocate_vla_args(octx, arg_symtab);
 		free(argvals), argvals = NULL;
 
@@ -388,7 +423,7 @@ const out_val *gen_call(
 		const out_val **args, out_ctx *octx,
 		const where *loc)
 {
-	const char *whynot;
+	const char *why;
 	const out_val *fn_ret;
 
 	/* (re-)emit line location - function calls are commonly split
@@ -397,34 +432,99 @@ const out_val *gen_call(
 	out_dbg_where(octx, loc);
 
 	fn_ret = inline_func_try_gen(
-			maybe_exp, maybe_dfn, fnval, args, octx, &whynot, loc);
+			maybe_exp, maybe_dfn, fnval, args, octx, &why, loc);
+
+	if(cc1_fopt.show_inlined)
+		note_at(loc, "function %sinlined: %s", fn_ret ? "" : "not ", why);
 
 	if(fn_ret){
-		if(cc1_fopt.show_inlined)
-			note_at(loc, "function inlined");
+		/* fnval came from the callee's label, which is now unused */
+		decl *callee = maybe_exp ? expr_to_declref(maybe_exp, NULL) : maybe_dfn;
 
-	}else{
+		if(callee && callee->sym && type_is(callee->ref, type_func))
+			dead_static_unref(decl_asm_spel(callee));
+	}
+
+	if(!fn_ret){
 		const int always_inline = !!(maybe_exp
 			? expr_attr_present(maybe_exp, attr_always_inline)
 			: attribute_present(maybe_dfn, attr_always_inline));
+		struct cc1_out_ctx *cc1_octx = *cc1_out_ctx(octx);
+		type *fnty = maybe_exp ? maybe_exp->tree_type : type_ptr_to(maybe_dfn->ref);
 
 		if(always_inline){
-			warn_at_print_error(loc, "couldn't always_inline call: %s", whynot);
+			warn_at_print_error(loc, "couldn't always_inline call: %s", why);
 
 			gen_had_error = 1;
 		}
 
-		fn_ret = out_call(octx, fnval, args,
-				maybe_exp ? maybe_exp->tree_type : type_ptr_to(maybe_dfn->ref));
+		/* a `return f(...)` we've been told can take over our frame */
+		fn_ret = NULL;
+		if(maybe_exp && cc1_octx && cc1_octx->sibling_call == maybe_exp)
+			fn_ret = out_call_sibling(octx, fnval, args, fnty);
+
+		if(!fn_ret)
+			fn_ret = out_call(octx, fnval, args, fnty);
+	}
+
+	/* the path to a cold function is rarely taken */
+	if(maybe_exp
+			? expr_attr_present(maybe_exp, attr_cold)
+			: attribute_present(maybe_dfn, attr_cold))
+	{
+		out_blk_cold(octx);
 	}
 
 	return fn_ret;
 }
 
+static enum out_tls_model gen_tls_model(decl *d)
+{
+	enum cc1_tls_model model;
+
+	if(cc1_fopt.pic){
+		/* we may be dlopen()ed, so the variable's
+		 * module isn't known until runtime */
+		model = TLS_MODEL_GLOBAL_DYNAMIC;
+	}else if(decl_linkage(d) == linkage_internal
+	|| (decl_defined(d, 0) && !attribute_present(d, attr_weak)))
+	{
+		/* the executable's own thread-locals are at a link-time offset */
+		model = TLS_MODEL_LOCAL_EXEC;
+	}else{
+		model = TLS_MODEL_INITIAL_EXEC;
+	}
+
+	/* -ftls-model= can only make things faster, as gcc */
+	if(cc1_tls_model > model)
+		model = cc1_tls_model;
+
+	switch(model){
+		case TLS_MODEL_DEFAULT:
+		case TLS_MODEL_GLOBAL_DYNAMIC:
+			break;
+		case TLS_MODEL_INITIAL_EXEC:
+			return OUT_TLS_INITIAL_EXEC;
+		case TLS_MODEL_LOCAL_EXEC:
+			return OUT_TLS_LOCAL_EXEC;
+	}
+	return OUT_TLS_GLOBAL_DYNAMIC;
+}
+
 const out_val *gen_decl_addr(out_ctx *octx, decl *d)
 {
 	const int via_got = decl_needs_GOTPLT(d);
 
+	dead_static_ref(decl_asm_spel(d));
+
+	if(d->store & store_thread){
+		return out_new_tls_lbl(
+				octx,
+				type_ptr_to(d->ref),
+				decl_asm_spel(d),
+				gen_tls_model(d));
+	}
+
 	return out_new_lbl(
 			octx,
 			type_ptr_to(d->ref),
@@ -460,8 +560,11 @@ void gen_asm_emit_type(out_ctx *octx, type *ty)
 static void infer_decl_section(decl *d, struct section *sec)
 {
 	const int is_code = !!type_is(d->ref, type_func);
-	const int is_ro = is_code || type_is_const(d->ref);
-	const enum section_flags flags = (is_code ? SECTION_FLAG_EXECUTABLE : 0) | (is_ro ? SECTION_FLAG_RO : 0);
+	const int is_tls = !!(d->store & store_thread);
+	const int is_ro = is_code || (type_is_const(d->ref) && !is_tls);
+	const enum section_flags flags = (is_code ? SECTION_FLAG_EXECUTABLE : 0)
+		| (is_ro ? SECTION_FLAG_RO : 0)
+		| (is_tls ? SECTION_FLAG_TLS : 0);
 	attribute *attr;
 
 	if((attr = attribute_present(d, attr_section))){
@@ -470,8 +573,25 @@ static void infer_decl_section(decl *d, struct section *sec)
 	}
 
 	if(type_is(d->ref, type_func)){
+		/* .text.hot / .text.unlikely, grouped together by the linker */
+		const int hotness = profile_func_hotness(d);
+		const char *temperature = attribute_present(d, attr_cold) ? "unlikely"
+			: attribute_present(d, attr_hot) ? "hot"
+			: hotness < 0 ? "unlikely"
+			: hotness > 0 ? "hot"
+			: NULL;
+
 		if(cc1_fopt.function_sections){
-			SECTION_FROM_FUNCDECL(sec, decl_asm_spel(d), flags);
+			SECTION_FROM_FUNCDECL(sec,
+					temperature
+					? ustrprintf("%s.%s", temperature, decl_asm_spel(d))
+					: decl_asm_spel(d),
+					flags);
+			return;
+		}
+
+		if(temperature){
+			SECTION_FROM_FUNCDECL(sec, temperature, flags);
 			return;
 		}
 
@@ -479,6 +599,15 @@ static void infer_decl_section(decl *d, struct section *sec)
 		return;
 	}
 
+	/* thread-locals ignore -fdata-sections, the per-decl name would lose the TLS prefix */
+	if(is_tls){
+		if(!d->bits.var.init.dinit || decl_init_is_zero(d->bits.var.init.dinit))
+			SECTION_FROM_BUILTIN(sec, SECTION_TBSS, flags);
+		else
+			SECTION_FROM_BUILTIN(sec, SECTION_TDATA, flags);
+		return;
+	}
+
 	if(cc1_fopt.data_sections){
 		SECTION_FROM_DATADECL(sec, decl_asm_spel(d), flags);
 		return;
@@ -506,6 +635,18 @@ static void infer_decl_section(decl *d, struct section *sec)
 	SECTION_FROM_BUILTIN(sec, SECTION_DATA, flags);
 }
 
+static void gen_asm_note_spel(struct cc1_out_ctx *cc1_octx, decl *d)
+{
+	if(!cc1_octx->spel_to_fndecl){
+		cc1_octx->spel_to_fndecl = dynmap_new(
+				const char *, strcmp, dynmap_strhash);
+	}
+	(void)dynmap_set(
+			const char *, decl *,
+			cc1_octx->spel_to_fndecl,
+			decl_asm_spel(d), d);
+}
+
 void gen_asm_global_w_store(decl *d, int emit_tenatives, out_ctx *octx)
 {
 	struct section section;
@@ -529,17 +670,11 @@ void gen_asm_global_w_store(decl *d, int emit_tenatives, out_ctx *octx)
 	if(!decl_asm_spel(d))
 		return; /* struct A { ... }; */
 
-	if(!cc1_octx->spel_to_fndecl){
-		cc1_octx->spel_to_fndecl = dynmap_new(
-				const char *, strcmp, dynmap_strhash);
-	}
-	(void)dynmap_set(
-			const char *, decl *,
-			cc1_octx->spel_to_fndecl,
-			decl_asm_spel(d), d);
+	gen_asm_note_spel(cc1_octx, d);
 
 	switch((enum decl_storage)(d->store & STORE_MASK_STORE)){
 		case store_inline:
+		case store_thread:
 		case store_auto:
 		case store_register:
 			ICE("%s storage on global %s",
@@ -576,6 +711,7 @@ void gen_asm_global_w_store(decl *d, int emit_tenatives, out_ctx *octx)
 	if((attr = attribute_present(d, attr_alias))){
 		assert(attr->type == attr_alias);
 		assert(!decl_defined(d, 0));
+		dead_static_ref(decl_asm_spel(attr->bits.alias));
 		asm_declare_alias(&section, d, attr->bits.alias);
 		emit_visibility = 1;
 	}
@@ -622,19 +758,62 @@ out:
 	cc1_octx->current_decl = old_decl;
 }
 
+static void gen_asm_deferred(decl **deferred, out_ctx *octx)
+{
+	struct cc1_out_ctx *cc1_octx = cc1_out_ctx_or_new(octx);
+	int progress;
+	decl **i;
+
+	/* emitting one may reference others */
+	do{
+		progress = 0;
+
+		for(i = deferred; i && *i; i++){
+			decl *d = *i;
+
+			if(cc1_octx->generated_decls
+			&& dynmap_exists(decl *, cc1_octx->generated_decls, d))
+			{
+				continue;
+			}
+
+			if(dead_static_referenced(decl_asm_spel(d))){
+				gen_asm_global_w_store(d, 0, octx);
+				progress = 1;
+			}
+		}
+	}while(progress);
+
+	for(i = deferred; i && *i; i++){
+		decl *d = *i;
+
+		if(!cc1_octx->generated_decls
+		|| !dynmap_exists(decl *, cc1_octx->generated_decls, d))
+		{
+			dead_static_drop(d);
+		}
+	}
+}
+
 void gen_asm(
 		symtable_global *globs,
 		const char *fname, const char *compdir,
 		struct out_dbg_filelist **pfilelist,
 		const char *producer)
 {
-	decl **inits = NULL, **terms = NULL;
+	decl **inits = NULL, **terms = NULL, **deferred = NULL;
 	decl **diter;
 	struct symtable_gasm **iasm = globs->gasms;
 	out_ctx *octx = out_ctx_new();
+	/* toplevel asm may refer to anything */
+	const int may_defer = !iasm;
+
+	time_report_push(TIME_GEN);
 
 	*pfilelist = NULL;
 
+	profile_begin(fname);
+
 	if(cc1_gdebug != DEBUG_OFF)
 		out_dbg_begin(octx, &octx->dbg.file_head, fname, compdir, cc1_std, producer);
 
@@ -648,7 +827,16 @@ void gen_asm(
 				iasm = NULL;
 		}
 
-		gen_asm_global_w_store(d, 0, octx);
+		if(may_defer
+		&& dead_static_candidate(d)
+		&& !dead_static_referenced(decl_asm_spel(d)))
+		{
+			/* still resolvable for inlining through function pointers */
+			gen_asm_note_spel(cc1_out_ctx_or_new(octx), d);
+			dynarray_add(&deferred, d);
+		}else{
+			gen_asm_global_w_store(d, 0, octx);
+		}
 
 		if(type_is(d->ref, type_func) && d->bits.func.code){
 			if(attribute_present(d, attr_constructor))
@@ -661,8 +849,14 @@ void gen_asm(
 	for(; iasm && *iasm; ++iasm)
 		gen_gasm((*iasm)->asm_str);
 
+	gen_asm_deferred(deferred, octx);
+	dynarray_free(decl **, deferred, NULL);
+
+	/* after all code, so only referenced literals are emitted */
 	gen_stringlits(globs->literals);
 
+	profile_end();
+
 	gen_inits_terms(inits, terms);
 	dynarray_free(decl **, inits, NULL);
 	dynarray_free(decl **, terms, NULL);
@@ -675,4 +869,6 @@ void gen_asm(
 
 	cc1_out_ctx_free(octx);
 	out_ctx_end(octx);
+
+	time_report_pop(TIME_GEN);
 }
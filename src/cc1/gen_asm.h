@@ -8,6 +8,9 @@ void gen_asm_extern(decl *d, out_ctx *octx);
 
 void gen_set_sym_outval(out_ctx *octx, sym *sym, const out_val *v);
 
+/* a register home for sym, if it's a -fmem2reg candidate and one is free */
+const out_val *gen_regvar_alloc(out_ctx *octx, sym *sym);
+
 void gen_vla_arg_sideeffects(decl *d, out_ctx *octx);
 
 #ifdef DBG_H
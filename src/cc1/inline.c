@@ -6,6 +6,7 @@
 #include "../util/dynarray.h"
 #include "../util/warn.h"
 #include "../util/alloc.h"
+#include "../util/str.h"
 
 #include "expr.h"
 #include "stmt.h"
@@ -22,14 +23,32 @@
 #include "funcargs.h"
 #include "type_is.h"
 
+/* cost model */
+#include "ops/expr_funcall.h"
+#include "ops/expr_sizeof.h"
+#include "ops/expr_cast.h"
+#include "ops/expr_identifier.h"
+#include "ops/expr_val.h"
+
 #include "inline.h"
 
 #include "cc1_out_ctx.h"
+#include "time_report.h"
+#include "profile.h"
 
 #define INLINE_DEPTH_MAX 5
 #define INLINE_MAX_STACK_BYTES 128
 #define INLINE_VLA_COST 64
-#define INLINE_MAX_STMTS 4
+
+/* costs are in rough instruction units: one per statement or expression node */
+#define INLINE_LIMIT_DEFAULT 16
+#define INLINE_CALL_COST 3 /* plus one per argument - saved by inlining */
+#define INLINE_LOOP_COST 8 /* test, back-edge and setup - little is saved by inlining a loop */
+#define INLINE_CONST_ARG_BONUS 4 /* per constant argument, which may fold */
+#define INLINE_LOOP_BONUS 8 /* call sites in loops pay their overhead repeatedly */
+#define INLINE_HOT_SCALE 2 /* -fprofile-use: limit multiplier for hot callees */
+#define INLINE_GROWTH_MIN 200 /* a function may always grow by this much... */
+#define INLINE_GROWTH_SCALE 2 /* ...or this multiple of its own size */
 
 struct inline_outs
 {
@@ -37,8 +56,12 @@ struct inline_outs
 	symtable *arg_symtab;
 	stmt *fncode;
 	struct cc1_out_ctx *cc1_octx;
+	int sibling;
+	unsigned cost; /* size of the inlined body */
 };
 
+unsigned cc1_inline_limit = INLINE_LIMIT_DEFAULT;
+
 struct inline_sym_map
 {
 	const out_val *sym_outval;
@@ -119,7 +142,7 @@ static void inline_sym_map_save(
 		pushed_vals[i].sym_outval = sym_outval(s);
 
 		/* if the symbol is addressed we need to spill it */
-		if(s->nwrites || out_is_nonconst_temporary(args[i]) || (type_qual(s->decl->ref) & qual_volatile)){
+		if(s->nwrites || out_is_nonconst_temporary(args[i]) || (type_qual(s->decl->ref) & (qual_volatile | qual_atomic))){
 			/* registers can't persist across inlining in the case of
 			 * function calls, etc etc - need to spill, hence
 			 * non-const temporary */
@@ -208,6 +231,7 @@ static const out_val *gen_inline_func(
 
 	inline_vars_push(cc1_octx, &saved, &nested_label_map);
 	cc1_octx->inline_.phi = out_blk_new(octx, "inline_phi");
+	cc1_octx->inline_.sibling = iouts->sibling;
 
 	if(cc1_gdebug != DEBUG_OFF){
 		struct out_dbg_lbl *dbg_startlbl;
@@ -230,6 +254,8 @@ static const out_val *gen_inline_func(
 
 	inline_sym_map_save(arg_symtab, args, pushed_vals, cc1_octx, octx);
 
+	profile_func_entry(iouts->fndecl, func_code, octx);
+
 	gen_func_stmt(func_code, octx);
 
 	inline_sym_map_restore(arg_symtab, pushed_vals, cc1_octx, octx);
@@ -264,43 +290,210 @@ void inline_ret_add(out_ctx *octx, const out_val *v)
 		dynarray_add(&cc1_octx->inline_.rets, mergee);
 }
 
+static unsigned inline_cost_expr(expr *e)
+{
+	unsigned cost;
+	expr **i;
+
+	if(!e)
+		return 0;
+
+	if(expr_kind(e, sizeof))
+		return 1; /* operand isn't evaluated */
+
+	/* operands and implicit conversions are mostly free */
+	cost = (expr_kind(e, identifier) || expr_kind(e, val)
+			|| (expr_kind(e, cast) && e->expr_cast_implicit) ? 0 : 1)
+		+ inline_cost_expr(e->lhs)
+		+ inline_cost_expr(e->rhs)
+		+ inline_cost_expr(e->expr);
+
+	if(expr_kind(e, funcall)){
+		cost += INLINE_CALL_COST;
+		for(i = e->funcargs; i && *i; i++)
+			cost += 1 + inline_cost_expr(*i);
+	}
+
+	if(e->code)
+		cost += inline_cost_stmt(e->code);
+
+	return cost;
+}
+
+static unsigned inline_cost_decls(symtable *stab)
+{
+	unsigned cost = 0;
+	decl **i;
+
+	for(i = stab ? symtab_decls(stab) : NULL; i && *i; i++){
+		decl *d = *i;
+
+		if(!type_is(d->ref, type_func) && d->bits.var.init.expr)
+			cost += 1 + inline_cost_expr(d->bits.var.init.expr);
+	}
+
+	return cost;
+}
+
+static void inline_cost_enter(stmt *s, int *stop, int *descend, void *ctx)
+{
+	unsigned *cost = ctx;
+
+	(void)stop;
+	(void)descend;
+
+	if(stmt_kind(s, code)){
+		*cost += inline_cost_decls(s->symtab);
+		return;
+	}
+	if(stmt_kind(s, noop))
+		return;
+	if(stmt_kind(s, case) || stmt_kind(s, case_range) || stmt_kind(s, default)){
+		*cost += 1; /* a compare or table entry */
+		return;
+	}
+
+	*cost += 1 + inline_cost_expr(s->expr) + inline_cost_expr(s->expr2);
+
+	if(stmt_kind(s, for) || stmt_kind(s, while) || stmt_kind(s, do))
+		*cost += INLINE_LOOP_COST;
+
+	if(s->flow){
+		*cost += inline_cost_decls(s->flow->for_init_symtab)
+			+ inline_cost_expr(s->flow->for_init)
+			+ inline_cost_expr(s->flow->for_while)
+			+ inline_cost_expr(s->flow->for_inc);
+	}
+}
+
+unsigned inline_cost_stmt(stmt *code)
+{
+	unsigned cost = 0;
+	stmt_walk(code, inline_cost_enter, NULL, &cost);
+	return cost;
+}
+
+static int inline_single_caller(decl *fndecl)
+{
+	unsigned uses = 0;
+	decl *d;
+
+	if(decl_linkage(fndecl) != linkage_internal)
+		return 0;
+
+	/* calls and address-takes, through any prototype */
+	for(d = decl_impl(fndecl, DECL_INCLUDE_ALIAS); d; d = d->proto)
+		if(d->sym)
+			uses += d->sym->nreads;
+
+	return uses == 1;
+}
+
+static unsigned inline_growth_budget(struct cc1_out_ctx *cc1_octx)
+{
+	decl *caller = cc1_octx->current_decl;
+
+	if(cc1_octx->inline_budget.fn != caller){
+		/* first inline decision in this function */
+		unsigned size = inline_cost_stmt(caller->bits.func.code);
+
+		cc1_octx->inline_budget.fn = caller;
+		cc1_octx->inline_budget.growth = 0;
+		cc1_octx->inline_budget.max = size * INLINE_GROWTH_SCALE;
+		if(cc1_octx->inline_budget.max < INLINE_GROWTH_MIN)
+			cc1_octx->inline_budget.max = INLINE_GROWTH_MIN;
+	}
+
+	if(cc1_octx->inline_budget.growth >= cc1_octx->inline_budget.max)
+		return 0;
+	return cc1_octx->inline_budget.max - cc1_octx->inline_budget.growth;
+}
+
 static int heuristic_should_inline(
-		decl *fndecl, stmt *fncode, symtable *symtab, out_ctx *octx)
+		struct inline_outs *iouts,
+		const out_val **args, size_t nargs,
+		out_ctx *octx, const char **why)
 {
+	static char reason[128];
 	struct cc1_out_ctx *cc1_octx = cc1_out_ctx_or_new(octx);
-	unsigned nstmts = 0;
-	unsigned new_stack;
+	decl *const fndecl = iouts->fndecl;
+	unsigned new_stack, limit, budget, bonus, nconst = 0;
+	int hotness, single_caller, in_loop;
+	size_t i;
+
+	iouts->cost = inline_cost_stmt(iouts->fncode);
 
-	if(attribute_present(fndecl, attr_always_inline))
+	if(attribute_present(fndecl, attr_always_inline)){
+		*why = "function has always_inline attribute";
 		return 1;
+	}
 
 	assert(cc1_octx->current_decl);
-	if(attribute_present(cc1_octx->current_decl, attr_flatten))
+	if(attribute_present(cc1_octx->current_decl, attr_flatten)){
+		*why = "caller has flatten attribute";
 		return 1;
+	}
 
 	/* as with clang and gcc, -fno-inline-functions affects just the heuristic
 	 * __attribute((always_inline / flatten)) overrides it */
-	if(!cc1_fopt.inline_functions)
+	if(!cc1_fopt.inline_functions){
+		*why = "inlining disabled";
 		return 0;
+	}
 
-	/* if it's marked inline, inline it
-	 * if there's more than X stack space, deny
-	 * if there's too many statements, deny
-	 */
-	if(fndecl->store & store_inline)
+	if(fndecl->store & store_inline){
+		*why = "function declared inline";
 		return 1;
+	}
 
-	new_stack = symtab_decl_bytes(symtab, INLINE_VLA_COST, 0, NULL)
+	/* with -fprofile-use, never-run functions aren't worth the growth,
+	 * and hot ones are allowed more */
+	hotness = profile_func_hotness(fndecl);
+	if(hotness < 0){
+		*why = "function never executed in profile";
+		return 0;
+	}
+
+	new_stack = symtab_decl_bytes(iouts->arg_symtab, INLINE_VLA_COST, 0, NULL)
 		+ out_current_stack(octx);
 
-	if(new_stack > INLINE_MAX_STACK_BYTES)
+	if(new_stack > INLINE_MAX_STACK_BYTES){
+		xsnprintf(reason, sizeof reason,
+				"stack usage %u exceeds %u bytes",
+				new_stack, INLINE_MAX_STACK_BYTES);
+		*why = reason;
 		return 0;
+	}
+
+	for(i = 0; i < nargs; i++)
+		if(out_is_const(args[i]))
+			nconst++;
 
-	stmt_walk(fncode, stmts_count, NULL, &nstmts);
-	if(nstmts > INLINE_MAX_STMTS)
+	single_caller = inline_single_caller(fndecl);
+	in_loop = cc1_octx->loop_depth > 0;
+
+	bonus = INLINE_CALL_COST + nargs
+		+ nconst * INLINE_CONST_ARG_BONUS
+		+ (in_loop ? INLINE_LOOP_BONUS : 0)
+		/* the out-of-line copy can be dropped */
+		+ (single_caller ? iouts->cost / 2 : 0);
+
+	limit = cc1_inline_limit * (hotness > 0 ? INLINE_HOT_SCALE : 1);
+	budget = inline_growth_budget(cc1_octx);
+
+	xsnprintf(reason, sizeof reason,
+			"cost %u, bonus %u%s%s%s, limit %u, growth budget %u",
+			iouts->cost, bonus,
+			nconst ? " (constant args)" : "",
+			single_caller ? " (single caller)" : "",
+			in_loop ? " (in loop)" : "",
+			limit, budget);
+	*why = reason;
+
+	if(iouts->cost > budget)
 		return 0;
 
-	return 1;
+	return iouts->cost <= limit + bonus;
 }
 
 static stmt *try_resolve_val_to_func(
@@ -330,12 +523,14 @@ static stmt *try_resolve_val_to_func(
 	return NULL;
 }
 
-ucc_nonnull((3, 4, 5))
+ucc_nonnull((3, 4, 5, 8))
 static const char *check_and_ret_inline(
 		expr *maybe_call_expr, decl *maybe_decl,
 		out_ctx *octx,
 		const out_val *fnval,
-		struct inline_outs *iouts, size_t nargs)
+		struct inline_outs *iouts,
+		const out_val **args, size_t nargs,
+		const char **reason)
 {
 	funcargs *fargs;
 	const char *why;
@@ -417,9 +612,8 @@ static const char *check_and_ret_inline(
 		return "recursion too deep";
 	}
 
-	if(!heuristic_should_inline(iouts->fndecl, iouts->fncode, iouts->arg_symtab, octx)){
-		return "heuristic denied";
-	}
+	if(!heuristic_should_inline(iouts, args, nargs, octx, reason))
+		return *reason;
 
 	return NULL;
 }
@@ -429,23 +623,35 @@ const out_val *inline_func_try_gen(
 		const out_val *fnval,
 		const out_val **args,
 		out_ctx *octx,
-		const char **whynot, const where *call_loc)
+		const char **why, const where *call_loc)
 {
 	const out_val *inlined_ret;
 	struct inline_outs iouts = { 0 };
+	const char *whynot;
 
-	*whynot = check_and_ret_inline(
+	whynot = check_and_ret_inline(
 			maybe_call_expr, maybe_decl, octx, fnval,
-			&iouts, dynarray_count(args));
+			&iouts, args, dynarray_count(args), why);
 
-	if(*whynot){
+	if(whynot){
+		*why = whynot;
 		if(cc1_fopt.verbose_asm)
-			out_comment(octx, "can't inline call: %s", *whynot);
+			out_comment(octx, "can't inline call: %s", whynot);
 		if(iouts.fndecl && iouts.fndecl->store & store_inline)
-			cc1_warn_at(call_loc, inline_failed, "can't inline call: %s", *whynot);
+			cc1_warn_at(call_loc, inline_failed, "can't inline call: %s", whynot);
 		return NULL;
 	}
 
+	if(cc1_fopt.verbose_asm)
+		out_comment(octx, "inlining call: %s", *why);
+
+	iouts.cc1_octx->inline_budget.growth += iouts.cost;
+
+	/* inlined in place of a sibling call - its own tail calls can jump */
+	iouts.sibling = maybe_call_expr
+		&& iouts.cc1_octx->sibling_call == maybe_call_expr;
+
+	time_report_push(TIME_INLINE);
 	iouts.cc1_octx->inline_.depth++;
 	{
 		/* we don't use the call expr/value */
@@ -458,6 +664,7 @@ const out_val *inline_func_try_gen(
 				octx, call_loc);
 	}
 	iouts.cc1_octx->inline_.depth--;
+	time_report_pop(TIME_INLINE);
 
 	return inlined_ret;
 }
@@ -3,13 +3,19 @@
 
 #include "out/forwards.h"
 
+extern unsigned cc1_inline_limit; /* -finline-limit= */
+
+/* size of code in rough instruction units, as used by the inliner */
+unsigned inline_cost_stmt(stmt *);
+
+/* *why is set to the reason for the decision, whether inlined or not */
 ucc_nonnull((3, 4, 5, 6))
 const out_val *inline_func_try_gen(
 		expr *maybe_call_expr, decl *maybe_decl,
 		const out_val *fnval,
 		const out_val **args,
 		out_ctx *octx,
-		const char **whynot, const where *call_loc);
+		const char **why, const where *call_loc);
 
 void inline_ret_add(out_ctx *octx, const out_val *v);
 
@@ -0,0 +1,1805 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+#include "../util/alloc.h"
+#include "../util/dynarray.h"
+#include "../util/dynmap.h"
+#include "../util/platform.h"
+#include "../util/macros.h"
+#include "../util/warn.h"
+
+#include "cc1.h"
+#include "fopt.h"
+#include "expr.h"
+#include "stmt.h"
+#include "decl.h"
+#include "sym.h"
+#include "type_is.h"
+#include "type_nav.h"
+#include "gen_asm.h"
+#include "cc1_out_ctx.h"
+#include "out/out.h"
+
+#include "ops/expr__Generic.h"
+#include "ops/expr_addr.h"
+#include "ops/expr_assign.h"
+#include "ops/expr_assign_compound.h"
+#include "ops/expr_block.h"
+#include "ops/expr_cast.h"
+#include "ops/expr_comma.h"
+#include "ops/expr_compound_lit.h"
+#include "ops/expr_deref.h"
+#include "ops/expr_funcall.h"
+#include "ops/expr_identifier.h"
+#include "ops/expr_if.h"
+#include "ops/expr_op.h"
+#include "ops/expr_sizeof.h"
+#include "ops/expr_string.h"
+#include "ops/expr_struct.h"
+#include "ops/expr_val.h"
+#include "ops/stmt_case.h"
+#include "ops/stmt_case_range.h"
+#include "ops/stmt_code.h"
+#include "ops/stmt_default.h"
+#include "ops/stmt_expr.h"
+#include "ops/stmt_for.h"
+#include "ops/stmt_label.h"
+#include "ops/stmt_noop.h"
+#include "ops/stmt_switch.h"
+#include "ops/stmt_while.h"
+#include "ops/__builtin.h"
+
+#include "loop.h"
+
+/* callee-save registers we take per loop, leaving the rest for its locals */
+#define LOOP_MAX_REGS 4
+/* below this, a value recomputed each iteration beats a reload from the stack */
+#define LOOP_STACK_COST 3
+#define LOOP_CALL_COST 8
+
+struct loop_subst
+{
+	const out_val *val; /* lvalue holding the precomputed value */
+	unsigned inline_depth; /* inlined copies of the expression aren't replaced */
+	struct loop_subst *shadowed;
+};
+
+struct loop_cand
+{
+	expr *e;
+	struct loop_cand *same; /* shares the value of an earlier candidate */
+	long step; /* induction pointers: elements per increment */
+	const out_val *val;
+	struct loop_subst *subst;
+};
+
+struct loop
+{
+	const stmt *s;
+	struct loop_cand **ivs, **hoists;
+	struct loop *outer;
+};
+
+/* what a loop's code changes */
+struct loop_scan
+{
+	sym **written; /* once per direct write or declaration */
+	int stores; /* writes through memory */
+	int calls; /* calls to other than pure/const functions */
+	int labels; /* jumps may bypass the preheader */
+	unsigned switch_depth;
+	unsigned local_regvars;
+};
+
+static struct
+{
+	unsigned loops, hoisted, ivs, vectorised;
+} stats;
+
+static struct loop *innermost;
+
+static unsigned loop_ptr_hash(const void *p)
+{
+	return (unsigned)(intptr_t)p ^ (unsigned)((intptr_t)p >> 16);
+}
+
+/* --- scanning */
+
+static void scan_expr(struct loop_scan *, expr *);
+static stmt_walk_enter scan_stmt_enter;
+static stmt_walk_leave scan_stmt_leave;
+
+static void scan_written(struct loop_scan *scan, sym *s)
+{
+	if(s)
+		dynarray_add(&scan->written, s);
+}
+
+static void scan_decls(struct loop_scan *scan, symtable *stab)
+{
+	decl **i;
+
+	for(i = stab ? symtab_decls(stab) : NULL; i && *i; i++){
+		decl *d = *i;
+
+		if(!d->sym || type_is(d->ref, type_func))
+			continue;
+
+		scan_written(scan, d->sym);
+		if(d->sym->regvar)
+			scan->local_regvars++;
+
+		scan_expr(scan, d->bits.var.init.expr);
+	}
+}
+
+static int call_is_pure(expr *e, int *reads_memory)
+{
+	*reads_memory = 1;
+
+	if(e->f_gen != gen_expr_funcall)
+		return 0; /* most builtins have their own effects */
+
+	if(builtin_is_pure(e))
+		return 1;
+
+	if(func_or_builtin_attr_present(e, attr_const)){
+		*reads_memory = 0;
+		return 1;
+	}
+
+	return !!func_or_builtin_attr_present(e, attr_pure);
+}
+
+static void scan_expr(struct loop_scan *scan, expr *e)
+{
+	expr **i;
+
+	if(!e)
+		return;
+
+	if(expr_kind(e, assign) || expr_kind(e, assign_compound)){
+		expr *target = e->lhs;
+
+		if(expr_kind(target, identifier) && target->bits.ident.type == IDENT_NORM)
+			scan_written(scan, target->bits.ident.bits.ident.sym);
+		else
+			scan->stores = 1;
+
+	}else if(expr_kind(e, funcall)){
+		int reads_memory;
+
+		if(!call_is_pure(e, &reads_memory))
+			scan->calls = scan->stores = 1;
+
+	}else if(expr_kind(e, block) || expr_kind(e, compound_lit)){
+		scan->calls = scan->stores = 1;
+
+	}else if(expr_kind(e, _Generic) && e->bits.generic.chosen){
+		scan_expr(scan, e->bits.generic.chosen->e);
+	}
+
+	if(!expr_kind(e, struct)) /* rhs is the member name */
+		scan_expr(scan, e->rhs);
+	scan_expr(scan, e->lhs);
+	scan_expr(scan, e->expr);
+
+	for(i = e->funcargs; i && *i; i++)
+		scan_expr(scan, *i);
+
+	if(e->code)
+		stmt_walk(e->code, scan_stmt_enter, scan_stmt_leave, scan);
+}
+
+static void scan_stmt_enter(stmt *s, int *stop, int *descend, void *ctx)
+{
+	struct loop_scan *scan = ctx;
+
+	(void)stop;
+	(void)descend;
+
+	if(stmt_kind(s, switch))
+		scan->switch_depth++;
+
+	if(stmt_kind(s, label)
+	|| (!scan->switch_depth
+		&& (stmt_kind(s, case) || stmt_kind(s, case_range) || stmt_kind(s, default))))
+	{
+		scan->labels = 1;
+	}
+
+	if(stmt_kind(s, code))
+		scan_decls(scan, s->symtab);
+
+	scan_expr(scan, s->expr);
+	scan_expr(scan, s->expr2);
+
+	if(s->flow){
+		scan_decls(scan, s->flow->for_init_symtab);
+		scan_expr(scan, s->flow->for_init);
+		scan_expr(scan, s->flow->for_while);
+		scan_expr(scan, s->flow->for_inc);
+	}
+}
+
+static void scan_stmt_leave(stmt *s, void *ctx)
+{
+	struct loop_scan *scan = ctx;
+
+	if(stmt_kind(s, switch))
+		scan->switch_depth--;
+}
+
+static void scan_loop(struct loop_scan *scan, const stmt *s)
+{
+	memset(scan, 0, sizeof *scan);
+
+	if(stmt_kind(s, while)){
+		/* the condition's scope is entered each iteration */
+		scan_decls(scan, s->symtab);
+		if(s->flow && s->flow->for_init_symtab != s->symtab)
+			scan_decls(scan, s->flow->for_init_symtab);
+		scan_expr(scan, s->expr);
+	}else{
+		scan_expr(scan, s->flow->for_while);
+		scan_expr(scan, s->flow->for_inc);
+	}
+
+	stmt_walk(s->lhs, scan_stmt_enter, scan_stmt_leave, scan);
+}
+
+static unsigned scan_writes(struct loop_scan *scan, sym *s)
+{
+	unsigned n = 0;
+	sym **i;
+
+	for(i = scan->written; i && *i; i++)
+		if(*i == s)
+			n++;
+
+	return n;
+}
+
+/* --- invariance */
+
+static int invariant(struct loop_scan *, expr *, int may_trap);
+
+static int sym_in_memory(sym *s)
+{
+	decl *d = s->decl;
+
+	switch((enum decl_storage)(d->store & STORE_MASK_STORE)){
+		case store_static:
+		case store_extern:
+		case store_thread:
+			return 1;
+		default:
+			break;
+	}
+
+	return s->type == sym_global
+		|| (d->flags & DECL_FLAGS_ADDRESSED)
+		|| !(type_is_integral(d->ref) || type_is_ptr(d->ref) || type_is_floating(d->ref));
+}
+
+static int memory_unchanged(struct loop_scan *scan)
+{
+	return !scan->stores && !scan->calls;
+}
+
+static int sym_value_invariant(struct loop_scan *scan, sym *s)
+{
+	if(!s || scan_writes(scan, s))
+		return 0;
+
+	if(type_qual(s->decl->ref) & (qual_volatile | qual_atomic))
+		return 0;
+
+	return !sym_in_memory(s) || memory_unchanged(scan);
+}
+
+/* the address an lvalue designates doesn't change */
+static int addr_invariant(struct loop_scan *scan, expr *lval, int may_trap)
+{
+	/* variables declared in the loop have no storage before it */
+	if(expr_kind(lval, identifier))
+		return lval->bits.ident.type == IDENT_NORM
+			&& !scan_writes(scan, lval->bits.ident.bits.ident.sym)
+			&& !type_is_variably_modified(lval->tree_type);
+
+	if(expr_kind(lval, deref))
+		return invariant(scan, expr_deref_what(lval), may_trap);
+
+	if(expr_kind(lval, struct))
+		return lval->expr_is_st_dot
+			? addr_invariant(scan, lval->lhs, may_trap)
+			: invariant(scan, lval->lhs, may_trap);
+
+	if(expr_kind(lval, str))
+		return 1;
+
+	return 0;
+}
+
+/* the value an lvalue holds doesn't change */
+static int lval_invariant(struct loop_scan *scan, expr *lval, int may_trap)
+{
+	if(type_qual(lval->tree_type) & (qual_volatile | qual_atomic))
+		return 0;
+
+	if(expr_kind(lval, identifier)){
+		return lval->bits.ident.type == IDENT_NORM
+			&& sym_value_invariant(scan, lval->bits.ident.bits.ident.sym);
+	}
+
+	if(expr_kind(lval, struct) && lval->expr_is_st_dot)
+		return lval_invariant(scan, lval->lhs, may_trap)
+			&& memory_unchanged(scan);
+
+	/* a read through a pointer may fault where the loop wouldn't have run it */
+	if(!may_trap || !memory_unchanged(scan))
+		return 0;
+
+	return addr_invariant(scan, lval, may_trap);
+}
+
+static int const_nonzero(expr *e)
+{
+	consty k;
+
+	const_fold(e, &k);
+
+	return k.type == CONST_NUM
+		&& K_INTEGRAL(k.bits.num)
+		&& k.bits.num.val.i != 0
+		&& (sintegral_t)k.bits.num.val.i != -1;
+}
+
+static int invariant(struct loop_scan *scan, expr *e, int may_trap)
+{
+	consty k;
+	expr **i;
+
+	if(!e)
+		return 1;
+
+	const_fold(e, &k);
+	if(CONST_AT_COMPILE_TIME(k.type))
+		return 1;
+
+	if(expr_kind(e, val) || expr_kind(e, str))
+		return 1;
+
+	if(expr_kind(e, identifier) || expr_kind(e, struct) || expr_kind(e, deref))
+		return addr_invariant(scan, e, may_trap);
+
+	if(expr_kind(e, addr))
+		return expr_addr_target(e) && addr_invariant(scan, expr_addr_target(e), may_trap);
+
+	if(expr_kind(e, sizeof))
+		return 0; /* non-constant: a vla */
+
+	if(expr_kind(e, cast)){
+		expr *sub = expr_cast_child(e);
+
+		if(!expr_cast_is_lval2rval(e))
+			return invariant(scan, sub, may_trap);
+
+		/* arrays and functions decay to their address */
+		if(type_is_array(sub->tree_type) || type_is(sub->tree_type, type_func))
+			return addr_invariant(scan, sub, may_trap);
+
+		return lval_invariant(scan, sub, may_trap);
+	}
+
+	if(expr_kind(e, op)){
+		switch(e->bits.op.op){
+			case op_andsc:
+			case op_orsc:
+				return invariant(scan, e->lhs, may_trap)
+					&& invariant(scan, e->rhs, 0);
+
+			case op_divide:
+			case op_modulus:
+				if(!may_trap && !const_nonzero(e->rhs))
+					return 0;
+				break;
+
+			default:
+				break;
+		}
+
+		return invariant(scan, e->lhs, may_trap)
+			&& invariant(scan, e->rhs, may_trap);
+	}
+
+	if(expr_kind(e, if)){
+		return invariant(scan, e->expr, may_trap)
+			&& invariant(scan, e->lhs, 0)
+			&& invariant(scan, e->rhs, 0);
+	}
+
+	if(expr_kind(e, comma))
+		return invariant(scan, e->lhs, may_trap)
+			&& invariant(scan, e->rhs, may_trap);
+
+	if(expr_kind(e, funcall)){
+		int reads_memory;
+
+		/* might not return, or fault, where the loop wouldn't have called it */
+		if(!may_trap || !call_is_pure(e, &reads_memory))
+			return 0;
+		if(reads_memory && !memory_unchanged(scan))
+			return 0;
+
+		if(!invariant(scan, e->expr, may_trap))
+			return 0;
+		for(i = e->funcargs; i && *i; i++)
+			if(!invariant(scan, *i, may_trap))
+				return 0;
+		return 1;
+	}
+
+	return 0;
+}
+
+/* roughly the instructions saved per iteration by hoisting `e' */
+static unsigned hoist_cost(expr *e)
+{
+	unsigned cost = 0;
+	expr **i;
+
+	if(!e)
+		return 0;
+
+	if(expr_kind(e, val) || expr_kind(e, sizeof) || expr_kind(e, str))
+		return 0;
+
+	if(expr_kind(e, identifier))
+		return 0;
+
+	if(expr_kind(e, addr))
+		return hoist_cost(expr_addr_target(e));
+
+	if(expr_kind(e, cast)){
+		expr *sub = expr_cast_child(e);
+
+		if(!expr_cast_is_lval2rval(e))
+			return hoist_cost(sub) + !expr_cast_is_implicit(e);
+
+		/* register variables are read for free */
+		if(expr_kind(sub, identifier)
+		&& sub->bits.ident.type == IDENT_NORM
+		&& sub->bits.ident.bits.ident.sym
+		&& sub->bits.ident.bits.ident.sym->regvar)
+		{
+			return 0;
+		}
+		return 1 + hoist_cost(sub);
+	}
+
+	if(expr_kind(e, funcall)){
+		cost = LOOP_CALL_COST;
+		for(i = e->funcargs; i && *i; i++)
+			cost += hoist_cost(*i);
+		return cost;
+	}
+
+	if(expr_kind(e, op) && (e->bits.op.op == op_divide || e->bits.op.op == op_modulus))
+		cost += 4;
+
+	return cost + 1
+		+ hoist_cost(e->lhs)
+		+ (expr_kind(e, struct) ? 0 : hoist_cost(e->rhs))
+		+ hoist_cost(e->expr);
+}
+
+/* structurally equal, so one precomputed value serves both */
+static int expr_same(expr *a, expr *b)
+{
+	if(!a || !b)
+		return a == b;
+
+	if(a == b)
+		return 1;
+
+	if(a->f_str != b->f_str)
+		return 0;
+
+	if(type_cmp(a->tree_type, b->tree_type, 0) & TYPE_NOT_EQUAL)
+		return 0;
+
+	if(expr_kind(a, val)){
+		consty ka, kb;
+		const_fold(a, &ka);
+		const_fold(b, &kb);
+		return ka.type == CONST_NUM && kb.type == CONST_NUM
+			&& K_INTEGRAL(ka.bits.num) && K_INTEGRAL(kb.bits.num)
+			&& ka.bits.num.val.i == kb.bits.num.val.i;
+	}
+
+	if(expr_kind(a, identifier)){
+		return a->bits.ident.type == IDENT_NORM
+			&& b->bits.ident.type == IDENT_NORM
+			&& a->bits.ident.bits.ident.sym
+			&& a->bits.ident.bits.ident.sym == b->bits.ident.bits.ident.sym;
+	}
+
+	if(expr_kind(a, cast)){
+		if(expr_cast_is_lval2rval(a) != expr_cast_is_lval2rval(b))
+			return 0;
+		return expr_same(expr_cast_child(a), expr_cast_child(b));
+	}
+
+	if(expr_kind(a, op)){
+		return a->bits.op.op == b->bits.op.op
+			&& expr_same(a->lhs, b->lhs)
+			&& expr_same(a->rhs, b->rhs);
+	}
+
+	if(expr_kind(a, deref))
+		return expr_same(expr_deref_what(a), expr_deref_what(b));
+
+	return 0;
+}
+
+/* --- candidates */
+
+static struct loop_cand *cand_find(struct loop_cand **cands, expr *e)
+{
+	struct loop_cand **i;
+
+	for(i = cands; i && *i; i++)
+		if((*i)->e == e)
+			return *i;
+
+	return NULL;
+}
+
+static struct loop_cand *cand_add(struct loop_cand ***cands, expr *e, long step)
+{
+	struct loop_cand *c = umalloc(sizeof *c);
+	struct loop_cand **i;
+
+	c->e = e;
+	c->step = step;
+
+	for(i = *cands; i && *i; i++){
+		if(!(*i)->same && (*i)->step == step && expr_same((*i)->e, e)){
+			c->same = *i;
+			break;
+		}
+	}
+
+	dynarray_add(cands, c);
+	return c;
+}
+
+static int substituted(out_ctx *octx, const expr *e)
+{
+	struct cc1_out_ctx *cc1_octx = *cc1_out_ctx(octx);
+
+	return cc1_octx && cc1_octx->loop_subst
+		&& dynmap_exists(expr *, cc1_octx->loop_subst, (expr *)e);
+}
+
+struct hoist_ctx
+{
+	struct loop_scan *scan;
+	struct loop *loop;
+	out_ctx *octx;
+};
+
+static int hoistable(struct hoist_ctx *ctx, expr *e, int may_trap)
+{
+	type *t = e->tree_type;
+
+	if(!t || expr_is_lval(e) != LVALUE_NO)
+		return 0;
+
+	if(!type_is_integral(t) && !type_is_ptr(t))
+		return 0;
+
+	if(type_size(t, NULL) > platform_word_size())
+		return 0;
+
+	return invariant(ctx->scan, e, may_trap);
+}
+
+static void hoist_walk(struct hoist_ctx *ctx, expr *e, int may_trap)
+{
+	expr **i;
+
+	if(!e)
+		return;
+
+	if(substituted(ctx->octx, e) || cand_find(ctx->loop->ivs, e))
+		return;
+
+	if(expr_kind(e, sizeof) || expr_kind(e, block) || expr_kind(e, compound_lit) || e->code)
+		return;
+
+	if(hoistable(ctx, e, may_trap)){
+		if(hoist_cost(e) > 0)
+			cand_add(&ctx->loop->hoists, e, 0);
+		return;
+	}
+
+	if(expr_kind(e, op)
+	&& (e->bits.op.op == op_andsc || e->bits.op.op == op_orsc))
+	{
+		hoist_walk(ctx, e->lhs, may_trap);
+		hoist_walk(ctx, e->rhs, 0);
+		return;
+	}
+
+	if(expr_kind(e, if)){
+		hoist_walk(ctx, e->expr, may_trap);
+		hoist_walk(ctx, e->lhs, 0);
+		hoist_walk(ctx, e->rhs, 0);
+		return;
+	}
+
+	if(expr_kind(e, funcall)){
+		/* the callee stays put - direct calls and inlining need to see it */
+		for(i = e->funcargs; i && *i; i++)
+			hoist_walk(ctx, *i, may_trap);
+		return;
+	}
+
+	hoist_walk(ctx, e->lhs, may_trap);
+	if(!expr_kind(e, struct))
+		hoist_walk(ctx, e->rhs, may_trap);
+	hoist_walk(ctx, e->expr, may_trap);
+
+	for(i = e->funcargs; i && *i; i++)
+		hoist_walk(ctx, *i, may_trap);
+}
+
+/* --- induction variables */
+
+struct iv_ctx
+{
+	struct loop *loop;
+	sym *iv;
+	long step;
+	struct loop_scan *scan;
+	out_ctx *octx;
+};
+
+/* `i' or `i + c', possibly widened */
+static int iv_index(struct iv_ctx *ctx, expr *e)
+{
+	while(expr_kind(e, cast) && !expr_cast_is_lval2rval(e)){
+		expr *sub = expr_cast_child(e);
+		type *from = sub->tree_type, *to = e->tree_type;
+
+		if(!type_is_integral(from) || !type_is_integral(to))
+			return 0;
+		if(type_size(to, NULL) < type_size(from, NULL))
+			return 0;
+		/* zero-extension would wrap where the pointer doesn't */
+		if(!type_is_signed(from) && type_size(from, NULL) < platform_word_size())
+			return 0;
+
+		e = sub;
+	}
+
+	if(expr_kind(e, op) && (e->bits.op.op == op_plus || e->bits.op.op == op_minus)){
+		consty k;
+
+		const_fold(e->rhs, &k);
+		if(k.type != CONST_NUM || !K_INTEGRAL(k.bits.num))
+			return 0;
+
+		e = e->lhs;
+	}
+
+	if(!expr_kind(e, cast) || !expr_cast_is_lval2rval(e))
+		return 0;
+	e = expr_cast_child(e);
+
+	return expr_kind(e, identifier)
+		&& e->bits.ident.type == IDENT_NORM
+		&& e->bits.ident.bits.ident.sym == ctx->iv;
+}
+
+static int iv_candidate(struct iv_ctx *ctx, expr *e)
+{
+	type *pointee;
+	expr *base;
+
+	if(!expr_kind(e, op) || e->bits.op.op != op_plus)
+		return 0;
+
+	pointee = type_is_ptr(e->tree_type);
+	if(!pointee || !type_is_complete(pointee) || type_is_variably_modified(pointee))
+		return 0;
+
+	if(iv_index(ctx, e->rhs))
+		base = e->lhs;
+	else if(iv_index(ctx, e->lhs))
+		base = e->rhs;
+	else
+		return 0;
+
+	return type_is_ptr(base->tree_type) && invariant(ctx->scan, base, 0);
+}
+
+static void iv_walk(struct iv_ctx *ctx, expr *e)
+{
+	expr **i;
+
+	if(!e || substituted(ctx->octx, e))
+		return;
+
+	if(expr_kind(e, sizeof) || expr_kind(e, block) || expr_kind(e, compound_lit) || e->code)
+		return;
+
+	if(iv_candidate(ctx, e)){
+		cand_add(&ctx->loop->ivs, e, ctx->step);
+		return;
+	}
+
+	iv_walk(ctx, e->lhs);
+	if(!expr_kind(e, struct))
+		iv_walk(ctx, e->rhs);
+	iv_walk(ctx, e->expr);
+
+	for(i = e->funcargs; i && *i; i++)
+		iv_walk(ctx, *i);
+}
+
+/* `i++', `--i', `i += c' */
+static sym *iv_from_inc(expr *inc, long *step)
+{
+	expr *target;
+	consty k;
+	sym *s;
+
+	if(!inc || !expr_kind(inc, assign_compound))
+		return NULL;
+
+	switch(inc->bits.compoundop.op){
+		case op_plus:
+		case op_minus:
+			break;
+		default:
+			return NULL;
+	}
+
+	target = inc->lhs;
+	if(!expr_kind(target, identifier) || target->bits.ident.type != IDENT_NORM)
+		return NULL;
+
+	s = target->bits.ident.bits.ident.sym;
+	if(!s || sym_in_memory(s) || !type_is_integral(s->decl->ref))
+		return NULL;
+	if(type_qual(s->decl->ref) & (qual_volatile | qual_atomic))
+		return NULL;
+	/* unsigned wrap-around would wrap the index but not the pointer */
+	if(!type_is_signed(s->decl->ref)
+	&& type_size(s->decl->ref, NULL) < platform_word_size())
+	{
+		return NULL;
+	}
+
+	const_fold(inc->rhs, &k);
+	if(k.type != CONST_NUM || !K_INTEGRAL(k.bits.num))
+		return NULL;
+
+	*step = inc->bits.compoundop.op == op_minus
+		? -(long)k.bits.num.val.i
+		: (long)k.bits.num.val.i;
+
+	return s;
+}
+
+struct body_walk
+{
+	void (*fn)(void *, expr *, int may_trap);
+	void *ctx;
+};
+
+static void body_decls(struct body_walk *w, symtable *stab)
+{
+	decl **i;
+
+	for(i = stab ? symtab_decls(stab) : NULL; i && *i; i++)
+		if(!type_is((*i)->ref, type_func))
+			w->fn(w->ctx, (*i)->bits.var.init.expr, 0);
+}
+
+static void body_enter(stmt *s, int *stop, int *descend, void *ctx)
+{
+	struct body_walk *w = ctx;
+
+	(void)stop;
+	(void)descend;
+
+	if(stmt_kind(s, code))
+		body_decls(w, s->symtab);
+
+	w->fn(w->ctx, s->expr, 0);
+	w->fn(w->ctx, s->expr2, 0);
+
+	if(s->flow){
+		body_decls(w, s->flow->for_init_symtab);
+		w->fn(w->ctx, s->flow->for_init, 0);
+		w->fn(w->ctx, s->flow->for_while, 0);
+		w->fn(w->ctx, s->flow->for_inc, 0);
+	}
+}
+
+static void loop_walk(const stmt *s, void (*fn)(void *, expr *, int), void *ctx)
+{
+	struct body_walk w;
+
+	w.fn = fn;
+	w.ctx = ctx;
+
+	/* the test runs at least once */
+	if(stmt_kind(s, while)){
+		fn(ctx, s->expr, 1);
+	}else{
+		fn(ctx, s->flow->for_while, 1);
+		fn(ctx, s->flow->for_inc, 0);
+	}
+
+	stmt_walk(s->lhs, body_enter, NULL, &w);
+}
+
+static void iv_walk_fn(void *ctx, expr *e, int may_trap)
+{
+	(void)may_trap;
+	iv_walk(ctx, e);
+}
+
+static void hoist_walk_fn(void *ctx, expr *e, int may_trap)
+{
+	hoist_walk(ctx, e, may_trap);
+}
+
+/* --- generation */
+
+static void subst_push(out_ctx *octx, struct loop_cand *c)
+{
+	struct cc1_out_ctx *cc1_octx = cc1_out_ctx_or_new(octx);
+	struct loop_subst *sub = umalloc(sizeof *sub);
+	const struct loop_cand *owner = c->same ? c->same : c;
+
+	if(!cc1_octx->loop_subst)
+		cc1_octx->loop_subst = dynmap_new(expr *, NULL, loop_ptr_hash);
+
+	sub->val = out_val_retain(octx, owner->val);
+	sub->inline_depth = cc1_octx->inline_.depth;
+	sub->shadowed = dynmap_set(expr *, struct loop_subst *,
+			cc1_octx->loop_subst, c->e, sub);
+
+	c->subst = sub;
+}
+
+static void subst_pop(out_ctx *octx, struct loop_cand *c)
+{
+	struct cc1_out_ctx *cc1_octx = *cc1_out_ctx(octx);
+	struct loop_subst *sub = c->subst;
+
+	if(!sub)
+		return;
+
+	if(sub->shadowed){
+		(void)dynmap_set(expr *, struct loop_subst *,
+				cc1_octx->loop_subst, c->e, sub->shadowed);
+	}else{
+		(void)dynmap_rm(expr *, struct loop_subst *,
+				cc1_octx->loop_subst, c->e);
+	}
+
+	out_val_release(octx, sub->val);
+	free(sub);
+	c->subst = NULL;
+}
+
+static const out_val *cand_alloc(
+		out_ctx *octx, struct loop_cand *c, unsigned *regs, int stack_ok)
+{
+	const out_val *v = NULL;
+
+	if(*regs){
+		v = out_aalloc_reg(octx, c->e->tree_type);
+		if(v)
+			--*regs;
+	}
+
+	if(!v && stack_ok)
+		v = out_aalloct(octx, c->e->tree_type);
+
+	return v;
+}
+
+static unsigned cands_gen(
+		out_ctx *octx, struct loop_cand **cands, unsigned *regs, int is_iv)
+{
+	struct loop_cand **i;
+	unsigned n = 0;
+
+	for(i = cands; i && *i; i++){
+		struct loop_cand *c = *i;
+
+		if(c->same)
+			continue;
+
+		c->val = cand_alloc(octx, c, regs,
+				!is_iv && hoist_cost(c->e) >= LOOP_STACK_COST);
+
+		if(!c->val)
+			continue;
+
+		out_val_retain(octx, c->val);
+		out_store(octx, c->val, gen_expr(c->e, octx));
+
+		if(cc1_fopt.verbose_asm){
+			out_comment(octx, "%s %s",
+					is_iv ? "induction pointer" : "loop invariant",
+					out_val_str(c->val, 1));
+		}
+
+		n++;
+	}
+
+	/* installed after, so gen_expr() above computes the real value */
+	for(i = cands; i && *i; i++){
+		struct loop_cand *c = *i;
+
+		if((c->same ? c->same : c)->val)
+			subst_push(octx, c);
+	}
+
+	return n;
+}
+
+static void cands_free(out_ctx *octx, struct loop_cand ***cands)
+{
+	struct loop_cand **i;
+
+	for(i = *cands; i && *i; i++)
+		subst_pop(octx, *i);
+
+	for(i = *cands; i && *i; i++){
+		if((*i)->val)
+			out_adealloc(octx, &(*i)->val);
+		free(*i);
+	}
+
+	dynarray_free(struct loop_cand **, *cands, NULL);
+}
+
+/* --- vectorisation */
+
+/* runtime overlap tests we'll emit before giving up */
+#define VEC_MAX_ALIAS_CHECKS 6
+
+struct vec_ref
+{
+	expr *addr; /* `base + index' */
+	expr *base;
+	long off; /* index - i */
+};
+
+struct vec
+{
+	struct loop_scan *scan;
+	out_ctx *octx;
+	struct iv_ctx iv;
+	expr *iv_lval; /* the increment's target */
+	expr *iv_side, *bound; /* i < n */
+
+	type *elem;
+	unsigned lanes, regs;
+	unsigned tmp_base, tmp_end; /* [tmp_base, tmp_end) hold intermediates */
+
+	expr **stmts;
+	struct vec_ref **stores, **loads;
+	struct vec_ref **checks; /* pairs, overlap tested at runtime */
+	expr **splats; /* invariants, from the last register down */
+	expr *reduction; /* s op= ... */
+
+	const char *why;
+};
+
+static int vec_fail(struct vec *v, const char *why)
+{
+	if(!v->why)
+		v->why = why;
+	return 0;
+}
+
+/* anything generating a call would clobber the vector registers */
+static int vec_has_call(expr *e)
+{
+	expr **i;
+
+	if(!e)
+		return 0;
+
+	if(expr_kind(e, funcall) || expr_kind(e, block) || expr_kind(e, compound_lit) || e->code)
+		return 1;
+
+	/* global-dynamic tls goes through __tls_get_addr() */
+	if(expr_kind(e, identifier)
+	&& e->bits.ident.type == IDENT_NORM
+	&& e->bits.ident.bits.ident.sym
+	&& (e->bits.ident.bits.ident.sym->decl->store & store_thread))
+	{
+		return 1;
+	}
+
+	if(vec_has_call(e->lhs) || (!expr_kind(e, struct) && vec_has_call(e->rhs)) || vec_has_call(e->expr))
+		return 1;
+
+	for(i = e->funcargs; i && *i; i++)
+		if(vec_has_call(*i))
+			return 1;
+
+	return 0;
+}
+
+static int vec_elem(struct vec *v, type *t)
+{
+	unsigned lanes = out_vec_lanes(v->octx, t);
+
+	if(!lanes)
+		return vec_fail(v, "unsupported element type");
+
+	if(!v->elem){
+		v->elem = t;
+		v->lanes = lanes;
+		return 1;
+	}
+
+	if(type_is_floating(t) != type_is_floating(v->elem)
+	|| type_size(t, NULL) != type_size(v->elem, NULL))
+	{
+		return vec_fail(v, "mixed element types");
+	}
+
+	return 1;
+}
+
+/* `i', possibly converted for the comparison */
+static int vec_is_iv(struct vec *v, expr *e)
+{
+	while(expr_kind(e, cast) && !expr_cast_is_lval2rval(e)){
+		expr *sub = expr_cast_child(e);
+
+		if(!type_is_integral(sub->tree_type) || !type_is_integral(e->tree_type)
+		|| type_size(e->tree_type, NULL) < type_size(sub->tree_type, NULL))
+		{
+			return 0;
+		}
+		e = sub;
+	}
+
+	if(!expr_kind(e, cast) || !expr_cast_is_lval2rval(e))
+		return 0;
+	e = expr_cast_child(e);
+
+	return expr_kind(e, identifier)
+		&& e->bits.ident.type == IDENT_NORM
+		&& e->bits.ident.bits.ident.sym == v->iv.iv;
+}
+
+static long vec_index_off(expr *idx)
+{
+	consty k;
+
+	while(expr_kind(idx, cast) && !expr_cast_is_lval2rval(idx))
+		idx = expr_cast_child(idx);
+
+	if(!expr_kind(idx, op))
+		return 0;
+
+	const_fold(idx->rhs, &k);
+	return idx->bits.op.op == op_minus
+		? -(long)k.bits.num.val.i
+		: (long)k.bits.num.val.i;
+}
+
+/* `base[i + c]' */
+static int vec_ref(struct vec *v, expr *lval, struct vec_ref ***refs)
+{
+	struct vec_ref *r;
+	expr *addr, *base, *idx;
+
+	if(!expr_kind(lval, deref))
+		return vec_fail(v, "not an array access");
+
+	addr = expr_deref_what(lval);
+	if(!expr_kind(addr, op) || addr->bits.op.op != op_plus)
+		return vec_fail(v, "not an array access");
+
+	if(iv_index(&v->iv, addr->rhs))
+		base = addr->lhs, idx = addr->rhs;
+	else if(iv_index(&v->iv, addr->lhs))
+		base = addr->rhs, idx = addr->lhs;
+	else
+		return vec_fail(v, "array index isn't the loop counter");
+
+	if(!type_is_ptr(base->tree_type)
+	|| !invariant(v->scan, base, 0)
+	|| vec_has_call(base))
+	{
+		return vec_fail(v, "array base changes in the loop");
+	}
+
+	if(!vec_elem(v, lval->tree_type))
+		return 0;
+
+	r = umalloc(sizeof *r);
+	r->addr = addr;
+	r->base = base;
+	r->off = vec_index_off(idx);
+	dynarray_add(refs, r);
+
+	return 1;
+}
+
+static int vec_splattable(struct vec *v, expr *e)
+{
+	type *t = e->tree_type;
+
+	if(!invariant(v->scan, e, 0) || vec_has_call(e))
+		return 0;
+
+	/* the value is converted to the element type first */
+	if(type_is_floating(v->elem))
+		return type_is_integral(t)
+			|| (type_is_floating(t) && type_size(t, NULL) == type_size(v->elem, NULL));
+
+	return type_is_integral(t);
+}
+
+static unsigned vec_splat_reg(struct vec *v, expr *e)
+{
+	unsigned i;
+
+	for(i = 0; v->splats && v->splats[i]; i++)
+		if(v->splats[i] == e)
+			return v->regs - 1 - i;
+
+	return -1u;
+}
+
+static void vec_use_tmp(struct vec *v, unsigned reg)
+{
+	if(reg + 1 > v->tmp_end)
+		v->tmp_end = reg + 1;
+}
+
+/* mirrors vec_gen() - the result ends up in `next', unless it's a splat */
+static int vec_expr(struct vec *v, expr *e, unsigned next)
+{
+	if(!v->elem)
+		return vec_fail(v, "no array access");
+
+	if(vec_splattable(v, e)){
+		if(vec_splat_reg(v, e) == -1u)
+			dynarray_add(&v->splats, e);
+		return 1;
+	}
+
+	if(expr_kind(e, cast)){
+		expr *sub = expr_cast_child(e);
+
+		if(expr_cast_is_lval2rval(e)){
+			if(!expr_kind(sub, deref))
+				return vec_fail(v, "value changes in the loop");
+
+			vec_use_tmp(v, next);
+			return vec_ref(v, sub, &v->loads);
+		}
+
+		/* signedness changes only */
+		if(!vec_elem(v, e->tree_type) || !vec_elem(v, sub->tree_type))
+			return vec_fail(v, "type conversion in the loop");
+
+		return vec_expr(v, sub, next);
+	}
+
+	if(expr_kind(e, op)){
+		if(!vec_elem(v, e->tree_type))
+			return 0;
+		if(!out_vec_op_supported(v->octx, e->bits.op.op, v->elem))
+			return vec_fail(v, "no vector form of the operation");
+
+		if(!vec_expr(v, e->lhs, next))
+			return 0;
+		if(vec_splat_reg(v, e->lhs) != -1u)
+			vec_use_tmp(v, next); /* copied, the splat is reused */
+
+		return vec_expr(v, e->rhs, next + 1);
+	}
+
+	return vec_fail(v, "unsupported expression");
+}
+
+static int vec_reduction(struct vec *v, expr *e)
+{
+	sym *s = e->lhs->bits.ident.bits.ident.sym;
+	type *ty;
+
+	if(v->reduction)
+		return vec_fail(v, "more than one reduction");
+
+	if(e->lhs->bits.ident.type != IDENT_NORM || !s || sym_in_memory(s))
+		return vec_fail(v, "reduction into memory");
+
+	ty = s->decl->ref;
+	if(type_is_floating(ty))
+		return vec_fail(v, "reordering a floating point reduction");
+
+	switch(e->bits.compoundop.op){
+		case op_plus:
+		case op_xor:
+		case op_or:
+			break;
+		default:
+			return vec_fail(v, "unsupported reduction");
+	}
+
+	if(!vec_elem(v, ty) || scan_writes(v->scan, s) != 1)
+		return vec_fail(v, "unsupported reduction");
+
+	v->reduction = e;
+	return 1;
+}
+
+static int vec_stmt(struct vec *v, expr *e)
+{
+	struct vec_ref *old;
+
+	if(expr_kind(e, assign)){
+		if(!vec_ref(v, e->lhs, &v->stores))
+			return 0;
+		return vec_expr(v, e->rhs, v->tmp_base);
+	}
+
+	if(expr_kind(e, assign_compound)){
+		if(expr_kind(e->lhs, identifier))
+			return vec_reduction(v, e) && vec_expr(v, e->rhs, v->tmp_base);
+
+		if(!vec_ref(v, e->lhs, &v->stores))
+			return 0;
+		if(!out_vec_op_supported(v->octx, e->bits.compoundop.op, v->elem))
+			return vec_fail(v, "no vector form of the operation");
+
+		/* the old value is loaded alongside */
+		old = umalloc(sizeof *old);
+		*old = *v->stores[dynarray_count(v->stores) - 1];
+		dynarray_add(&v->loads, old);
+		vec_use_tmp(v, v->tmp_base);
+
+		return vec_expr(v, e->rhs, v->tmp_base + 1);
+	}
+
+	if(vec_has_call(e))
+		return vec_fail(v, "call in the loop");
+
+	return vec_fail(v, "unsupported statement");
+}
+
+static int vec_body(struct vec *v, stmt *s)
+{
+	stmt **i;
+
+	if(stmt_kind(s, noop))
+		return 1;
+
+	if(stmt_kind(s, expr)){
+		if(!vec_stmt(v, s->expr))
+			return 0;
+		dynarray_add(&v->stmts, s->expr);
+		return 1;
+	}
+
+	if(stmt_kind(s, code)){
+		if(s->symtab && symtab_decls(s->symtab) && *symtab_decls(s->symtab))
+			return vec_fail(v, "declarations in the loop");
+
+		for(i = s->bits.code.stmts; i && *i; i++)
+			if(!vec_body(v, *i))
+				return 0;
+		return 1;
+	}
+
+	return vec_fail(v, "control flow in the loop");
+}
+
+static int vec_test(struct vec *v, expr *test)
+{
+	if(!test || !expr_kind(test, op))
+		return vec_fail(v, "loop test isn't `i < n'");
+
+	switch(test->bits.op.op){
+		case op_lt:
+			v->iv_side = test->lhs;
+			v->bound = test->rhs;
+			break;
+		case op_gt:
+			v->iv_side = test->rhs;
+			v->bound = test->lhs;
+			break;
+		default:
+			return vec_fail(v, "loop test isn't `i < n'");
+	}
+
+	if(!vec_is_iv(v, v->iv_side))
+		return vec_fail(v, "loop test isn't `i < n'");
+
+	if(!invariant(v->scan, v->bound, 1) || vec_has_call(v->bound))
+		return vec_fail(v, "loop bound changes in the loop");
+
+	return 1;
+}
+
+/* the declared arrays are distinct objects */
+static sym *vec_base_object(expr *base)
+{
+	if(!expr_kind(base, cast) || !expr_cast_is_lval2rval(base))
+		return NULL;
+
+	base = expr_cast_child(base);
+	if(!expr_kind(base, identifier)
+	|| base->bits.ident.type != IDENT_NORM
+	|| !type_is_array(base->tree_type))
+	{
+		return NULL;
+	}
+
+	return base->bits.ident.bits.ident.sym;
+}
+
+static int vec_base_restrict(expr *base)
+{
+	sym *s;
+
+	if(!expr_kind(base, cast) || !expr_cast_is_lval2rval(base))
+		return 0;
+
+	base = expr_cast_child(base);
+	if(!expr_kind(base, identifier) || base->bits.ident.type != IDENT_NORM)
+		return 0;
+
+	s = base->bits.ident.bits.ident.sym;
+	return s && (type_qual(s->decl->ref) & qual_restrict);
+}
+
+static int vec_alias_pair(struct vec *v, struct vec_ref *st, struct vec_ref *r)
+{
+	const long bytes = (long)(v->lanes * type_size(v->elem, NULL));
+	sym *a, *b;
+
+	if(expr_same(st->base, r->base)){
+		long d = (r->off - st->off) * (long)type_size(v->elem, NULL);
+
+		/* the same element, or never within one vector's reach */
+		if(d == 0 || d >= bytes || d <= -bytes)
+			return 1;
+		return vec_fail(v, "dependence between iterations");
+	}
+
+	if(vec_base_restrict(st->base) || vec_base_restrict(r->base))
+		return 1;
+
+	a = vec_base_object(st->base);
+	b = vec_base_object(r->base);
+	if(a && b && a != b)
+		return 1;
+
+	if(dynarray_count(v->checks) / 2 >= VEC_MAX_ALIAS_CHECKS)
+		return vec_fail(v, "too many possibly aliasing arrays");
+
+	dynarray_add(&v->checks, st);
+	dynarray_add(&v->checks, r);
+	return 1;
+}
+
+static int vec_alias(struct vec *v)
+{
+	struct vec_ref **i, **j;
+
+	for(i = v->stores; i && *i; i++){
+		for(j = i + 1; *j; j++)
+			if(!vec_alias_pair(v, *i, *j))
+				return 0;
+
+		for(j = v->loads; j && *j; j++)
+			if(!vec_alias_pair(v, *i, *j))
+				return 0;
+	}
+
+	return 1;
+}
+
+static int vec_analyse(struct vec *v, const stmt *s)
+{
+	static const enum san_opts instrumented[] = {
+		SAN_BOUNDS, SAN_NULL, SAN_ALIGNMENT, SAN_POINTER_OVERFLOW,
+		SAN_SIGNED_INTEGER_OVERFLOW, SAN_FLOAT_DIVIDE_BY_ZERO,
+	};
+	unsigned i;
+	long step;
+
+	for(i = 0; i < countof(instrumented); i++)
+		if(out_sanitize_enabled(v->octx, instrumented[i]))
+			return vec_fail(v, "sanitized code");
+
+	if(cc1_fopt.trapv || cc1_fopt.profile_generate)
+		return vec_fail(v, "instrumented code");
+
+	v->iv.iv = iv_from_inc(s->flow->for_inc, &step);
+	if(!v->iv.iv || step != 1 || scan_writes(v->scan, v->iv.iv) != 1)
+		return vec_fail(v, "not a counted loop");
+	v->iv_lval = s->flow->for_inc->lhs;
+
+	v->regs = out_vec_regs(v->octx);
+
+	if(!vec_test(v, s->flow->for_while))
+		return 0;
+
+	/* the accumulator's found on the way, so reserve it up front */
+	v->tmp_base = v->tmp_end = 1;
+	if(!vec_body(v, s->lhs))
+		return 0;
+
+	if(!v->stmts)
+		return vec_fail(v, "empty loop");
+
+	if(v->reduction){
+		vec_use_tmp(v, 1); /* scratch for the final reduction */
+	}else{
+		/* no accumulator - slide the temporaries down */
+		v->tmp_base = 0;
+		v->tmp_end--;
+	}
+
+	if(v->tmp_end + dynarray_count(v->splats) > v->regs)
+		return vec_fail(v, "too many live values");
+
+	return vec_alias(v);
+}
+
+static unsigned vec_gen(struct vec *v, expr *e, unsigned next)
+{
+	unsigned lhs, rhs;
+
+	if((lhs = vec_splat_reg(v, e)) != -1u)
+		return lhs;
+
+	if(expr_kind(e, cast)){
+		expr *sub = expr_cast_child(e);
+
+		if(!expr_cast_is_lval2rval(e))
+			return vec_gen(v, sub, next);
+
+		out_vec_load(v->octx, next, gen_expr(expr_deref_what(sub), v->octx));
+		return next;
+	}
+
+	lhs = vec_gen(v, e->lhs, next);
+	if(lhs != next)
+		out_vec_copy(v->octx, next, lhs);
+
+	rhs = vec_gen(v, e->rhs, next + 1);
+	out_vec_op(v->octx, e->bits.op.op, v->elem, next, rhs);
+
+	return next;
+}
+
+static void vec_gen_stmt(struct vec *v, expr *e)
+{
+	out_ctx *octx = v->octx;
+	unsigned r;
+
+	if(expr_kind(e, assign)){
+		r = vec_gen(v, e->rhs, v->tmp_base);
+		out_vec_store(octx, gen_expr(expr_deref_what(e->lhs), octx), r);
+
+	}else if(expr_kind(e->lhs, identifier)){
+		r = vec_gen(v, e->rhs, v->tmp_base);
+		out_vec_op(octx, e->bits.compoundop.op, v->elem, 0, r);
+
+	}else{
+		const unsigned dest = v->tmp_base;
+
+		out_vec_load(octx, dest, gen_expr(expr_deref_what(e->lhs), octx));
+		r = vec_gen(v, e->rhs, dest + 1);
+		out_vec_op(octx, e->bits.compoundop.op, v->elem, dest, r);
+		out_vec_store(octx, gen_expr(expr_deref_what(e->lhs), octx), dest);
+	}
+}
+
+static const out_val *vec_addr_diff(struct vec *v, struct vec_ref *a, struct vec_ref *b)
+{
+	type *intptr_ty = type_nav_btype(cc1_type_nav, type_intptr_t);
+	const out_val *va, *vb;
+
+	va = out_change_type(v->octx, gen_expr(a->addr, v->octx), intptr_ty);
+	vb = out_change_type(v->octx, gen_expr(b->addr, v->octx), intptr_ty);
+
+	return out_op(v->octx, op_minus, vb, va);
+}
+
+/* bail to the scalar loop if a store and another access are less than
+ * a vector apart, unless they're the same element */
+static void vec_gen_alias_checks(struct vec *v, out_blk *blk_scalar)
+{
+	const long bytes = (long)(v->lanes * type_size(v->elem, NULL));
+	type *intptr_ty = type_nav_btype(cc1_type_nav, type_intptr_t);
+	type *uintptr_ty = type_nav_btype(cc1_type_nav, type_uintptr_t);
+	out_ctx *octx = v->octx;
+	struct vec_ref **i;
+
+	for(i = v->checks; i && *i; i += 2){
+		out_blk *blk_ok = out_blk_new(octx, "vec_alias_ok");
+		out_blk *blk_near = out_blk_new(octx, "vec_alias_near");
+		const out_val *d;
+
+		d = vec_addr_diff(v, i[0], i[1]);
+		out_ctrl_branch(octx,
+				out_op(octx, op_eq, d, out_new_zero(octx, intptr_ty)),
+				blk_ok, blk_near);
+
+		out_current_blk(octx, blk_near);
+		{
+			/* -bytes < d < bytes */
+			d = out_op(octx, op_plus,
+					vec_addr_diff(v, i[0], i[1]),
+					out_new_l(octx, intptr_ty, bytes - 1));
+			d = out_change_type(octx, d, uintptr_ty);
+
+			out_ctrl_branch(octx,
+					out_op(octx, op_lt, d, out_new_l(octx, uintptr_ty, 2 * bytes - 1)),
+					blk_scalar, blk_ok);
+		}
+
+		out_current_blk(octx, blk_ok);
+	}
+}
+
+static void vec_gen_loop(struct vec *v, const stmt *s)
+{
+	out_ctx *octx = v->octx;
+	out_blk *blk_test = out_blk_new(octx, "vec_test"),
+	        *blk_room = out_blk_new(octx, "vec_room"),
+	        *blk_body = out_blk_new(octx, "vec_body"),
+	        *blk_end = out_blk_new(octx, "vec_end");
+	expr **i;
+	unsigned n;
+
+	if(cc1_fopt.verbose_asm)
+		out_comment(octx, "vectorised, %u lanes", v->lanes);
+
+	if(v->reduction)
+		out_vec_zero(octx, 0);
+
+	for(n = 0; v->splats && v->splats[n]; n++){
+		expr *e = v->splats[n];
+
+		out_vec_splat(octx, v->regs - 1 - n,
+				out_cast(octx, gen_expr(e, octx), v->elem, 0));
+	}
+
+	vec_gen_alias_checks(v, blk_end);
+
+	out_ctrl_transfer_make_current(octx, blk_test);
+	out_ctrl_branch(octx, gen_expr(s->flow->for_while, octx), blk_room, blk_end);
+
+	out_current_blk(octx, blk_room);
+	{
+		/* i < n is known - n - i can't wrap as unsigned */
+		type *uty = type_sign(cc1_type_nav, v->iv_side->tree_type, 0);
+		const out_val *left;
+
+		left = out_op(octx, op_minus,
+				out_cast(octx, gen_expr(v->bound, octx), uty, 0),
+				out_cast(octx, gen_expr(v->iv_side, octx), uty, 0));
+
+		out_ctrl_branch(octx,
+				out_op(octx, op_ge, left, out_new_l(octx, uty, v->lanes)),
+				blk_body, blk_end);
+	}
+
+	out_current_blk(octx, blk_body);
+	{
+		const out_val *iv;
+
+		for(i = v->stmts; *i; i++)
+			vec_gen_stmt(v, *i);
+
+		iv = gen_expr(v->iv_lval, octx);
+		out_val_retain(octx, iv);
+		out_store(octx, iv,
+				out_op(octx, op_plus,
+					out_deref(octx, iv),
+					out_new_l(octx, v->iv_lval->tree_type, v->lanes)));
+
+		out_ctrl_transfer(octx, blk_test, NULL, NULL, 0);
+	}
+
+	/* the scalar loop finishes off the remainder */
+	out_current_blk(octx, blk_end);
+	if(v->reduction){
+		expr *target = v->reduction->lhs;
+		const out_val *lval = gen_expr(target, octx), *part;
+
+		part = out_vec_reduce(octx, v->reduction->bits.compoundop.op, v->elem, 0, 1);
+		part = out_change_type(octx, part, target->tree_type);
+
+		out_val_retain(octx, lval);
+		out_store(octx, lval,
+				out_op(octx, v->reduction->bits.compoundop.op,
+					out_deref(octx, lval), part));
+	}
+}
+
+static void vec_free(struct vec *v)
+{
+	dynarray_free(expr **, v->stmts, NULL);
+	dynarray_free(struct vec_ref **, v->stores, free);
+	dynarray_free(struct vec_ref **, v->loads, free);
+	dynarray_free(struct vec_ref **, v->checks, NULL);
+	dynarray_free(expr **, v->splats, NULL);
+}
+
+static void loop_vectorise(const stmt *s, struct loop_scan *scan, out_ctx *octx)
+{
+	struct vec v = { 0 };
+
+	v.scan = scan;
+	v.octx = octx;
+	v.iv.scan = scan;
+	v.iv.octx = octx;
+
+	if(vec_analyse(&v, s)){
+		vec_gen_loop(&v, s);
+		stats.vectorised++;
+
+		if(cc1_fopt.opt_info_vec)
+			note_at(&s->where, "loop vectorised using %u byte vectors",
+					v.lanes * type_size(v.elem, NULL));
+	}else if(cc1_fopt.opt_info_vec_missed){
+		note_at(&s->where, "loop not vectorised: %s", v.why);
+	}
+
+	vec_free(&v);
+}
+
+void loop_begin(const stmt *s, out_ctx *octx)
+{
+	struct loop *loop = umalloc(sizeof *loop);
+	struct loop_scan scan;
+	unsigned regs, nivs, nhoisted;
+
+	loop->s = s;
+	loop->outer = innermost;
+	innermost = loop;
+
+	if(!cc1_fopt.move_loop_invariants && !cc1_fopt.ivopts && !cc1_fopt.tree_vectorize)
+		return;
+
+	scan_loop(&scan, s);
+
+	if(scan.labels)
+		goto out;
+
+	/* before the scalar loop's induction pointers, which start from i */
+	if(cc1_fopt.tree_vectorize && stmt_kind(s, for))
+		loop_vectorise(s, &scan, octx);
+
+	regs = scan.local_regvars < LOOP_MAX_REGS
+		? LOOP_MAX_REGS - scan.local_regvars
+		: 0;
+
+	if(cc1_fopt.ivopts
+	&& stmt_kind(s, for)
+	&& !out_sanitize_enabled(octx, SAN_BOUNDS))
+	{
+		struct iv_ctx ctx;
+
+		ctx.loop = loop;
+		ctx.scan = &scan;
+		ctx.octx = octx;
+		ctx.iv = iv_from_inc(s->flow->for_inc, &ctx.step);
+
+		/* the increment must be the only write */
+		if(ctx.iv && ctx.step && scan_writes(&scan, ctx.iv) == 1)
+			loop_walk(s, iv_walk_fn, &ctx);
+	}
+
+	if(cc1_fopt.move_loop_invariants){
+		struct hoist_ctx ctx;
+
+		ctx.scan = &scan;
+		ctx.loop = loop;
+		ctx.octx = octx;
+
+		loop_walk(s, hoist_walk_fn, &ctx);
+	}
+
+	/* induction pointers first, they save the most */
+	nivs = cands_gen(octx, loop->ivs, &regs, 1);
+	nhoisted = cands_gen(octx, loop->hoists, &regs, 0);
+
+	if(nivs || nhoisted){
+		stats.loops++;
+		stats.ivs += nivs;
+		stats.hoisted += nhoisted;
+	}
+
+out:
+	dynarray_free(sym **, scan.written, NULL);
+}
+
+void loop_inc(const stmt *s, out_ctx *octx)
+{
+	struct loop_cand **i;
+
+	assert(innermost && innermost->s == s);
+
+	for(i = innermost->ivs; i && *i; i++){
+		struct loop_cand *c = *i;
+		const out_val *next;
+
+		if(c->same || !c->val)
+			continue;
+
+		out_val_retain(octx, c->val);
+		out_val_retain(octx, c->val);
+
+		next = out_op(octx, op_plus,
+				out_deref(octx, c->val),
+				out_new_l(octx, type_nav_btype(cc1_type_nav, type_long), c->step));
+
+		out_store(octx, c->val, next);
+	}
+}
+
+void loop_end(const stmt *s, out_ctx *octx)
+{
+	struct loop *loop = innermost;
+
+	assert(loop && loop->s == s);
+	innermost = loop->outer;
+
+	cands_free(octx, &loop->ivs);
+	cands_free(octx, &loop->hoists);
+	free(loop);
+}
+
+const out_val *loop_substitute(const expr *e, out_ctx *octx)
+{
+	struct cc1_out_ctx *cc1_octx;
+	struct loop_subst *sub;
+
+	if(!octx)
+		return NULL;
+
+	cc1_octx = *cc1_out_ctx(octx);
+	if(!cc1_octx || !cc1_octx->loop_subst)
+		return NULL;
+
+	sub = dynmap_get(expr *, struct loop_subst *, cc1_octx->loop_subst, (expr *)e);
+	if(!sub || sub->inline_depth != cc1_octx->inline_.depth)
+		return NULL;
+
+	return out_deref(octx, out_val_retain(octx, sub->val));
+}
+
+void loop_stats(FILE *f)
+{
+	fprintf(f, "loops: %u optimised, %u invariants hoisted, %u induction pointers, %u vectorised\n",
+			stats.loops, stats.hoisted, stats.ivs, stats.vectorised);
+}
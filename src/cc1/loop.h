@@ -0,0 +1,39 @@
+#ifndef LOOP_H
+#define LOOP_H
+
+#include <stdio.h>
+
+#include "out/forwards.h"
+
+/* -fmove-loop-invariants, -fivopts, -ftree-vectorize
+ *
+ * side-effect free expressions whose operands a for/while loop doesn't
+ * change are evaluated once, before the loop. for loops stepping an integer
+ * by a constant also keep a pointer for each `base[i]' / `base + i', advanced
+ * alongside the increment instead of recomputing base + i * size.
+ *
+ * innermost `for(...; i < n; i++)' loops over int/float/double arrays get a
+ * packed copy ahead of them, the scalar loop finishing off the remainder.
+ *
+ * the loop's AST isn't changed - gen_expr() asks for the precomputed value
+ * whenever it reaches a replaced expression
+ */
+
+struct stmt;
+struct expr;
+
+/* in the preheader, after any for-init */
+void loop_begin(const struct stmt *, out_ctx *);
+
+/* after the for-increment, before jumping back to the test */
+void loop_inc(const struct stmt *, out_ctx *);
+
+/* after the loop */
+void loop_end(const struct stmt *, out_ctx *);
+
+/* the value replacing `e' in the loops being generated, or NULL */
+const out_val *loop_substitute(const struct expr *e, out_ctx *);
+
+void loop_stats(FILE *);
+
+#endif
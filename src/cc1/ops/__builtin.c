@@ -6,6 +6,7 @@
 #include "../../util/util.h"
 #include "../../util/dynarray.h"
 #include "../../util/alloc.h"
+#include "../../util/macros.h"
 
 #include "__builtin.h"
 
@@ -26,6 +27,7 @@
 #include "../out/out.h"
 #include "__builtins.h"
 #include "__builtin_va.h"
+#include "__builtin_atomic.h"
 
 #include "../parse_expr.h"
 #include "../parse_type.h"
@@ -63,6 +65,9 @@ static func_builtin_parse parse_unreachable
                           , parse_add_overflow
                           , parse_sub_overflow
                           , parse_mul_overflow
+                          , parse_bitop
+                          , parse_prefetch
+                          , parse_assume_aligned
 #ifdef BUILTIN_LIBC_FUNCTIONS
                           , parse_memset
                           , parse_memcpy
@@ -146,6 +151,11 @@ static builtin_table *builtin_find(const char *sp)
 expr *builtin_parse(const char *sp, symtable *scope)
 {
 	builtin_table *b;
+	expr *atomic;
+
+	/* not library functions, so independent of -fno-builtin */
+	if((atomic = builtin_parse_atomic(sp, scope)))
+		return atomic;
 
 	if(cc1_fopt.builtin && (b = builtin_find(sp))){
 		expr *(*f)(const char *, symtable *) = b->parser;
@@ -691,7 +701,7 @@ static const out_val *builtin_gen_expect(const expr *e, out_ctx *octx)
 
 	const_fold(e->funcargs[1], &k);
 	if(k.type == CONST_NUM)
-		eval = out_annotate_likely(octx, eval, !!k.bits.num.val.i);
+		eval = out_annotate_likely(octx, eval, !k.bits.num.val.i);
 
 	return eval;
 }
@@ -766,6 +776,13 @@ static const out_val *gen_choose_expr(const expr *e, out_ctx *octx)
 	return gen_expr(CHOOSE_EXPR_CHOSEN(e), octx);
 }
 
+expr *builtin_choose_expr_chosen(const expr *e)
+{
+	if(e->f_gen != gen_choose_expr)
+		return NULL;
+	return CHOOSE_EXPR_CHOSEN(e);
+}
+
 static expr *parse_choose_expr(const char *ident, symtable *scope)
 {
 	expr *fcall = parse_any_args(scope);
@@ -1004,6 +1021,11 @@ static void const_strlen(expr *e, consty *k)
 	}
 }
 
+int builtin_is_pure(const expr *e)
+{
+	return e->f_const_fold == const_strlen;
+}
+
 static expr *parse_strlen(const char *ident, symtable *scope)
 {
 	expr *fcall = parse_any_args(scope);
@@ -1274,3 +1296,253 @@ static expr *parse_mul_overflow(const char *ident, symtable *scope)
 {
 	return parse_arith_overflow(ident, scope, op_multiply);
 }
+
+/* --- popcount, clz, ctz, ffs, bswap */
+
+static void fold_bitop(expr *e, symtable *stab)
+{
+	const char *name = BUILTIN_SPEL(e->expr);
+	type *argty = type_nav_btype(cc1_type_nav, e->bits.builtin_bitop.arg);
+
+	if(e->bits.builtin_bitop.op == OUT_BITOP_BSWAP)
+		e->tree_type = argty;
+	else
+		e->tree_type = type_nav_btype(cc1_type_nav, type_int);
+	wur_builtin(e);
+
+	if(dynarray_count(e->funcargs) != 1){
+		warn_at_print_error(&e->where, "%s takes a single argument", name);
+		fold_had_error = 1;
+		return;
+	}
+
+	FOLD_EXPR(e->funcargs[0], stab);
+	if(fold_check_expr(e->funcargs[0], FOLD_CHK_INTEGRAL, name))
+		return;
+
+	fold_insert_casts(argty, &e->funcargs[0], stab);
+}
+
+static void const_bitop(expr *e, consty *k)
+{
+	expr *arg = e->funcargs[0];
+	integral_t result;
+
+	const_fold(arg, k);
+	if(k->type != CONST_NUM)
+		return;
+
+	if(!out_bitop_fold(e->bits.builtin_bitop.op,
+				k->bits.num.val.i, type_size(arg->tree_type, NULL), &result))
+	{
+		/* clz/ctz of zero - leave it to the target */
+		CONST_FOLD_NO(k, e);
+		return;
+	}
+
+	CONST_FOLD_LEAF(k);
+	k->type = CONST_NUM;
+	k->bits.num.val.i = result;
+	if(e->bits.builtin_bitop.op == OUT_BITOP_BSWAP)
+		k->bits.num.suffix = VAL_UNSIGNED;
+}
+
+static const out_val *builtin_gen_bitop(const expr *e, out_ctx *octx)
+{
+	const out_val *v = gen_expr(e->funcargs[0], octx);
+
+	v = out_bitop(octx, e->bits.builtin_bitop.op, v);
+
+	return out_cast(octx, v, e->tree_type, 0);
+}
+
+static expr *parse_bitop(const char *ident, symtable *scope)
+{
+	static const struct
+	{
+		const char *name;
+		enum out_bitop op;
+	} ops[] = {
+		{ "popcount", OUT_BITOP_POPCOUNT },
+		{ "clz", OUT_BITOP_CLZ },
+		{ "ctz", OUT_BITOP_CTZ },
+		{ "ffs", OUT_BITOP_FFS },
+		{ "bswap", OUT_BITOP_BSWAP },
+	};
+	expr *e = parse_any_args(scope);
+	const char *suffix = NULL;
+	unsigned i;
+
+	expr_mutate_builtin(e, bitop);
+	e->f_const_fold = const_bitop;
+
+	if(!strncmp(ident, PREFIX, strlen(PREFIX)))
+		ident += strlen(PREFIX);
+
+	for(i = 0; i < countof(ops); i++){
+		size_t len = strlen(ops[i].name);
+
+		if(!strncmp(ident, ops[i].name, len)){
+			e->bits.builtin_bitop.op = ops[i].op;
+			suffix = ident + len;
+			break;
+		}
+	}
+
+	/* ffs takes signed arguments, but only the bits matter */
+	if(!suffix)
+		ICE("bad bitop '%s'", ident);
+	else if(!*suffix || !strcmp(suffix, "32"))
+		e->bits.builtin_bitop.arg = type_uint;
+	else if(!strcmp(suffix, "l"))
+		e->bits.builtin_bitop.arg = type_ulong;
+	else if(!strcmp(suffix, "ll") || !strcmp(suffix, "64"))
+		e->bits.builtin_bitop.arg = type_ullong;
+	else if(!strcmp(suffix, "16"))
+		e->bits.builtin_bitop.arg = type_ushort;
+	else
+		ICE("bad bitop suffix '%s'", ident);
+
+	return e;
+}
+
+/* --- prefetch */
+
+static int builtin_const_arg(
+		expr *e, unsigned i, integral_t max, integral_t *out)
+{
+	const char *name = BUILTIN_SPEL(e->expr);
+	consty k;
+
+	if(fold_check_expr(e->funcargs[i], FOLD_CHK_INTEGRAL | FOLD_CHK_CONST_I, name))
+		return 0;
+
+	const_fold(e->funcargs[i], &k);
+	if(k.bits.num.val.i > max){
+		warn_at_print_error(&e->funcargs[i]->where,
+				"%s argument %u out of range (0 - %u)",
+				name, i + 1, (unsigned)max);
+		fold_had_error = 1;
+		return 0;
+	}
+
+	*out = k.bits.num.val.i;
+	return 1;
+}
+
+static void fold_prefetch(expr *e, symtable *stab)
+{
+	const char *name = BUILTIN_SPEL(e->expr);
+	integral_t ignored;
+	int i, n = dynarray_count(e->funcargs);
+
+	e->tree_type = type_nav_btype(cc1_type_nav, type_void);
+
+	if(n < 1 || n > 3){
+		warn_at_print_error(&e->where, "%s takes one to three arguments", name);
+		fold_had_error = 1;
+		return;
+	}
+
+	for(i = 0; i < n; i++)
+		FOLD_EXPR(e->funcargs[i], stab);
+
+	if(!type_is_ptr(e->funcargs[0]->tree_type)){
+		warn_at_print_error(&e->where, "%s expects a pointer argument", name);
+		fold_had_error = 1;
+		return;
+	}
+
+	/* rw: 0 or 1, locality: 0 - 3 */
+	if(n > 1 && builtin_const_arg(e, 1, 1, &ignored) && n > 2)
+		builtin_const_arg(e, 2, 3, &ignored);
+}
+
+static int builtin_prefetch_arg(const expr *e, unsigned i, int def)
+{
+	consty k;
+
+	if(dynarray_count(e->funcargs) <= i)
+		return def;
+
+	const_fold(e->funcargs[i], &k);
+	return k.bits.num.val.i;
+}
+
+static const out_val *builtin_gen_prefetch(const expr *e, out_ctx *octx)
+{
+	out_prefetch(octx,
+			gen_expr(e->funcargs[0], octx),
+			builtin_prefetch_arg(e, 1, 0),
+			builtin_prefetch_arg(e, 2, 3));
+
+	return out_new_noop(octx);
+}
+
+static expr *parse_prefetch(const char *ident, symtable *scope)
+{
+	expr *fcall = parse_any_args(scope);
+
+	(void)ident;
+
+	expr_mutate_builtin(fcall, prefetch);
+
+	return fcall;
+}
+
+/* --- assume_aligned */
+
+static void fold_assume_aligned(expr *e, symtable *stab)
+{
+	const char *name = BUILTIN_SPEL(e->expr);
+	integral_t align, misalign;
+	int i, n = dynarray_count(e->funcargs);
+
+	e->tree_type = type_ptr_to(type_nav_btype(cc1_type_nav, type_void));
+	wur_builtin(e);
+
+	if(n < 2 || n > 3){
+		warn_at_print_error(&e->where, "%s takes two or three arguments", name);
+		fold_had_error = 1;
+		return;
+	}
+
+	for(i = 0; i < n; i++)
+		FOLD_EXPR(e->funcargs[i], stab);
+
+	if(!type_is_ptr(e->funcargs[0]->tree_type)){
+		warn_at_print_error(&e->where, "%s expects a pointer argument", name);
+		fold_had_error = 1;
+		return;
+	}
+
+	if(!builtin_const_arg(e, 1, ~(integral_t)0, &align))
+		return;
+
+	if(!align || (align & (align - 1))){
+		warn_at_print_error(&e->funcargs[1]->where,
+				"%s alignment isn't a power of two", name);
+		fold_had_error = 1;
+		return;
+	}
+
+	if(n > 2)
+		builtin_const_arg(e, 2, align - 1, &misalign);
+}
+
+static const out_val *builtin_gen_assume_aligned(const expr *e, out_ctx *octx)
+{
+	/* nothing downstream tracks pointer alignment yet */
+	return out_change_type(octx, gen_expr(e->funcargs[0], octx), e->tree_type);
+}
+
+static expr *parse_assume_aligned(const char *ident, symtable *scope)
+{
+	expr *fcall = parse_any_args(scope);
+
+	(void)ident;
+
+	expr_mutate_builtin(fcall, assume_aligned);
+
+	return fcall;
+}
@@ -21,4 +21,10 @@ expr *builtin_new_memcpy(expr *to, expr *from, size_t len);
 
 const char *str_expr_builtin(void);
 
+/* the selected operand of a __builtin_choose_expr(), else NULL */
+expr *builtin_choose_expr_chosen(const expr *);
+
+/* a call only reading memory, e.g. strlen() */
+int builtin_is_pure(const expr *);
+
 #endif
@@ -0,0 +1,486 @@
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <assert.h>
+
+#include "../../util/util.h"
+#include "../../util/dynarray.h"
+#include "../../util/macros.h"
+
+#include "__builtin.h"
+#include "__builtins.h"
+#include "__builtin_atomic.h"
+
+#include "../cc1.h"
+#include "../fold.h"
+#include "../const.h"
+#include "../gen_asm.h"
+#include "../type_is.h"
+#include "../type_nav.h"
+#include "../funcargs.h"
+
+#include "../out/out.h"
+
+#include "../ops/expr_addr.h"
+
+enum atomic_kind
+{
+	ATOMIC_LOAD,
+	ATOMIC_STORE,
+	ATOMIC_EXCHANGE,
+	ATOMIC_CMPXCHG, /* __atomic_compare_exchange_n */
+	ATOMIC_FETCH_OP, /* returns the old value */
+	ATOMIC_OP_FETCH, /* returns the new value */
+	ATOMIC_TEST_AND_SET,
+	ATOMIC_CLEAR,
+	ATOMIC_FENCE,
+	ATOMIC_SIGNAL_FENCE,
+	ATOMIC_LOCK_FREE,
+	ATOMIC_SYNC_BOOL_CAS,
+	ATOMIC_SYNC_VAL_CAS
+};
+
+struct builtin_atomic
+{
+	const char *name;
+	enum atomic_kind kind;
+	enum op_type op; /* op_bnot is nand */
+	unsigned nargs;
+	int order_arg; /* index of the memory order, or -1 for the implied one */
+	enum out_memorder implied;
+};
+
+static const struct builtin_atomic builtin_atomics[] = {
+#define ATOMIC_BUILTIN(name, kind, op, nargs, order_arg, implied) \
+	{ name, ATOMIC_ ## kind, op, nargs, order_arg, OUT_MO_ ## implied },
+	ATOMIC_BUILTINS
+#undef ATOMIC_BUILTIN
+};
+
+/* the object operated on, unqualified */
+static type *atomic_obj_type(const expr *e)
+{
+	const struct builtin_atomic *b = e->bits.builtin_atomic;
+
+	switch(b->kind){
+		case ATOMIC_TEST_AND_SET:
+			return type_nav_btype(cc1_type_nav, type_uchar);
+		case ATOMIC_CLEAR:
+			if(b->order_arg != -1)
+				return type_nav_btype(cc1_type_nav, type_uchar);
+			break; /* __sync_lock_release: *ptr's type */
+		default:
+			break;
+	}
+
+	return type_unqualify(type_is_ptr(e->funcargs[0]->tree_type));
+}
+
+static int atomic_check_ptr(expr *e, symtable *stab)
+{
+	const struct builtin_atomic *b = e->bits.builtin_atomic;
+	const char *name = BUILTIN_SPEL(e->expr);
+	expr *arg = e->funcargs[0];
+	type *pointee = type_is_ptr(arg->tree_type);
+	unsigned sz;
+
+	if(!pointee){
+		warn_at_print_error(&arg->where,
+				"%s expects a pointer argument (not \"%s\")",
+				name, type_to_str(arg->tree_type));
+		fold_had_error = 1;
+		return 0;
+	}
+
+	if(b->kind != ATOMIC_LOAD && type_is_const(pointee)){
+		warn_at_print_error(&arg->where,
+				"%s of const-qualified object (%s)",
+				name, type_to_str(pointee));
+		fold_had_error = 1;
+		return 0;
+	}
+
+	if(b->kind == ATOMIC_TEST_AND_SET || atomic_obj_type(e) != type_unqualify(pointee))
+		return 1;
+
+	sz = type_is_complete(pointee) ? type_size(pointee, &arg->where) : 0;
+
+	if(!(type_is_integral(pointee) || type_is_ptr(pointee))
+	|| (sz != 1 && sz != 2 && sz != 4 && sz != 8))
+	{
+		warn_at_print_error(&arg->where,
+				"%s needs a pointer to a 1, 2, 4 or 8 byte integer or pointer (not \"%s\")",
+				name, type_to_str(arg->tree_type));
+		fold_had_error = 1;
+		return 0;
+	}
+
+	if((b->kind == ATOMIC_FETCH_OP || b->kind == ATOMIC_OP_FETCH)
+	&& b->op != op_plus && b->op != op_minus
+	&& !type_is_integral(pointee))
+	{
+		warn_at_print_error(&arg->where,
+				"%s needs a pointer to an integer (not \"%s\")",
+				name, type_to_str(arg->tree_type));
+		fold_had_error = 1;
+		return 0;
+	}
+
+	if(expr_kind(arg, addr))
+		fold_inc_writes_if_sym(expr_addr_target(arg), stab);
+
+	return 1;
+}
+
+static void fold_atomic(expr *e, symtable *stab)
+{
+	const struct builtin_atomic *b = e->bits.builtin_atomic;
+	const char *name = BUILTIN_SPEL(e->expr);
+	type *obj_ty;
+	unsigned i, n = dynarray_count(e->funcargs);
+
+	switch(b->kind){
+		case ATOMIC_LOAD:
+		case ATOMIC_EXCHANGE:
+		case ATOMIC_FETCH_OP:
+		case ATOMIC_OP_FETCH:
+		case ATOMIC_SYNC_VAL_CAS:
+			/* set below */
+			e->tree_type = NULL;
+			break;
+		case ATOMIC_STORE:
+		case ATOMIC_CLEAR:
+		case ATOMIC_FENCE:
+		case ATOMIC_SIGNAL_FENCE:
+			e->tree_type = type_nav_btype(cc1_type_nav, type_void);
+			break;
+		case ATOMIC_CMPXCHG:
+		case ATOMIC_TEST_AND_SET:
+		case ATOMIC_LOCK_FREE:
+		case ATOMIC_SYNC_BOOL_CAS:
+			e->tree_type = type_nav_btype(cc1_type_nav, type__Bool);
+			break;
+	}
+
+	if(n != b->nargs){
+		warn_at_print_error(&e->where, "%s takes %u argument%s",
+				name, b->nargs, b->nargs == 1 ? "" : "s");
+		fold_had_error = 1;
+		if(!e->tree_type)
+			e->tree_type = type_nav_btype(cc1_type_nav, type_int);
+		return;
+	}
+
+	for(i = 0; i < n; i++)
+		FOLD_EXPR(e->funcargs[i], stab);
+
+	if(b->order_arg != -1){
+		/* compare_exchange has the failure order following */
+		for(i = b->order_arg; i < n; i++)
+			if(fold_check_expr(e->funcargs[i], FOLD_CHK_INTEGRAL, name))
+				return;
+	}
+
+	switch(b->kind){
+		case ATOMIC_FENCE:
+		case ATOMIC_SIGNAL_FENCE:
+			return;
+
+		case ATOMIC_LOCK_FREE:
+			/* the object is assumed to be naturally aligned */
+			e->freestanding = 0;
+			if(fold_check_expr(e->funcargs[0],
+						FOLD_CHK_INTEGRAL | FOLD_CHK_CONST_I, name))
+			{
+				fold_had_error = 1;
+			}
+			return;
+
+		default:
+			break;
+	}
+
+	if(!atomic_check_ptr(e, stab)){
+		if(!e->tree_type)
+			e->tree_type = type_nav_btype(cc1_type_nav, type_int);
+		return;
+	}
+
+	obj_ty = atomic_obj_type(e);
+	if(!e->tree_type)
+		e->tree_type = obj_ty;
+
+	switch(b->kind){
+		case ATOMIC_CMPXCHG:
+		{
+			expr *expected = e->funcargs[1];
+			type *exp_ty = type_is_ptr(expected->tree_type);
+
+			if(!exp_ty || !type_is_complete(exp_ty)
+			|| type_size(exp_ty, NULL) != type_size(obj_ty, NULL))
+			{
+				warn_at_print_error(&expected->where,
+						"%s's second argument should be \"%s *\" (not \"%s\")",
+						name, type_to_str(obj_ty), type_to_str(expected->tree_type));
+				fold_had_error = 1;
+				return;
+			}
+
+			if(fold_check_expr(e->funcargs[3], FOLD_CHK_INTEGRAL, name))
+				return;
+
+			fold_insert_casts(obj_ty, &e->funcargs[2], stab);
+			break;
+		}
+
+		case ATOMIC_SYNC_BOOL_CAS:
+		case ATOMIC_SYNC_VAL_CAS:
+			fold_insert_casts(obj_ty, &e->funcargs[1], stab);
+			fold_insert_casts(obj_ty, &e->funcargs[2], stab);
+			break;
+
+		case ATOMIC_FETCH_OP:
+		case ATOMIC_OP_FETCH:
+			if(type_is_ptr(obj_ty)){
+				/* unscaled, as gcc */
+				if(fold_check_expr(e->funcargs[1], FOLD_CHK_INTEGRAL, name))
+					return;
+				fold_insert_casts(
+						type_nav_btype(cc1_type_nav, type_intptr_t),
+						&e->funcargs[1], stab);
+				break;
+			}
+			/* fall */
+		case ATOMIC_STORE:
+		case ATOMIC_EXCHANGE:
+			fold_insert_casts(obj_ty, &e->funcargs[1], stab);
+			break;
+
+		default:
+			break;
+	}
+
+	/* the rest are useful for their side effect alone */
+	if(b->kind == ATOMIC_LOAD)
+		e->freestanding = 0; /* needs use */
+}
+
+static void const_atomic(expr *e, consty *k)
+{
+	const struct builtin_atomic *b = e->bits.builtin_atomic;
+	consty sz;
+
+	if(b->kind != ATOMIC_LOCK_FREE){
+		CONST_FOLD_NO(k, e);
+		return;
+	}
+
+	const_fold(e->funcargs[0], &sz);
+	if(sz.type != CONST_NUM){
+		CONST_FOLD_NO(k, e);
+		return;
+	}
+
+	CONST_FOLD_LEAF(k);
+	k->type = CONST_NUM;
+	switch(sz.bits.num.val.i){
+		case 1: case 2: case 4: case 8:
+			k->bits.num.val.i = 1;
+			break;
+		default:
+			k->bits.num.val.i = 0;
+	}
+}
+
+static enum out_memorder atomic_order(const expr *e, out_ctx *octx, int i)
+{
+	const struct builtin_atomic *b = e->bits.builtin_atomic;
+	consty k;
+
+	if(b->order_arg == -1)
+		return b->implied;
+
+	const_fold(e->funcargs[b->order_arg + i], &k);
+	if(k.type == CONST_NUM && k.bits.num.val.i <= OUT_MO_SEQ_CST)
+	{
+		return k.bits.num.val.i;
+	}
+
+	/* a runtime order - use the strongest */
+	out_val_consume(octx, gen_expr(e->funcargs[b->order_arg + i], octx));
+	return OUT_MO_SEQ_CST;
+}
+
+static const out_val *atomic_gen_cmpxchg(const expr *e, out_ctx *octx)
+{
+	const struct builtin_atomic *b = e->bits.builtin_atomic;
+	const out_val *ptr, *expected, *desired, *old, *success;
+	const out_val *exp_ptr = NULL;
+	enum out_memorder mo = atomic_order(e, octx, 0);
+
+	if(b->kind == ATOMIC_CMPXCHG){
+		/* weak is permitted to fail spuriously, cmpxchg never does */
+		out_val_consume(octx, gen_expr(e->funcargs[3], octx));
+		(void)atomic_order(e, octx, 1);
+	}
+
+	ptr = gen_expr(e->funcargs[0], octx);
+
+	if(b->kind == ATOMIC_CMPXCHG){
+		exp_ptr = gen_expr(e->funcargs[1], octx);
+		out_val_retain(octx, exp_ptr);
+		expected = out_deref(octx, exp_ptr);
+	}else{
+		expected = gen_expr(e->funcargs[1], octx);
+	}
+
+	desired = gen_expr(e->funcargs[2], octx);
+
+	old = out_atomic_cmpxchg(octx, ptr, expected, desired, mo, &success);
+
+	switch(b->kind){
+		case ATOMIC_CMPXCHG:
+		{
+			/* *expected is only written when the exchange fails - it may
+			 * alias *ptr, or be shared with other threads */
+			out_blk *blk_fail = out_blk_new(octx, "cmpxchg_fail");
+			out_blk *blk_ok = out_blk_new(octx, "cmpxchg_ok");
+			out_blk *landing = out_blk_new(octx, "cmpxchg_end");
+			type *ty = e->tree_type;
+
+			out_ctrl_branch(octx, success, blk_ok, blk_fail);
+
+			out_current_blk(octx, blk_fail);
+			{
+				out_store(octx, exp_ptr, old);
+				out_ctrl_transfer(octx, landing, out_new_zero(octx, ty), &blk_fail, 1);
+			}
+
+			out_current_blk(octx, blk_ok);
+			{
+				out_ctrl_transfer(octx, landing, out_new_l(octx, ty, 1), &blk_ok, 1);
+			}
+
+			out_current_blk(octx, landing);
+			return out_ctrl_merge(octx, blk_ok, blk_fail);
+		}
+		case ATOMIC_SYNC_BOOL_CAS:
+			out_val_consume(octx, old);
+			return success;
+		default:
+			out_val_consume(octx, success);
+			return out_change_type(octx, old, e->tree_type);
+	}
+}
+
+static const out_val *builtin_gen_atomic(const expr *e, out_ctx *octx)
+{
+	const struct builtin_atomic *b = e->bits.builtin_atomic;
+	type *obj_ty;
+	const out_val *ptr, *val, *old;
+	enum out_memorder mo;
+
+	switch(b->kind){
+		case ATOMIC_FENCE:
+			out_atomic_fence(octx, atomic_order(e, octx, 0));
+			return out_new_noop(octx);
+
+		case ATOMIC_SIGNAL_FENCE:
+			/* only a compiler barrier, which every call to us is */
+			(void)atomic_order(e, octx, 0);
+			return out_new_noop(octx);
+
+		case ATOMIC_LOCK_FREE:
+		{
+			/* reached with -fno-const-fold */
+			consty k;
+
+			const_atomic((expr *)e, &k);
+			assert(k.type == CONST_NUM);
+			return out_new_l(octx, e->tree_type, k.bits.num.val.i);
+		}
+
+		case ATOMIC_CMPXCHG:
+		case ATOMIC_SYNC_BOOL_CAS:
+		case ATOMIC_SYNC_VAL_CAS:
+			return atomic_gen_cmpxchg(e, octx);
+
+		default:
+			break;
+	}
+
+	obj_ty = atomic_obj_type(e);
+	mo = atomic_order(e, octx, 0);
+	ptr = out_change_type(octx, gen_expr(e->funcargs[0], octx), type_ptr_to(obj_ty));
+
+	switch(b->kind){
+		case ATOMIC_LOAD:
+			return out_atomic_load(octx, ptr, mo);
+
+		case ATOMIC_STORE:
+			out_atomic_store(octx, ptr, gen_expr(e->funcargs[1], octx), mo);
+			return out_new_noop(octx);
+
+		case ATOMIC_CLEAR:
+			out_atomic_store(octx, ptr, out_new_zero(octx, obj_ty), mo);
+			return out_new_noop(octx);
+
+		case ATOMIC_EXCHANGE:
+			val = gen_expr(e->funcargs[1], octx);
+			return out_atomic_exchange(octx, ptr, val, mo);
+
+		case ATOMIC_TEST_AND_SET:
+			old = out_atomic_exchange(octx, ptr, out_new_l(octx, obj_ty, 1), mo);
+			return out_op(octx, op_ne, old, out_new_zero(octx, obj_ty));
+
+		case ATOMIC_FETCH_OP:
+			val = gen_expr(e->funcargs[1], octx);
+			old = out_atomic_fetch_op(octx, b->op, ptr, val, mo);
+			return out_change_type(octx, old, e->tree_type);
+
+		case ATOMIC_OP_FETCH:
+		{
+			const out_val *new;
+
+			val = gen_expr(e->funcargs[1], octx);
+			out_val_retain(octx, val);
+			old = out_atomic_fetch_op(octx, b->op, ptr, val, mo);
+
+			if(b->op == op_bnot)
+				new = out_op_unary(octx, op_bnot, out_op(octx, op_and, old, val));
+			else
+				new = out_op(octx, b->op, old, val);
+
+			return out_change_type(octx, new, e->tree_type);
+		}
+
+		default:
+			break;
+	}
+
+	ICE("bad atomic builtin %s", b->name);
+}
+
+expr *builtin_parse_atomic(const char *ident, symtable *scope)
+{
+	expr *fcall;
+	unsigned i;
+
+	if(strncmp(ident, "__atomic_", 9) && strncmp(ident, "__sync_", 7))
+		return NULL;
+
+	for(i = 0; i < countof(builtin_atomics); i++)
+		if(!strcmp(ident, builtin_atomics[i].name))
+			break;
+
+	if(i == countof(builtin_atomics))
+		return NULL;
+
+	fcall = parse_any_args(scope);
+	fcall->bits.builtin_atomic = &builtin_atomics[i];
+
+	expr_mutate_builtin(fcall, atomic);
+	fcall->f_const_fold = const_atomic;
+
+	return fcall;
+}
@@ -0,0 +1,7 @@
+#ifndef BUILTIN_ATOMIC_H
+#define BUILTIN_ATOMIC_H
+
+/* __atomic_* and __sync_*, NULL if ident isn't one of them */
+expr *builtin_parse_atomic(const char *ident, symtable *scope);
+
+#endif
@@ -21,9 +21,69 @@
 	BUILTIN("add_overflow", add_overflow)         \
 	BUILTIN("sub_overflow", sub_overflow)         \
 	BUILTIN("mul_overflow", mul_overflow)         \
+	BUILTIN("popcount", bitop)                    \
+	BUILTIN("popcountl", bitop)                   \
+	BUILTIN("popcountll", bitop)                  \
+	BUILTIN("clz", bitop)                         \
+	BUILTIN("clzl", bitop)                        \
+	BUILTIN("clzll", bitop)                       \
+	BUILTIN("ctz", bitop)                         \
+	BUILTIN("ctzl", bitop)                        \
+	BUILTIN("ctzll", bitop)                       \
+	BUILTIN("ffs", bitop)                         \
+	BUILTIN("ffsl", bitop)                        \
+	BUILTIN("ffsll", bitop)                       \
+	BUILTIN("bswap16", bitop)                     \
+	BUILTIN("bswap32", bitop)                     \
+	BUILTIN("bswap64", bitop)                     \
+	BUILTIN("prefetch", prefetch)                 \
+	BUILTIN("assume_aligned", assume_aligned)     \
 	BUILTIN("va_start", va_start)                 \
 	BUILTIN("va_arg", va_arg)                     \
 	BUILTIN("va_end", va_end)                     \
 	BUILTIN("va_copy", va_copy)
 
+/* name, kind, op, argument count, memory order argument index (-1: implied), implied order
+ * the op is bnot for nand */
+#define ATOMIC_BUILTINS \
+	ATOMIC_BUILTIN("__atomic_load_n", LOAD, 0, 2, 1, RELAXED)                        \
+	ATOMIC_BUILTIN("__atomic_store_n", STORE, 0, 3, 2, RELAXED)                      \
+	ATOMIC_BUILTIN("__atomic_exchange_n", EXCHANGE, 0, 3, 2, RELAXED)                \
+	ATOMIC_BUILTIN("__atomic_compare_exchange_n", CMPXCHG, 0, 6, 4, RELAXED)         \
+	ATOMIC_BUILTIN("__atomic_test_and_set", TEST_AND_SET, 0, 2, 1, RELAXED)          \
+	ATOMIC_BUILTIN("__atomic_clear", CLEAR, 0, 2, 1, RELAXED)                        \
+	ATOMIC_BUILTIN("__atomic_thread_fence", FENCE, 0, 1, 0, RELAXED)                 \
+	ATOMIC_BUILTIN("__atomic_signal_fence", SIGNAL_FENCE, 0, 1, 0, RELAXED)          \
+	ATOMIC_BUILTIN("__atomic_always_lock_free", LOCK_FREE, 0, 2, -1, RELAXED)        \
+	ATOMIC_BUILTIN("__atomic_is_lock_free", LOCK_FREE, 0, 2, -1, RELAXED)            \
+	ATOMIC_BUILTIN("__atomic_fetch_add", FETCH_OP, op_plus, 3, 2, RELAXED)           \
+	ATOMIC_BUILTIN("__atomic_add_fetch", OP_FETCH, op_plus, 3, 2, RELAXED)           \
+	ATOMIC_BUILTIN("__atomic_fetch_sub", FETCH_OP, op_minus, 3, 2, RELAXED)          \
+	ATOMIC_BUILTIN("__atomic_sub_fetch", OP_FETCH, op_minus, 3, 2, RELAXED)          \
+	ATOMIC_BUILTIN("__atomic_fetch_and", FETCH_OP, op_and, 3, 2, RELAXED)            \
+	ATOMIC_BUILTIN("__atomic_and_fetch", OP_FETCH, op_and, 3, 2, RELAXED)            \
+	ATOMIC_BUILTIN("__atomic_fetch_or", FETCH_OP, op_or, 3, 2, RELAXED)              \
+	ATOMIC_BUILTIN("__atomic_or_fetch", OP_FETCH, op_or, 3, 2, RELAXED)              \
+	ATOMIC_BUILTIN("__atomic_fetch_xor", FETCH_OP, op_xor, 3, 2, RELAXED)            \
+	ATOMIC_BUILTIN("__atomic_xor_fetch", OP_FETCH, op_xor, 3, 2, RELAXED)            \
+	ATOMIC_BUILTIN("__atomic_fetch_nand", FETCH_OP, op_bnot, 3, 2, RELAXED)          \
+	ATOMIC_BUILTIN("__atomic_nand_fetch", OP_FETCH, op_bnot, 3, 2, RELAXED)          \
+	ATOMIC_BUILTIN("__sync_fetch_and_add", FETCH_OP, op_plus, 2, -1, SEQ_CST)        \
+	ATOMIC_BUILTIN("__sync_add_and_fetch", OP_FETCH, op_plus, 2, -1, SEQ_CST)        \
+	ATOMIC_BUILTIN("__sync_fetch_and_sub", FETCH_OP, op_minus, 2, -1, SEQ_CST)       \
+	ATOMIC_BUILTIN("__sync_sub_and_fetch", OP_FETCH, op_minus, 2, -1, SEQ_CST)       \
+	ATOMIC_BUILTIN("__sync_fetch_and_and", FETCH_OP, op_and, 2, -1, SEQ_CST)         \
+	ATOMIC_BUILTIN("__sync_and_and_fetch", OP_FETCH, op_and, 2, -1, SEQ_CST)         \
+	ATOMIC_BUILTIN("__sync_fetch_and_or", FETCH_OP, op_or, 2, -1, SEQ_CST)           \
+	ATOMIC_BUILTIN("__sync_or_and_fetch", OP_FETCH, op_or, 2, -1, SEQ_CST)           \
+	ATOMIC_BUILTIN("__sync_fetch_and_xor", FETCH_OP, op_xor, 2, -1, SEQ_CST)         \
+	ATOMIC_BUILTIN("__sync_xor_and_fetch", OP_FETCH, op_xor, 2, -1, SEQ_CST)         \
+	ATOMIC_BUILTIN("__sync_fetch_and_nand", FETCH_OP, op_bnot, 2, -1, SEQ_CST)       \
+	ATOMIC_BUILTIN("__sync_nand_and_fetch", OP_FETCH, op_bnot, 2, -1, SEQ_CST)       \
+	ATOMIC_BUILTIN("__sync_bool_compare_and_swap", SYNC_BOOL_CAS, 0, 3, -1, SEQ_CST) \
+	ATOMIC_BUILTIN("__sync_val_compare_and_swap", SYNC_VAL_CAS, 0, 3, -1, SEQ_CST)   \
+	ATOMIC_BUILTIN("__sync_lock_test_and_set", EXCHANGE, 0, 2, -1, ACQUIRE)          \
+	ATOMIC_BUILTIN("__sync_lock_release", CLEAR, 0, 1, -1, RELEASE)                  \
+	ATOMIC_BUILTIN("__sync_synchronize", FENCE, 0, 0, -1, SEQ_CST)
+
 #endif
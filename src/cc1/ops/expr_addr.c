@@ -11,6 +11,8 @@
 #include "../type_nav.h"
 #include "expr_identifier.h"
 #include "expr_struct.h"
+#include "expr__Generic.h"
+#include "__builtin.h"
 
 const char *str_expr_addr(void)
 {
@@ -33,6 +35,21 @@ expr *expr_addr_target(const expr *e)
 	return e->lhs;
 }
 
+static expr *addr_skip_selections(expr *e)
+{
+	/* &_Generic(..., T: x) and &__builtin_choose_expr(..., x, ...) address x */
+	for(;;){
+		expr *chosen;
+
+		if(expr_kind(e, _Generic) && e->bits.generic.chosen)
+			chosen = e->bits.generic.chosen->e;
+		else if(!(chosen = builtin_choose_expr_chosen(e)))
+			return e;
+
+		e = chosen;
+	}
+}
+
 void fold_expr_addr(expr *e, symtable *stab)
 {
 	if(e->bits.lbl.spel){
@@ -53,6 +70,8 @@ void fold_expr_addr(expr *e, symtable *stab)
 		e->tree_type = type_ptr_to(type_nav_btype(cc1_type_nav, type_void));
 
 	}else{
+		expr *target;
+
 		/* if it's an identifier, act as a read */
 		fold_inc_writes_if_sym(e->lhs, stab);
 
@@ -68,8 +87,8 @@ void fold_expr_addr(expr *e, symtable *stab)
 			return;
 		}
 
-		if(expr_kind(e->lhs, identifier)){
-			sym *sym = e->lhs->bits.ident.bits.ident.sym;
+		if(expr_kind(target = addr_skip_selections(e->lhs), identifier)){
+			sym *sym = target->bits.ident.bits.ident.sym;
 			if(sym){
 				decl *d = sym->decl;
 
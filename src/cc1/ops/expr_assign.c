@@ -87,11 +87,13 @@ void expr_assign_const_check(expr *e, where *w)
 
 static const out_val *lea_assign_lhs(const expr *e, out_ctx *octx)
 {
-	/* generate our assignment (e->expr), then lea
-	 * our lhs, i.e. the struct identifier
-	 * we're assigning to */
-	out_val_consume(octx, gen_expr(e->expr, octx));
-	return gen_expr(e->lhs, octx);
+	/* generate our assignment (e->expr), which gives back
+	 * the address of our lhs - regenerating the lhs would
+	 * repeat its side effects, e.g. *f() = s */
+	return out_change_type(
+			octx,
+			gen_expr(e->expr, octx),
+			type_ptr_to(e->lhs->tree_type));
 }
 
 void fold_expr_assign(expr *e, symtable *stab)
@@ -188,6 +190,14 @@ const out_val *gen_expr_assign(const expr *e, out_ctx *octx)
 
 	val = gen_expr(e->rhs, octx);
 	store = gen_expr(e->lhs, octx);
+
+	if(type_qual(e->lhs->tree_type) & qual_atomic){
+		/* the result is the value stored, another thread may have changed it since */
+		out_val_retain(octx, val);
+		out_atomic_store(octx, store, val, OUT_MO_SEQ_CST);
+		return val;
+	}
+
 	out_val_retain(octx, store);
 
 	out_store(octx, store, val);
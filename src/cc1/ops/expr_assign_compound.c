@@ -1,3 +1,5 @@
+#include "../../util/platform.h"
+
 #include "ops.h"
 #include "expr_assign_compound.h"
 
@@ -5,12 +7,55 @@
 #include "expr_op.h"
 
 #include "../type_nav.h"
+#include "../type_is.h"
 
 const char *str_expr_assign_compound(void)
 {
 	return "compound-assignment";
 }
 
+static int assign_compound_is_atomic(const expr *e)
+{
+	return type_qual(e->lhs->tree_type) & qual_atomic;
+}
+
+static int assign_compound_atomic_is_fetch_op(const expr *e)
+{
+	/* these map onto a single atomic read-modify-write,
+	 * anything else is retried with cmpxchg */
+	type *ty = e->tree_type;
+
+	if(!type_is_integral(e->rhs->tree_type)
+	|| type_is_primitive(ty, type__Bool))
+	{
+		return 0;
+	}
+
+	switch(e->bits.compoundop.op){
+		case op_plus:
+		case op_minus:
+			return type_is_integral(ty) || type_is_nonvoid_ptr(ty);
+		case op_and:
+		case op_or:
+		case op_xor:
+			return type_is_integral(ty);
+		default:
+			return 0;
+	}
+}
+
+static void fold_check_atomic(expr *e)
+{
+	/* cmpxchg can't compare anything wider than a word, e.g. long double */
+	if(type_size(e->tree_type, &e->where) > platform_word_size()){
+		warn_at_print_error(&e->where,
+				"unsupported %s= on _Atomic type '%s'",
+				op_to_str(e->bits.compoundop.op),
+				type_to_str(e->lhs->tree_type));
+		fold_had_error = 1;
+	}
+}
+
 void fold_expr_assign_compound(expr *e, symtable *stab)
 {
 	const char *const desc = "compound assignment";
@@ -69,10 +114,132 @@ void fold_expr_assign_compound(expr *e, symtable *stab)
 		/*type_free_1(resolved); XXX: memleak */
 	}
 
+	if(assign_compound_is_atomic(e))
+		fold_check_atomic(e);
+
 	/* type check is done in op_required_promotion() */
 #undef lvalue
 }
 
+static const out_val *gen_expr_assign_compound_cas(
+		const expr *e, out_ctx *octx)
+{
+	/* old = *p;
+	 * do new = old op rhs;
+	 * while(!cmpxchg(p, &old, new));
+	 *
+	 * the values cross blocks, so they're kept in stack slots.
+	 * the exchange is done on an integer of the same size, which
+	 * also lets floating values through, read back via the slots */
+	type *ty = e->tree_type;
+	type *int_ty = type_nav_MAX_FOR(
+			cc1_type_nav, type_size(ty, &e->where), 0);
+	type *ptr_ty = type_ptr_to(ty);
+	type *int_ptr_ty = type_ptr_to(int_ty);
+	const out_val *addr_slot, *rhs_slot, *old_slot, *new_slot;
+	const out_val *addr_lhs, *rhs, *old, *result, *success;
+	out_blk *blk_retry, *blk_done;
+
+	addr_lhs = gen_expr(e->lhs, octx);
+	rhs = gen_expr(e->rhs, octx);
+
+	addr_slot = out_aalloct(octx, int_ptr_ty);
+	rhs_slot = out_aalloct(octx, e->rhs->tree_type);
+	old_slot = out_aalloct(octx, int_ty);
+	new_slot = out_aalloct(octx, int_ty);
+
+	out_store(octx, out_val_retain(octx, rhs_slot), rhs);
+	out_store(octx, out_val_retain(octx, addr_slot),
+			out_change_type(octx, addr_lhs, int_ptr_ty));
+
+	old = out_atomic_load(octx,
+			out_deref(octx, out_val_retain(octx, addr_slot)),
+			OUT_MO_SEQ_CST);
+	out_store(octx, out_val_retain(octx, old_slot), old);
+
+	blk_retry = out_blk_new(octx, "atomic_compound_retry");
+	blk_done = out_blk_new(octx, "atomic_compound_done");
+
+	out_ctrl_transfer_make_current(octx, blk_retry);
+	{
+		const out_val *lhs = out_deref(octx,
+				out_change_type(octx, out_val_retain(octx, old_slot), ptr_ty));
+
+		if(e->bits.compoundop.upcast_ty)
+			lhs = out_cast(octx, lhs, e->bits.compoundop.upcast_ty, /*normalise_bool:*/1);
+
+		result = out_op(octx, e->bits.compoundop.op,
+				lhs, out_deref(octx, out_val_retain(octx, rhs_slot)));
+		gen_op_trapv(ty, &result, octx, e->bits.compoundop.op);
+
+		if(e->bits.compoundop.upcast_ty)
+			result = out_cast(octx, result, ty, /*normalise_bool:*/1);
+
+		out_store(octx,
+				out_change_type(octx, out_val_retain(octx, new_slot), ptr_ty),
+				result);
+
+		/* on failure, cmpxchg hands back the current value for the next attempt */
+		old = out_atomic_cmpxchg(octx,
+				out_deref(octx, out_val_retain(octx, addr_slot)),
+				out_deref(octx, out_val_retain(octx, old_slot)),
+				out_deref(octx, out_val_retain(octx, new_slot)),
+				OUT_MO_SEQ_CST, &success);
+		out_store(octx, out_val_retain(octx, old_slot), old);
+
+		out_ctrl_branch(octx, success, blk_done, blk_retry);
+	}
+
+	out_current_blk(octx, blk_done);
+
+	result = out_deref(octx,
+			out_change_type(octx,
+				out_val_retain(octx, e->assign_is_post ? old_slot : new_slot),
+				ptr_ty));
+
+	out_adealloc(octx, &new_slot);
+	out_adealloc(octx, &old_slot);
+	out_adealloc(octx, &rhs_slot);
+	out_adealloc(octx, &addr_slot);
+
+	return result;
+}
+
+static const out_val *gen_expr_assign_compound_atomic(
+		const expr *e, out_ctx *octx)
+{
+	/* lock xadd and friends give us the old value,
+	 * the new one is recomputed from it */
+	const enum op_type op = e->bits.compoundop.op;
+	type *ty = e->tree_type;
+	type *pointee = type_is_ptr(ty);
+	const out_val *addr_lhs, *rhs, *old;
+
+	addr_lhs = gen_expr(e->lhs, octx);
+	rhs = gen_expr(e->rhs, octx);
+
+	if(pointee){
+		type *intptr_ty = type_nav_btype(cc1_type_nav, type_intptr_t);
+
+		rhs = out_op(octx, op_multiply,
+				out_cast(octx, rhs, intptr_ty, 0),
+				out_new_l(octx, intptr_ty, type_size(pointee, &e->where)));
+	}else{
+		/* any promotion is undone by truncating rhs, these ops wrap */
+		rhs = out_cast(octx, rhs, ty, 0);
+	}
+
+	if(!e->assign_is_post)
+		out_val_retain(octx, rhs);
+
+	old = out_atomic_fetch_op(octx, op, addr_lhs, rhs, OUT_MO_SEQ_CST);
+
+	if(e->assign_is_post)
+		return out_change_type(octx, old, ty);
+
+	return out_change_type(octx, out_op(octx, op, old, rhs), ty);
+}
+
 const out_val *gen_expr_assign_compound(const expr *e, out_ctx *octx)
 {
 	/* int += float
@@ -80,6 +247,12 @@ const out_val *gen_expr_assign_compound(const expr *e, out_ctx *octx)
 	 */
 	const out_val *saved_post = NULL, *addr_lhs, *rhs, *lhs, *result;
 
+	if(assign_compound_is_atomic(e)){
+		if(assign_compound_atomic_is_fetch_op(e))
+			return gen_expr_assign_compound_atomic(e, octx);
+		return gen_expr_assign_compound_cas(e, octx);
+	}
+
 	addr_lhs = gen_expr(e->lhs, octx);
 
 	out_val_retain(octx, addr_lhs); /* 2 */
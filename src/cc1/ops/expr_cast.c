@@ -611,6 +611,7 @@ const out_val *gen_expr_cast(const expr *e, out_ctx *octx)
 	type *tfrom = expr_cast_child(e)->tree_type;
 	const int cast_to_void = type_is_void(tto);
 	const int is_volatile = type_qual(tfrom) & qual_volatile;
+	const int is_atomic = type_qual(tfrom) & qual_atomic;
 	const out_val *casted;
 
 	/* return if cast-to-void */
@@ -619,7 +620,7 @@ const out_val *gen_expr_cast(const expr *e, out_ctx *octx)
 		return out_change_type(octx, gen_expr(expr_cast_child(e), octx), tto);
 	}
 
-	if(expr_cast_is_lval2rval(e) && !is_volatile){
+	if(expr_cast_is_lval2rval(e) && !is_volatile && !is_atomic){
 		/* we're an lval2rval cast
 		 * if inlining, check if we can substitute the lvalue's rvalue here
 		 */
@@ -665,7 +666,10 @@ const out_val *gen_expr_cast(const expr *e, out_ctx *octx)
 
 		}else{
 			/* primitive lval2rval */
-			casted = out_deref(octx, casted);
+			if(is_atomic)
+				casted = out_atomic_load(octx, casted, OUT_MO_SEQ_CST);
+			else
+				casted = out_deref(octx, casted);
 
 			if(type_is_primitive(e->tree_type, type__Bool))
 				sanitize_bool(casted, octx);
@@ -33,8 +33,9 @@ static void fold_const_expr_identifier(expr *e, consty *k)
 			if(sym && sym->decl){
 				decl *const d = sym->decl;
 
-				/* only a constant if global/static/extern */
-				if(decl_store_duration_is_static(d)){
+				/* only a constant if global/static/extern,
+				 * thread-locals have a per-thread address */
+				if(decl_store_duration_is_static(d) && !(d->store & store_thread)){
 					/* weak identifiers are constant, but not necessarily true */
 					CONST_FOLD_LEAF(k);
 
@@ -8,8 +8,12 @@
 #include "../out/lbl.h"
 #include "../type_is.h"
 #include "../type_nav.h"
+#include "../fopt.h"
 
+#include "expr_identifier.h"
+#include "expr_val.h"
 #include "expr_op.h"
+#include "expr_cast.h"
 
 const char *str_expr_if(void)
 {
@@ -39,7 +43,11 @@ static void fold_const_expr_if(expr *e, consty *k)
 		case CONST_NUM:
 		{
 			numeric *n = &consts[0].bits.num;
-			res = n->suffix & VAL_FLOATING ? n->val.f : n->val.i;
+			/* compare rather than convert - the condition may not fit an int */
+			if(n->suffix & VAL_FLOATING)
+				res = n->val.f != 0;
+			else
+				res = n->val.i != 0;
 			break;
 		}
 		case CONST_ADDR:
@@ -273,12 +281,104 @@ void fold_expr_if(expr *e, symtable *stab)
 	}
 }
 
+/* can the arm be evaluated whether or not it's selected?
+ * object reads, constants and a level of simple arithmetic */
+static int if_arm_is_cheap(const expr *e, int ops)
+{
+	type *ty = e->tree_type;
+
+	if(type_qual(ty) & qual_volatile)
+		return 0;
+
+	if(expr_kind(e, identifier)){
+		decl *d;
+
+		if(e->bits.ident.type == IDENT_ENUM)
+			return 1;
+
+		d = e->bits.ident.bits.ident.sym->decl;
+		return !(d->store & store_thread) && !type_is_vla(ty, VLA_ANY_DIMENSION);
+	}
+
+	if(!type_is_integral(ty) && !type_is_ptr(ty))
+		return 0;
+
+	if(expr_kind(e, val))
+		return 1;
+
+	if(expr_kind(e, cast))
+		return if_arm_is_cheap(expr_cast_child(e), ops);
+
+	if(expr_kind(e, op)){
+		switch(e->bits.op.op){
+			case op_plus:
+			case op_minus:
+			case op_and:
+			case op_or:
+			case op_xor:
+			case op_bnot:
+				break;
+			default:
+				return 0;
+		}
+
+		if(ops == 0)
+			return 0;
+
+		return if_arm_is_cheap(e->lhs, ops - 1)
+			&& (!e->rhs || if_arm_is_cheap(e->rhs, ops - 1));
+	}
+
+	return 0;
+}
+
+static int if_can_select(const expr *e)
+{
+	type *ty = e->tree_type;
+
+	if(!cc1_fopt.if_conversion || !e->lhs)
+		return 0;
+
+	/* cmov has no byte form, and floats would need a blend */
+	if(!type_is_integral(ty) && !type_is_ptr(ty))
+		return 0;
+	if(type_size(ty, NULL) < 2)
+		return 0;
+
+	return if_arm_is_cheap(e->lhs, 1) && if_arm_is_cheap(e->rhs, 1);
+}
+
+static const out_val *gen_expr_if_select(const expr *e, out_ctx *octx)
+{
+	/* a condition without side effects is generated last, so nothing
+	 * comes between its flags and the select */
+	const int cond_first = expr_has_sideeffects(e->expr);
+	const out_val *cond = NULL, *vtrue, *vfalse;
+
+	if(cond_first)
+		cond = gen_expr(e->expr, octx);
+
+	vtrue = out_cast(octx, gen_expr(e->lhs, octx), e->tree_type, 0);
+	vfalse = out_cast(octx, gen_expr(e->rhs, octx), e->tree_type, 0);
+
+	if(!cond_first)
+		cond = gen_expr(e->expr, octx);
+
+	return out_select(octx, cond, vtrue, vfalse);
+}
+
 const out_val *gen_expr_if(const expr *e, out_ctx *octx)
 {
-	out_blk *landing = out_blk_new(octx, "if_end"),
-	        *blk_lhs = out_blk_new(octx, "if_lhs"),
-	        *blk_rhs = out_blk_new(octx, "if_rhs");
-	const out_val *cond = gen_expr(e->expr, octx);
+	out_blk *landing, *blk_lhs, *blk_rhs;
+	const out_val *cond;
+
+	if(if_can_select(e))
+		return gen_expr_if_select(e, octx);
+
+	landing = out_blk_new(octx, "if_end");
+	blk_lhs = out_blk_new(octx, "if_lhs");
+	blk_rhs = out_blk_new(octx, "if_rhs");
+	cond = gen_expr(e->expr, octx);
 
 	if(!e->lhs)
 		out_val_retain(octx, cond);
@@ -3,6 +3,7 @@
 #include "ops.h"
 #include "stmt_case.h"
 #include "../out/lbl.h"
+#include "../profile.h"
 
 const char *str_stmt_case(void)
 {
@@ -20,6 +21,7 @@ void fold_stmt_case(stmt *t)
 void gen_stmt_case(const stmt *s, out_ctx *octx)
 {
 	out_ctrl_transfer_make_current(octx, s->bits.case_blk);
+	profile_count(s, 0, octx);
 	gen_stmt(s->lhs, octx);
 }
 
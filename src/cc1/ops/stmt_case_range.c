@@ -3,6 +3,7 @@
 #include "ops.h"
 #include "stmt_case_range.h"
 #include "../out/lbl.h"
+#include "../profile.h"
 
 const char *str_stmt_case_range(void)
 {
@@ -37,6 +38,7 @@ void fold_stmt_case_range(stmt *s)
 void gen_stmt_case_range(const stmt *s, out_ctx *octx)
 {
 	out_ctrl_transfer_make_current(octx, s->bits.case_blk);
+	profile_count(s, 0, octx);
 	gen_stmt(s->lhs, octx);
 }
 
@@ -288,6 +288,15 @@ static void gen_auto_decl_alloc(decl *d, out_ctx *octx)
 				align = decl_align(s->decl);
 			}
 
+			if(!vm){
+				const out_val *reg = gen_regvar_alloc(octx, s);
+
+				if(reg){
+					gen_set_sym_outval(octx, s, reg);
+					break;
+				}
+			}
+
 			gen_set_sym_outval(octx, s, out_aalloc(octx, siz, align, s->decl->ref));
 			break;
 		}
@@ -295,6 +304,7 @@ static void gen_auto_decl_alloc(decl *d, out_ctx *octx)
 		case store_static:
 		case store_extern:
 		case store_inline:
+		case store_thread:
 			break;
 	}
 }
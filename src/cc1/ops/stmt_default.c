@@ -3,6 +3,7 @@
 #include "ops.h"
 #include "stmt_default.h"
 #include "../out/lbl.h"
+#include "../profile.h"
 
 const char *str_stmt_default(void)
 {
@@ -17,6 +18,7 @@ void fold_stmt_default(stmt *s)
 void gen_stmt_default(const stmt *s, out_ctx *octx)
 {
 	out_ctrl_transfer_make_current(octx, s->bits.case_blk);
+	profile_count(s, 0, octx);
 	gen_stmt(s->lhs, octx);
 }
 
@@ -3,6 +3,8 @@
 #include "ops.h"
 #include "stmt_do.h"
 #include "../out/lbl.h"
+#include "../profile.h"
+#include "../cc1_out_ctx.h"
 
 const char *str_stmt_do(void)
 {
@@ -18,16 +20,21 @@ void gen_stmt_do(const stmt *s, out_ctx *octx)
 {
 	const out_val *cond;
 	out_blk *begin;
+	struct cc1_out_ctx *cc1_octx = cc1_out_ctx_or_new(octx);
 
 	begin = out_blk_new(octx, "do_begin");
 	stmt_init_blks(s,
 			out_blk_new(octx, "do_test"),
 			out_blk_new(octx, "do_end"));
 
+	profile_count(s, 1, octx);
 	out_ctrl_transfer(octx, begin, NULL, NULL, 0);
 
+	cc1_octx->loop_depth++;
+
 	out_current_blk(octx, begin);
 	{
+		profile_count(s, 0, octx);
 		gen_stmt(s->lhs, octx);
 		out_ctrl_transfer(octx, s->blk_continue, NULL, NULL, 0);
 	}
@@ -35,9 +42,12 @@ void gen_stmt_do(const stmt *s, out_ctx *octx)
 	out_current_blk(octx, s->blk_continue);
 	{
 		cond = gen_expr(s->expr, octx);
+		cond = profile_branch(s, cond, octx);
 		out_ctrl_branch(octx, cond, begin, s->blk_break);
 	}
 
+	cc1_octx->loop_depth--;
+
 	out_current_blk(octx, s->blk_break);
 }
 
@@ -5,7 +5,10 @@
 #include "stmt_for.h"
 #include "stmt_code.h"
 #include "../out/lbl.h"
+#include "../profile.h"
+#include "../cc1_out_ctx.h"
 #include "../decl_init.h"
+#include "../loop.h"
 
 const char *str_stmt_for(void)
 {
@@ -36,6 +39,7 @@ void gen_stmt_for(const stmt *s, out_ctx *octx)
 	        *blk_body = out_blk_new(octx, "for_body"),
 	        *blk_end = out_blk_new(octx, "for_end"),
 	        *blk_inc = out_blk_new(octx, "for_inc");
+	struct cc1_out_ctx *cc1_octx = cc1_out_ctx_or_new(octx);
 
 	flow_gen(s->flow, s->flow->for_init_symtab, el, octx);
 
@@ -46,11 +50,18 @@ void gen_stmt_for(const stmt *s, out_ctx *octx)
 		out_comment(octx, "for-init");
 	}
 
+	profile_count(s, 1, octx);
+
+	loop_begin(s, octx);
+
+	cc1_octx->loop_depth++;
+
 	out_ctrl_transfer_make_current(octx, blk_test);
 	if(s->flow->for_while){
 		const out_val *for_cond;
 
 		for_cond = gen_expr(s->flow->for_while, octx);
+		for_cond = profile_branch(s, for_cond, octx);
 
 		out_ctrl_branch(octx, for_cond, blk_body, blk_end);
 	}else{
@@ -61,6 +72,7 @@ void gen_stmt_for(const stmt *s, out_ctx *octx)
 
 	out_current_blk(octx, blk_body);
 	{
+		profile_count(s, 0, octx);
 		gen_stmt(s->lhs, octx);
 		out_ctrl_transfer(octx, blk_inc, NULL, NULL, 0);
 	}
@@ -69,9 +81,14 @@ void gen_stmt_for(const stmt *s, out_ctx *octx)
 	{
 		if(s->flow->for_inc)
 			out_val_consume(octx, gen_expr(s->flow->for_inc, octx));
+		loop_inc(s, octx);
 		out_ctrl_transfer(octx, blk_test, NULL, NULL, 0);
 	}
 
+	cc1_octx->loop_depth--;
+
+	loop_end(s, octx);
+
 	out_current_blk(octx, blk_end);
 	flow_end(s->flow, s->flow->for_init_symtab, el, octx);
 }
@@ -8,6 +8,7 @@
 #include "../fold_sym.h"
 #include "../out/dbg.h"
 #include "../out/dbg_lbl.h"
+#include "../profile.h"
 
 const char *str_stmt_if(void)
 {
@@ -96,17 +97,20 @@ void gen_stmt_if(const stmt *s, out_ctx *octx)
 
 	flow_gen(s->flow, s->symtab, el, octx);
 	cond = gen_expr(s->expr, octx);
+	cond = profile_branch(s, cond, octx);
 
 	out_ctrl_branch(octx, cond, blk_true, blk_false);
 
 	out_current_blk(octx, blk_true);
 	{
+		profile_count(s, 0, octx);
 		gen_stmt(s->lhs, octx);
 		out_ctrl_transfer(octx, blk_fi, NULL, NULL, 0);
 	}
 
 	out_current_blk(octx, blk_false);
 	{
+		profile_count(s, 1, octx);
 		if(s->rhs)
 			gen_stmt(s->rhs, octx);
 		out_ctrl_transfer(octx, blk_fi, NULL, NULL, 0);
@@ -2,6 +2,7 @@
 #include "stmt_return.h"
 
 #include "expr_block.h"
+#include "expr_funcall.h"
 #include "../funcargs.h"
 #include "../type_is.h"
 #include "../type_nav.h"
@@ -9,6 +10,7 @@
 #include "../cc1_out_ctx.h"
 #include "../inline.h"
 #include "../sanitize.h"
+#include "../fopt.h"
 
 const char *str_stmt_return(void)
 {
@@ -87,12 +89,83 @@ void fold_stmt_return(stmt *s)
 	}
 }
 
+static int symtab_frame_escapes(symtable *stab)
+{
+	symtable **si;
+	decl **di;
+
+	for(di = symtab_decls(stab); di && *di; di++){
+		decl *d = *di;
+
+		if(STORE_IS_TYPEDEF(d->store)
+		|| type_is(d->ref, type_func)
+		|| decl_store_duration_is_static(d))
+		{
+			continue;
+		}
+
+		/* anything that may be pointed to must outlive the call:
+		 * addressed scalars, aggregates (array decay, member addresses),
+		 * VLAs, compound literals (unnamed) and cleanups */
+		if(d->flags & DECL_FLAGS_ADDRESSED
+		|| !type_is_scalar(d->ref)
+		|| !d->spel
+		|| attribute_present(d, attr_cleanup))
+		{
+			return 1;
+		}
+	}
+
+	for(si = stab->children; si && *si; si++)
+		if(symtab_frame_escapes(*si))
+			return 1;
+
+	return 0;
+}
+
+static int stmt_return_sibling_call(const stmt *s, out_ctx *octx)
+{
+	struct cc1_out_ctx *cc1_octx = *cc1_out_ctx(octx);
+	decl *in_func;
+
+	if(!cc1_fopt.optimize_sibling_calls)
+		return 0;
+
+	/* an inlined return is only ours if the inlined call was */
+	if(cc1_octx && cc1_octx->inline_.depth && !cc1_octx->inline_.sibling)
+		return 0;
+
+	if(!s->expr || !expr_kind(s->expr, funcall))
+		return 0;
+
+	/* struct returns involve our own stret space */
+	if(type_is_s_or_u(s->expr->tree_type))
+		return 0;
+
+	in_func = symtab_func(s->symtab);
+	if(attribute_present(in_func, attr_returns_nonnull))
+		return 0;
+
+	return !symtab_frame_escapes(symtab_func_root(s->symtab));
+}
+
 void gen_stmt_return(const stmt *s, out_ctx *octx)
 {
 	struct cc1_out_ctx **pcc1_octx, *cc1_octx;
+	const out_val *ret_exp = NULL;
+
+	if(s->expr){
+		const int sibling = stmt_return_sibling_call(s, octx);
 
-	/* need to generate the ret expr before the scope leave code */
-	const out_val *ret_exp = s->expr ? gen_expr(s->expr, octx) : NULL;
+		if(sibling)
+			cc1_out_ctx_or_new(octx)->sibling_call = s->expr->expr;
+
+		/* need to generate the ret expr before the scope leave code */
+		ret_exp = gen_expr(s->expr, octx);
+
+		if(sibling)
+			(*cc1_out_ctx(octx))->sibling_call = NULL;
+	}
 
 	if(s->expr
 	&& type_is_ptr_or_block(s->expr->tree_type)
@@ -7,8 +7,11 @@
 #include "../sue.h"
 #include "../../util/alloc.h"
 #include "../out/lbl.h"
+#include "../type_nav.h"
+#include "../fopt.h"
 #include "../type_is.h"
 #include "../../util/dynarray.h"
+#include "../profile.h"
 
 #include "expr_op.h"
 
@@ -269,12 +272,258 @@ void fold_stmt_switch(stmt *s)
 		cc1_warn_at(&s->where, switch_default, "switch has no default label");
 }
 
+/* switch lowering:
+ * - fewer than SWITCH_BSEARCH_MIN cases: a compare chain, in source order
+ * - dense enough: a table of (case - table) offsets in .rodata
+ * - otherwise: a balanced binary search over the sorted cases
+ * with -fprofile-use, cases taking most of the remaining executions are
+ * first peeled off into compares ahead of the above
+ */
+#define SWITCH_BSEARCH_MIN 4
+#define SWITCH_TABLE_MIN 4
+#define SWITCH_TABLE_DENSITY 10 /* max table entries per case value */
+#define SWITCH_TABLE_MAX 65536
+#define SWITCH_PEEL_MAX 3
+
+struct switch_case
+{
+	/* keys are the case values truncated to the controlling type,
+	 * with the sign bit flipped for signed types, so an unsigned
+	 * comparison of keys orders cases as the switch type does */
+	integral_t lo, hi;
+	stmt *cse;
+};
+
+static integral_t switch_key(const numeric *n, type *ty)
+{
+	sintegral_t sext;
+	integral_t trunc = integral_truncate(n->val.i, type_size(ty, NULL), &sext);
+
+	if(type_is_signed(ty))
+		return (integral_t)sext ^ ((integral_t)1 << (INTEGRAL_BITS - 1));
+	return trunc;
+}
+
+static const out_val *switch_key_val(out_ctx *octx, type *ty, integral_t key)
+{
+	if(type_is_signed(ty))
+		key ^= (integral_t)1 << (INTEGRAL_BITS - 1);
+	return out_new_l(octx, ty, (long)key);
+}
+
+static int switch_case_cmp(const void *va, const void *vb)
+{
+	const struct switch_case *a = va, *b = vb;
+
+	if(a->lo < b->lo)
+		return -1;
+	return a->lo > b->lo;
+}
+
+/* emits a test for a single case, continuing in `next' on mismatch */
+static void switch_gen_test(
+		out_ctx *octx, const out_val *cmp_with, type *ty,
+		const struct switch_case *c, out_blk *next)
+{
+	if(c->lo != c->hi){
+		out_blk *blk_test2 = out_blk_new(octx, "range_true");
+
+		out_val_retain(octx, cmp_with);
+		out_ctrl_branch(octx,
+				out_op(octx, op_lt, cmp_with, switch_key_val(octx, ty, c->lo)),
+				next,
+				blk_test2);
+
+		out_current_blk(octx, blk_test2);
+
+		out_val_retain(octx, cmp_with);
+		out_ctrl_branch(octx,
+				out_op(octx, op_gt, cmp_with, switch_key_val(octx, ty, c->hi)),
+				next,
+				c->cse->bits.case_blk);
+
+	}else{
+		out_val_retain(octx, cmp_with);
+		out_ctrl_branch(octx,
+			out_op(octx, op_eq, switch_key_val(octx, ty, c->lo), cmp_with),
+			c->cse->bits.case_blk,
+			next);
+	}
+
+	out_current_blk(octx, next);
+}
+
+static void switch_gen_chain(
+		out_ctx *octx, const out_val *cmp_with, type *ty,
+		const struct switch_case *cases, size_t n, out_blk *fallback)
+{
+	size_t i;
+
+	for(i = 0; i < n; i++)
+		switch_gen_test(octx, cmp_with, ty, &cases[i], out_blk_new(octx, "case_next"));
+
+	out_ctrl_transfer(octx, fallback, NULL, NULL, 0);
+}
+
+static void switch_gen_bsearch(
+		out_ctx *octx, const out_val *cmp_with, type *ty,
+		const struct switch_case *cases, size_t n, out_blk *fallback)
+{
+	size_t mid;
+	out_blk *blk_lo, *blk_hi;
+
+	if(n < SWITCH_BSEARCH_MIN){
+		switch_gen_chain(octx, cmp_with, ty, cases, n, fallback);
+		return;
+	}
+
+	mid = n / 2;
+	blk_lo = out_blk_new(octx, "switch_lo");
+	blk_hi = out_blk_new(octx, "switch_hi");
+
+	out_val_retain(octx, cmp_with);
+	out_ctrl_branch(octx,
+			out_op(octx, op_lt, cmp_with, switch_key_val(octx, ty, cases[mid].lo)),
+			blk_lo,
+			blk_hi);
+
+	out_current_blk(octx, blk_lo);
+	switch_gen_bsearch(octx, cmp_with, ty, cases, mid, fallback);
+
+	out_current_blk(octx, blk_hi);
+	switch_gen_bsearch(octx, cmp_with, ty, cases + mid, n - mid, fallback);
+}
+
+static size_t switch_gen_hot(
+		out_ctx *octx, const out_val *cmp_with, type *ty,
+		struct switch_case *cases, size_t n, const stmt *pdefault)
+{
+	unsigned long *counts, total = 0;
+	size_t i, npeeled = 0;
+
+	if(!n)
+		return n;
+
+	counts = umalloc(n * sizeof *counts);
+	for(i = 0; i < n; i++){
+		if(!profile_stmt_count(cases[i].cse, 0, &counts[i]))
+			goto out;
+		total += counts[i];
+	}
+	if(pdefault){
+		unsigned long count;
+		if(profile_stmt_count(pdefault, 0, &count))
+			total += count;
+	}
+
+	while(npeeled < SWITCH_PEEL_MAX && npeeled < n){
+		size_t max = npeeled;
+		struct switch_case tmp_case;
+		unsigned long tmp_count;
+
+		for(i = npeeled + 1; i < n; i++)
+			if(counts[i] > counts[max])
+				max = i;
+
+		/* only worth it while the case dominates what's left */
+		if(counts[max] * 2 <= total)
+			break;
+		total -= counts[max];
+
+		tmp_case = cases[npeeled], cases[npeeled] = cases[max], cases[max] = tmp_case;
+		tmp_count = counts[npeeled], counts[npeeled] = counts[max], counts[max] = tmp_count;
+
+		switch_gen_test(octx, cmp_with, ty, &cases[npeeled], out_blk_new(octx, "case_next"));
+		npeeled++;
+	}
+
+	memmove(cases, cases + npeeled, (n - npeeled) * sizeof *cases);
+out:
+	free(counts);
+	return n - npeeled;
+}
+
+static int switch_use_table(
+		const struct switch_case *cases, size_t n, integral_t *pspan)
+{
+	integral_t span, nvals = 0;
+	size_t i;
+
+	if(!cc1_fopt.jump_tables || n < SWITCH_TABLE_MIN)
+		return 0;
+
+	span = cases[n - 1].hi - cases[0].lo;
+	if(span >= SWITCH_TABLE_MAX)
+		return 0;
+
+	for(i = 0; i < n; i++)
+		nvals += cases[i].hi - cases[i].lo + 1;
+
+	if(span + 1 > nvals * SWITCH_TABLE_DENSITY)
+		return 0;
+
+	*pspan = span;
+	return 1;
+}
+
+static void switch_gen_table(
+		out_ctx *octx, const out_val *cmp_with, type *ty,
+		const struct switch_case *cases, size_t n,
+		integral_t span, out_blk *fallback)
+{
+	type *ty_unsigned = type_nav_MAX_FOR(cc1_type_nav, type_size(ty, NULL), 0);
+	out_blk *blk_index = out_blk_new(octx, "switch_index");
+	out_blk **targets = umalloc((span + 1) * sizeof *targets);
+	const out_val *idx;
+	integral_t i;
+	size_t ci;
+
+	for(i = 0; i <= span; i++)
+		targets[i] = fallback;
+	for(ci = 0; ci < n; ci++){
+		for(i = cases[ci].lo; ; i++){
+			targets[i - cases[0].lo] = cases[ci].cse->bits.case_blk;
+			if(i == cases[ci].hi)
+				break;
+		}
+	}
+
+	/* idx = (unsigned)(x - min), anything above span isn't in the table.
+	 * idx is recalculated after the branch rather than kept live across it,
+	 * so its spill can't clobber the flags of the bounds check */
+	out_val_retain(octx, cmp_with);
+	idx = out_op(octx, op_minus, cmp_with, switch_key_val(octx, ty, cases[0].lo));
+	idx = out_change_type(octx, idx, ty_unsigned);
+
+	out_ctrl_branch(octx,
+			out_op(octx, op_gt, idx, out_new_l(octx, ty_unsigned, (long)span)),
+			fallback,
+			blk_index);
+
+	out_current_blk(octx, blk_index);
+
+	out_val_retain(octx, cmp_with);
+	idx = out_op(octx, op_minus, cmp_with, switch_key_val(octx, ty, cases[0].lo));
+	idx = out_change_type(octx, idx, ty_unsigned);
+
+	out_ctrl_transfer_table(octx, idx, targets, span + 1);
+
+	free(targets);
+}
+
 void gen_stmt_switch(const stmt *s, out_ctx *octx)
 {
 	stmt **iter, *pdefault;
 	out_blk *blk_switch_end = out_blk_new(octx, "switch_fin");
+	out_blk *blk_nomatch;
 	const out_val *cmp_with;
 	struct out_dbg_lbl *el[2][2];
+	type *ty = s->expr->tree_type;
+	struct switch_case *cases;
+	size_t n = dynarray_count(s->bits.switch_.cases), i = 0;
+	integral_t span;
+	numeric iv;
+	int is_const;
 
 	stmt_init_blks(s, NULL, blk_switch_end);
 
@@ -282,66 +531,47 @@ void gen_stmt_switch(const stmt *s, out_ctx *octx)
 
 	cmp_with = gen_expr(s->expr, octx);
 
-	for(iter = s->bits.switch_.cases; iter && *iter; iter++){
-		stmt *cse = *iter;
-		numeric iv;
-		out_blk *blk_cancel = out_blk_new(octx, "case_next");
+	pdefault = s->bits.switch_.default_case;
+	if(pdefault)
+		pdefault->bits.case_blk = out_blk_new(octx, "default");
+	blk_nomatch = pdefault ? pdefault->bits.case_blk : blk_switch_end;
 
-		const_fold_integral(cse->expr, &iv);
+	cases = umalloc((n ? n : 1) * sizeof *cases);
+
+	for(iter = s->bits.switch_.cases; iter && *iter; iter++, i++){
+		stmt *cse = *iter;
 
 		/* create the case blocks here,
 		 * since we need the jumps before we code-gen them */
 		cse->bits.case_blk = out_blk_new(octx, "case");
 
-		if(stmt_kind(cse, case_range)){
-			numeric max;
-			const out_val *this_case[2];
-			out_blk *blk_test2 = out_blk_new(octx, "range_true");
-
-			/* TODO: proper signed/unsiged format - out_op() */
-			const_fold_integral(cse->expr2, &max);
-
-			this_case[0] = out_new_num(octx, cse->expr->tree_type, &iv);
-
-			out_val_retain(octx, cmp_with);
-			out_ctrl_branch(octx,
-					out_op(octx, op_lt, cmp_with, this_case[0]),
-					blk_cancel,
-					blk_test2);
-
-			out_current_blk(octx, blk_test2);
-			this_case[1] = out_new_num(octx, cse->expr2->tree_type, &max);
+		const_fold_integral(cse->expr, &iv);
+		cases[i].cse = cse;
+		cases[i].lo = cases[i].hi = switch_key(&iv, ty);
 
-			out_val_retain(octx, cmp_with);
-			out_ctrl_branch(octx,
-					out_op(octx, op_gt, cmp_with, this_case[1]),
-					blk_cancel,
-					cse->bits.case_blk);
+		if(stmt_kind(cse, case_range)){
+			const_fold_integral(cse->expr2, &iv);
+			cases[i].hi = switch_key(&iv, ty);
+		}
+	}
 
-		}else{
-			const out_val *this_case = out_new_num(octx, cse->expr->tree_type, &iv);
+	is_const = const_fold_integral_try(s->expr, &iv);
+	if(!is_const)
+		n = switch_gen_hot(octx, cmp_with, ty, cases, n, pdefault);
 
-			out_val_retain(octx, cmp_with);
-			out_ctrl_branch(octx,
-				out_op(octx, op_eq, this_case, cmp_with),
-				cse->bits.case_blk,
-				blk_cancel);
-		}
+	if(n < SWITCH_BSEARCH_MIN || is_const){
+		switch_gen_chain(octx, cmp_with, ty, cases, n, blk_nomatch);
+	}else{
+		qsort(cases, n, sizeof *cases, switch_case_cmp);
 
-		out_current_blk(octx, blk_cancel);
-		/* implicitly linked to next */
+		if(switch_use_table(cases, n, &span))
+			switch_gen_table(octx, cmp_with, ty, cases, n, span, blk_nomatch);
+		else
+			switch_gen_bsearch(octx, cmp_with, ty, cases, n, blk_nomatch);
 	}
 
 	out_val_release(octx, cmp_with);
-
-	pdefault = s->bits.switch_.default_case;
-	if(pdefault)
-		pdefault->bits.case_blk = out_blk_new(octx, "default");
-
-	/* no matches - branch to default/end */
-	out_ctrl_transfer(octx,
-			pdefault ? pdefault->bits.case_blk : blk_switch_end,
-			NULL, NULL, 0);
+	free(cases);
 
 	{
 		out_blk *body = out_blk_new(octx, "switch_body");
@@ -4,6 +4,9 @@
 #include "stmt_while.h"
 #include "stmt_if.h"
 #include "../out/lbl.h"
+#include "../profile.h"
+#include "../cc1_out_ctx.h"
+#include "../loop.h"
 
 const char *str_stmt_while(void)
 {
@@ -26,6 +29,7 @@ void gen_stmt_while(const stmt *s, out_ctx *octx)
 {
 	struct out_dbg_lbl *endlbls[2][2];
 	out_blk *blk_body = out_blk_new(octx, "while_body");
+	struct cc1_out_ctx *cc1_octx = cc1_out_ctx_or_new(octx);
 
 	{
 		out_blk *blk_cont = out_blk_new(octx, "while_cont");
@@ -33,25 +37,35 @@ void gen_stmt_while(const stmt *s, out_ctx *octx)
 		stmt_init_blks(s, blk_cont, blk_break);
 	}
 
+	profile_count(s, 1, octx);
+	loop_begin(s, octx);
 	out_ctrl_transfer(octx, s->blk_continue, NULL, NULL, 0);
 
+	cc1_octx->loop_depth++;
+
 	out_current_blk(octx, s->blk_continue);
 	{
 		const out_val *cond;
 
 		flow_gen(s->flow, s->symtab, endlbls, octx);
 		cond = gen_expr(s->expr, octx);
+		cond = profile_branch(s, cond, octx);
 
 		out_ctrl_branch(octx, cond, blk_body, s->blk_break);
 	}
 
 	out_current_blk(octx, blk_body);
 	{
+		profile_count(s, 0, octx);
 		gen_stmt(s->lhs, octx);
 
 		out_ctrl_transfer(octx, s->blk_continue, NULL, NULL, 0);
 	}
 
+	cc1_octx->loop_depth--;
+
+	loop_end(s, octx);
+
 	out_current_blk(octx, s->blk_break);
 	{
 		flow_end(s->flow, s->symtab, endlbls, octx);
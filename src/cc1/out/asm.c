@@ -37,6 +37,7 @@
 #include "../cc1_target.h"
 #include "../cc1_out.h"
 #include "../mangle.h"
+#include "../dead_static.h"
 
 #include "../ops/expr_compound_lit.h"
 
@@ -67,6 +68,8 @@ const char *asm_section_desc(enum section_builtin sec)
 		case SECTION_BSS: return SECTION_DESC_BSS;
 		case SECTION_RODATA: return SECTION_DESC_RODATA;
 		case SECTION_RELRO: return SECTION_DESC_RELRO;
+		case SECTION_TDATA: return SECTION_DESC_TDATA;
+		case SECTION_TBSS: return SECTION_DESC_TBSS;
 		case SECTION_CTORS: return SECTION_DESC_CTORS;
 		case SECTION_DTORS: return SECTION_DESC_DTORS;
 		case SECTION_DBG_ABBREV: return SECTION_DESC_DBG_ABBREV;
@@ -97,8 +100,11 @@ static void switch_section_emit(const struct section *section)
 		if(cc1_target_details.as->supports_section_flags && !is_builtin){
 			const int is_code = section->flags & SECTION_FLAG_EXECUTABLE;
 			const int is_rw = !(section->flags & SECTION_FLAG_RO);
+			const int is_tls = section->flags & SECTION_FLAG_TLS;
 
-			xfprintf(cc1_output.file, ",\"a%s\",@progbits", is_code ? "x" : is_rw ? "w" : "");
+			xfprintf(cc1_output.file, ",\"a%s%s\",@progbits",
+					is_code ? "x" : is_rw ? "w" : "",
+					is_tls ? "T" : "");
 		}
 	}
 	xfprintf(cc1_output.file, "\n");
@@ -311,6 +317,7 @@ static void static_val(const struct section *sec, type *ty, expr *e)
 			switch(k.bits.addr.lbl_type){
 				case CONST_LBL_TRUE:
 				case CONST_LBL_WEAK:
+					dead_static_ref(k.bits.addr.bits.lbl);
 					asm_out_section(sec, "%s", k.bits.addr.bits.lbl);
 					break;
 				case CONST_LBL_MEMADDR:
@@ -735,6 +742,7 @@ void asm_declare_decl_init(const struct section *sec, decl *d)
 	if(section_is_builtin(sec)
 	&& d->bits.var.init.compiler_generated
 	&& cc1_fopt.common
+	&& !(d->store & store_thread) /* no common for thread-locals */
 	&& !attribute_present(d, attr_weak) /* variables can't be weak and common */)
 	{
 		unsigned align;
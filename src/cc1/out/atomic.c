@@ -0,0 +1,97 @@
+#include <stddef.h>
+#include <stdarg.h>
+#include <assert.h>
+
+#include "../type_nav.h"
+
+#include "out.h"
+#include "val.h"
+#include "virt.h"
+#include "impl.h"
+
+/* the read-modify-writes clobber the flags, and the backend
+ * may expand them into a loop */
+static void atomic_prepare(out_ctx *octx, const out_val *a, const out_val *b)
+{
+	const out_val *except[] = { a, b, NULL };
+
+	v_decay_flags_except(octx, except);
+}
+
+const out_val *out_atomic_load(
+		out_ctx *octx, const out_val *ptr, enum out_memorder mo)
+{
+	/* a register variable can't be seen by another thread */
+	if(ptr->flags & VAL_FLAG_REGVAR)
+		return out_deref(octx, ptr);
+
+	atomic_prepare(octx, ptr, NULL);
+	return impl_atomic_load(octx, ptr, mo);
+}
+
+void out_atomic_store(
+		out_ctx *octx, const out_val *ptr, const out_val *val,
+		enum out_memorder mo)
+{
+	if(ptr->flags & VAL_FLAG_REGVAR){
+		out_store(octx, ptr, val);
+		return;
+	}
+
+	atomic_prepare(octx, ptr, val);
+	impl_atomic_store(octx, ptr, val, mo);
+}
+
+const out_val *out_atomic_exchange(
+		out_ctx *octx, const out_val *ptr, const out_val *val,
+		enum out_memorder mo)
+{
+	(void)mo; /* always a full barrier */
+
+	atomic_prepare(octx, ptr, val);
+	return impl_atomic_exchange(octx, ptr, val);
+}
+
+const out_val *out_atomic_fetch_op(
+		out_ctx *octx, enum op_type op,
+		const out_val *ptr, const out_val *val,
+		enum out_memorder mo)
+{
+	(void)mo;
+
+	switch(op){
+		case op_plus:
+		case op_minus:
+		case op_and:
+		case op_or:
+		case op_xor:
+		case op_bnot:
+			break;
+		default:
+			assert(0 && "bad atomic op");
+	}
+
+	atomic_prepare(octx, ptr, val);
+	return impl_atomic_fetch_op(octx, op, ptr, val);
+}
+
+const out_val *out_atomic_cmpxchg(
+		out_ctx *octx, const out_val *ptr,
+		const out_val *expected, const out_val *desired,
+		enum out_memorder mo, const out_val **success)
+{
+	const out_val *except[] = { ptr, expected, desired, NULL };
+
+	(void)mo;
+
+	v_decay_flags_except(octx, except);
+	return impl_atomic_cmpxchg(octx, ptr, expected, desired, success);
+}
+
+void out_atomic_fence(out_ctx *octx, enum out_memorder mo)
+{
+	if(mo == OUT_MO_RELAXED)
+		return;
+
+	impl_atomic_fence(octx, mo);
+}
@@ -0,0 +1,196 @@
+#include <stddef.h>
+#include <stdarg.h>
+#include <limits.h>
+
+#include "../type_nav.h"
+
+#include "out.h"
+#include "val.h"
+#include "virt.h"
+#include "impl.h"
+
+#include "../fopt.h"
+#include "../cc1.h"
+
+int out_bitop_fold(
+		enum out_bitop op, integral_t v, unsigned bytes, integral_t *result)
+{
+	const unsigned bits = bytes * CHAR_BIT;
+	integral_t r = 0;
+	unsigned i;
+
+	if(bits < INTEGRAL_BITS)
+		v &= ((integral_t)1 << bits) - 1;
+
+	switch(op){
+		case OUT_BITOP_POPCOUNT:
+			for(; v; v &= v - 1)
+				r++;
+			break;
+
+		case OUT_BITOP_CLZ:
+			if(!v)
+				return 0;
+			for(r = bits; v; v >>= 1)
+				r--;
+			break;
+
+		case OUT_BITOP_CTZ:
+			if(!v)
+				return 0;
+			for(; !(v & 1); v >>= 1)
+				r++;
+			break;
+
+		case OUT_BITOP_FFS:
+			if(v)
+				for(r = 1; !(v & 1); v >>= 1)
+					r++;
+			break;
+
+		case OUT_BITOP_BSWAP:
+			for(i = 0; i < bytes; i++, v >>= CHAR_BIT)
+				r = (r << CHAR_BIT) | (v & 0xff);
+			break;
+	}
+
+	*result = r;
+	return 1;
+}
+
+/* a copy we may clobber - out_op() works in-place on its lhs */
+static const out_val *bitop_copy(out_ctx *octx, const out_val *v)
+{
+	out_val_retain(octx, v);
+	return v_dup_or_reuse(octx, v, v->t);
+}
+
+static const out_val *bitop_k(out_ctx *octx, type *ty, integral_t k)
+{
+	return out_new_l(octx, ty, (long)k);
+}
+
+static const out_val *bitop_popcount(
+		out_ctx *octx, const out_val *x, unsigned bits)
+{
+	/* sum adjacent bits, then pairs, then nibbles, then bytes */
+	const integral_t ones = bits < INTEGRAL_BITS
+		? ((integral_t)1 << bits) - 1 : ~(integral_t)0;
+	type *ty = x->t;
+	const out_val *t;
+
+	t = out_op(octx, op_shiftr, bitop_copy(octx, x), bitop_k(octx, ty, 1));
+	t = out_op(octx, op_and, t, bitop_k(octx, ty, ones / 3));
+	x = out_op(octx, op_minus, x, t);
+
+	t = out_op(octx, op_shiftr, bitop_copy(octx, x), bitop_k(octx, ty, 2));
+	t = out_op(octx, op_and, t, bitop_k(octx, ty, ones / 5));
+	x = out_op(octx, op_and, x, bitop_k(octx, ty, ones / 5));
+	x = out_op(octx, op_plus, x, t);
+
+	t = out_op(octx, op_shiftr, bitop_copy(octx, x), bitop_k(octx, ty, 4));
+	x = out_op(octx, op_plus, x, t);
+	x = out_op(octx, op_and, x, bitop_k(octx, ty, ones / 17));
+
+	x = out_op(octx, op_multiply, x, bitop_k(octx, ty, ones / 255));
+	return out_op(octx, op_shiftr, x, bitop_k(octx, ty, bits - CHAR_BIT));
+}
+
+static const out_val *bitop_clz(
+		out_ctx *octx, const out_val *x, unsigned bits)
+{
+	/* smear the top set bit down, then count the zeros above it */
+	unsigned sh;
+
+	for(sh = 1; sh < bits; sh *= 2){
+		const out_val *t = out_op(octx, op_shiftr,
+				bitop_copy(octx, x), bitop_k(octx, x->t, sh));
+
+		x = out_op(octx, op_or, x, t);
+	}
+
+	return bitop_popcount(octx, out_op_unary(octx, op_bnot, x), bits);
+}
+
+static const out_val *bitop_generic(
+		out_ctx *octx, enum out_bitop op, const out_val *x)
+{
+	type *ty = x->t;
+	const unsigned bytes = type_size(ty, NULL);
+	const unsigned bits = bytes * CHAR_BIT;
+	const out_val *t;
+	unsigned i;
+
+	switch(op){
+		case OUT_BITOP_POPCOUNT:
+			return bitop_popcount(octx, x, bits);
+
+		case OUT_BITOP_CLZ:
+			return bitop_clz(octx, x, bits);
+
+		case OUT_BITOP_CTZ:
+			/* the bits below the lowest set one: ~x & (x - 1) */
+			t = out_op(octx, op_minus, bitop_copy(octx, x), bitop_k(octx, ty, 1));
+			x = out_op(octx, op_and, out_op_unary(octx, op_bnot, x), t);
+			return bitop_popcount(octx, x, bits);
+
+		case OUT_BITOP_FFS:
+			/* bits - clz(x & -x), which gives zero for zero */
+			t = out_op_unary(octx, op_minus, bitop_copy(octx, x));
+			x = bitop_clz(octx, out_op(octx, op_and, x, t), bits);
+			return out_op(octx, op_minus, bitop_k(octx, ty, bits), x);
+
+		case OUT_BITOP_BSWAP:
+		{
+			const out_val *r = NULL;
+
+			for(i = 0; i < bytes; i++){
+				const int sh = (int)(bytes - 1 - 2 * i) * CHAR_BIT;
+
+				t = bitop_copy(octx, x);
+				if(sh > 0)
+					t = out_op(octx, op_shiftl, t, bitop_k(octx, ty, sh));
+				else if(sh < 0)
+					t = out_op(octx, op_shiftr, t, bitop_k(octx, ty, -sh));
+				t = out_op(octx, op_and, t,
+						bitop_k(octx, ty, (integral_t)0xff << (bytes - 1 - i) * CHAR_BIT));
+
+				r = r ? out_op(octx, op_or, r, t) : t;
+			}
+
+			out_val_consume(octx, x);
+			return r;
+		}
+	}
+
+	return x;
+}
+
+const out_val *out_bitop(out_ctx *octx, enum out_bitop op, const out_val *v)
+{
+	const out_val *native;
+
+	if(v->type == V_CONST_I && cc1_fopt.const_fold){
+		integral_t folded;
+
+		if(out_bitop_fold(op, v->bits.val_i, type_size(v->t, NULL), &folded)){
+			out_val *k = v_dup_or_reuse(octx, v, v->t);
+			k->bits.val_i = folded;
+			return k;
+		}
+	}
+
+	/* bit scans and counts clobber the flags */
+	v_decay_flags_except1(octx, v);
+
+	native = impl_bitop(octx, op, v);
+	if(native)
+		return native;
+
+	return bitop_generic(octx, op, v_to_reg(octx, v));
+}
+
+void out_prefetch(out_ctx *octx, const out_val *addr, int write, int locality)
+{
+	impl_prefetch(octx, addr, write, locality);
+}
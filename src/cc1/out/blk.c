@@ -19,11 +19,15 @@
 #include "dbg_lbl.h"
 
 #include "blk.h"
+#include "insn.h"
+#include "peephole.h"
+#include "obj.h"
 #include "impl_jmp.h"
 
 #include "asm.h" /* cc_out */
 #include "../cc1.h" /* fopt_mode */
 #include "../fopt.h"
+#include "../time_report.h"
 
 #define JMP_THREAD_LIM 10
 
@@ -31,6 +35,10 @@ struct flush_state
 {
 	/* for jump threading - the block we jump to if not immediately flushing */
 	out_blk *jmpto;
+
+	/* -freorder-blocks: cold blocks are held back until the hot ones are out */
+	out_blk **cold_blks;
+	int defer_cold;
 };
 
 static void dot_blocks(out_blk *);
@@ -41,35 +49,46 @@ static void blk_jmpnext(out_blk *to, struct flush_state *st)
 	st->jmpto = to;
 }
 
-static void blk_jmpthread(struct flush_state *st, const struct section *sec)
+static void blk_jmpthread(
+		struct flush_state *st, out_blk *next, const struct section *sec)
 {
 	out_blk *to = st->jmpto;
 
 	if(cc1_fopt.thread_jumps){
 		int lim = 0;
 
-		while(!to->insns && to->type == BLK_NEXT_BLOCK && lim < JMP_THREAD_LIM){
+		while(blk_is_empty(to) && to->type == BLK_NEXT_BLOCK && lim < JMP_THREAD_LIM){
 			to = to->bits.next;
 			lim++; /* prevent circulars */
 		}
 
 		if(lim && cc1_fopt.verbose_asm)
 			asm_out_section(sec, "\t# jump threaded through %d blocks\n", lim);
+
+		if(to == next){
+			/* threaded through to the block we're about to emit */
+			if(cc1_fopt.verbose_asm)
+				asm_out_section(sec, "\t# implicit jump to next line\n");
+			return;
+		}
 	}
 
-	impl_jmp(to->lbl);
+	impl_jmp(sec, to->lbl);
 }
 
 static void blk_codegen(out_blk *blk, struct flush_state *st, const struct section *sec)
 {
-	char **i;
+	size_t i;
+
+	if(cc1_fopt.peephole)
+		blk_peephole(blk);
 
 	/* before any instructions, if we have a pending jmpto and
 	 * we aren't the target branch, we need to cut off the last
 	 * block with a jump to said jmpto */
 	if(st->jmpto){
 		if(st->jmpto != blk)
-			blk_jmpthread(st, sec);
+			blk_jmpthread(st, blk, sec);
 		else if(cc1_fopt.verbose_asm)
 			asm_out_section(sec, "\t# implicit jump to next line\n");
 		st->jmpto = NULL;
@@ -78,14 +97,29 @@ static void blk_codegen(out_blk *blk, struct flush_state *st, const struct secti
 	if(blk->align)
 		asm_out_align(sec, blk->align);
 
-	asm_out_section(sec, "%s: # %s\n", blk->lbl, blk->desc);
+	asm_out_section(sec, "%s: # %s%s\n",
+			blk->lbl, blk->desc,
+			blk->cold && cc1_fopt.verbose_asm ? " (cold)" : "");
 	if(blk->force_lbl)
 		asm_out_section(sec, "%s: # mustgen_spel\n", blk->force_lbl);
 
 	out_dbg_labels_emit_release_v(&blk->labels.start);
 
-	for(i = blk->insns; i && *i; i++)
-		asm_out_section(sec, "%s", *i);
+	for(i = 0; i < blk->ninsns; i++){
+		const struct insn *insn = &blk->insns[i];
+		char buf[INSN_LINE_MAX];
+
+		if(!insn->op){
+			asm_out_section(sec, "%s", insn->bits.text);
+		}else if(obj_active()){
+			/* integrated assembler - no need for the text */
+			asm_switch_section(sec);
+			obj_insn(insn);
+		}else{
+			insn_str(insn, buf, sizeof buf);
+			asm_out_section(sec, "\t%s\n", buf);
+		}
+	}
 
 	out_dbg_labels_emit_release_v(&blk->labels.end);
 }
@@ -94,6 +128,10 @@ static void bfs_block(out_blk *blk, struct flush_state *st, const struct section
 {
 	if(blk->emitted || !blk->reachable)
 		return;
+	if(blk->cold && st->defer_cold){
+		dynarray_add(&st->cold_blks, blk);
+		return;
+	}
 	blk->emitted = 1;
 
 	if(blk->merge_preds){
@@ -125,8 +163,9 @@ static void bfs_block(out_blk *blk, struct flush_state *st, const struct section
 			/* we always jump to the true block if the conditional failed */
 			blk_jmpnext(blk->bits.cond.if_1_blk, st);
 
-			/* if it's unlikely, we want the false block already in the pipeline */
-			if(blk->bits.cond.unlikely){
+			/* the fall-through is usually the likely path - if not, get the
+			 * jump target into the pipeline first */
+			if(blk->bits.cond.unlikely == blk->bits.cond.if_1_blk){
 				bfs_block(blk->bits.cond.if_0_blk, st, sec);
 				bfs_block(blk->bits.cond.if_1_blk, st, sec);
 			}else{
@@ -158,11 +197,86 @@ static void mark_reachable_blocks(out_blk *blk)
 	}
 }
 
+static int blk_edge_cold(out_blk *from, out_blk *to)
+{
+	return from->cold
+		|| (from->type == BLK_COND && from->bits.cond.unlikely == to);
+}
+
+static void blk_note_edge(out_blk *from, out_blk *to)
+{
+	if(blk_edge_cold(from, to))
+		return;
+
+	to->hot_pred = 1;
+
+	/* fallthrough, or the likely arm of a hinted branch */
+	if(from->type != BLK_COND
+	|| from->bits.cond.if_0_blk == from->bits.cond.if_1_blk
+	|| from->bits.cond.unlikely)
+	{
+		to->straight_pred = 1;
+	}
+}
+
+static void mark_cold_blocks(out_ctx *octx, out_blk *first)
+{
+	/* seeds are blocks hinted as cold (cold calls), the unlikely arms of
+	 * __builtin_expect()ed branches and blocks ending in a noreturn call
+	 * or trap that are only entered off a branch - exit() at the end of
+	 * the main path isn't rare.
+	 * From there, a block is cold if it's only entered via cold edges */
+	int changed;
+
+	do{
+		out_blk *b, **must_i;
+
+		changed = 0;
+
+		for(b = octx->mem_blk_head; b; b = b->next)
+			b->hot_pred = b->straight_pred = 0;
+
+		/* entry points are assumed hot */
+		first->hot_pred = first->straight_pred = 1;
+		for(must_i = octx->mustgen; must_i && *must_i; must_i++)
+			(*must_i)->hot_pred = (*must_i)->straight_pred = 1;
+
+		for(b = octx->mem_blk_head; b; b = b->next){
+			if(!b->reachable)
+				continue;
+
+			switch(b->type){
+				case BLK_NEXT_BLOCK:
+					blk_note_edge(b, b->bits.next);
+					break;
+				case BLK_COND:
+					blk_note_edge(b, b->bits.cond.if_0_blk);
+					blk_note_edge(b, b->bits.cond.if_1_blk);
+					break;
+				default:
+					break;
+			}
+		}
+
+		for(b = octx->mem_blk_head; b; b = b->next){
+			if(!b->reachable || b->cold || b == first)
+				continue;
+
+			if(!b->hot_pred || (b->noreturn && !b->straight_pred)){
+				b->cold = 1;
+				changed = 1;
+			}
+		}
+	}while(changed);
+}
+
 void blk_flushall(out_ctx *octx, out_blk *first, char *end_dbg_lbl, const struct section *sec)
 {
 	struct flush_state st = { 0 };
 	out_blk **must_i;
 
+	time_report_push(TIME_BLK_FLUSH);
+
 	if(cc1_fopt.dump_basic_blocks)
 		dot_blocks(first);
 
@@ -170,17 +284,35 @@ void blk_flushall(out_ctx *octx, out_blk *first, char *end_dbg_lbl, const struct
 	for(must_i = octx->mustgen; must_i && *must_i; must_i++)
 		mark_reachable_blocks(*must_i);
 
+	if(cc1_fopt.reorder_blocks){
+		mark_cold_blocks(octx, first);
+		st.defer_cold = 1;
+	}
+
 	bfs_block(first, &st, sec);
 
 	for(must_i = octx->mustgen; must_i && *must_i; must_i++)
 		bfs_block(*must_i, &st, sec);
 
+	if(st.cold_blks){
+		/* the hot path is out, append the rarely executed blocks */
+		out_blk **i;
+
+		st.defer_cold = 0;
+		for(i = st.cold_blks; *i; i++)
+			bfs_block(*i, &st, sec);
+
+		dynarray_free(out_blk **, st.cold_blks, NULL);
+	}
+
 	if(st.jmpto)
-		impl_jmp(st.jmpto->lbl);
+		impl_jmp(sec, st.jmpto->lbl);
 
 	asm_out_section(sec, "%s:\n", end_dbg_lbl);
 
 	out_dbg_labels_emit_release_v(&octx->pending_lbls);
+
+	time_report_pop(TIME_BLK_FLUSH);
 }
 
 static void dot_replace(char *lbl)
@@ -244,7 +376,7 @@ static void dot_blocks(out_blk *b)
 void blk_terminate_condjmp(
 		out_ctx *octx, char *condinsn,
 		out_blk *condto, out_blk *uncondto,
-		int unlikely)
+		out_blk *unlikely)
 {
 	out_blk *current = octx->current_blk;
 
@@ -273,7 +405,7 @@ void blk_terminate_undef(out_blk *b)
 
 static out_blk *blk_new_common(out_ctx *octx, char *lbl, const char *desc)
 {
-	out_blk *blk = umalloc(sizeof *blk);
+	out_blk *blk = umalloc_tag(sizeof *blk, UALLOC_BLK);
 	blk->lbl = lbl;
 	blk->desc = desc;
 
@@ -319,3 +451,9 @@ void out_blk_mustgen(out_ctx *octx, out_blk *blk, char *force_lbl)
 
 	dynarray_add(&octx->mustgen, blk);
 }
+
+void out_blk_cold(out_ctx *octx)
+{
+	if(octx->current_blk)
+		octx->current_blk->cold = 1;
+}
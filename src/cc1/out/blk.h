@@ -1,16 +1,20 @@
 #ifndef BLK_H
 #define BLK_H
 
+#include <stddef.h>
+
 #include "forwards.h"
 
 struct section;
+struct insn;
 
 struct out_blk
 {
 	/* all blocks: */
 	const char *desc;
 	char *lbl, *force_lbl;
-	char **insns;
+	struct insn *insns;
+	size_t ninsns, insns_max;
 
 	struct
 	{
@@ -21,6 +25,8 @@ struct out_blk
 	out_blk *next;
 	unsigned align;
 	unsigned reachable : 1, emitted : 1;
+	unsigned cold : 1, hot_pred : 1; /* rarely executed / has a likely entry */
+	unsigned noreturn : 1, straight_pred : 1; /* ends in a noreturn call / has a fallthrough or likely entry */
 
 	enum
 	{
@@ -49,7 +55,7 @@ struct out_blk
 		{
 			char *insn;
 			out_blk *if_0_blk, *if_1_blk;
-			char unlikely;
+			out_blk *unlikely; /* the rarely taken successor, if known */
 		} cond;
 	} bits;
 };
@@ -61,17 +67,14 @@ void blk_flushall(out_ctx *octx, out_blk *first, char *end_dbg_lbl, const struct
 void blk_terminate_condjmp(
 		out_ctx *octx, char *condinsn,
 		out_blk *bpass, out_blk *bfail,
-		int unlikely);
+		out_blk *unlikely);
 
 void blk_terminate_jmp(out_blk *, char *jmpinsn);
 void blk_terminate_undef(out_blk *);
 
 void blk_transfer(out_blk *from, out_blk *to);
 
-#define blk_add_insn(blk, insn) \
-	dynarray_add(&(blk)->insns, (insn))
-
 #define blk_is_empty(blk) \
-	(!(blk)->insns)
+	(!(blk)->ninsns)
 
 #endif
@@ -5,6 +5,9 @@
 
 #include "../../util/dynarray.h"
 
+#include "../type.h"
+#include "../type_nav.h"
+
 #include "forwards.h"
 #include "blk.h"
 
@@ -15,6 +18,9 @@
 #include "ctx.h"
 #include "virt.h"
 
+#include "lbl.h"
+#include "section.h"
+
 #include "ctrl.h"
 
 static void v_transfer_spill(out_ctx *octx, const out_val *skip)
@@ -33,12 +39,17 @@ void out_ctrl_branch(
 		const out_val *cond,
 		out_blk *if_true, out_blk *if_false)
 {
+	out_blk *unlikely = NULL;
+
+	if(cond->flags & VAL_FLAG_LIKELY)
+		unlikely = if_false;
+	else if(cond->flags & VAL_FLAG_UNLIKELY)
+		unlikely = if_true;
+
 	v_decay_flags_except1(octx, cond);
 	v_transfer_spill(octx, cond);
 
-	impl_branch(octx,
-			cond, if_true, if_false,
-			!!(cond->flags & VAL_FLAG_LIKELY));
+	impl_branch(octx, cond, if_true, if_false, unlikely);
 
 	out_current_blk(octx, if_true);
 }
@@ -51,8 +62,53 @@ void out_ctrl_end_ret(out_ctx *octx, const out_val *ret, type *ty)
 	octx->current_blk = NULL;
 }
 
+void out_ctrl_transfer_table(
+		out_ctx *octx, const out_val *idx,
+		out_blk **targets, unsigned long ntargets)
+{
+	type *ty_long = type_nav_btype(cc1_type_nav, type_long);
+	type *ty_int = type_nav_btype(cc1_type_nav, type_int);
+	type *ty_voidp = type_ptr_to(type_nav_btype(cc1_type_nav, type_void));
+	const unsigned ent_size = type_size(ty_int, NULL);
+	char *tbl_lbl = out_label_code("switch_tbl");
+	const out_val *tbl, *ent;
+	unsigned long i;
+
+	/* target = tbl + ((int *)tbl)[idx] */
+	idx = out_cast(octx, idx, ty_long, 0);
+	idx = out_op(octx, op_multiply, idx, out_new_l(octx, ty_long, ent_size));
+
+	tbl = out_new_lbl(octx, ty_long, tbl_lbl, OUT_LBL_PIC | OUT_LBL_PICLOCAL);
+	out_val_retain(octx, tbl);
+
+	ent = out_op(octx, op_plus, tbl, idx);
+	ent = out_change_type(octx, ent, type_ptr_to(ty_int));
+	ent = out_deref(octx, ent);
+	ent = out_cast(octx, ent, ty_long, 0);
+
+	ent = out_op(octx, op_plus, tbl, ent);
+	ent = out_change_type(octx, ent, ty_voidp);
+
+	out_ctrl_transfer_exp(octx, ent);
+
+	asm_out_align(&section_rodata, ent_size);
+	asm_out_section(&section_rodata, "%s:\n", tbl_lbl);
+	for(i = 0; i < ntargets; i++){
+		/* the targets are only reachable via the table */
+		if(i == 0 || targets[i] != targets[i - 1])
+			out_blk_mustgen(octx, targets[i], NULL);
+
+		asm_out_section(&section_rodata, "\t.long %s - %s\n", targets[i]->lbl, tbl_lbl);
+	}
+
+	free(tbl_lbl);
+}
+
 void out_ctrl_end_undefined(out_ctx *octx)
 {
+	/* paths branching off to a noreturn call or trap are rarely taken */
+	if(octx->current_blk)
+		octx->current_blk->noreturn = 1;
 	impl_undefined(octx);
 	octx->current_blk = NULL;
 }
@@ -14,6 +14,11 @@ struct out_ctx
 	out_blk *argspill_done_blk; /* finished spilling args - post variadic branching, etc */
 	out_blk *postprologue_blk; /* after arg spill, etc - user code goes here */
 	out_blk *epilogue_blk; /* stack tidy, stack protector check, callee save, etc */
+	struct out_sibling_call
+	{
+		out_blk *blk; /* epilogue copy, ending in a jump */
+		char *jmp;
+	} **sibling_calls;
 
 	out_blk *current_blk; /* pointer to current */
 
@@ -30,7 +35,8 @@ struct out_ctx
 	{
 		out_val val;
 		struct out_val_list *next, *prev;
-	} *val_head, *val_tail;
+		struct out_val_list *next_dead;
+	} *val_head, *val_tail, *val_dead; /* live values, newest first */
 	const out_val *current_stret;
 	const out_val *stack_canary_ent;
 
@@ -45,6 +51,7 @@ struct out_ctx
 	v_stackt cur_stack_sz;
 	v_stackt max_stack_sz;
 	v_stackt stack_n_alloc; /* just the alloc_n() part */
+	v_stackt stack_unshared_sz; /* all growth, as if nothing was reclaimed */
 	v_stackt stack_callspace; /* space used by extra call arguments */
 	v_stackt stack_calleesave_space; /* space used callee-save spills */
 	unsigned max_align;
@@ -36,8 +36,10 @@
 #include "write.h" /* dbg_add_file */
 #include "val.h"
 #include "backend.h" /* REG_BP */
+#include "impl.h" /* impl_reg_to_dwarf */
 #include "blk.h" /* .lbl */
 #include "dbg_lbl.h"
+#include "../time_report.h"
 
 #define DEBUG_TYPE_SKIP type_skip_non_tdefs_consts
 #define DEBUG_TYPE_HASH type_hash_skip_nontdefs_consts
@@ -113,7 +115,10 @@
 #define DW_OPS               \
 	X(DW_OP_plus_uconst, 0x23) \
 	X(DW_OP_addr, 0x3)         \
+	X(DW_OP_const8u, 0xe)      \
+	X(DW_OP_GNU_push_tls_address, 0xe0) \
 	X(DW_OP_breg6, 0x76)       \
+	X(DW_OP_reg0, 0x50)        \
 	X(DW_OP_deref, 0x6)
 
 enum dwarf_tag
@@ -182,6 +187,8 @@ static const char *die_op_to_str(enum dwarf_block_ops o)
 		DW_OPS
 #undef X
 	}
+	if(o > DW_OP_reg0 && o <= DW_OP_reg0 + 31)
+		return "DW_OP_regN";
 	return NULL;
 }
 
@@ -315,7 +322,7 @@ static void dwarf_die_new_at(struct DIE *d, enum dwarf_tag tag)
 
 static struct DIE *dwarf_die_new(enum dwarf_tag tag)
 {
-	struct DIE *d = umalloc(sizeof *d);
+	struct DIE *d = umalloc_tag(sizeof *d, UALLOC_DWARF);
 	dwarf_die_new_at(d, tag);
 	return d;
 }
@@ -436,7 +443,7 @@ static void dwarf_attr(
 		enum dwarf_attr_encoding enc,
 		void *data)
 {
-	struct DIE_attr *at = umalloc(sizeof *at);
+	struct DIE_attr *at = umalloc_tag(sizeof *at, UALLOC_DWARF);
 
 	dynarray_add(&die->attrs, at);
 
@@ -784,6 +791,8 @@ static struct DIE *dwarf_type_die(
 				tag = DW_TAG_volatile_type;
 			else if(q & qual_restrict)
 				tag = DW_TAG_restrict_type;
+			else if(q & qual_atomic) /* DW_TAG_atomic_type is DWARF 5 */
+				return dwarf_type_die(cu, parent, ty->ref);
 			else
 				ucc_unreach(NULL);
 
@@ -959,12 +968,29 @@ static int dbg_get_val_location(const out_val *v, long *const offset)
 	}
 }
 
+static struct dwarf_block *dbg_regvar_location(const out_val *v)
+{
+	struct dwarf_block *locn = umalloc(sizeof *locn);
+
+	locn->cnt = 1;
+	locn->ents = umalloc(sizeof *locn->ents);
+	locn->ents[0].type = BLOCK_HEADER;
+	locn->ents[0].bits.v = DW_OP_reg0 + impl_reg_to_dwarf(&v->bits.regoff.reg);
+
+	return locn;
+}
+
 static void dbg_add_sym_location(struct DIE *param, const out_val *v)
 {
 	struct dwarf_block *locn;
 	struct dwarf_block_ent *locn_data;
 	long offset;
 
+	if(v->flags & VAL_FLAG_REGVAR){
+		dwarf_attr(param, DW_AT_location, DW_FORM_block1, dbg_regvar_location(v));
+		return;
+	}
+
 	if(!dbg_get_val_location(v, &offset))
 		return;
 
@@ -1007,7 +1033,10 @@ static struct DIE *dbg_create_decl_die_local(
 
 	assert(d->sym);
 	assert(val && "local variable without out_val");
-	if(dbg_get_val_location(val, &offset)){
+	if(val->flags & VAL_FLAG_REGVAR){
+		dwarf_attr(var, DW_AT_location, DW_FORM_block1, dbg_regvar_location(val));
+
+	}else if(dbg_get_val_location(val, &offset)){
 		struct dwarf_block_ent *locn_ents;
 		struct dwarf_block *locn;
 		const int vla = type_is_variably_modified(d->ref);
@@ -1220,6 +1249,19 @@ static void dwarf_location_addr(struct dwarf_block_ent *locn_ents, decl *d)
 	locn_ents[1].bits.str = ustrdup(decl_asm_spel(d));
 }
 
+static void dwarf_location_tls(struct dwarf_block_ent *locn_ents, decl *d)
+{
+	/* offset into the module's TLS block, then ask for this thread's copy */
+	locn_ents[0].type = BLOCK_HEADER;
+	locn_ents[0].bits.v = DW_OP_const8u;
+
+	locn_ents[1].type = BLOCK_ADDR_STR;
+	locn_ents[1].bits.str = ustrprintf("%s@dtpoff", decl_asm_spel(d));
+
+	locn_ents[2].type = BLOCK_HEADER;
+	locn_ents[2].bits.v = DW_OP_GNU_push_tls_address;
+}
+
 static struct DIE *dwarf_global_variable(
 		struct cc1_dbg_ctx *dbg, decl *d, const int only_if_init)
 {
@@ -1251,12 +1293,17 @@ static struct DIE *dwarf_global_variable(
 		struct dwarf_block *locn;
 		struct dwarf_block_ent *locn_ents;
 
+		const int tls = !!(d->store & store_thread);
+
 		locn = umalloc(sizeof *locn);
-		locn_ents = umalloc(2 * sizeof *locn_ents);
+		locn_ents = umalloc((tls ? 3 : 2) * sizeof *locn_ents);
 
-		dwarf_location_addr(locn_ents, d);
+		if(tls)
+			dwarf_location_tls(locn_ents, d);
+		else
+			dwarf_location_addr(locn_ents, d);
 
-		locn->cnt = 2;
+		locn->cnt = tls ? 3 : 2;
 		locn->ents = locn_ents;
 
 		dwarf_attr(vardie, DW_AT_location, DW_FORM_block1, locn);
@@ -1319,23 +1366,24 @@ static struct DIE *dwarf_subprogram_func(
 	const char *asmsp;
 	int code_emitted;
 
-	subprog = dwarf_global_lookup(cu, d->spel);
-	if(subprog)
-		return subprog;
-
-	code_emitted = decl_should_emit_code(d);
-	if(!is_inline_instance && !code_emitted)
-		return NULL;
+	code_emitted = !is_inline_instance && decl_should_emit_code(d);
 
-	subprog = dwarf_die_new(DW_TAG_subprogram);
+	subprog = dwarf_global_lookup(cu, d->spel);
+	if(!subprog){
+		if(!is_inline_instance && !code_emitted)
+			return NULL;
 
-	asmsp = decl_asm_spel(d);
+		subprog = dwarf_die_new(DW_TAG_subprogram);
 
-	dwarf_attr_decl(cu, subprog,
-			d, type_func_call(d->ref, NULL),
-			/*show_extern:*/1);
+		dwarf_attr_decl(cu, subprog,
+				d, type_func_call(d->ref, NULL),
+				/*show_extern:*/1);
+	}
 
-	if(code_emitted){
+	/* an inlined function's code may never be emitted (-ftoplevel-reorder),
+	 * so its range is only added when it is */
+	if(code_emitted && !dwarf_attr_lookup(subprog, DW_AT_low_pc)){
+		asmsp = decl_asm_spel(d);
 		dwarf_attr(subprog, DW_AT_low_pc, DW_FORM_addr, ustrdup(asmsp));
 		dwarf_attr(subprog, DW_AT_high_pc, DW_FORM_addr, out_dbg_func_end(asmsp));
 	}
@@ -1602,9 +1650,13 @@ static void dwarf_flush(struct DIE_compile_unit *cu, long initial_offset)
 	flush.info.sec = &section_dbg_info;
 	flush.abbrev.sec = &section_dbg_abbrev;
 
+	time_report_push(TIME_DBG);
+
 	dwarf_flush_die(&cu->die, &flush);
 
 	asm_out_section(&section_dbg_abbrev, "\t.byte 0 # end\n");
+
+	time_report_pop(TIME_DBG);
 }
 
 static unsigned long dwarf_offset_die(
@@ -12,6 +12,7 @@
 
 #include "val.h"
 #include "blk.h"
+#include "insn.h"
 #include "ctx.h"
 #include "dbg_file.h"
 
@@ -80,7 +81,7 @@ void out_dbg_flush(out_ctx *octx)
 	else
 		location = ustrprintf(".loc %d %d\n", idx, octx->dbg.where.line);
 
-	blk_add_insn(octx->current_blk, location);
+	insn_add_text(octx->current_blk, location);
 }
 
 void out_dbg_where(out_ctx *octx, const where *w)
@@ -0,0 +1,426 @@
+#include <stddef.h>
+#include <stdarg.h>
+#include <limits.h>
+#include <assert.h>
+
+#include "../../util/math.h"
+#include "../../util/platform.h"
+#include "../../util/macros.h"
+
+#include "../type.h"
+#include "../type_is.h"
+#include "../type_nav.h"
+
+#include "out.h"
+#include "val.h"
+#include "virt.h"
+#include "impl.h"
+#include "divconst.h"
+
+#include "../cc1.h"
+
+/*
+ * Division by an invariant integer, after Hacker's Delight, chapter 10:
+ * n / d == mulhi(n, M) >> s, for a magic multiplier M with a few fixups.
+ *
+ * The magic is computed in W-bit modular arithmetic, masked to the width.
+ */
+
+#define W_MASK(bits) ((bits) < INTEGRAL_BITS \
+		? ((integral_t)1 << (bits)) - 1 : ~(integral_t)0)
+
+static sintegral_t sign_extend(integral_t v, unsigned bits)
+{
+	if(bits < INTEGRAL_BITS && (v & ((integral_t)1 << (bits - 1))))
+		v |= ~W_MASK(bits);
+	return (sintegral_t)v;
+}
+
+void out_divconst_magic_s(
+		sintegral_t d, unsigned bits, struct divconst_magic *magic)
+{
+	const integral_t mask = W_MASK(bits);
+	const integral_t two_w1 = (integral_t)1 << (bits - 1);
+	const integral_t ad = (d < 0 ? -(integral_t)d : (integral_t)d) & mask;
+	integral_t t, anc, q1, r1, q2, r2, delta;
+	unsigned p;
+
+	assert(d < -1 || d > 1);
+
+	t = two_w1 + (((integral_t)d & mask) >> (bits - 1));
+	anc = t - 1 - t % ad; /* |nc| */
+	p = bits - 1;
+	q1 = two_w1 / anc;
+	r1 = two_w1 - q1 * anc;
+	q2 = two_w1 / ad;
+	r2 = two_w1 - q2 * ad;
+
+	do{
+		p++;
+		q1 = (q1 * 2) & mask;
+		r1 = (r1 * 2) & mask;
+		if(r1 >= anc){
+			q1 = (q1 + 1) & mask;
+			r1 = (r1 - anc) & mask;
+		}
+		q2 = (q2 * 2) & mask;
+		r2 = (r2 * 2) & mask;
+		if(r2 >= ad){
+			q2 = (q2 + 1) & mask;
+			r2 = (r2 - ad) & mask;
+		}
+		delta = ad - r2;
+	}while(q1 < delta || (q1 == delta && r1 == 0));
+
+	magic->mul = (q2 + 1) & mask;
+	if(d < 0)
+		magic->mul = -magic->mul & mask;
+	magic->shift = p - bits;
+	magic->add = 0;
+}
+
+void out_divconst_magic_u(
+		integral_t d, unsigned bits, struct divconst_magic *magic)
+{
+	const integral_t mask = W_MASK(bits);
+	const integral_t two_w1 = (integral_t)1 << (bits - 1);
+	integral_t nc, q1, r1, q2, r2, delta;
+	unsigned p;
+	int add = 0;
+
+	assert(d > 1 && d <= mask);
+
+	nc = (mask - ((mask + 1 - d) & mask) % d) & mask;
+	p = bits - 1;
+	q1 = two_w1 / nc;
+	r1 = two_w1 - q1 * nc;
+	q2 = (two_w1 - 1) / d;
+	r2 = (two_w1 - 1) - q2 * d;
+
+	do{
+		p++;
+		if(r1 >= nc - r1){
+			q1 = (q1 * 2 + 1) & mask;
+			r1 = (r1 * 2 - nc) & mask;
+		}else{
+			q1 = (q1 * 2) & mask;
+			r1 = (r1 * 2) & mask;
+		}
+		if(r2 + 1 >= d - r2){
+			if(q2 >= two_w1 - 1)
+				add = 1;
+			q2 = (q2 * 2 + 1) & mask;
+			r2 = (r2 * 2 + 1 - d) & mask;
+		}else{
+			if(q2 >= two_w1)
+				add = 1;
+			q2 = (q2 * 2) & mask;
+			r2 = (r2 * 2 + 1) & mask;
+		}
+		delta = d - 1 - r2;
+	}while(p < 2 * bits && (q1 < delta || (q1 == delta && r1 == 0)));
+
+	magic->mul = (q2 + 1) & mask;
+	magic->shift = p - bits;
+	magic->add = add;
+}
+
+/* a copy we may clobber - out_op() works in-place on its lhs */
+static const out_val *divconst_copy(out_ctx *octx, const out_val *v)
+{
+	out_val_retain(octx, v);
+	return v_dup_or_reuse(octx, v, v->t);
+}
+
+static const out_val *divconst_k(out_ctx *octx, type *ty, sintegral_t k)
+{
+	return out_new_l(octx, ty, (long)k);
+}
+
+/* mulhi(n, mul) >> shift - a 32-bit value widens and takes the top half
+ * of a 64-bit product, so mul may be a 33-bit signed multiplier there */
+static const out_val *divconst_mulhi(
+		out_ctx *octx, const out_val *n, sintegral_t mul, unsigned shift)
+{
+	type *ty = n->t;
+	const unsigned bits = type_size(ty, NULL) * CHAR_BIT;
+	const int is_signed = type_is_signed(ty);
+
+	if(bits < 64){
+		type *wide = type_nav_btype(cc1_type_nav,
+				is_signed ? type_llong : type_ullong);
+
+		n = out_cast(octx, n, wide, /*normalise_bool*/0);
+		n = out_op(octx, op_multiply, n, divconst_k(octx, wide, mul));
+		n = out_op(octx, op_shiftr, n, divconst_k(octx, wide, bits + shift));
+		return out_cast(octx, n, ty, /*normalise_bool*/0);
+	}
+
+	n = impl_mulhi(octx, n, divconst_k(octx, ty, mul));
+	if(shift)
+		n = out_op(octx, op_shiftr, n, divconst_k(octx, ty, shift));
+	return n;
+}
+
+static const out_val *divconst_u(
+		out_ctx *octx, const out_val *n, integral_t d, unsigned bits)
+{
+	struct divconst_magic magic;
+	const out_val *t;
+
+	out_divconst_magic_u(d, bits, &magic);
+
+	if(!magic.add)
+		return divconst_mulhi(octx, n, magic.mul, magic.shift);
+
+	/* the multiplier needs W+1 bits:
+	 * q = (((n - t) >> 1) + t) >> (s - 1), where t = mulhi(n, M) */
+	t = divconst_mulhi(octx, divconst_copy(octx, n), magic.mul, 0);
+	n = out_op(octx, op_minus, n, divconst_copy(octx, t));
+	n = out_op(octx, op_shiftr, n, divconst_k(octx, n->t, 1));
+	n = out_op(octx, op_plus, n, t);
+	if(magic.shift > 1)
+		n = out_op(octx, op_shiftr, n, divconst_k(octx, n->t, magic.shift - 1));
+	return n;
+}
+
+static const out_val *divconst_s(
+		out_ctx *octx, const out_val *n, sintegral_t d, unsigned bits)
+{
+	struct divconst_magic magic;
+	sintegral_t mul;
+	type *ty = n->t;
+	const out_val *q, *sign;
+
+	out_divconst_magic_s(d, bits, &magic);
+	mul = sign_extend(magic.mul, bits);
+
+	if(bits < 64){
+		/* fold the +/- n correction into a wider multiplier */
+		if(d > 0 && mul < 0)
+			mul += (sintegral_t)1 << bits;
+		else if(d < 0 && mul > 0)
+			mul -= (sintegral_t)1 << bits;
+
+		q = divconst_mulhi(octx, n, mul, magic.shift);
+	}else{
+		q = divconst_mulhi(octx, divconst_copy(octx, n), mul, 0);
+
+		if(d > 0 && mul < 0)
+			q = out_op(octx, op_plus, q, n);
+		else if(d < 0 && mul > 0)
+			q = out_op(octx, op_minus, q, n);
+		else
+			out_val_consume(octx, n);
+
+		if(magic.shift)
+			q = out_op(octx, op_shiftr, q, divconst_k(octx, ty, magic.shift));
+	}
+
+	/* round towards zero: add one if the quotient is negative */
+	sign = out_op(octx, op_shiftr, divconst_copy(octx, q),
+			divconst_k(octx, ty, bits - 1));
+	return out_op(octx, op_minus, q, sign);
+}
+
+/* n / +/-2^k, rounding towards zero */
+static const out_val *divconst_s_pow2(
+		out_ctx *octx, enum op_type op, const out_val *n,
+		sintegral_t d, unsigned bits)
+{
+	const integral_t ad = d < 0 ? -(integral_t)d : (integral_t)d;
+	const unsigned k = log2ll(ad);
+	type *ty = n->t;
+	const out_val *bias;
+
+	/* bias = n < 0 ? 2^k - 1 : 0 */
+	bias = out_op(octx, op_shiftr, divconst_copy(octx, n),
+			divconst_k(octx, ty, bits - 1));
+	bias = out_op(octx, op_and, bias, divconst_k(octx, ty, ad - 1));
+
+	if(op == op_modulus){
+		/* ((n + bias) & (2^k - 1)) - bias */
+		n = out_op(octx, op_plus, n, divconst_copy(octx, bias));
+		n = out_op(octx, op_and, n, divconst_k(octx, ty, ad - 1));
+		return out_op(octx, op_minus, n, bias);
+	}
+
+	bias = out_op(octx, op_plus, bias, n);
+	bias = out_op(octx, op_shiftr, bias, divconst_k(octx, ty, k));
+	if(d < 0)
+		bias = out_op_unary(octx, op_minus, bias);
+	return bias;
+}
+
+const out_val *out_divconst(
+		out_ctx *octx, enum op_type op,
+		const out_val *n, const out_val *vd)
+{
+	type *ty = n->t;
+	const int is_signed = type_is_signed(ty);
+	unsigned bits;
+	integral_t d;
+	sintegral_t sd;
+	const out_val *q;
+
+	if(op != op_divide && op != op_modulus)
+		return NULL;
+	if(vd->type != V_CONST_I || n->type == V_CONST_I)
+		return NULL;
+	if(!type_is_integral(ty) || !type_is_integral(vd->t))
+		return NULL;
+	/* the 64-bit forms need a native high multiply */
+	if(platform_word_size() != 8)
+		return NULL;
+
+	bits = type_size(ty, NULL) * CHAR_BIT;
+	if(bits != 32 && bits != 64)
+		return NULL;
+	if(type_size(vd->t, NULL) * CHAR_BIT != bits)
+		return NULL;
+
+	d = vd->bits.val_i & W_MASK(bits);
+	sd = sign_extend(d, bits);
+	if(is_signed ? (sd >= -1 && sd <= 1) : d <= 1)
+		return NULL;
+
+	out_val_consume(octx, vd);
+	n = v_to_reg(octx, n);
+
+	if(is_signed){
+		if(ispow2(sd < 0 ? -(integral_t)sd : d))
+			return divconst_s_pow2(octx, op, n, sd, bits);
+
+		q = divconst_s(octx, divconst_copy(octx, n), sd, bits);
+	}else{
+		q = divconst_u(octx, divconst_copy(octx, n), d, bits);
+	}
+
+	if(op == op_divide){
+		out_val_consume(octx, n);
+		return q;
+	}
+
+	/* n % d == n - (n / d) * d */
+	q = out_op(octx, op_multiply, q, divconst_k(octx, ty, is_signed ? sd : (sintegral_t)d));
+	return out_op(octx, op_minus, n, q);
+}
+
+/* evaluate the sequences above on the host, for the self-test */
+static integral_t test_mulhi_u64(integral_t a, integral_t b)
+{
+	const integral_t lo_mask = 0xffffffffu;
+	integral_t a_lo = a & lo_mask, a_hi = a >> 32;
+	integral_t b_lo = b & lo_mask, b_hi = b >> 32;
+	integral_t ll = a_lo * b_lo, lh = a_lo * b_hi, hl = a_hi * b_lo;
+	integral_t mid = (ll >> 32) + (lh & lo_mask) + (hl & lo_mask);
+
+	return a_hi * b_hi + (lh >> 32) + (hl >> 32) + (mid >> 32);
+}
+
+static sintegral_t test_mulhi_s64(sintegral_t a, sintegral_t b)
+{
+	integral_t hi = test_mulhi_u64(a, b);
+
+	if(a < 0)
+		hi -= b;
+	if(b < 0)
+		hi -= a;
+	return hi;
+}
+
+static int test_div_u(integral_t n, integral_t d, unsigned bits)
+{
+	const integral_t mask = W_MASK(bits);
+	struct divconst_magic magic;
+	integral_t t, q;
+
+	out_divconst_magic_u(d, bits, &magic);
+
+	t = bits == 64
+		? test_mulhi_u64(n, magic.mul)
+		: (n * magic.mul) >> bits;
+
+	if(magic.add)
+		q = ((((n - t) & mask) >> 1) + t) >> (magic.shift - 1);
+	else
+		q = t >> magic.shift;
+
+	return (q & mask) == n / d;
+}
+
+static int test_div_s(sintegral_t n, sintegral_t d, unsigned bits)
+{
+	struct divconst_magic magic;
+	sintegral_t mul, q;
+
+	out_divconst_magic_s(d, bits, &magic);
+	mul = sign_extend(magic.mul, bits);
+
+	if(bits == 64){
+		q = test_mulhi_s64(n, mul);
+		if(d > 0 && mul < 0)
+			q += n;
+		else if(d < 0 && mul > 0)
+			q -= n;
+		q >>= magic.shift;
+	}else{
+		/* as generated, with the correction in the multiplier */
+		if(d > 0 && mul < 0)
+			mul += (sintegral_t)1 << bits;
+		else if(d < 0 && mul > 0)
+			mul -= (sintegral_t)1 << bits;
+		q = (n * mul) >> (bits + magic.shift);
+	}
+	q += q < 0;
+
+	return q == n / d;
+}
+
+void test_out_divconst(void)
+{
+	static const sintegral_t ns[] = {
+		0, 1, 2, 3, 7, 59, 60, 61, 99, 100, 101, 999, 1000, 1001,
+		65535, 65536, 1000000, 0x7ffffffe, 0x7fffffff,
+	};
+	static const sintegral_t ds[] = {
+		2, 3, 5, 6, 7, 9, 10, 11, 12, 13, 25, 60, 100, 125, 641, 1000,
+		3600, 86400, 1000000, 0x3fffffff, 0x40000001, 0x7fffffff,
+	};
+	unsigned i, j;
+	sintegral_t d;
+	integral_t n;
+
+	for(d = 2; d < 2000; d++){
+		for(i = 0; i < countof(ns); i++){
+			assert(test_div_u(ns[i], d, 32));
+			assert(test_div_u(0xffffffffu - ns[i], d, 32));
+			assert(test_div_u(ns[i], d, 64));
+			assert(test_div_u(~(integral_t)0 - ns[i], d, 64));
+
+			assert(test_div_s(ns[i], d, 32));
+			assert(test_div_s(-ns[i] - 1, d, 32));
+			assert(test_div_s(-ns[i], -d, 32));
+			assert(test_div_s(ns[i], d, 64));
+			assert(test_div_s(-ns[i], -d, 64));
+			assert(test_div_s(LLONG_MIN + ns[i], d, 64));
+			assert(test_div_s(LLONG_MAX - ns[i], -d, 64));
+		}
+	}
+
+	for(i = 0; i < countof(ds); i++){
+		const sintegral_t big = ds[i] << 20 | 1;
+
+		for(j = 0, n = 1; j < 64; j++, n = n * 3 + j){
+			assert(test_div_u(n & 0xffffffffu, ds[i], 32));
+			assert(test_div_u(n, ds[i], 64));
+			assert(test_div_u(n, big, 64));
+			assert(test_div_u(n, ~(integral_t)0 - ds[i], 64));
+
+			assert(test_div_s((sintegral_t)(n & 0xffffffffu) - 0x80000000, ds[i], 32));
+			assert(test_div_s((sintegral_t)(n & 0xffffffffu) - 0x80000000, -ds[i], 32));
+			assert(test_div_s((sintegral_t)n, ds[i], 64));
+			assert(test_div_s((sintegral_t)n, -big, 64));
+		}
+	}
+}
@@ -0,0 +1,22 @@
+#ifndef OUT_DIVCONST_H
+#define OUT_DIVCONST_H
+
+struct divconst_magic
+{
+	integral_t mul; /* W-bit multiplier */
+	unsigned shift;
+	int add; /* unsigned only - the multiplier needs W+1 bits */
+};
+
+void out_divconst_magic_s(
+		sintegral_t d, unsigned bits, struct divconst_magic *);
+void out_divconst_magic_u(
+		integral_t d, unsigned bits, struct divconst_magic *);
+
+/* n / d or n % d for a constant d, as multiplies and shifts.
+ * NULL if d or n's type don't suit, and the caller should divide */
+ucc_wur const out_val *out_divconst(
+		out_ctx *, enum op_type,
+		const out_val *n, const out_val *d);
+
+#endif
@@ -10,6 +10,7 @@
 #include "forwards.h"
 #include "val.h"
 #include "blk.h"
+#include "insn.h"
 #include "ctx.h"
 #include "out.h"
 #include "dbg_lbl.h"
@@ -29,15 +30,15 @@ static void blk_free_labels(struct out_dbg_lbl ***parray)
 
 static void blk_free(out_blk *blk)
 {
-	char **i;
+	size_t i;
 
 	blk_free_labels(&blk->labels.start);
 	blk_free_labels(&blk->labels.end);
 
 	free(blk->lbl);
 
-	for(i = blk->insns; i && *i; i++)
-		free(*i);
+	for(i = 0; i < blk->ninsns; i++)
+		insn_free(&blk->insns[i]);
 	free(blk->insns);
 
 	if(blk->type == BLK_COND)
@@ -83,7 +84,12 @@ static void out_wipe_vals(out_ctx *octx)
 		free(l);
 	}
 
-	octx->val_head = octx->val_tail = NULL;
+	for(l = octx->val_dead; l; l = next){
+		next = l->next_dead;
+		free(l);
+	}
+
+	octx->val_head = octx->val_tail = octx->val_dead = NULL;
 }
 
 void out_perfunc_teardown(out_ctx *octx)
@@ -19,11 +19,14 @@
 #include "blk.h"
 #include "dbg.h"
 #include "stack_protector.h"
+#include "stack.h"
 
 #include "../cc1.h" /* mopt_mode */
 #include "../fopt.h"
 #include "../../util/platform.h"
 #include "../../util/dynarray.h"
+#include "../../util/alloc.h"
+#include "../../util/macros.h"
 
 const out_val *out_call(out_ctx *octx,
 		const out_val *fn, const out_val **args,
@@ -38,6 +41,37 @@ const out_val *out_call(out_ctx *octx,
 	return impl_call(octx, fn, args, fnty);
 }
 
+const out_val *out_call_sibling(out_ctx *octx,
+		const out_val *fn, const out_val **args,
+		type *fnty)
+{
+	type *const retty = type_called(type_is_ptr_or_block(fnty), NULL);
+	struct out_sibling_call *sib;
+	char *jmp;
+
+	/* the canary check and alloca()'d memory need our frame */
+	if(octx->stack_canary_ent || octx->alloca_count)
+		return NULL;
+
+	jmp = impl_call_sibling(octx, fn, args, fnty);
+	if(!jmp)
+		return NULL;
+
+	if(cc1_fopt.verbose_asm)
+		out_comment(octx, "sibling call, reusing frame");
+
+	/* the jump is written with the epilogue, once callee saves are known */
+	sib = umalloc(sizeof *sib);
+	sib->blk = out_blk_new(octx, "sibling_call");
+	sib->jmp = jmp;
+	dynarray_add(&octx->sibling_calls, sib);
+
+	out_ctrl_transfer(octx, sib->blk, NULL, NULL, 0);
+	octx->current_blk = NULL;
+
+	return type_is_void(retty) ? out_new_noop(octx) : out_new_zero(octx, retty);
+}
+
 static void callee_save_or_restore_1(
 		out_ctx *octx, out_blk *in_blk,
 		struct vreg *cs, const out_val *stack_pos,
@@ -91,9 +125,14 @@ static void callee_save_or_restore(
 	restore_blk = octx->epilogue_blk;
 
 	for(i = octx->used_callee_saved; i && i->is_float != 2; i++){
+		struct out_sibling_call **sib;
+
 		callee_save_or_restore_1(octx, spill_blk, i, stack_locn, voidpp, 1, fnstart, fnend);
 		callee_save_or_restore_1(octx, restore_blk, i, stack_locn, voidpp, 0, fnstart, fnend);
 
+		for(sib = octx->sibling_calls; sib && *sib; sib++)
+			callee_save_or_restore_1(octx, (*sib)->blk, i, stack_locn, voidpp, 0, fnstart, fnend);
+
 		stack_locn = out_op(octx, op_plus, stack_locn,
 				out_new_l(octx, arithty, voidpsz));
 	}
@@ -334,12 +373,20 @@ void out_func_epilogue(
 
 	out_current_blk(octx, octx->epilogue_blk);
 	{
+		struct out_sibling_call **sib;
+
 		out_check_stack_canary(octx);
 
-		impl_func_epilogue(octx, ty, clean_stack);
+		impl_func_epilogue(octx, ty, clean_stack, NULL);
 		/* terminate here without an insn */
 		assert(octx->current_blk->type == BLK_UNINIT);
 		octx->current_blk->type = BLK_TERMINAL;
+
+		for(sib = octx->sibling_calls; sib && *sib; sib++){
+			out_current_blk(octx, (*sib)->blk);
+			impl_func_epilogue(octx, ty, clean_stack, (*sib)->jmp);
+			octx->current_blk->type = BLK_TERMINAL;
+		}
 	}
 
 	/* space for spills */
@@ -356,14 +403,17 @@ void out_func_epilogue(
 			assert(octx->max_stack_sz >= octx->stack_n_alloc);
 
 			out_comment(octx,
-					"stack_sz{cur=%lu,max=%lu} n_alloc=%lu call_spc=%lu calleesve=%lu max_align=%u",
+					"stack_sz{cur=%lu,max=%lu,unshared=%lu} n_alloc=%lu call_spc=%lu calleesve=%lu max_align=%u",
 					octx->cur_stack_sz,
 					octx->max_stack_sz,
+					MAX(octx->stack_unshared_sz, octx->max_stack_sz),
 					octx->stack_n_alloc,
 					octx->stack_callspace,
 					octx->stack_calleesave_space,
 					octx->max_align);
 
+			stack_reuse_account(octx);
+
 			if(cc1_fopt.verbose_asm){
 				out_comment(octx,
 						"red-zone %s (stack @ %zu bytes, had_call: %d, stack_ptr_manipulated: %d)",
@@ -401,6 +451,15 @@ void out_func_epilogue(
 
 	free(octx->used_callee_saved), octx->used_callee_saved = NULL;
 
+	{
+		struct out_sibling_call **sib;
+
+		for(sib = octx->sibling_calls; sib && *sib; sib++)
+			free((*sib)->jmp);
+
+		dynarray_free(struct out_sibling_call **, octx->sibling_calls, free);
+	}
+
 	if(octx->current_stret){
 		out_val_release(octx, octx->current_stret);
 		octx->current_stret = NULL;
@@ -417,6 +476,7 @@ void out_func_epilogue(
 		octx->max_align =
 		octx->stack_callspace =
 		octx->stack_calleesave_space =
+		octx->stack_unshared_sz =
 		octx->stack_n_alloc = 0;
 }
 
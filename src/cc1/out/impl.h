@@ -16,6 +16,12 @@ void impl_reg_cp_no_off(
 
 ucc_wur const out_val *impl_op(out_ctx *octx, enum op_type, const out_val *l, const out_val *r);
 ucc_wur const out_val *impl_op_unary(out_ctx *octx, enum op_type, const out_val *);
+/* NULL if there's no native form, for out_select() to mask instead */
+ucc_wur const out_val *impl_select(
+		out_ctx *, const out_val *cond_flag,
+		const out_val *vtrue, const out_val *vfalse);
+/* the high half of l * r, signed or unsigned as l's type */
+ucc_wur const out_val *impl_mulhi(out_ctx *octx, const out_val *l, const out_val *r);
 
 ucc_wur const out_val *impl_deref(
 		out_ctx *octx, const out_val *vp,
@@ -24,7 +30,7 @@ ucc_wur const out_val *impl_deref(
 	ucc_nonnull((1, 2, 3));
 
 void impl_branch(out_ctx *, const out_val *,
-		out_blk *bt, out_blk *bf, int unlikely);
+		out_blk *bt, out_blk *bf, out_blk *unlikely);
 void impl_jmp_expr(out_ctx *, const out_val *);
 
 ucc_wur const out_val *impl_i2f(out_ctx *octx, const out_val *, type *t_i, type *t_f);
@@ -43,6 +49,13 @@ ucc_wur const out_val *impl_call(
 		const out_val *fn, const out_val **args,
 		type *fnty);
 
+/* sets up args for a jump to fn, returning the jump target,
+ * or NULL (consuming nothing) if fn can't take over our frame */
+ucc_wur char *impl_call_sibling(
+		out_ctx *octx,
+		const out_val *fn, const out_val **args,
+		type *fnty);
+
 void impl_to_retreg(out_ctx *, const out_val *, type *retty);
 
 void impl_func_prologue_save_fp(out_ctx *octx);
@@ -52,10 +65,47 @@ void impl_func_prologue_save_call_regs(
 		const out_val *arg_offsets[/*nargs*/]);
 
 void impl_func_prologue_save_variadic(out_ctx *octx, type *rf);
-void impl_func_epilogue(out_ctx *, type *, int clean_stack);
+void impl_func_epilogue(out_ctx *, type *, int clean_stack, const char *sibling_jmp);
 
 void impl_undefined(out_ctx *octx);
+
+/* inline string ops, see out_memcpy(). src == NULL zeroes dest */
+void impl_mem_vec(out_ctx *, const out_val *dest, const out_val *src);
+void impl_mem_rep(
+		out_ctx *,
+		const out_val **dest, const out_val **src,
+		unsigned long nwords);
+/* NULL if there's no native form, for out_bitop() to expand */
+ucc_wur const out_val *impl_bitop(out_ctx *, enum out_bitop, const out_val *);
+void impl_prefetch(out_ctx *, const out_val *addr, int write, int locality);
+/* packed operations, see out_vec_*() */
+unsigned impl_vec_lanes(out_ctx *, type *elem);
+int impl_vec_op_supported(enum op_type, type *elem);
+void impl_vec_load(out_ctx *, unsigned reg, const out_val *addr, type *elem);
+void impl_vec_store(out_ctx *, const out_val *addr, unsigned reg, type *elem);
+void impl_vec_splat(out_ctx *, unsigned reg, const out_val *);
+void impl_vec_zero(out_ctx *, unsigned reg);
+void impl_vec_copy(out_ctx *, unsigned dest, unsigned src);
+void impl_vec_op(out_ctx *, enum op_type, type *elem, unsigned dest, unsigned src);
+ucc_wur const out_val *impl_vec_reduce(
+		out_ctx *, enum op_type, type *elem, unsigned reg, unsigned scratch);
+/* atomics, see out_atomic_*() - memory orders are at least the one asked for */
+ucc_wur const out_val *impl_atomic_load(
+		out_ctx *, const out_val *ptr, enum out_memorder);
+void impl_atomic_store(
+		out_ctx *, const out_val *ptr, const out_val *val, enum out_memorder);
+ucc_wur const out_val *impl_atomic_exchange(
+		out_ctx *, const out_val *ptr, const out_val *val);
+ucc_wur const out_val *impl_atomic_fetch_op(
+		out_ctx *, enum op_type, const out_val *ptr, const out_val *val);
+ucc_wur const out_val *impl_atomic_cmpxchg(
+		out_ctx *, const out_val *ptr,
+		const out_val *expected, const out_val *desired,
+		const out_val **success);
+void impl_atomic_fence(out_ctx *, enum out_memorder);
 void impl_debugtrap(out_ctx *octx);
+ucc_wur const out_val *impl_tls_addr(
+		out_ctx *, type *, const char *lbl, enum out_tls_model);
 void impl_set_nan(out_ctx *, out_val *);
 ucc_wur const out_val *impl_test_overflow(out_ctx *, const out_val **);
 
@@ -64,6 +114,8 @@ int impl_reg_to_idx(const struct vreg *);
 void impl_scratch_to_reg(int scratch, struct vreg *);
 int impl_reg_frame_const(const struct vreg *, int sp);
 int impl_reg_savable(const struct vreg *);
+int impl_reg_to_dwarf(const struct vreg *);
+const char *impl_reg_str(const struct vreg *);
 
 /* callee save register bools */
 int impl_reg_is_scratch(type *fnty, const struct vreg *);
@@ -0,0 +1,83 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../util/alloc.h"
+#include "../../util/dynmap.h"
+
+#include "forwards.h"
+#include "blk.h"
+#include "insn.h"
+
+static dynmap *insn_strings;
+
+const char *insn_intern(const char *s, size_t len)
+{
+	char buf[INSN_LINE_MAX];
+	char *found;
+
+	if(len >= sizeof buf)
+		len = sizeof buf - 1;
+	memcpy(buf, s, len);
+	buf[len] = '\0';
+
+	if(!insn_strings)
+		insn_strings = dynmap_new(char *, strcmp, dynmap_strhash);
+
+	found = dynmap_get(char *, char *, insn_strings, buf);
+	if(!found){
+		found = ustrdup_tag(buf, UALLOC_INSN);
+		(void)dynmap_set(char *, char *, insn_strings, found, found);
+	}
+
+	return found;
+}
+
+static struct insn *insn_new(out_blk *blk)
+{
+	if(blk->ninsns == blk->insns_max){
+		blk->insns_max = blk->insns_max ? blk->insns_max * 2 : 8;
+		blk->insns = urealloc_tag(
+				blk->insns,
+				blk->insns_max * sizeof *blk->insns,
+				blk->ninsns * sizeof *blk->insns,
+				UALLOC_INSN);
+	}
+
+	return &blk->insns[blk->ninsns++];
+}
+
+void insn_add(out_blk *blk, const struct insn *i)
+{
+	*insn_new(blk) = *i;
+}
+
+void insn_insert(out_blk *blk, size_t at, const struct insn *i)
+{
+	insn_new(blk);
+	memmove(&blk->insns[at + 1], &blk->insns[at],
+			(blk->ninsns - 1 - at) * sizeof *blk->insns);
+	blk->insns[at] = *i;
+}
+
+void insn_add_text(out_blk *blk, char *text)
+{
+	struct insn *i = insn_new(blk);
+
+	memset(i, 0, sizeof *i);
+	i->bits.text = text;
+}
+
+int insn_str(const struct insn *i, char *buf, size_t n)
+{
+	if(!i->op)
+		return snprintf(buf, n, "%s", i->bits.text);
+
+	return impl_insn_str(i, buf, n);
+}
+
+void insn_free(struct insn *i)
+{
+	if(!i->op)
+		free(i->bits.text);
+}
@@ -0,0 +1,77 @@
+#ifndef INSN_H
+#define INSN_H
+
+#include <stddef.h>
+
+#include "forwards.h"
+
+#define INSN_MAX_OPNDS 3
+#define INSN_REG_NONE -1
+
+/* longest instruction line a record formats to */
+#define INSN_LINE_MAX 256
+
+enum insn_opnd_kind
+{
+	OPND_NONE,
+	OPND_REG, /* register */
+	OPND_IMM, /* immediate - number and/or symbol */
+	OPND_MEM, /* memory - [sym][+num](base, index, scale) */
+	OPND_SYM  /* bare symbol - branch target or absolute address */
+};
+
+enum insn_reloc
+{
+	INSN_RELOC_NONE,
+	INSN_RELOC_PLT,
+	INSN_RELOC_GOTPCREL,
+	INSN_RELOC_TPOFF,
+	INSN_RELOC_GOTTPOFF
+};
+
+/* kept to 24 bytes - blocks hold one of these per operand slot */
+struct insn_opnd
+{
+	unsigned char kind; /* enum insn_opnd_kind */
+	unsigned char reloc; /* enum insn_reloc, suffixes sym */
+	unsigned char regsz; /* bytes, OPND_REG */
+	unsigned char scale; /* OPND_MEM, 0 if absent */
+	unsigned char seg; /* OPND_MEM/SYM segment override, backend's, 0 if none */
+	unsigned indirect : 1; /* branch through operand */
+	unsigned is_unsigned : 1; /* OPND_IMM, num is printed unsigned */
+	signed char reg; /* OPND_REG, or OPND_MEM base */
+	signed char idx; /* OPND_MEM index */
+	const char *sym; /* interned, may be null */
+	long long num; /* immediate value or displacement */
+};
+
+/* a single backend instruction, kept structured until its block is flushed.
+ * lines the backend can't represent (comments, directives, ...) are kept
+ * verbatim in .bits.text, with .op null */
+struct insn
+{
+	const char *op; /* interned mnemonic */
+	unsigned char nopnds;
+	union
+	{
+		struct insn_opnd opnds[INSN_MAX_OPNDS];
+		char *text;
+	} bits;
+};
+
+const char *insn_intern(const char *s, size_t len);
+
+void insn_add(out_blk *, const struct insn *);
+void insn_add_text(out_blk *, char *text);
+void insn_insert(out_blk *, size_t at, const struct insn *);
+
+/* formats an instruction's assembly line into buf,
+ * with no indent or newline. returns snprintf() style */
+int insn_str(const struct insn *, char *buf, size_t n);
+
+void insn_free(struct insn *);
+
+/* backend: format an instruction record */
+int impl_insn_str(const struct insn *, char *buf, size_t n);
+
+#endif
@@ -1,11 +1,14 @@
 #include <stddef.h>
+#include <stdarg.h>
 #include <stdlib.h>
 #include <assert.h>
 
 #include "../type_nav.h"
+#include "../type_is.h"
 
 #include "out.h"
 #include "val.h" /* for .t */
+#include "impl.h"
 
 /* for libc */
 #include "../funcargs.h"
@@ -13,35 +16,141 @@
 #include "../fopt.h"
 #include "../cc1.h"
 
-static void out_memcpy_single(
+enum stringop_method
+{
+	STRINGOP_LIBCALL,
+	STRINGOP_MOVES,
+	STRINGOP_REP
+};
+
+/* past this, a rep-prefixed string instruction is shorter than the moves */
+#define STRINGOP_MOVES_MAX 64
+
+static enum stringop_method stringop_choose(unsigned long nbytes)
+{
+	switch(cc1_mstringop_strategy){
+		case STRINGOP_STRATEGY_LIBCALL:
+			if(!cc1_fopt.freestanding)
+				return STRINGOP_LIBCALL;
+			break;
+		case STRINGOP_STRATEGY_THRESHOLD:
+			if(!cc1_fopt.freestanding && nbytes >= cc1_mstringop_threshold)
+				return STRINGOP_LIBCALL;
+			break;
+		case STRINGOP_STRATEGY_LOOP:
+			break;
+		case STRINGOP_STRATEGY_UNROLLED:
+			return STRINGOP_MOVES;
+		case STRINGOP_STRATEGY_REP:
+			return nbytes >= MEM_REP_BYTES ? STRINGOP_REP : STRINGOP_MOVES;
+	}
+
+	return nbytes > STRINGOP_MOVES_MAX ? STRINGOP_REP : STRINGOP_MOVES;
+}
+
+static const out_val *mem_seek(
+		out_ctx *octx, const out_val *p, long delta, type *ptr_ty)
+{
+	/* byte-wise pointer adjustment - a register offset, not an instruction */
+	p = out_change_type(octx, p,
+			type_ptr_to(type_nav_btype(cc1_type_nav, type_nchar)));
+
+	if(delta)
+		p = out_op(octx, delta > 0 ? op_plus : op_minus, p,
+				out_new_l(octx, type_nav_btype(cc1_type_nav, type_intptr_t), labs(delta)));
+
+	return out_change_type(octx, p, ptr_ty);
+}
+
+static void mem_move1(
 		out_ctx *octx,
-		const out_val **dst, const out_val **src)
+		const out_val **dest, const out_val **src,
+		long delta, unsigned size)
 {
-	type *t1 = type_nav_btype(cc1_type_nav, type_intptr_t);
+	type *ty, *ptr_ty;
+
+	if(size == MEM_VEC_BYTES){
+		ty = type_nav_btype(cc1_type_nav, type_nchar);
+		ptr_ty = type_ptr_to(ty);
+	}else{
+		ty = type_nav_MAX_FOR(cc1_type_nav, size, 0);
+		ptr_ty = type_ptr_to(ty);
+	}
 
-	out_val_retain(octx, *dst);
-	out_val_retain(octx, *src);
-	out_store(octx, *dst, out_deref(octx, *src));
+	*dest = mem_seek(octx, *dest, delta, ptr_ty);
+	if(*src)
+		*src = mem_seek(octx, *src, delta, ptr_ty);
 
-	*dst = out_op(octx, op_plus, *dst, out_new_l(octx, t1, 1));
-	*src = out_op(octx, op_plus, *src, out_new_l(octx, t1, 1));
+	out_val_retain(octx, *dest);
+	if(*src)
+		out_val_retain(octx, *src);
+
+	if(size == MEM_VEC_BYTES){
+		impl_mem_vec(octx, *dest, *src);
+		return;
+	}
+
+	out_store(octx, *dest,
+			*src ? out_deref(octx, *src) : out_new_zero(octx, ty));
 }
 
-static int should_use_libc(unsigned long nbytes)
+/* straight-line copy (or zeroing, *src == NULL) of nbytes from *dest,
+ * widest moves first. Once a wider move has been made, the tail is
+ * done with a single move overlapping what's already been copied */
+static void mem_moves(
+		out_ctx *octx,
+		const out_val **dest, const out_val **src,
+		unsigned long nbytes)
 {
-	if(cc1_fopt.freestanding)
-		return 0;
+	unsigned long off = 0, at = 0;
 
-	switch(cc1_mstringop_strategy){
-		case STRINGOP_STRATEGY_LIBCALL:
-			return 1;
-		case STRINGOP_STRATEGY_LOOP:
-			return 0;
-		case STRINGOP_STRATEGY_THRESHOLD:
-			return nbytes >= cc1_mstringop_threshold;
+	while(off < nbytes){
+		unsigned long left = nbytes - off;
+		unsigned step, wider;
+
+		for(step = MEM_VEC_BYTES; step > left; step /= 2);
+		wider = step * 2;
+
+		if(left > step && wider <= MEM_VEC_BYTES && wider <= nbytes){
+			mem_move1(octx, dest, src, (long)(nbytes - wider) - (long)at, wider);
+			break;
+		}
+
+		mem_move1(octx, dest, src, (long)off - (long)at, step);
+		at = off;
+		off += step;
 	}
+}
+
+static void mem_inline(
+		out_ctx *octx,
+		const out_val *dest, const out_val *src,
+		unsigned long nbytes)
+{
+	/* consumes dest and src */
+	if(stringop_choose(nbytes) == STRINGOP_REP){
+		unsigned long nwords = nbytes / MEM_REP_BYTES;
+		type *charp = type_ptr_to(type_nav_btype(cc1_type_nav, type_nchar));
 
-	assert(0 && "unreachable");
+		if(cc1_fopt.verbose_asm)
+			out_comment(octx, "rep of %lu words", nwords);
+
+		/* remove potential struct types, as for emit_libc_call() */
+		dest = mem_seek(octx, dest, 0, charp);
+		if(src)
+			src = mem_seek(octx, src, 0, charp);
+
+		impl_mem_rep(octx, &dest, src ? &src : NULL, nwords);
+
+		/* dest and src now point past the copied words */
+		nbytes %= MEM_REP_BYTES;
+	}
+
+	mem_moves(octx, &dest, &src, nbytes);
+
+	out_val_release(octx, dest);
+	if(src)
+		out_val_release(octx, src);
 }
 
 static const out_val *emit_libc_call(
@@ -86,35 +195,19 @@ const out_val *out_memcpy(
 		return dest;
 	}
 
-	if(should_use_libc(nbytes)){
+	if(stringop_choose(nbytes) == STRINGOP_LIBCALL){
 		const out_val *nbytes_val = out_new_l(octx, type_nav_btype(cc1_type_nav, type_uintptr_t), nbytes);
 
 		return emit_libc_call(octx, "memcpy", dest, src, nbytes_val);
-	}else{
-		size_t bytes_todo = nbytes;
-
-		if(cc1_fopt.verbose_asm)
-			out_comment(octx, "generated memcpy of %zu bytes", nbytes);
-
-		while(bytes_todo > 0){
-			type *step = type_nav_MAX_FOR(cc1_type_nav, bytes_todo, 0);
-			type *step_ptr = type_ptr_to(step);
-			unsigned step_sz = type_size(step, NULL);
-
-			dest = out_change_type(octx, dest, step_ptr);
-			src = out_change_type(octx, src, step_ptr);
+	}
 
-			while(bytes_todo >= step_sz){
-				out_memcpy_single(octx, &dest, &src);
-				bytes_todo -= step_sz;
-			}
-		}
+	if(cc1_fopt.verbose_asm)
+		out_comment(octx, "generated memcpy of %lu bytes", nbytes);
 
-		out_val_release(octx, src);
-		return out_op(
-				octx, op_minus,
-				dest, out_new_l(octx, dest->t, nbytes));
-	}
+	/* memcpy returns the original dest */
+	out_val_retain(octx, dest);
+	mem_inline(octx, dest, src, nbytes);
+	return dest;
 }
 
 void out_memset(
@@ -128,62 +221,24 @@ void out_memset(
 		return;
 	}
 
-	if(should_use_libc(nbytes)){
+	if(v_ptr->flags & VAL_FLAG_REGVAR){
+		assert(byte == 0 && "TODO: non-zero out_memset()");
+		out_store(octx, v_ptr, out_new_zero(octx, type_is_ptr(v_ptr->t)));
+		return;
+	}
+
+	if(stringop_choose(nbytes) == STRINGOP_LIBCALL){
 		const out_val *byte_val = out_new_l(octx, type_nav_btype(cc1_type_nav, type_uchar), byte);
 		const out_val *nbytes_val = out_new_l(octx, type_nav_btype(cc1_type_nav, type_uintptr_t), nbytes);
 
 		out_val_consume(octx, emit_libc_call(octx, "memset", v_ptr, byte_val, nbytes_val));
-	}else{
-		size_t n, rem;
-		unsigned i;
-		type *tzero = type_nav_MAX_FOR(cc1_type_nav, nbytes, 0);
-
-		type *textra, *textrap;
-
-		assert(byte == 0 && "TODO: non-zero out_memset()");
-
-		if(!tzero)
-			tzero = type_nav_btype(cc1_type_nav, type_nchar);
-
-		n   = nbytes / type_size(tzero, NULL);
-		rem = nbytes % type_size(tzero, NULL);
-
-		if((textra = rem ? type_nav_MAX_FOR(cc1_type_nav, rem, 0) : NULL))
-			textrap = type_ptr_to(textra);
-
-		v_ptr = out_change_type(octx, v_ptr, type_ptr_to(tzero));
-
-#ifdef MEMSET_VERBOSE
-		out_comment("memset(%s, %d, %lu), using ptr<%s>, %lu steps",
-				e->expr->f_str(),
-				e->bits.builtin_memset.ch,
-				e->bits.builtin_memset.len,
-				type_to_str(tzero), n);
-#endif
-
-		for(i = 0; i < n; i++){
-			const out_val *v_zero = out_new_zero(octx, tzero);
-			const out_val *v_inc;
-
-			/* *p = 0 */
-			out_val_retain(octx, v_ptr);
-			out_store(octx, v_ptr, v_zero);
-
-			/* p++ (copied pointer) */
-			v_inc = out_new_l(octx, type_nav_btype(cc1_type_nav, type_intptr_t), 1);
-
-			v_ptr = out_op(octx, op_plus, v_ptr, v_inc);
+		return;
+	}
 
-			if(rem){
-				/* need to zero a little more */
-				v_ptr = out_change_type(octx, v_ptr, textrap);
-				v_zero = out_new_zero(octx, textra);
+	assert(byte == 0 && "TODO: non-zero out_memset()");
 
-				out_val_retain(octx, v_ptr);
-				out_store(octx, v_ptr, v_zero);
-			}
-		}
+	if(cc1_fopt.verbose_asm)
+		out_comment(octx, "generated memset of %lu bytes", nbytes);
 
-		out_val_release(octx, v_ptr);
-	}
+	mem_inline(octx, v_ptr, NULL, nbytes);
 }
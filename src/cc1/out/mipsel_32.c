@@ -524,3 +524,154 @@ int impl_frame_ptr_to_reg(int nframes)
 	ICE("TODO: builtin frame address");
 	return -1;
 }
+
+const out_val *impl_bitop(out_ctx *octx, enum out_bitop op, const out_val *v)
+{
+	/* no clz/wsbh before mips32r2 - out_bitop() expands these */
+	(void)octx;
+	(void)op;
+	(void)v;
+	return NULL;
+}
+
+void impl_prefetch(out_ctx *octx, const out_val *addr, int write, int locality)
+{
+	/* pref needs mips32/mips iv, the hint is only advisory */
+	(void)write;
+	(void)locality;
+	out_val_consume(octx, addr);
+}
+
+unsigned impl_vec_lanes(out_ctx *octx, type *elem)
+{
+	/* no SIMD - the loop vectoriser leaves everything scalar */
+	(void)octx;
+	(void)elem;
+	return 0;
+}
+
+int impl_vec_op_supported(enum op_type op, type *elem)
+{
+	(void)op;
+	(void)elem;
+	return 0;
+}
+
+void impl_vec_load(out_ctx *octx, unsigned reg, const out_val *addr, type *elem)
+{
+	ICE("TODO: vector load");
+}
+
+void impl_vec_store(out_ctx *octx, const out_val *addr, unsigned reg, type *elem)
+{
+	ICE("TODO: vector store");
+}
+
+void impl_vec_splat(out_ctx *octx, unsigned reg, const out_val *v)
+{
+	ICE("TODO: vector splat");
+}
+
+void impl_vec_zero(out_ctx *octx, unsigned reg)
+{
+	ICE("TODO: vector zero");
+}
+
+void impl_vec_copy(out_ctx *octx, unsigned dest, unsigned src)
+{
+	ICE("TODO: vector copy");
+}
+
+void impl_vec_op(out_ctx *octx, enum op_type op, type *elem, unsigned dest, unsigned src)
+{
+	ICE("TODO: vector op");
+}
+
+const out_val *impl_vec_reduce(
+		out_ctx *octx, enum op_type op, type *elem, unsigned reg, unsigned scratch)
+{
+	ICE("TODO: vector reduce");
+	return NULL;
+}
+
+const out_val *impl_atomic_load(
+		out_ctx *octx, const out_val *ptr, enum out_memorder mo)
+{
+	ICE("TODO: atomics (ll/sc)");
+	return NULL;
+}
+
+void impl_atomic_store(
+		out_ctx *octx, const out_val *ptr, const out_val *val,
+		enum out_memorder mo)
+{
+	ICE("TODO: atomics (ll/sc)");
+}
+
+const out_val *impl_atomic_exchange(
+		out_ctx *octx, const out_val *ptr, const out_val *val)
+{
+	ICE("TODO: atomics (ll/sc)");
+	return NULL;
+}
+
+const out_val *impl_atomic_fetch_op(
+		out_ctx *octx, enum op_type op,
+		const out_val *ptr, const out_val *val)
+{
+	ICE("TODO: atomics (ll/sc)");
+	return NULL;
+}
+
+const out_val *impl_atomic_cmpxchg(
+		out_ctx *octx, const out_val *ptr,
+		const out_val *expected, const out_val *desired,
+		const out_val **success)
+{
+	ICE("TODO: atomics (ll/sc)");
+	return NULL;
+}
+
+void impl_atomic_fence(out_ctx *octx, enum out_memorder mo)
+{
+	out_asm(octx, "sync");
+}
+
+char *impl_call_sibling(
+		out_ctx *octx,
+		const out_val *fn, const out_val **args,
+		type *fnty)
+{
+	(void)octx;
+	(void)fn;
+	(void)args;
+	(void)fnty;
+	return NULL;
+}
+
+const out_val *impl_select(
+		out_ctx *octx, const out_val *cond,
+		const out_val *vtrue, const out_val *vfalse)
+{
+	/* no movn/movz yet - out_select() masks */
+	(void)octx;
+	(void)cond;
+	(void)vtrue;
+	(void)vfalse;
+	return NULL;
+}
+
+const out_val *impl_mulhi(
+		out_ctx *octx, const out_val *l, const out_val *r)
+{
+	/* out_divconst() only expands on 64-bit targets */
+	ICE("TODO: mulhi");
+	return NULL;
+}
+
+const out_val *impl_tls_addr(
+		out_ctx *octx, type *ty, const char *lbl, enum out_tls_model model)
+{
+	ICE("TODO: thread-local storage");
+	return NULL;
+}
@@ -55,4 +55,7 @@
 #define REG_RET        MIPS_REG_V0
 #define REG_SP         MIPS_REG_SP
 
+#define VEC_BYTES 0 /* no SIMD */
+#define N_VEC_REGS 0
+
 #endif
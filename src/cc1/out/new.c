@@ -21,6 +21,7 @@
 #include "ctx.h"
 #include "blk.h"
 #include "impl.h"
+#include "virt.h"
 
 out_val *out_new_blk_addr(out_ctx *octx, out_blk *blk)
 {
@@ -122,6 +123,22 @@ out_val *out_new_lbl(
 	return v;
 }
 
+const out_val *out_new_tls_lbl(
+		out_ctx *octx, type *ty,
+		const char *s,
+		enum out_tls_model model)
+{
+	const out_val *except[] = { NULL };
+
+	if(model == OUT_TLS_GLOBAL_DYNAMIC){
+		/* calls __tls_get_addr(), so we need a frame */
+		octx->had_call = 1;
+	}
+	v_decay_flags_except(octx, except);
+
+	return impl_tls_addr(octx, ty, s, model);
+}
+
 out_val *out_new_nan(out_ctx *octx, type *ty)
 {
 	out_val *v = v_new(octx, ty);
@@ -0,0 +1,1943 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdarg.h>
+#include <ctype.h>
+
+#include "../../util/alloc.h"
+#include "../../util/dynmap.h"
+#include "../../util/dynarray.h"
+#include "../../util/macros.h"
+#include "../../util/warn.h"
+#include "../../util/where.h"
+
+#include "obj.h"
+#include "obj_impl.h"
+#include "elf.h"
+
+#define OBJ_LINE_MAX 4096
+#define OBJ_NUMLBL_MAX 100
+
+struct obj_fixup
+{
+	struct obj_section *sec;
+	unsigned long long off;
+	unsigned size;
+	enum obj_fixup_flags flags;
+	long long pc_adjust;
+	struct obj_expr expr;
+	unsigned lineno;
+};
+
+struct obj_dbg_row
+{
+	struct obj_section *sec;
+	unsigned long long off;
+	unsigned file, line, col;
+};
+
+static struct
+{
+	dynmap *syms; /* char * => struct obj_sym * */
+	struct obj_sym **symlist; /* every symbol, including temporaries */
+	struct obj_section **sections;
+	struct obj_section *cur, *prev;
+	struct obj_section **section_stack;
+
+	struct obj_fixup *fixups;
+	size_t nfixups, fixups_max;
+
+	struct obj_dbg_row *rows;
+	size_t nrows, rows_max;
+	char **files; /* .file index => name, NULL-terminated with gaps as "" */
+
+	unsigned numlbl[OBJ_NUMLBL_MAX];
+
+	FILE *text; /* cc1's assembly output, read back up to text_off */
+	long text_off;
+
+	unsigned lineno;
+	const char *line;
+	int in_comment;
+	int errors;
+} obj;
+
+void obj_error(const char *fmt, ...)
+{
+	where w;
+	char buf[256];
+	va_list l;
+
+	memset(&w, 0, sizeof w);
+	w.fname = "<integrated-as>";
+	w.line = obj.lineno;
+	w.line_str = obj.line;
+
+	va_start(l, fmt);
+	vsnprintf(buf, sizeof buf, fmt, l);
+	va_end(l);
+
+	warn_at_print_error(&w, "%s", buf);
+	obj.errors++;
+}
+
+static const char *skipspace(const char *p)
+{
+	while(*p == ' ' || *p == '\t')
+		p++;
+	return p;
+}
+
+static int is_sym_start(int c)
+{
+	return isalpha(c) || c == '_' || c == '.';
+}
+
+static int is_sym_char(int c)
+{
+	return isalnum(c) || c == '_' || c == '.' || c == '$';
+}
+
+static struct obj_sym *obj_sym_new(char *name)
+{
+	struct obj_sym *sym = umalloc_tag(sizeof *sym, UALLOC_OBJ);
+
+	memset(sym, 0, sizeof *sym);
+	sym->name = name;
+	dynarray_add(&obj.symlist, sym);
+
+	return sym;
+}
+
+static struct obj_sym *obj_sym_get(const char *name, size_t len)
+{
+	char buf[OBJ_LINE_MAX];
+	struct obj_sym *sym;
+
+	if(len >= sizeof buf)
+		len = sizeof buf - 1;
+	memcpy(buf, name, len);
+	buf[len] = '\0';
+
+	sym = dynmap_get(char *, struct obj_sym *, obj.syms, buf);
+	if(!sym){
+		sym = obj_sym_new(ustrdup_tag(buf, UALLOC_OBJ));
+		(void)dynmap_set(char *, struct obj_sym *, obj.syms, sym->name, sym);
+	}
+
+	return sym;
+}
+
+struct obj_sym *obj_sym_ref(const char *name)
+{
+	return obj_sym_get(name, strlen(name));
+}
+
+static struct obj_section *obj_section_get(const char *name);
+
+static struct obj_section *obj_cur(void)
+{
+	if(!obj.cur)
+		obj.cur = obj_section_get(".text");
+	return obj.cur;
+}
+
+static void obj_sym_define(struct obj_sym *sym)
+{
+	struct obj_section *sec = obj_cur();
+
+	if(sym->defined || sym->is_common){
+		obj_error("symbol \"%s\" is already defined", sym->name);
+		return;
+	}
+
+	sym->defined = 1;
+	sym->sec = sec;
+	sym->value = sec->size;
+}
+
+/* the location counter, `.' */
+static struct obj_sym *obj_dot(void)
+{
+	struct obj_sym *sym = obj_sym_new(NULL);
+	obj_sym_define(sym);
+	return sym;
+}
+
+static void obj_numlbl_name(char *buf, size_t n, unsigned lbl, unsigned instance)
+{
+	snprintf(buf, n, ".L%u\001%u", lbl, instance);
+}
+
+static int obj_modifier_parse(const char **pp, enum obj_modifier *mod)
+{
+	static const struct
+	{
+		const char *name;
+		enum obj_modifier mod;
+	} mods[] = {
+		{ "PLT", OBJ_MOD_PLT },
+		{ "GOTPCREL", OBJ_MOD_GOTPCREL },
+		{ "GOTOFF", OBJ_MOD_GOTOFF },
+		{ "GOTTPOFF", OBJ_MOD_GOTTPOFF },
+		{ "TPOFF", OBJ_MOD_TPOFF },
+		{ "TLSGD", OBJ_MOD_TLSGD },
+		{ "TLSLD", OBJ_MOD_TLSLD },
+		{ "DTPOFF", OBJ_MOD_DTPOFF },
+	};
+	const char *start = *pp, *p = start;
+	size_t i;
+
+	while(isalnum(*p))
+		p++;
+
+	for(i = 0; i < countof(mods); i++){
+		if(strlen(mods[i].name) == (size_t)(p - start)
+		&& !strncasecmp(mods[i].name, start, p - start))
+		{
+			*mod = mods[i].mod;
+			*pp = p;
+			return 0;
+		}
+	}
+
+	obj_error("unknown relocation modifier \"@%.*s\"", (int)(p - start), start);
+	return 1;
+}
+
+static int obj_expr_sum(const char **pp, struct obj_expr *e);
+
+static int obj_expr_primary(const char **pp, struct obj_expr *e)
+{
+	const char *p = skipspace(*pp);
+
+	memset(e, 0, sizeof *e);
+
+	if(*p == '('){
+		p++;
+		if(obj_expr_sum(&p, e))
+			return 1;
+		p = skipspace(p);
+		if(*p != ')'){
+			obj_error("expected ')' in expression");
+			return 1;
+		}
+		p++;
+
+	}else if(*p == '-' || *p == '~' || *p == '+'){
+		const char op = *p++;
+
+		if(obj_expr_primary(&p, e))
+			return 1;
+		if(op != '+'){
+			if(!obj_expr_is_const(e)){
+				obj_error("can't negate a symbol");
+				return 1;
+			}
+			e->num = op == '-' ? -e->num : ~e->num;
+		}
+
+	}else if(isdigit(*p)){
+		const char *digits = p;
+		char *end;
+
+		while(isdigit(*p))
+			p++;
+
+		if((*p == 'b' || *p == 'f') && !is_sym_char(p[1])
+		&& !(p - digits == 1 && *digits == '0' && *p == 'b' && isdigit(p[1])))
+		{
+			/* 1b, 1f: numeric local labels */
+			char buf[32];
+			unsigned lbl = strtoul(digits, NULL, 10);
+			unsigned instance;
+
+			if(lbl >= OBJ_NUMLBL_MAX){
+				obj_error("numeric label %u out of range", lbl);
+				return 1;
+			}
+			instance = obj.numlbl[lbl];
+			if(*p == 'b'){
+				if(instance == 0){
+					obj_error("no previous definition of label %u", lbl);
+					return 1;
+				}
+				instance--;
+			}
+
+			obj_numlbl_name(buf, sizeof buf, lbl, instance);
+			e->add = obj_sym_get(buf, strlen(buf));
+			p++;
+		}else{
+			p = digits;
+			if(p[0] == '0' && (p[1] == 'b' || p[1] == 'B'))
+				e->num = strtoull(p + 2, &end, 2);
+			else
+				e->num = strtoull(p, &end, 0);
+			p = end;
+		}
+
+	}else if(*p == '\''){
+		p++;
+		if(*p == '\\'){
+			p++;
+			switch(*p){
+				case 'n': e->num = '\n'; break;
+				case 't': e->num = '\t'; break;
+				case 'r': e->num = '\r'; break;
+				case '0': e->num = '\0'; break;
+				default: e->num = (unsigned char)*p;
+			}
+		}else{
+			e->num = (unsigned char)*p;
+		}
+		if(*p)
+			p++;
+		if(*p == '\'')
+			p++;
+
+	}else if(*p == '.' && !is_sym_char(p[1])){
+		e->add = obj_dot();
+		p++;
+
+	}else if(is_sym_start(*p)){
+		const char *start = p;
+
+		while(is_sym_char(*p))
+			p++;
+
+		e->add = obj_sym_get(start, p - start);
+
+		if(*p == '@'){
+			p++;
+			if(obj_modifier_parse(&p, &e->mod))
+				return 1;
+		}
+
+	}else{
+		obj_error("expected expression at \"%s\"", p);
+		return 1;
+	}
+
+	*pp = p;
+	return 0;
+}
+
+static int obj_expr_term(const char **pp, struct obj_expr *e)
+{
+	const char *p;
+
+	if(obj_expr_primary(pp, e))
+		return 1;
+
+	for(;;){
+		struct obj_expr rhs;
+		char op[2];
+
+		p = skipspace(*pp);
+		op[0] = *p;
+		op[1] = p[1];
+
+		switch(op[0]){
+			case '*': case '/': case '%':
+			case '&': case '|': case '^':
+				p++;
+				break;
+			case '<': case '>':
+				if(op[1] != op[0])
+					return 0;
+				p += 2;
+				break;
+			default:
+				return 0;
+		}
+
+		if(obj_expr_primary(&p, &rhs))
+			return 1;
+		*pp = p;
+
+		if(!obj_expr_is_const(e) || !obj_expr_is_const(&rhs)){
+			obj_error("operator '%c' needs constant operands", op[0]);
+			return 1;
+		}
+
+		switch(op[0]){
+			case '*': e->num *= rhs.num; break;
+			case '&': e->num &= rhs.num; break;
+			case '|': e->num |= rhs.num; break;
+			case '^': e->num ^= rhs.num; break;
+			case '<': e->num <<= rhs.num; break;
+			case '>': e->num >>= rhs.num; break;
+			case '/':
+			case '%':
+				if(rhs.num == 0){
+					obj_error("division by zero in expression");
+					return 1;
+				}
+				e->num = op[0] == '/' ? e->num / rhs.num : e->num % rhs.num;
+				break;
+		}
+	}
+}
+
+static int obj_expr_combine(struct obj_expr *e, const struct obj_expr *rhs, int negate)
+{
+	struct obj_sym *add = negate ? rhs->sub : rhs->add;
+	struct obj_sym *sub = negate ? rhs->add : rhs->sub;
+
+	e->num += negate ? -rhs->num : rhs->num;
+
+	if(rhs->mod){
+		if(e->mod){
+			obj_error("multiple relocation modifiers in expression");
+			return 1;
+		}
+		e->mod = rhs->mod;
+	}
+
+	if(add){
+		if(e->add){
+			obj_error("can't add two symbols");
+			return 1;
+		}
+		e->add = add;
+	}
+	if(sub){
+		if(e->sub){
+			obj_error("can't subtract two symbols");
+			return 1;
+		}
+		e->sub = sub;
+	}
+
+	if(e->add && e->add == e->sub)
+		e->add = e->sub = NULL;
+
+	return 0;
+}
+
+static int obj_expr_sum(const char **pp, struct obj_expr *e)
+{
+	if(obj_expr_term(pp, e))
+		return 1;
+
+	for(;;){
+		const char *p = skipspace(*pp);
+		struct obj_expr rhs;
+		int negate;
+
+		if(*p != '+' && *p != '-')
+			return 0;
+		negate = *p == '-';
+		p++;
+
+		if(obj_expr_term(&p, &rhs) || obj_expr_combine(e, &rhs, negate))
+			return 1;
+		*pp = p;
+	}
+}
+
+int obj_expr_parse(const char **pp, struct obj_expr *e)
+{
+	if(obj_expr_sum(pp, e))
+		return 1;
+	*pp = skipspace(*pp);
+	return 0;
+}
+
+int obj_expr_is_const(const struct obj_expr *e)
+{
+	return !e->add && !e->sub && !e->mod;
+}
+
+/* for directives that need a value now, e.g. .space */
+static int obj_expr_const_now(const struct obj_expr *e, long long *out)
+{
+	if(e->mod)
+		goto bad;
+
+	*out = e->num;
+	if(e->add && e->add->is_abs && !e->sub){
+		*out += e->add->value;
+		return 0;
+	}
+	if(e->add || e->sub){
+		if(!e->add || !e->sub
+		|| !e->add->defined || !e->sub->defined
+		|| e->add->sec != e->sub->sec)
+		{
+			goto bad;
+		}
+		*out += e->add->value - e->sub->value;
+	}
+	return 0;
+bad:
+	obj_error("expression must be constant");
+	return 1;
+}
+
+static int obj_parse_const(const char **pp, long long *out)
+{
+	struct obj_expr e;
+
+	return obj_expr_parse(pp, &e) || obj_expr_const_now(&e, out);
+}
+
+static int obj_expect_end(const char *p)
+{
+	p = skipspace(p);
+	if(*p){
+		obj_error("junk at end of line: \"%s\"", p);
+		return 1;
+	}
+	return 0;
+}
+
+static int obj_expect_comma(const char **pp)
+{
+	const char *p = skipspace(*pp);
+
+	if(*p != ','){
+		obj_error("expected ','");
+		return 1;
+	}
+	*pp = skipspace(p + 1);
+	return 0;
+}
+
+static struct obj_sym *obj_parse_sym(const char **pp)
+{
+	const char *p = skipspace(*pp), *start = p;
+
+	if(!is_sym_start(*p)){
+		obj_error("expected symbol name");
+		return NULL;
+	}
+	while(is_sym_char(*p))
+		p++;
+
+	*pp = p;
+	return obj_sym_get(start, p - start);
+}
+
+/* ---- sections ---- */
+
+static void obj_section_defaults(struct obj_section *sec)
+{
+	static const struct
+	{
+		const char *prefix;
+		unsigned type;
+		unsigned long flags;
+	} defaults[] = {
+		{ ".text", SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR },
+		{ ".data", SHT_PROGBITS, SHF_ALLOC | SHF_WRITE },
+		{ ".bss", SHT_NOBITS, SHF_ALLOC | SHF_WRITE },
+		{ ".rodata", SHT_PROGBITS, SHF_ALLOC },
+		{ ".tdata", SHT_PROGBITS, SHF_ALLOC | SHF_WRITE | SHF_TLS },
+		{ ".tbss", SHT_NOBITS, SHF_ALLOC | SHF_WRITE | SHF_TLS },
+		{ ".init_array", SHT_INIT_ARRAY, SHF_ALLOC | SHF_WRITE },
+		{ ".fini_array", SHT_FINI_ARRAY, SHF_ALLOC | SHF_WRITE },
+		{ ".ctors", SHT_PROGBITS, SHF_ALLOC | SHF_WRITE },
+		{ ".dtors", SHT_PROGBITS, SHF_ALLOC | SHF_WRITE },
+		{ ".note", SHT_NOTE, 0 },
+	};
+	size_t i;
+
+	sec->type = SHT_PROGBITS;
+	sec->flags = 0;
+
+	for(i = 0; i < countof(defaults); i++){
+		size_t len = strlen(defaults[i].prefix);
+
+		if(!strncmp(sec->name, defaults[i].prefix, len)
+		&& (sec->name[len] == '\0' || sec->name[len] == '.'))
+		{
+			sec->type = defaults[i].type;
+			sec->flags = defaults[i].flags;
+			break;
+		}
+	}
+}
+
+static struct obj_section *obj_section_get(const char *name)
+{
+	struct obj_section **i, *sec;
+	struct obj_sym *secsym;
+
+	for(i = obj.sections; i && *i; i++)
+		if(!strcmp((*i)->name, name))
+			return *i;
+
+	sec = umalloc_tag(sizeof *sec, UALLOC_OBJ);
+	memset(sec, 0, sizeof *sec);
+	sec->name = ustrdup_tag(name, UALLOC_OBJ);
+	sec->align = 1;
+	obj_section_defaults(sec);
+
+	secsym = obj_sym_new(NULL);
+	secsym->defined = 1;
+	secsym->is_section = 1;
+	secsym->sec = sec;
+	secsym->type = STT_SECTION;
+	sec->secsym = secsym;
+
+	dynarray_add(&obj.sections, sec);
+
+	return sec;
+}
+
+static void obj_section_switch(struct obj_section *sec)
+{
+	if(sec != obj.cur){
+		obj.prev = obj.cur;
+		obj.cur = sec;
+	}
+}
+
+static void obj_reserve(struct obj_section *sec, size_t n)
+{
+	if(sec->len + n > sec->max){
+		size_t old = sec->max;
+
+		sec->max = sec->max ? sec->max * 2 : 256;
+		while(sec->max < sec->len + n)
+			sec->max *= 2;
+
+		sec->data = urealloc_tag(sec->data, sec->max, old, UALLOC_OBJ);
+	}
+}
+
+static void obj_emit(const void *p, size_t n)
+{
+	struct obj_section *sec = obj_cur();
+
+	if(sec->type == SHT_NOBITS){
+		const unsigned char *bytes = p;
+		size_t i;
+
+		for(i = 0; i < n; i++){
+			if(bytes[i]){
+				obj_error("non-zero data in section \"%s\"", sec->name);
+				break;
+			}
+		}
+		sec->size += n;
+		return;
+	}
+
+	obj_reserve(sec, n);
+	memcpy(sec->data + sec->len, p, n);
+	sec->len += n;
+	sec->size = sec->len;
+}
+
+static void obj_emit_fill(unsigned char fill, unsigned long long n, int nops)
+{
+	struct obj_section *sec = obj_cur();
+
+	if(sec->type == SHT_NOBITS){
+		if(fill)
+			obj_error("non-zero fill in section \"%s\"", sec->name);
+		sec->size += n;
+		return;
+	}
+
+	obj_reserve(sec, n);
+	if(nops)
+		impl_obj_fill_nops(sec->data + sec->len, n);
+	else
+		memset(sec->data + sec->len, fill, n);
+	sec->len += n;
+	sec->size = sec->len;
+}
+
+static void obj_emit_int(unsigned long long v, unsigned size)
+{
+	unsigned char buf[8];
+	unsigned i;
+
+	for(i = 0; i < size; i++)
+		buf[i] = v >> (8 * i);
+
+	obj_emit(buf, size);
+}
+
+static void obj_fixup_add(
+		struct obj_section *sec, unsigned long long off,
+		unsigned size, enum obj_fixup_flags flags,
+		long long pc_adjust, const struct obj_expr *e)
+{
+	struct obj_fixup *f;
+
+	if(obj.nfixups == obj.fixups_max){
+		size_t old = obj.fixups_max * sizeof *obj.fixups;
+
+		obj.fixups_max = obj.fixups_max ? obj.fixups_max * 2 : 64;
+		obj.fixups = urealloc_tag(obj.fixups,
+				obj.fixups_max * sizeof *obj.fixups, old, UALLOC_OBJ);
+	}
+
+	f = &obj.fixups[obj.nfixups++];
+	f->sec = sec;
+	f->off = off;
+	f->size = size;
+	f->flags = flags;
+	f->pc_adjust = pc_adjust;
+	f->expr = *e;
+	f->lineno = obj.lineno;
+}
+
+static int obj_fits(long long v, unsigned size, int is_signed)
+{
+	long long lo, hi;
+
+	if(size >= 8)
+		return 1;
+
+	lo = -(1LL << (size * 8 - 1));
+	hi = is_signed ? (1LL << (size * 8 - 1)) - 1 : (1LL << (size * 8)) - 1;
+
+	return lo <= v && v <= hi;
+}
+
+/* emit a data value of `size' bytes, deferring symbolic values to a fixup */
+static void obj_emit_expr(const struct obj_expr *e, unsigned size)
+{
+	struct obj_section *sec = obj_cur();
+
+	if(obj_expr_is_const(e)){
+		if(!obj_fits(e->num, size, 0))
+			obj_error("value %lld truncated to %u byte%s", e->num, size, size > 1 ? "s" : "");
+		obj_emit_int(e->num, size);
+		return;
+	}
+
+	if(sec->type == SHT_NOBITS){
+		obj_error("relocation in section \"%s\"", sec->name);
+		return;
+	}
+
+	obj_fixup_add(sec, sec->size, size, 0, 0, e);
+	obj_emit_int(0, size);
+}
+
+static void obj_align(unsigned long long align, int have_fill, unsigned char fill)
+{
+	struct obj_section *sec = obj_cur();
+	unsigned long long pad;
+
+	if(align == 0)
+		align = 1;
+	if(align & (align - 1)){
+		obj_error("alignment %llu is not a power of two", align);
+		return;
+	}
+
+	if(align > sec->align)
+		sec->align = align;
+
+	pad = (align - sec->size % align) % align;
+	obj_emit_fill(fill, pad, !have_fill && (sec->flags & SHF_EXECINSTR));
+}
+
+/* ---- directives ---- */
+
+static void dir_section_common(const char *name, const char *p)
+{
+	struct obj_section *sec = obj_section_get(name);
+
+	p = skipspace(p);
+	if(*p == ','){
+		const char *flags;
+		unsigned long f = 0;
+
+		p = skipspace(p + 1);
+		if(*p != '"'){
+			obj_error("expected section flags string");
+			return;
+		}
+		for(flags = p + 1; *flags && *flags != '"'; flags++){
+			switch(*flags){
+				case 'a': f |= SHF_ALLOC; break;
+				case 'w': f |= SHF_WRITE; break;
+				case 'x': f |= SHF_EXECINSTR; break;
+				case 'M': f |= SHF_MERGE; break;
+				case 'S': f |= SHF_STRINGS; break;
+				case 'T': f |= SHF_TLS; break;
+				default:
+					obj_error("unknown section flag '%c'", *flags);
+					return;
+			}
+		}
+		if(*flags != '"'){
+			obj_error("unterminated section flags");
+			return;
+		}
+		p = skipspace(flags + 1);
+
+		sec->flags = f;
+
+		if(*p == ','){
+			const char *type;
+
+			p = skipspace(p + 1);
+			if(*p != '@' && *p != '%'){
+				obj_error("expected section type");
+				return;
+			}
+			type = ++p;
+			while(isalpha(*p) || *p == '_')
+				p++;
+
+			if(!strncmp(type, "progbits", p - type))
+				sec->type = SHT_PROGBITS;
+			else if(!strncmp(type, "nobits", p - type))
+				sec->type = SHT_NOBITS;
+			else if(!strncmp(type, "note", p - type))
+				sec->type = SHT_NOTE;
+			else if(!strncmp(type, "init_array", p - type))
+				sec->type = SHT_INIT_ARRAY;
+			else if(!strncmp(type, "fini_array", p - type))
+				sec->type = SHT_FINI_ARRAY;
+			else{
+				obj_error("unknown section type \"%.*s\"", (int)(p - type), type);
+				return;
+			}
+
+			p = skipspace(p);
+			if(*p == ','){
+				long long entsize;
+
+				p++;
+				if(obj_parse_const(&p, &entsize))
+					return;
+				sec->entsize = entsize;
+			}
+		}
+	}
+
+	if(obj_expect_end(p))
+		return;
+
+	obj_section_switch(sec);
+}
+
+static void dir_section(const char *p)
+{
+	char name[OBJ_LINE_MAX];
+	const char *start;
+
+	p = skipspace(p);
+	if(*p == '"'){
+		start = ++p;
+		while(*p && *p != '"')
+			p++;
+		if(!*p){
+			obj_error("unterminated section name");
+			return;
+		}
+		snprintf(name, sizeof name, "%.*s", (int)(p - start), start);
+		p++;
+	}else{
+		start = p;
+		while(*p && *p != ',' && *p != ' ' && *p != '\t')
+			p++;
+		if(p == start){
+			obj_error("expected section name");
+			return;
+		}
+		snprintf(name, sizeof name, "%.*s", (int)(p - start), start);
+	}
+
+	dir_section_common(name, p);
+}
+
+static void dir_text(const char *p) { dir_section_common(".text", p); }
+static void dir_data(const char *p) { dir_section_common(".data", p); }
+static void dir_bss(const char *p) { dir_section_common(".bss", p); }
+
+static void dir_pushsection(const char *p)
+{
+	dynarray_add(&obj.section_stack, obj_cur());
+	dir_section(p);
+}
+
+static void dir_popsection(const char *p)
+{
+	struct obj_section *sec = dynarray_pop(struct obj_section *, &obj.section_stack);
+
+	if(obj_expect_end(p))
+		return;
+	if(!sec){
+		obj_error(".popsection without .pushsection");
+		return;
+	}
+	obj_section_switch(sec);
+}
+
+static void dir_previous(const char *p)
+{
+	if(obj_expect_end(p))
+		return;
+	if(obj.prev)
+		obj_section_switch(obj.prev);
+}
+
+static void dir_bind(const char *p, enum obj_bind bind, int local)
+{
+	for(;;){
+		struct obj_sym *sym = obj_parse_sym(&p);
+		if(!sym)
+			return;
+
+		sym->bind = bind;
+		if(local)
+			sym->explicit_local = 1;
+
+		p = skipspace(p);
+		if(*p != ',')
+			break;
+		p++;
+	}
+	obj_expect_end(p);
+}
+
+static void dir_globl(const char *p) { dir_bind(p, OBJ_BIND_GLOBAL, 0); }
+static void dir_weak(const char *p) { dir_bind(p, OBJ_BIND_WEAK, 0); }
+static void dir_local(const char *p) { dir_bind(p, OBJ_BIND_LOCAL, 1); }
+
+static void dir_visibility(const char *p, unsigned char vis)
+{
+	for(;;){
+		struct obj_sym *sym = obj_parse_sym(&p);
+		if(!sym)
+			return;
+
+		sym->visibility = vis;
+
+		p = skipspace(p);
+		if(*p != ',')
+			break;
+		p++;
+	}
+	obj_expect_end(p);
+}
+
+static void dir_hidden(const char *p) { dir_visibility(p, STV_HIDDEN); }
+static void dir_protected(const char *p) { dir_visibility(p, STV_PROTECTED); }
+static void dir_internal(const char *p) { dir_visibility(p, STV_INTERNAL); }
+
+static void dir_type(const char *p)
+{
+	static const struct
+	{
+		const char *name;
+		unsigned char type;
+	} types[] = {
+		{ "function", STT_FUNC },
+		{ "object", STT_OBJECT },
+		{ "tls_object", STT_TLS },
+		{ "notype", STT_NOTYPE },
+		{ "common", STT_COMMON },
+		{ "gnu_indirect_function", STT_GNU_IFUNC },
+	};
+	struct obj_sym *sym = obj_parse_sym(&p);
+	const char *type;
+	size_t i;
+
+	if(!sym || obj_expect_comma(&p))
+		return;
+
+	if(*p == '@' || *p == '%')
+		p++;
+	type = p;
+	while(isalpha(*p) || *p == '_')
+		p++;
+
+	for(i = 0; i < countof(types); i++){
+		if(strlen(types[i].name) == (size_t)(p - type)
+		&& !strncmp(types[i].name, type, p - type))
+		{
+			sym->type = types[i].type;
+			obj_expect_end(p);
+			return;
+		}
+	}
+
+	obj_error("unknown symbol type \"%.*s\"", (int)(p - type), type);
+}
+
+static void dir_size(const char *p)
+{
+	struct obj_sym *sym = obj_parse_sym(&p);
+
+	if(!sym || obj_expect_comma(&p))
+		return;
+
+	if(obj_expr_parse(&p, &sym->size_expr) || obj_expect_end(p))
+		return;
+
+	sym->has_size = 1;
+}
+
+static void obj_bss_alloc(struct obj_sym *sym, unsigned long long size, unsigned long long align)
+{
+	struct obj_section *save = obj.cur;
+	struct obj_section *bss = obj_section_get(".bss");
+
+	obj.cur = bss;
+	obj_align(align, 1, 0);
+	obj_sym_define(sym);
+	obj_emit_fill(0, size, 0);
+	obj.cur = save;
+
+	sym->size = size;
+	if(!sym->type)
+		sym->type = STT_OBJECT;
+}
+
+static void dir_comm_common(const char *p, int local)
+{
+	struct obj_sym *sym = obj_parse_sym(&p);
+	long long size, align = 1;
+
+	if(!sym || obj_expect_comma(&p) || obj_parse_const(&p, &size))
+		return;
+
+	p = skipspace(p);
+	if(*p == ','){
+		p++;
+		if(obj_parse_const(&p, &align))
+			return;
+	}
+	if(obj_expect_end(p))
+		return;
+
+	if(sym->defined){
+		obj_error("symbol \"%s\" is already defined", sym->name);
+		return;
+	}
+
+	if(local || sym->explicit_local){
+		obj_bss_alloc(sym, size, align);
+		return;
+	}
+
+	sym->is_common = 1;
+	sym->value = align;
+	sym->size = size;
+	if(sym->bind == OBJ_BIND_LOCAL)
+		sym->bind = OBJ_BIND_GLOBAL;
+	if(!sym->type)
+		sym->type = STT_OBJECT;
+}
+
+static void dir_comm(const char *p) { dir_comm_common(p, 0); }
+static void dir_lcomm(const char *p) { dir_comm_common(p, 1); }
+
+static void dir_set(const char *p)
+{
+	struct obj_sym *sym = obj_parse_sym(&p);
+	struct obj_expr e;
+
+	if(!sym || obj_expect_comma(&p) || obj_expr_parse(&p, &e) || obj_expect_end(p))
+		return;
+
+	if(sym->defined){
+		obj_error("symbol \"%s\" is already defined", sym->name);
+		return;
+	}
+
+	if(e.add && !e.sub && !e.mod && e.add->defined){
+		sym->defined = 1;
+		sym->sec = e.add->sec;
+		sym->is_abs = e.add->is_abs;
+		sym->value = e.add->value + e.num;
+	}else{
+		long long v;
+
+		if(obj_expr_const_now(&e, &v))
+			return;
+		sym->defined = 1;
+		sym->is_abs = 1;
+		sym->value = v;
+	}
+}
+
+static void dir_data_n(const char *p, unsigned size)
+{
+	for(;;){
+		struct obj_expr e;
+
+		if(obj_expr_parse(&p, &e))
+			return;
+		obj_emit_expr(&e, size);
+
+		p = skipspace(p);
+		if(*p != ',')
+			break;
+		p++;
+	}
+	obj_expect_end(p);
+}
+
+static void dir_byte(const char *p) { dir_data_n(p, 1); }
+static void dir_short(const char *p) { dir_data_n(p, 2); }
+static void dir_long(const char *p) { dir_data_n(p, 4); }
+static void dir_quad(const char *p) { dir_data_n(p, 8); }
+
+static const char *obj_parse_string(const char *p, int nul_terminate)
+{
+	p = skipspace(p);
+	if(*p != '"'){
+		obj_error("expected string");
+		return NULL;
+	}
+
+	for(p++; *p != '"'; p++){
+		unsigned char ch;
+
+		if(!*p){
+			obj_error("unterminated string");
+			return NULL;
+		}
+
+		if(*p != '\\'){
+			ch = *p;
+		}else{
+			switch(*++p){
+				case 'n': ch = '\n'; break;
+				case 't': ch = '\t'; break;
+				case 'r': ch = '\r'; break;
+				case 'b': ch = '\b'; break;
+				case 'f': ch = '\f'; break;
+				case 'v': ch = '\v'; break;
+				case 'x':
+				case 'X':
+					ch = 0;
+					while(isxdigit(p[1])){
+						p++;
+						ch = ch * 16 + (isdigit(*p) ? *p - '0' : tolower(*p) - 'a' + 10);
+					}
+					break;
+				case '0': case '1': case '2': case '3':
+				case '4': case '5': case '6': case '7':
+				{
+					int n;
+					ch = 0;
+					for(n = 0; n < 3 && '0' <= *p && *p <= '7'; n++, p++)
+						ch = ch * 8 + *p - '0';
+					p--;
+					break;
+				}
+				case '\0':
+					obj_error("unterminated string");
+					return NULL;
+				default:
+					ch = *p;
+			}
+		}
+
+		obj_emit(&ch, 1);
+	}
+
+	if(nul_terminate)
+		obj_emit("", 1);
+
+	return p + 1;
+}
+
+static void dir_ascii_common(const char *p, int nul_terminate)
+{
+	for(;;){
+		p = obj_parse_string(p, nul_terminate);
+		if(!p)
+			return;
+
+		p = skipspace(p);
+		if(*p != ',')
+			break;
+		p++;
+	}
+	obj_expect_end(p);
+}
+
+static void dir_ascii(const char *p) { dir_ascii_common(p, 0); }
+static void dir_asciz(const char *p) { dir_ascii_common(p, 1); }
+
+static void dir_space(const char *p)
+{
+	long long n, fill = 0;
+
+	if(obj_parse_const(&p, &n))
+		return;
+
+	p = skipspace(p);
+	if(*p == ','){
+		p++;
+		if(obj_parse_const(&p, &fill))
+			return;
+	}
+	if(obj_expect_end(p))
+		return;
+
+	if(n < 0){
+		obj_error("negative .space size");
+		return;
+	}
+
+	obj_emit_fill(fill, n, 0);
+}
+
+static void dir_align_common(const char *p, int pow2)
+{
+	long long align, fill = 0;
+	int have_fill = 0;
+
+	if(obj_parse_const(&p, &align))
+		return;
+
+	p = skipspace(p);
+	if(*p == ','){
+		p = skipspace(p + 1);
+		if(*p != ','){
+			if(obj_parse_const(&p, &fill))
+				return;
+			have_fill = 1;
+		}
+		p = skipspace(p);
+		if(*p == ','){
+			long long max;
+			p++;
+			/* maximum padding - ignored, we always align fully */
+			if(obj_parse_const(&p, &max))
+				return;
+		}
+	}
+	if(obj_expect_end(p))
+		return;
+
+	if(pow2){
+		if(align < 0 || align > 30){
+			obj_error("bad alignment %lld", align);
+			return;
+		}
+		align = 1LL << align;
+	}
+
+	obj_align(align, have_fill, fill);
+}
+
+static void dir_align(const char *p) { dir_align_common(p, 0); }
+static void dir_p2align(const char *p) { dir_align_common(p, 1); }
+
+static void dir_file(const char *p)
+{
+	long long idx;
+	const char *start;
+	size_t n;
+
+	p = skipspace(p);
+	if(*p == '"')
+		return; /* .file "name", for the symbol table - not needed */
+
+	if(obj_parse_const(&p, &idx))
+		return;
+	if(idx <= 0 || idx > 0xffff){
+		obj_error("bad file number %lld", idx);
+		return;
+	}
+
+	p = skipspace(p);
+	if(*p != '"'){
+		obj_error("expected file name");
+		return;
+	}
+	start = ++p;
+	while(*p && *p != '"'){
+		if(*p == '\\' && p[1])
+			p++;
+		p++;
+	}
+	if(!*p){
+		obj_error("unterminated file name");
+		return;
+	}
+	if(obj_expect_end(p + 1))
+		return;
+
+	n = dynarray_count(obj.files);
+	while(n < (size_t)idx){
+		dynarray_add(&obj.files, ustrdup_tag("", UALLOC_OBJ));
+		n++;
+	}
+
+	free(obj.files[idx - 1]);
+	obj.files[idx - 1] = ustrdup2(start, p);
+}
+
+static void dir_loc(const char *p)
+{
+	long long file, line, col = 0;
+	struct obj_section *sec = obj_cur();
+	struct obj_dbg_row *row;
+
+	if(obj_parse_const(&p, &file) || obj_parse_const(&p, &line))
+		return;
+	p = skipspace(p);
+	if(isdigit(*p) && obj_parse_const(&p, &col))
+		return;
+	/* the remainder are options (is_stmt, discriminator, ...) we ignore */
+
+	if(obj.nrows
+	&& obj.rows[obj.nrows - 1].sec == sec
+	&& obj.rows[obj.nrows - 1].off == sec->size)
+	{
+		/* no code since the last .loc - replace it */
+		row = &obj.rows[obj.nrows - 1];
+	}else{
+		if(obj.nrows == obj.rows_max){
+			size_t old = obj.rows_max * sizeof *obj.rows;
+
+			obj.rows_max = obj.rows_max ? obj.rows_max * 2 : 64;
+			obj.rows = urealloc_tag(obj.rows,
+					obj.rows_max * sizeof *obj.rows, old, UALLOC_OBJ);
+		}
+		row = &obj.rows[obj.nrows++];
+	}
+
+	row->sec = sec;
+	row->off = sec->size;
+	row->file = file;
+	row->line = line;
+	row->col = col;
+}
+
+static void dir_ignore(const char *p)
+{
+	(void)p;
+}
+
+static const struct obj_directive
+{
+	const char *name;
+	void (*handler)(const char *);
+} obj_directives[] = {
+	{ "section", dir_section },
+	{ "pushsection", dir_pushsection },
+	{ "popsection", dir_popsection },
+	{ "previous", dir_previous },
+	{ "text", dir_text },
+	{ "data", dir_data },
+	{ "bss", dir_bss },
+
+	{ "globl", dir_globl },
+	{ "global", dir_globl },
+	{ "weak", dir_weak },
+	{ "local", dir_local },
+	{ "hidden", dir_hidden },
+	{ "protected", dir_protected },
+	{ "internal", dir_internal },
+	{ "type", dir_type },
+	{ "size", dir_size },
+	{ "comm", dir_comm },
+	{ "lcomm", dir_lcomm },
+	{ "set", dir_set },
+	{ "equ", dir_set },
+
+	{ "byte", dir_byte },
+	{ "short", dir_short },
+	{ "word", dir_short },
+	{ "value", dir_short },
+	{ "2byte", dir_short },
+	{ "long", dir_long },
+	{ "int", dir_long },
+	{ "4byte", dir_long },
+	{ "quad", dir_quad },
+	{ "8byte", dir_quad },
+	{ "ascii", dir_ascii },
+	{ "asciz", dir_asciz },
+	{ "string", dir_asciz },
+	{ "space", dir_space },
+	{ "skip", dir_space },
+	{ "zero", dir_space },
+	{ "align", dir_align },
+	{ "balign", dir_align },
+	{ "p2align", dir_p2align },
+
+	{ "file", dir_file },
+	{ "loc", dir_loc },
+
+	{ "ident", dir_ignore },
+	{ "att_syntax", dir_ignore },
+	{ "code64", dir_ignore },
+};
+
+static void obj_directive(const char *p)
+{
+	const char *start = p;
+	size_t i;
+
+	while(is_sym_char(*p))
+		p++;
+
+	for(i = 0; i < countof(obj_directives); i++){
+		if(strlen(obj_directives[i].name) == (size_t)(p - start)
+		&& !strncmp(obj_directives[i].name, start, p - start))
+		{
+			obj_directives[i].handler(skipspace(p));
+			return;
+		}
+	}
+
+	obj_error("unsupported directive \".%.*s\"", (int)(p - start), start);
+}
+
+static void obj_insn_emit(const struct obj_insn *insn)
+{
+	struct obj_section *sec = obj_cur();
+	unsigned long long off;
+	unsigned i;
+
+	if(sec->type == SHT_NOBITS){
+		obj_error("instruction in section \"%s\"", sec->name);
+		return;
+	}
+
+	off = sec->size;
+	obj_emit(insn->bytes, insn->len);
+
+	for(i = 0; i < insn->nfixups; i++){
+		const struct obj_insn_fixup *f = &insn->fixups[i];
+
+		obj_fixup_add(sec, off + f->off, f->size, f->flags,
+				f->flags & OBJ_FIX_PCREL ? -(long long)(insn->len - f->off) : 0,
+				&f->expr);
+	}
+}
+
+static void obj_instruction(const char *p)
+{
+	struct obj_insn insn;
+
+	memset(&insn, 0, sizeof insn);
+	if(impl_obj_encode(p, &insn))
+		return;
+
+	obj_insn_emit(&insn);
+}
+
+static void obj_statement(const char *p)
+{
+	for(;;){
+		const char *start;
+
+		p = skipspace(p);
+		if(!*p)
+			return;
+
+		start = p;
+		if(isdigit(*p)){
+			while(isdigit(*p))
+				p++;
+
+			if(*p == ':'){
+				char buf[32];
+				unsigned lbl = strtoul(start, NULL, 10);
+
+				if(lbl >= OBJ_NUMLBL_MAX){
+					obj_error("numeric label %u out of range", lbl);
+					return;
+				}
+				obj_numlbl_name(buf, sizeof buf, lbl, obj.numlbl[lbl]++);
+				obj_sym_define(obj_sym_get(buf, strlen(buf)));
+				p++;
+				continue;
+			}
+			p = start;
+		}else if(is_sym_start(*p)){
+			while(is_sym_char(*p))
+				p++;
+
+			if(*p == ':'){
+				obj_sym_define(obj_sym_get(start, p - start));
+				p++;
+				continue;
+			}
+			p = start;
+		}
+		break;
+	}
+
+	if(*p == '.')
+		obj_directive(p + 1);
+	else
+		obj_instruction(p);
+}
+
+/* strip comments and split on ';', outside strings */
+static void obj_line(const char *line)
+{
+	char buf[OBJ_LINE_MAX];
+	size_t n = 0;
+	int in_str = 0;
+	const char *p;
+
+	for(p = line; *p && *p != '\n'; p++){
+		if(obj.in_comment){
+			if(p[0] == '*' && p[1] == '/'){
+				obj.in_comment = 0;
+				p++;
+			}
+			continue;
+		}
+
+		if(in_str){
+			if(*p == '\\' && p[1] && p[1] != '\n'){
+				if(n < sizeof buf - 2)
+					buf[n++] = *p;
+				p++;
+			}else if(*p == '"'){
+				in_str = 0;
+			}
+		}else if(*p == '"'){
+			in_str = 1;
+		}else if(*p == '#'){
+			break;
+		}else if(p[0] == '/' && p[1] == '*'){
+			obj.in_comment = 1;
+			p++;
+			continue;
+		}else if(*p == ';'){
+			buf[n] = '\0';
+			obj_statement(buf);
+			n = 0;
+			continue;
+		}
+
+		if(n < sizeof buf - 1)
+			buf[n++] = *p;
+	}
+
+	if(n == sizeof buf - 1){
+		obj_error("line too long");
+		return;
+	}
+
+	buf[n] = '\0';
+	obj_statement(buf);
+}
+
+/* ---- fixups, symbol sizes and debug lines ---- */
+
+static void obj_patch(struct obj_section *sec, unsigned long long off, unsigned long long v, unsigned size)
+{
+	unsigned i;
+
+	for(i = 0; i < size; i++)
+		sec->data[off + i] = v >> (8 * i);
+}
+
+static void obj_reloc_add(
+		struct obj_section *sec, unsigned long long off,
+		unsigned type, struct obj_sym *sym, long long addend)
+{
+	struct obj_reloc *r;
+
+	if(sec->nrelocs == sec->relocs_max){
+		size_t old = sec->relocs_max * sizeof *sec->relocs;
+
+		sec->relocs_max = sec->relocs_max ? sec->relocs_max * 2 : 16;
+		sec->relocs = urealloc_tag(sec->relocs,
+				sec->relocs_max * sizeof *sec->relocs, old, UALLOC_OBJ);
+	}
+
+	r = &sec->relocs[sec->nrelocs++];
+	r->off = off;
+	r->type = type;
+	r->sym = sym;
+	r->addend = addend;
+
+	sym->referenced = 1;
+}
+
+static void obj_fixup_resolve(struct obj_fixup *f)
+{
+	struct obj_expr *e = &f->expr;
+	struct obj_sym *sym = e->add;
+	enum obj_fixup_flags flags = f->flags;
+	long long addend = e->num;
+	unsigned type;
+
+	obj.lineno = f->lineno;
+
+	if(e->sub){
+		if(!e->sub->defined || e->sub->is_common){
+			obj_error("can't subtract undefined symbol \"%s\"",
+					e->sub->name ? e->sub->name : ".");
+			return;
+		}
+
+		if(sym && sym->defined && !sym->is_common && sym->sec == e->sub->sec){
+			addend += sym->value - e->sub->value;
+			sym = NULL;
+		}else if(e->sub->sec == f->sec && !(flags & OBJ_FIX_PCREL)){
+			/* x - y, where y is in this section: pc-relative to x */
+			flags |= OBJ_FIX_PCREL;
+			addend += f->off - e->sub->value;
+		}else{
+			obj_error("can't subtract symbols from different sections");
+			return;
+		}
+	}
+
+	if(flags & OBJ_FIX_PCREL)
+		addend += f->pc_adjust;
+
+	if(sym && sym->is_abs && !e->mod){
+		addend += sym->value;
+		sym = NULL;
+	}
+
+	if(!sym){
+		if(flags & OBJ_FIX_PCREL){
+			obj_error("pc-relative reference to an absolute value");
+			return;
+		}
+		if(!obj_fits(addend, f->size, flags & OBJ_FIX_SIGNED))
+			obj_error("value %lld truncated to %u byte%s",
+					addend, f->size, f->size > 1 ? "s" : "");
+		obj_patch(f->sec, f->off, addend, f->size);
+		return;
+	}
+
+	if((flags & OBJ_FIX_PCREL)
+	&& (e->mod == OBJ_MOD_NONE || e->mod == OBJ_MOD_PLT)
+	&& sym->defined && !sym->is_common
+	&& sym->bind == OBJ_BIND_LOCAL
+	&& sym->sec == f->sec)
+	{
+		long long v = addend + (long long)sym->value - (long long)f->off;
+
+		if(!obj_fits(v, f->size, 1))
+			obj_error("pc-relative offset %lld out of range", v);
+		obj_patch(f->sec, f->off, v, f->size);
+		return;
+	}
+
+	switch(e->mod){
+		case OBJ_MOD_GOTTPOFF:
+		case OBJ_MOD_TPOFF:
+		case OBJ_MOD_TLSGD:
+		case OBJ_MOD_TLSLD:
+		case OBJ_MOD_DTPOFF:
+			/* an undefined thread-local is only known as one by its references */
+			sym->type = STT_TLS;
+			break;
+		default:
+			break;
+	}
+
+	type = impl_obj_reloc_type(f->size, flags, e->mod);
+	if(!type){
+		obj_error("unsupported relocation for \"%s\"", sym->name ? sym->name : ".");
+		return;
+	}
+
+	if(e->mod == OBJ_MOD_NONE
+	&& sym->defined && !sym->is_common && !sym->is_section
+	&& sym->bind == OBJ_BIND_LOCAL)
+	{
+		/* local symbols are referenced via their section */
+		addend += sym->value;
+		sym = sym->sec->secsym;
+	}
+
+	if(!sym->defined && !sym->is_common && sym->bind == OBJ_BIND_LOCAL)
+		sym->bind = OBJ_BIND_GLOBAL;
+
+	obj_reloc_add(f->sec, f->off, type, sym, addend);
+}
+
+static void obj_sym_finalise(struct obj_sym *sym)
+{
+	struct obj_expr *e = &sym->size_expr;
+	long long size;
+
+	if(sym->sec && (sym->sec->flags & SHF_TLS) && !sym->is_section)
+		sym->type = STT_TLS;
+
+	if(!sym->has_size)
+		return;
+
+	size = e->num;
+	if(e->add || e->sub){
+		if(e->mod || !e->add || !e->sub
+		|| !e->add->defined || !e->sub->defined
+		|| e->add->sec != e->sub->sec)
+		{
+			obj_error("size of \"%s\" isn't constant", sym->name);
+			return;
+		}
+		size += e->add->value - e->sub->value;
+	}
+	sym->size = size;
+}
+
+static void obj_uleb(unsigned long long v)
+{
+	do{
+		unsigned char byte = v & 0x7f;
+		v >>= 7;
+		if(v)
+			byte |= 0x80;
+		obj_emit(&byte, 1);
+	}while(v);
+}
+
+static void obj_sleb(long long v)
+{
+	for(;;){
+		unsigned char byte = v & 0x7f;
+		int sign = byte & 0x40;
+
+		v >>= 7;
+		if((v == 0 && !sign) || (v == -1 && sign)){
+			obj_emit(&byte, 1);
+			break;
+		}
+		byte |= 0x80;
+		obj_emit(&byte, 1);
+	}
+}
+
+/* DWARF 2 .debug_line, from .file and .loc */
+static void obj_dbg_line(void)
+{
+	enum
+	{
+		DW_LNS_copy = 1,
+		DW_LNS_advance_pc = 2,
+		DW_LNS_advance_line = 3,
+		DW_LNS_set_file = 4,
+		DW_LNS_set_column = 5,
+		DW_LNE_end_sequence = 1,
+		DW_LNE_set_address = 2,
+	};
+	static const unsigned char std_opcode_lengths[] = {
+		0, 1, 1, 1, 1, 0, 0, 0, 1, 0, 0, 1
+	};
+	struct obj_section *line_sec, **seci;
+	unsigned long long start, hdr_start;
+	char **file;
+
+	if(!obj.nrows && !obj.files)
+		return;
+
+	line_sec = obj_section_get(".debug_line");
+	obj.cur = line_sec;
+	obj.lineno = 0;
+
+	start = line_sec->size;
+	obj_emit_int(0, 4); /* unit_length */
+	obj_emit_int(2, 2); /* version */
+	hdr_start = line_sec->size;
+	obj_emit_int(0, 4); /* header_length */
+	obj_emit_int(1, 1); /* minimum_instruction_length */
+	obj_emit_int(1, 1); /* default_is_stmt */
+	obj_emit_int(-5 & 0xff, 1); /* line_base */
+	obj_emit_int(14, 1); /* line_range */
+	obj_emit_int(countof(std_opcode_lengths) + 1, 1); /* opcode_base */
+	obj_emit(std_opcode_lengths, sizeof std_opcode_lengths);
+	obj_emit_int(0, 1); /* include_directories */
+	for(file = obj.files; file && *file; file++){
+		obj_emit(*file, strlen(*file) + 1);
+		obj_uleb(0); /* directory */
+		obj_uleb(0); /* mtime */
+		obj_uleb(0); /* length */
+	}
+	obj_emit_int(0, 1);
+	obj_patch(line_sec, hdr_start, line_sec->size - hdr_start - 4, 4);
+
+	for(seci = obj.sections; *seci; seci++){
+		struct obj_section *sec = *seci;
+		unsigned long long addr = 0;
+		unsigned cur_file = 1, cur_line = 1, cur_col = 0;
+		int started = 0;
+		size_t i;
+
+		for(i = 0; i < obj.nrows; i++){
+			const struct obj_dbg_row *row = &obj.rows[i];
+
+			if(row->sec != sec)
+				continue;
+
+			if(!started){
+				struct obj_expr e = { 0 };
+
+				e.add = sec->secsym;
+				e.num = row->off;
+
+				obj_emit_int(0, 1);
+				obj_uleb(9);
+				obj_emit_int(DW_LNE_set_address, 1);
+				obj_emit_expr(&e, 8);
+
+				addr = row->off;
+				started = 1;
+			}
+
+			if(row->file != cur_file){
+				obj_emit_int(DW_LNS_set_file, 1);
+				obj_uleb(row->file);
+				cur_file = row->file;
+			}
+			if(row->col != cur_col){
+				obj_emit_int(DW_LNS_set_column, 1);
+				obj_uleb(row->col);
+				cur_col = row->col;
+			}
+			if(row->off != addr){
+				obj_emit_int(DW_LNS_advance_pc, 1);
+				obj_uleb(row->off - addr);
+				addr = row->off;
+			}
+			if(row->line != cur_line){
+				obj_emit_int(DW_LNS_advance_line, 1);
+				obj_sleb((long long)row->line - (long long)cur_line);
+				cur_line = row->line;
+			}
+			obj_emit_int(DW_LNS_copy, 1);
+		}
+
+		if(started){
+			if(sec->size != addr){
+				obj_emit_int(DW_LNS_advance_pc, 1);
+				obj_uleb(sec->size - addr);
+			}
+			obj_emit_int(0, 1);
+			obj_uleb(1);
+			obj_emit_int(DW_LNE_end_sequence, 1);
+		}
+	}
+
+	obj_patch(line_sec, start, line_sec->size - start - 4, 4);
+}
+
+static void obj_free(void)
+{
+	struct obj_section **sec;
+	struct obj_sym **sym;
+
+	for(sec = obj.sections; sec && *sec; sec++){
+		free((*sec)->name);
+		free((*sec)->data);
+		free((*sec)->relocs);
+		free(*sec);
+	}
+	dynarray_free(struct obj_section **, obj.sections, NULL);
+
+	for(sym = obj.symlist; sym && *sym; sym++){
+		free((*sym)->name);
+		free(*sym);
+	}
+	dynarray_free(struct obj_sym **, obj.symlist, NULL);
+	dynmap_free(obj.syms);
+
+	dynarray_free(struct obj_section **, obj.section_stack, NULL);
+	dynarray_free(char **, obj.files, free);
+	free(obj.fixups);
+	free(obj.rows);
+
+	memset(&obj, 0, sizeof obj);
+}
+
+/* assembles whatever text has been written since the last call.
+ * a trailing partial line is left for next time, unless this is the end */
+static void obj_text_read(int end)
+{
+	char line[OBJ_LINE_MAX];
+	long pos = ftell(obj.text);
+
+	if(pos < 0)
+		die("read assembly:");
+	if(pos == obj.text_off)
+		return;
+
+	if(fseek(obj.text, obj.text_off, SEEK_SET))
+		die("read assembly:");
+
+	while(fgets(line, sizeof line, obj.text)){
+		size_t len = strlen(line);
+
+		if(!end && line[len - 1] != '\n' && feof(obj.text))
+			break;
+
+		obj.text_off += len;
+		obj.lineno++;
+		obj.line = line;
+		obj_line(line);
+	}
+	if(ferror(obj.text))
+		die("read assembly:");
+	obj.line = NULL;
+
+	/* back to appending */
+	if(fseek(obj.text, 0, SEEK_END))
+		die("read assembly:");
+}
+
+void obj_begin(FILE *text)
+{
+	memset(&obj, 0, sizeof obj);
+	obj.syms = dynmap_new(char *, strcmp, dynmap_strhash);
+	obj.text = text;
+	obj.text_off = ftell(text);
+}
+
+int obj_active(void)
+{
+	return !!obj.text;
+}
+
+void obj_insn(const struct insn *i)
+{
+	struct obj_insn insn;
+
+	/* labels, directives and .loc lines before this instruction */
+	obj_text_read(0);
+
+	memset(&insn, 0, sizeof insn);
+	if(impl_obj_encode_insn(i, &insn))
+		return;
+
+	obj_insn_emit(&insn);
+}
+
+int obj_end(FILE *out)
+{
+	struct obj_sym **sym;
+	size_t i;
+	int errors;
+
+	obj_text_read(1);
+
+	obj_dbg_line();
+
+	for(i = 0; i < obj.nfixups; i++)
+		obj_fixup_resolve(&obj.fixups[i]);
+	obj.lineno = 0;
+
+	for(sym = obj.symlist; *sym; sym++)
+		obj_sym_finalise(*sym);
+
+	errors = obj.errors;
+	if(!errors)
+		obj_elf_write(out, obj.sections, obj.symlist, impl_obj_machine());
+
+	obj_free();
+
+	return errors;
+}
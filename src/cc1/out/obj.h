@@ -0,0 +1,20 @@
+#ifndef OUT_OBJ_H
+#define OUT_OBJ_H
+
+#include <stdio.h>
+
+struct insn;
+
+/* integrated assembler, for -emit=obj:
+ * cc1 writes its assembly text to `text' as usual, and it is read back
+ * as compilation goes. instruction records skip the text and are encoded
+ * directly, in order with the text around them */
+void obj_begin(FILE *text);
+int obj_active(void);
+void obj_insn(const struct insn *);
+
+/* writes an ELF64 relocatable object to `out'.
+ * returns non-zero after reporting errors */
+int obj_end(FILE *out);
+
+#endif
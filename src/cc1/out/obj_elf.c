@@ -0,0 +1,276 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../util/alloc.h"
+#include "../../util/dynarray.h"
+#include "../../util/util.h"
+#include "../../util/warn.h"
+
+#include "obj_impl.h"
+#include "elf.h"
+
+struct elf_buf
+{
+	unsigned char *data;
+	size_t len, max;
+};
+
+static void elf_buf_add(struct elf_buf *b, const void *p, size_t n)
+{
+	if(b->len + n > b->max){
+		size_t old = b->max;
+
+		b->max = b->max ? b->max * 2 : 256;
+		while(b->max < b->len + n)
+			b->max *= 2;
+
+		b->data = urealloc_tag(b->data, b->max, old, UALLOC_OBJ);
+	}
+	memcpy(b->data + b->len, p, n);
+	b->len += n;
+}
+
+static void elf_put(struct elf_buf *b, unsigned long long v, unsigned size)
+{
+	unsigned char bytes[8];
+	unsigned i;
+
+	for(i = 0; i < size; i++)
+		bytes[i] = v >> (8 * i);
+
+	elf_buf_add(b, bytes, size);
+}
+
+static unsigned elf_str(struct elf_buf *strtab, const char *s)
+{
+	unsigned off = strtab->len;
+	elf_buf_add(strtab, s, strlen(s) + 1);
+	return off;
+}
+
+static int elf_sym_emitted(const struct obj_sym *sym)
+{
+	if(sym->is_section)
+		return 1;
+	if(!sym->name)
+		return 0;
+
+	if(sym->bind != OBJ_BIND_LOCAL)
+		return 1; /* includes referenced undefined symbols */
+
+	if(sym->referenced)
+		return 1;
+
+	/* assembler-local labels are dropped, like gas */
+	return sym->defined && strncmp(sym->name, ".L", 2);
+}
+
+static unsigned elf_sym_shndx(const struct obj_sym *sym)
+{
+	if(sym->is_common)
+		return SHN_COMMON;
+	if(sym->is_abs)
+		return SHN_ABS;
+	if(!sym->defined)
+		return SHN_UNDEF;
+	return sym->sec->idx;
+}
+
+static void elf_sym_out(
+		struct elf_buf *symtab, struct elf_buf *strtab,
+		struct obj_sym *sym, unsigned idx)
+{
+	unsigned char bind;
+
+	switch(sym->bind){
+		case OBJ_BIND_GLOBAL: bind = STB_GLOBAL; break;
+		case OBJ_BIND_WEAK: bind = STB_WEAK; break;
+		default: bind = STB_LOCAL; break;
+	}
+
+	sym->idx = idx;
+
+	elf_put(symtab, sym->is_section || !sym->name ? 0 : elf_str(strtab, sym->name), 4);
+	elf_put(symtab, (bind << 4) | (sym->type & 0xf), 1);
+	elf_put(symtab, sym->visibility, 1);
+	elf_put(symtab, elf_sym_shndx(sym), 2);
+	elf_put(symtab, sym->value, 8);
+	elf_put(symtab, sym->size, 8);
+}
+
+static void elf_shdr(
+		struct elf_buf *shdrs,
+		unsigned name, unsigned type, unsigned long long flags,
+		unsigned long long offset, unsigned long long size,
+		unsigned link, unsigned info,
+		unsigned long long align, unsigned long long entsize)
+{
+	elf_put(shdrs, name, 4);
+	elf_put(shdrs, type, 4);
+	elf_put(shdrs, flags, 8);
+	elf_put(shdrs, 0, 8); /* addr */
+	elf_put(shdrs, offset, 8);
+	elf_put(shdrs, size, 8);
+	elf_put(shdrs, link, 4);
+	elf_put(shdrs, info, 4);
+	elf_put(shdrs, align, 8);
+	elf_put(shdrs, entsize, 8);
+}
+
+static void elf_align(struct elf_buf *body, unsigned long long align)
+{
+	static const unsigned char zero[16];
+
+	while(align > 1 && (ELF64_EHDR_SIZE + body->len) % align)
+		elf_buf_add(body, zero,
+				align - (ELF64_EHDR_SIZE + body->len) % align > sizeof zero
+				? sizeof zero
+				: align - (ELF64_EHDR_SIZE + body->len) % align);
+}
+
+void obj_elf_write(
+		FILE *f,
+		struct obj_section **sections,
+		struct obj_sym **syms,
+		unsigned machine)
+{
+	struct elf_buf body = { 0 }, shdrs = { 0 };
+	struct elf_buf symtab = { 0 }, strtab = { 0 }, shstrtab = { 0 };
+	struct elf_buf ehdr = { 0 };
+	struct obj_section **seci;
+	struct obj_sym **symi;
+	unsigned nshdrs, symtab_idx, strtab_idx, shstrtab_idx;
+	unsigned nsyms, first_global;
+	unsigned long long symtab_off, strtab_off, shstrtab_off, shdrs_off;
+
+	/* section header indices: each section is followed by its relocations */
+	nshdrs = 1;
+	for(seci = sections; seci && *seci; seci++){
+		(*seci)->idx = nshdrs++;
+		if((*seci)->nrelocs)
+			(*seci)->rela_idx = nshdrs++;
+	}
+	symtab_idx = nshdrs++;
+	strtab_idx = nshdrs++;
+	shstrtab_idx = nshdrs++;
+
+	/* symbols: null, locals, then globals */
+	elf_str(&strtab, "");
+	{
+		static const unsigned char null_sym[ELF64_SYM_SIZE];
+		elf_buf_add(&symtab, null_sym, sizeof null_sym);
+	}
+	nsyms = 1;
+
+	for(symi = syms; symi && *symi; symi++)
+		if((*symi)->is_section)
+			elf_sym_out(&symtab, &strtab, *symi, nsyms++);
+	for(symi = syms; symi && *symi; symi++)
+		if(!(*symi)->is_section && (*symi)->bind == OBJ_BIND_LOCAL && elf_sym_emitted(*symi))
+			elf_sym_out(&symtab, &strtab, *symi, nsyms++);
+	first_global = nsyms;
+	for(symi = syms; symi && *symi; symi++)
+		if((*symi)->bind != OBJ_BIND_LOCAL && elf_sym_emitted(*symi))
+			elf_sym_out(&symtab, &strtab, *symi, nsyms++);
+
+	/* contents */
+	elf_str(&shstrtab, "");
+	elf_shdr(&shdrs, 0, SHT_NULL, 0, 0, 0, 0, 0, 0, 0);
+
+	for(seci = sections; seci && *seci; seci++){
+		struct obj_section *sec = *seci;
+		unsigned long long off;
+		unsigned name = elf_str(&shstrtab, sec->name);
+		size_t i;
+
+		elf_align(&body, sec->align);
+		off = ELF64_EHDR_SIZE + body.len;
+		if(sec->type != SHT_NOBITS)
+			elf_buf_add(&body, sec->data, sec->len);
+
+		elf_shdr(&shdrs, name, sec->type, sec->flags,
+				off, sec->size, 0, 0, sec->align, sec->entsize);
+
+		if(!sec->nrelocs)
+			continue;
+
+		{
+			char *relname = ustrprintf(".rela%s", sec->name);
+			name = elf_str(&shstrtab, relname);
+			free(relname);
+		}
+
+		elf_align(&body, 8);
+		off = ELF64_EHDR_SIZE + body.len;
+		for(i = 0; i < sec->nrelocs; i++){
+			const struct obj_reloc *r = &sec->relocs[i];
+
+			elf_put(&body, r->off, 8);
+			elf_put(&body, ((unsigned long long)r->sym->idx << 32) | r->type, 8);
+			elf_put(&body, r->addend, 8);
+		}
+
+		elf_shdr(&shdrs, name, SHT_RELA, SHF_INFO_LINK,
+				off, sec->nrelocs * ELF64_RELA_SIZE,
+				symtab_idx, sec->idx, 8, ELF64_RELA_SIZE);
+	}
+
+	elf_align(&body, 8);
+	symtab_off = ELF64_EHDR_SIZE + body.len;
+	elf_buf_add(&body, symtab.data, symtab.len);
+	elf_shdr(&shdrs, elf_str(&shstrtab, ".symtab"), SHT_SYMTAB, 0,
+			symtab_off, symtab.len, strtab_idx, first_global, 8, ELF64_SYM_SIZE);
+
+	strtab_off = ELF64_EHDR_SIZE + body.len;
+	elf_buf_add(&body, strtab.data, strtab.len);
+	elf_shdr(&shdrs, elf_str(&shstrtab, ".strtab"), SHT_STRTAB, 0,
+			strtab_off, strtab.len, 0, 0, 1, 0);
+
+	shstrtab_off = ELF64_EHDR_SIZE + body.len;
+	{
+		/* the name must be added before the contents are written */
+		unsigned name = elf_str(&shstrtab, ".shstrtab");
+		elf_buf_add(&body, shstrtab.data, shstrtab.len);
+		elf_shdr(&shdrs, name, SHT_STRTAB, 0,
+				shstrtab_off, shstrtab.len, 0, 0, 1, 0);
+	}
+
+	elf_align(&body, 8);
+	shdrs_off = ELF64_EHDR_SIZE + body.len;
+
+	/* header */
+	elf_buf_add(&ehdr, "\177ELF", 4);
+	elf_put(&ehdr, 2, 1); /* ELFCLASS64 */
+	elf_put(&ehdr, 1, 1); /* ELFDATA2LSB */
+	elf_put(&ehdr, 1, 1); /* EV_CURRENT */
+	elf_put(&ehdr, 0, 1); /* ELFOSABI_NONE */
+	elf_put(&ehdr, 0, 8); /* abi version + padding */
+	elf_put(&ehdr, ET_REL, 2);
+	elf_put(&ehdr, machine, 2);
+	elf_put(&ehdr, 1, 4); /* version */
+	elf_put(&ehdr, 0, 8); /* entry */
+	elf_put(&ehdr, 0, 8); /* phoff */
+	elf_put(&ehdr, shdrs_off, 8);
+	elf_put(&ehdr, 0, 4); /* flags */
+	elf_put(&ehdr, ELF64_EHDR_SIZE, 2);
+	elf_put(&ehdr, 0, 2); /* phentsize */
+	elf_put(&ehdr, 0, 2); /* phnum */
+	elf_put(&ehdr, ELF64_SHDR_SIZE, 2);
+	elf_put(&ehdr, nshdrs, 2);
+	elf_put(&ehdr, shstrtab_idx, 2);
+
+	if(fwrite(ehdr.data, 1, ehdr.len, f) != ehdr.len
+	|| fwrite(body.data, 1, body.len, f) != body.len
+	|| fwrite(shdrs.data, 1, shdrs.len, f) != shdrs.len)
+	{
+		die("write object file:");
+	}
+
+	free(ehdr.data);
+	free(body.data);
+	free(shdrs.data);
+	free(symtab.data);
+	free(strtab.data);
+	free(shstrtab.data);
+}
@@ -0,0 +1,131 @@
+#ifndef OUT_OBJ_IMPL_H
+#define OUT_OBJ_IMPL_H
+
+#include <stdio.h>
+
+#include "../../util/compiler.h"
+
+struct insn;
+
+/* shared between the integrated assembler's front end (obj.c),
+ * the target's instruction encoder and the ELF writer (obj_elf.c) */
+
+enum obj_modifier
+{
+	OBJ_MOD_NONE,
+	OBJ_MOD_PLT,
+	OBJ_MOD_GOTPCREL,
+	OBJ_MOD_GOTOFF,
+	OBJ_MOD_GOTTPOFF,
+	OBJ_MOD_TPOFF,
+	OBJ_MOD_TLSGD,
+	OBJ_MOD_TLSLD,
+	OBJ_MOD_DTPOFF
+};
+
+/* add - sub + num, with an optional @modifier */
+struct obj_expr
+{
+	struct obj_sym *add, *sub;
+	long long num;
+	enum obj_modifier mod;
+};
+
+struct obj_reloc
+{
+	unsigned long long off;
+	unsigned type;
+	struct obj_sym *sym;
+	long long addend;
+};
+
+struct obj_section
+{
+	char *name;
+	unsigned type;
+	unsigned long flags;
+	unsigned long align, entsize;
+	unsigned long long size; /* == len, unless SHT_NOBITS */
+
+	unsigned char *data;
+	size_t len, max;
+
+	struct obj_reloc *relocs;
+	size_t nrelocs, relocs_max;
+
+	struct obj_sym *secsym;
+	unsigned idx, rela_idx; /* section header indices */
+};
+
+enum obj_bind
+{
+	OBJ_BIND_LOCAL,
+	OBJ_BIND_GLOBAL,
+	OBJ_BIND_WEAK
+};
+
+struct obj_sym
+{
+	char *name; /* NULL for temporaries, e.g. `.' */
+	struct obj_section *sec; /* NULL: undefined, absolute or common */
+	unsigned long long value, size;
+
+	struct obj_expr size_expr;
+
+	unsigned char bind, type, visibility;
+	unsigned defined : 1,
+	         is_abs : 1,
+	         is_common : 1,
+	         is_section : 1,
+	         explicit_local : 1,
+	         has_size : 1,
+	         referenced : 1;
+
+	unsigned idx; /* .symtab index */
+};
+
+enum obj_fixup_flags
+{
+	OBJ_FIX_PCREL = 1 << 0,
+	OBJ_FIX_SIGNED = 1 << 1,
+	OBJ_FIX_BRANCH = 1 << 2 /* call/jmp target - may go via the PLT */
+};
+
+struct obj_insn_fixup
+{
+	unsigned off, size;
+	enum obj_fixup_flags flags;
+	struct obj_expr expr;
+};
+
+#define OBJ_INSN_MAX 16
+
+struct obj_insn
+{
+	unsigned char bytes[OBJ_INSN_MAX];
+	unsigned len;
+	struct obj_insn_fixup fixups[2];
+	unsigned nfixups;
+};
+
+/* front end services, for the encoder */
+void obj_error(const char *fmt, ...) ucc_printflike(1, 2);
+int obj_expr_parse(const char **, struct obj_expr *);
+int obj_expr_is_const(const struct obj_expr *);
+struct obj_sym *obj_sym_ref(const char *name);
+
+/* target hooks */
+int impl_obj_encode(const char *stmt, struct obj_insn *);
+int impl_obj_encode_insn(const struct insn *, struct obj_insn *);
+unsigned impl_obj_reloc_type(unsigned size, enum obj_fixup_flags, enum obj_modifier);
+void impl_obj_fill_nops(unsigned char *, size_t);
+unsigned impl_obj_machine(void);
+
+/* ELF writer */
+void obj_elf_write(
+		FILE *,
+		struct obj_section **sections,
+		struct obj_sym **syms,
+		unsigned machine);
+
+#endif
@@ -14,6 +14,7 @@
 #include "asm.h"
 #include "impl.h"
 #include "virt.h"
+#include "divconst.h"
 
 #include "../const.h"
 #include "../cc1.h" /* fopt_mode */
@@ -387,7 +388,11 @@ const out_val *out_op(
 			break;
 	}
 
-	result = impl_op(octx, binop, lhs, rhs);
+	result = NULL;
+	if(vconst && !out_sanitize_enabled(octx, SAN_SIGNED_INTEGER_OVERFLOW | SAN_POINTER_OVERFLOW))
+		result = out_divconst(octx, binop, lhs, rhs);
+	if(!result)
+		result = impl_op(octx, binop, lhs, rhs);
 
 	if(div)
 		result = out_op(octx, op_divide, result, div);
@@ -447,6 +452,44 @@ const out_val *out_op_unary(out_ctx *octx, enum op_type uop, const out_val *val)
 	return impl_op_unary(octx, uop, val);
 }
 
+const out_val *out_select(
+		out_ctx *octx, const out_val *cond,
+		const out_val *vtrue, const out_val *vfalse)
+{
+	type *ty = vfalse->t;
+	type *arith;
+	const out_val *native, *mask, *vfalse_copy;
+
+	if(cond->type == V_CONST_I && cc1_fopt.const_fold){
+		const int which = !!cond->bits.val_i;
+
+		out_val_consume(octx, cond);
+		out_val_consume(octx, which ? vfalse : vtrue);
+		return which ? vtrue : vfalse;
+	}
+
+	if(cond->type != V_FLAG)
+		cond = out_op(octx, op_ne, cond, out_new_zero(octx, cond->t));
+
+	native = impl_select(octx, cond, vtrue, vfalse);
+	if(native)
+		return native;
+
+	/* vfalse ^ ((vtrue ^ vfalse) & -cond) */
+	arith = type_is_ptr(ty) ? type_nav_btype(cc1_type_nav, type_uintptr_t) : ty;
+
+	mask = out_op_unary(octx, op_minus, out_cast(octx, cond, arith, /*normalise_bool*/1));
+
+	vfalse = out_change_type(octx, v_to_reg(octx, vfalse), arith);
+	out_val_retain(octx, vfalse);
+	vfalse_copy = v_dup_or_reuse(octx, vfalse, arith);
+
+	vtrue = out_op(octx, op_xor, out_change_type(octx, vtrue, arith), vfalse_copy);
+	vtrue = out_op(octx, op_and, vtrue, mask);
+
+	return out_change_type(octx, out_op(octx, op_xor, vfalse, vtrue), ty);
+}
+
 void test_out_out(void)
 {
 	out_val v = { 0 };
@@ -221,6 +221,9 @@ const out_val *out_deref(out_ctx *octx, const out_val *target)
 	const out_val *dval;
 	int done_out_deref;
 
+	if(target->flags & VAL_FLAG_REGVAR)
+		return v_regvar_load(octx, target);
+
 	/* if the pointed-to object is not an lvalue, don't deref */
 	if(type_is(tnext, type_array)
 	|| type_is(tnext, type_func))
@@ -313,6 +316,11 @@ const out_val *out_set_bitfield(
 
 void out_store(out_ctx *octx, const out_val *dest, const out_val *val)
 {
+	if(dest->flags & VAL_FLAG_REGVAR){
+		v_regvar_store(octx, dest, val);
+		return;
+	}
+
 	if(dest->bitfield.nbits){
 		out_val_retain(octx, dest);
 		val = out_bitfield_scalar_merge(octx, &dest->bitfield, val, dest);
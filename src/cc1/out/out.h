@@ -37,6 +37,18 @@ out_val *out_new_lbl(out_ctx *, type *, const char *s, enum out_pic_type)
 
 out_val *out_new_blk_addr(out_ctx *, out_blk *) ucc_wur;
 
+enum out_tls_model
+{
+	OUT_TLS_LOCAL_EXEC, /* defined in the executable: %fs-relative */
+	OUT_TLS_INITIAL_EXEC, /* in the executable or a startup module: offset via the GOT */
+	OUT_TLS_GLOBAL_DYNAMIC /* anywhere: __tls_get_addr() */
+};
+
+/* address of a thread-local variable, s, as type ty */
+const out_val *out_new_tls_lbl(
+		out_ctx *, type *ty, const char *s, enum out_tls_model)
+	ucc_wur;
+
 out_val *out_new_noop(out_ctx *) ucc_wur;
 
 const out_val *out_new_sym(out_ctx *, sym *) ucc_wur;
@@ -79,6 +91,66 @@ ucc_wur const out_val *out_annotate_likely(
 /* operators/comparisons */
 ucc_wur const out_val *out_op(out_ctx *, enum op_type, const out_val *lhs, const out_val *rhs);
 ucc_wur const out_val *out_op_unary(out_ctx *, enum op_type, const out_val *);
+/* cond ? vtrue : vfalse without branching - both values are consumed */
+ucc_wur const out_val *out_select(
+		out_ctx *, const out_val *cond,
+		const out_val *vtrue, const out_val *vfalse);
+
+enum out_bitop
+{
+	OUT_BITOP_POPCOUNT,
+	OUT_BITOP_CLZ, /* undefined for zero */
+	OUT_BITOP_CTZ, /* undefined for zero */
+	OUT_BITOP_FFS,
+	OUT_BITOP_BSWAP
+};
+
+/* the result has the operand's (unsigned) type */
+ucc_wur const out_val *out_bitop(out_ctx *, enum out_bitop, const out_val *);
+
+/* returns 0 if the result is undefined, e.g. clz(0) */
+int out_bitop_fold(
+		enum out_bitop, integral_t v, unsigned bytes, integral_t *result);
+
+/* consumes addr. locality is 0 (none) to 3 (keep in all cache levels) */
+void out_prefetch(out_ctx *, const out_val *addr, int write, int locality);
+
+enum out_memorder
+{
+	/* values match __ATOMIC_RELAXED ... __ATOMIC_SEQ_CST */
+	OUT_MO_RELAXED,
+	OUT_MO_CONSUME,
+	OUT_MO_ACQUIRE,
+	OUT_MO_RELEASE,
+	OUT_MO_ACQ_REL,
+	OUT_MO_SEQ_CST
+};
+
+/* atomic accesses - ptr points at an integer or pointer of size 1, 2, 4 or 8.
+ * all consume their arguments */
+ucc_wur const out_val *out_atomic_load(
+		out_ctx *, const out_val *ptr, enum out_memorder);
+
+void out_atomic_store(
+		out_ctx *, const out_val *ptr, const out_val *val, enum out_memorder);
+
+/* the following return the previous value, in val's type */
+ucc_wur const out_val *out_atomic_exchange(
+		out_ctx *, const out_val *ptr, const out_val *val, enum out_memorder);
+
+/* op is one of plus, minus, and, or, xor, or bnot for nand: *ptr = ~(*ptr & val) */
+ucc_wur const out_val *out_atomic_fetch_op(
+		out_ctx *, enum op_type,
+		const out_val *ptr, const out_val *val, enum out_memorder);
+
+/* *success is set to a _Bool for whether *ptr held expected
+ * and was replaced with desired */
+ucc_wur const out_val *out_atomic_cmpxchg(
+		out_ctx *, const out_val *ptr,
+		const out_val *expected, const out_val *desired,
+		enum out_memorder, const out_val **success);
+
+void out_atomic_fence(out_ctx *, enum out_memorder);
 
 ucc_wur const out_val *out_memcpy(
 		out_ctx *octx,
@@ -91,6 +163,25 @@ void out_memset(
 		unsigned char byte,
 		unsigned long nbytes);
 
+/* packed operations for the loop vectoriser. vector registers are numbered
+ * from 0 to out_vec_regs() - 1, belong to the caller and don't survive calls.
+ * loads and stores are unaligned and take their element type from addr */
+unsigned out_vec_lanes(out_ctx *, type *elem); /* 0 if unsupported */
+unsigned out_vec_regs(out_ctx *);
+int out_vec_op_supported(out_ctx *, enum op_type, type *elem);
+
+void out_vec_load(out_ctx *, unsigned reg, const out_val *addr);
+void out_vec_store(out_ctx *, const out_val *addr, unsigned reg);
+/* every lane = v */
+void out_vec_splat(out_ctx *, unsigned reg, const out_val *v);
+void out_vec_zero(out_ctx *, unsigned reg);
+void out_vec_copy(out_ctx *, unsigned dest, unsigned src);
+/* dest = dest op src */
+void out_vec_op(out_ctx *, enum op_type, type *elem, unsigned dest, unsigned src);
+/* combine reg's lanes with op, clobbering reg and scratch */
+ucc_wur const out_val *out_vec_reduce(
+		out_ctx *, enum op_type, type *elem, unsigned reg, unsigned scratch);
+
 ucc_wur const out_val *out_deref(out_ctx *, const out_val *) ucc_wur;
 
 ucc_wur const out_val *out_cast(out_ctx *, const out_val *, type *to, int normalise_bool)
@@ -105,6 +196,13 @@ ucc_wur const out_val *out_call(out_ctx *,
 		type *fnty)
 		ucc_nonnull((1, 2, 4));
 
+/* call from tail position, jumping to fn once our frame is torn down.
+ * NULL if this isn't possible, in which case nothing is consumed */
+ucc_wur const out_val *out_call_sibling(out_ctx *,
+		const out_val *fn, const out_val **args,
+		type *fnty)
+		ucc_nonnull((1, 2, 4));
+
 
 /* control flow */
 ucc_wur out_blk *out_blk_new(out_ctx *, const char *desc);
@@ -137,6 +235,12 @@ void out_ctrl_transfer_make_current(out_ctx *octx, out_blk *to);
 /* goto *<exp> */
 void out_ctrl_transfer_exp(out_ctx *, const out_val *addr);
 
+/* goto *targets[idx] - idx must already be bounds checked.
+ * the table is emitted to .rodata as offsets, so is PIC-safe */
+void out_ctrl_transfer_table(
+		out_ctx *, const out_val *idx,
+		out_blk **targets, unsigned long ntargets);
+
 void out_ctrl_branch(
 		out_ctx *octx,
 		const out_val *cond,
@@ -144,6 +248,9 @@ void out_ctrl_branch(
 
 void out_blk_mustgen(out_ctx *octx, out_blk *blk, char *force_lbl);
 
+/* hint that the current block is rarely executed, e.g. it calls a cold function */
+void out_blk_cold(out_ctx *);
+
 /* maybe ret null */
 ucc_wur const out_val *out_ctrl_merge(out_ctx *, out_blk *, out_blk *);
 
@@ -175,10 +282,15 @@ const out_val *out_aalloc(out_ctx *, unsigned sz, unsigned align, type *);
 const out_val *out_aalloct(out_ctx *, type *);
 void out_adealloc(out_ctx *, const out_val **);
 
+/* returns a pointer-to-ty held in a callee-save register,
+ * or NULL if none are free. released with out_adealloc() like a stack slot */
+const out_val *out_aalloc_reg(out_ctx *, type *ty);
+
 void out_force_read(out_ctx *octx, type *, const out_val *);
 
 const char *out_get_lbl(const out_val *) ucc_nonnull();
 int out_is_nonconst_temporary(const out_val *) ucc_nonnull();
+int out_is_const(const out_val *) ucc_nonnull();
 unsigned out_current_stack(out_ctx *); /* used in inlining */
 
 /* commenting */
@@ -186,5 +298,6 @@ void out_comment(out_ctx *, const char *, ...) ucc_printflike(2, 3);
 const char *out_val_str(const out_val *, int deref);
 
 void test_out_out(void);
+void test_out_divconst(void);
 
 #endif
@@ -0,0 +1,482 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include "../../util/alloc.h"
+#include "../../util/macros.h"
+
+#include "../cc1.h"
+#include "../fopt.h"
+
+#include "forwards.h"
+#include "blk.h"
+#include "insn.h"
+#include "backend.h"
+#include "peephole.h"
+
+/* patterns match the x86_64 backend's AT&T instruction records.
+ * each is given an instruction and the next one in the block (or NO_INSN)
+ * and returns non-zero if it changed anything */
+#define NO_INSN ((size_t)-1)
+
+typedef int peephole_f(out_blk *, size_t i, size_t next);
+
+enum flag_use
+{
+	FLAGS_DEAD,
+	FLAGS_READ,
+	FLAGS_UNKNOWN,
+	FLAGS_UNTOUCHED
+};
+
+static peephole_f pp_store_reload, pp_mov_back, pp_self_mov,
+	pp_arith_zero, pp_redundant_test;
+
+static struct peephole_pattern
+{
+	const char *name;
+	peephole_f *fn;
+	unsigned long fired;
+} patterns[] = {
+	{ "store-reload", pp_store_reload, 0 },
+	{ "mov-back", pp_mov_back, 0 },
+	{ "self-mov", pp_self_mov, 0 },
+	{ "arith-zero", pp_arith_zero, 0 },
+	{ "redundant-test", pp_redundant_test, 0 },
+};
+
+static const struct peephole_pattern *current_pattern;
+static unsigned long insns_in, insns_out;
+
+/* op is `base' with an optional integer size suffix */
+static int op_is(const char *op, const char *base)
+{
+	size_t len = strlen(base);
+
+	if(strncmp(op, base, len))
+		return 0;
+
+	return !op[len] || (strchr("bwlq", op[len]) && !op[len + 1]);
+}
+
+static int op_is_any(const char *op, const char *const *bases)
+{
+	for(; *bases; bases++)
+		if(op_is(op, *bases))
+			return 1;
+	return 0;
+}
+
+static int op_is_mov(const char *op, int allow_fp)
+{
+	return op_is(op, "mov")
+		|| (allow_fp && (!strcmp(op, "movss") || !strcmp(op, "movsd")));
+}
+
+static int text_is_comment_start(const char *text)
+{
+	if(*text == '\t')
+		text++;
+	return !strncmp(text, "/*", 2);
+}
+
+static int text_is_ignorable(const char *text)
+{
+	if(*text == '\t')
+		text++;
+	return *text == '#' || !strncmp(text, ".loc ", 5);
+}
+
+/* skips deleted records, comments and .loc lines, stopping
+ * at anything else we don't understand (*barrier is set) */
+static size_t pp_next(out_blk *blk, size_t i, int *barrier)
+{
+	if(barrier)
+		*barrier = 0;
+
+	for(i++; i < blk->ninsns; i++){
+		const struct insn *insn = &blk->insns[i];
+
+		if(insn->op)
+			return i;
+
+		if(!insn->bits.text || text_is_ignorable(insn->bits.text))
+			continue;
+
+		if(text_is_comment_start(insn->bits.text)){
+			/* comments may be split over several records */
+			for(; i < blk->ninsns; i++){
+				const struct insn *c = &blk->insns[i];
+				if(!c->op && c->bits.text && strstr(c->bits.text, "*/"))
+					break;
+			}
+			continue;
+		}
+
+		if(barrier)
+			*barrier = 1;
+		break;
+	}
+
+	return NO_INSN;
+}
+
+static enum flag_use op_flag_use(const char *op)
+{
+	static const char *const writers[] = {
+		"cmp", "test", "add", "sub", "and", "or", "xor", "neg",
+		"imul", "mul", "idiv", "div", "call", "ret", NULL
+	};
+	static const char *const neutral[] = {
+		"lea", "push", "pop", "not", "leave", NULL
+	};
+
+	if((op[0] == 'j' && strcmp(op, "jmp"))
+	|| !strncmp(op, "set", 3)
+	|| !strncmp(op, "cmov", 4)
+	|| op_is(op, "adc")
+	|| op_is(op, "sbb"))
+	{
+		return FLAGS_READ;
+	}
+
+	if(op_is_any(op, writers)
+	|| !strncmp(op, "ucomis", 6)
+	|| !strncmp(op, "comis", 5)
+	|| !strcmp(op, "jmp")
+	|| !strcmp(op, "ud2"))
+	{
+		/* jmp and ud2 leave the block - nothing after reads flags */
+		return FLAGS_DEAD;
+	}
+
+	if(op_is_any(op, neutral)
+	|| !strncmp(op, "mov", 3)
+	|| !strncmp(op, "cvt", 3)
+	|| !strcmp(op, "cqto") || !strcmp(op, "cltd")
+	|| !strcmp(op, "cltq") || !strcmp(op, "cwtl"))
+	{
+		return FLAGS_UNTOUCHED;
+	}
+
+	return FLAGS_UNKNOWN;
+}
+
+/* who reads the flags after instruction i? *cc is set for FLAGS_READ */
+static enum flag_use flags_after(out_blk *blk, size_t i, const char **cc)
+{
+	int barrier;
+
+	for(i = pp_next(blk, i, &barrier); i != NO_INSN; i = pp_next(blk, i, &barrier)){
+		const char *op = blk->insns[i].op;
+		enum flag_use use = op_flag_use(op);
+
+		if(use == FLAGS_READ){
+			*cc = op + (op[0] == 'j' ? 1 : op[0] == 's' ? 3 : 4);
+			return FLAGS_READ;
+		}
+		if(use != FLAGS_UNTOUCHED)
+			return use;
+	}
+
+	if(barrier)
+		return FLAGS_UNKNOWN;
+
+	/* flags don't live across blocks, other than into a conditional jump */
+	if(blk->type == BLK_COND){
+		*cc = blk->bits.cond.insn + 1;
+		return FLAGS_READ;
+	}
+	return FLAGS_DEAD;
+}
+
+static int cc_is(const char *cc, const char *want)
+{
+	size_t len = strlen(want);
+	return !strncmp(cc, want, len) && (!cc[len] || cc[len] == ' ');
+}
+
+static int opnd_eq(const struct insn_opnd *a, const struct insn_opnd *b)
+{
+	return a->kind == b->kind
+		&& a->indirect == b->indirect
+		&& a->reg == b->reg
+		&& a->idx == b->idx
+		&& a->scale == b->scale
+		&& a->seg == b->seg
+		&& a->sym == b->sym
+		&& a->reloc == b->reloc
+		&& a->num == b->num
+		&& (a->kind != OPND_REG || a->regsz == b->regsz);
+}
+
+static int opnd_is_reg(const struct insn_opnd *o)
+{
+	return o->kind == OPND_REG && !o->indirect;
+}
+
+static int opnd_is_frame_slot(const struct insn_opnd *o)
+{
+	return o->kind == OPND_MEM
+		&& !o->sym
+		&& o->idx == INSN_REG_NONE
+		&& (o->reg == REG_BP || o->reg == REG_SP);
+}
+
+static void pp_annotate(out_blk *blk, size_t i)
+{
+	char buf[INSN_LINE_MAX];
+
+	insn_str(&blk->insns[i], buf, sizeof buf);
+	insn_free(&blk->insns[i]);
+	blk->insns[i].op = NULL;
+	blk->insns[i].bits.text = ustrprintf_tag(UALLOC_INSN,
+			"\t# peephole %s: %s\n", current_pattern->name, buf);
+}
+
+static void pp_delete(out_blk *blk, size_t i)
+{
+	if(cc1_fopt.verbose_asm){
+		pp_annotate(blk, i);
+	}else{
+		insn_free(&blk->insns[i]);
+		blk->insns[i].op = NULL;
+		blk->insns[i].bits.text = NULL;
+	}
+}
+
+/* mov %r, slot ; mov slot, %r2 -> mov %r, slot ; mov %r, %r2 (or nothing) */
+static int pp_store_reload(out_blk *blk, size_t i, size_t next)
+{
+	struct insn *st = &blk->insns[i], *ld;
+
+	if(next == NO_INSN || !op_is_mov(st->op, 1))
+		return 0;
+
+	ld = &blk->insns[next];
+	if(ld->op != st->op
+	|| st->nopnds != 2 || ld->nopnds != 2
+	|| !opnd_is_reg(&st->bits.opnds[0])
+	|| !opnd_is_frame_slot(&st->bits.opnds[1])
+	|| !opnd_eq(&st->bits.opnds[1], &ld->bits.opnds[0])
+	|| !opnd_is_reg(&ld->bits.opnds[1]))
+	{
+		return 0;
+	}
+
+	/* a 32-bit reload also clears the upper half - that's left
+	 * to the rewrite below, giving movl %r, %r */
+	if(opnd_eq(&st->bits.opnds[0], &ld->bits.opnds[1]) && st->bits.opnds[0].regsz != 4){
+		pp_delete(blk, next);
+		return 1;
+	}
+
+	/* movss/movsd between registers only merge the low lane */
+	if(!op_is_mov(st->op, 0)
+	|| st->bits.opnds[0].regsz != ld->bits.opnds[1].regsz)
+	{
+		return 0;
+	}
+
+	if(cc1_fopt.verbose_asm){
+		struct insn rewritten = *ld;
+
+		rewritten.bits.opnds[0] = st->bits.opnds[0];
+		pp_annotate(blk, next);
+		insn_insert(blk, next + 1, &rewritten);
+	}else{
+		ld->bits.opnds[0] = st->bits.opnds[0];
+	}
+	return 1;
+}
+
+/* mov %a, %b ; mov %b, %a -> mov %a, %b
+ * only for full-width moves: movl zero-extends into %a's upper half,
+ * and movq between xmm registers clears the upper lane, while movss
+ * and movsd between registers only merge the low lane */
+static int pp_mov_back(out_blk *blk, size_t i, size_t next)
+{
+	struct insn *a = &blk->insns[i], *b;
+	unsigned regsz;
+
+	if(next == NO_INSN)
+		return 0;
+
+	if(!strcmp(a->op, "movq"))
+		regsz = 8;
+	else if(!strcmp(a->op, "movss") || !strcmp(a->op, "movsd"))
+		regsz = 16;
+	else
+		return 0;
+
+	b = &blk->insns[next];
+	if(b->op != a->op
+	|| a->nopnds != 2 || b->nopnds != 2
+	|| !opnd_is_reg(&a->bits.opnds[0]) || !opnd_is_reg(&a->bits.opnds[1])
+	|| a->bits.opnds[0].regsz != regsz || a->bits.opnds[1].regsz != regsz
+	|| !opnd_eq(&a->bits.opnds[0], &b->bits.opnds[1])
+	|| !opnd_eq(&a->bits.opnds[1], &b->bits.opnds[0]))
+	{
+		return 0;
+	}
+
+	pp_delete(blk, next);
+	return 1;
+}
+
+/* movq %a, %a - movl isn't a nop, it zero-extends */
+static int pp_self_mov(out_blk *blk, size_t i, size_t next)
+{
+	struct insn *a = &blk->insns[i];
+
+	(void)next;
+
+	if(strcmp(a->op, "movq") && strcmp(a->op, "movss") && strcmp(a->op, "movsd"))
+		return 0;
+
+	if(a->nopnds != 2
+	|| !opnd_is_reg(&a->bits.opnds[0])
+	|| !opnd_eq(&a->bits.opnds[0], &a->bits.opnds[1]))
+	{
+		return 0;
+	}
+
+	pp_delete(blk, i);
+	return 1;
+}
+
+/* add $0, %r / sub $0, %r, when nothing reads the flags.
+ * 64-bit only, the 32-bit forms zero-extend */
+static int pp_arith_zero(out_blk *blk, size_t i, size_t next)
+{
+	static const char *const ops[] = { "add", "sub", "or", "xor", NULL };
+	struct insn *a = &blk->insns[i];
+	const char *cc;
+
+	(void)next;
+
+	if(!op_is_any(a->op, ops)
+	|| a->nopnds != 2
+	|| a->bits.opnds[0].kind != OPND_IMM
+	|| a->bits.opnds[0].sym
+	|| a->bits.opnds[0].num != 0
+	|| !opnd_is_reg(&a->bits.opnds[1])
+	|| a->bits.opnds[1].regsz != 8)
+	{
+		return 0;
+	}
+
+	if(flags_after(blk, i, &cc) != FLAGS_DEAD)
+		return 0;
+
+	pp_delete(blk, i);
+	return 1;
+}
+
+/* arith ..., %r ; test %r, %r -> arith ..., %r
+ * valid when the flags the test would set match the arithmetic's */
+static int pp_redundant_test(out_blk *blk, size_t i, size_t next)
+{
+	static const char *const logic_ops[] = { "and", "or", "xor", NULL };
+	static const char *const arith_ops[] = { "add", "sub", "inc", "dec", "neg", NULL };
+	struct insn *a = &blk->insns[i], *t;
+	const struct insn_opnd *dst;
+	const char *cc;
+	int logic;
+
+	if(next == NO_INSN || !a->nopnds)
+		return 0;
+
+	logic = op_is_any(a->op, logic_ops);
+	if(!logic && !op_is_any(a->op, arith_ops))
+		return 0;
+
+	dst = &a->bits.opnds[a->nopnds - 1];
+	if(!opnd_is_reg(dst))
+		return 0;
+
+	t = &blk->insns[next];
+	if(t->nopnds != 2 || !opnd_eq(&t->bits.opnds[1], dst))
+		return 0;
+
+	if(op_is(t->op, "test")){
+		if(!opnd_eq(&t->bits.opnds[0], dst))
+			return 0;
+	}else if(op_is(t->op, "cmp")){
+		if(t->bits.opnds[0].kind != OPND_IMM || t->bits.opnds[0].sym || t->bits.opnds[0].num)
+			return 0;
+	}else{
+		return 0;
+	}
+
+	switch(flags_after(blk, next, &cc)){
+		case FLAGS_UNKNOWN:
+		case FLAGS_UNTOUCHED:
+			return 0;
+		case FLAGS_DEAD:
+			break;
+		case FLAGS_READ:
+			/* and/or/xor set flags exactly as test does,
+			 * the arithmetic ops only agree on ZF and SF */
+			if(!logic
+			&& !cc_is(cc, "e") && !cc_is(cc, "z")
+			&& !cc_is(cc, "ne") && !cc_is(cc, "nz")
+			&& !cc_is(cc, "s") && !cc_is(cc, "ns"))
+			{
+				return 0;
+			}
+			break;
+	}
+
+	pp_delete(blk, next);
+	return 1;
+}
+
+static unsigned long count_insns(out_blk *blk)
+{
+	unsigned long n = 0;
+	size_t i;
+
+	for(i = 0; i < blk->ninsns; i++)
+		if(blk->insns[i].op)
+			n++;
+	return n;
+}
+
+void blk_peephole(out_blk *blk)
+{
+	size_t i, j;
+
+	insns_in += count_insns(blk);
+
+	for(i = 0; i < blk->ninsns; i++){
+		size_t k;
+
+		for(k = 0; k < countof(patterns) && blk->insns[i].op; k++){
+			current_pattern = &patterns[k];
+
+			if(patterns[k].fn(blk, i, pp_next(blk, i, NULL)))
+				patterns[k].fired++;
+		}
+	}
+
+	/* drop deleted records */
+	for(i = j = 0; i < blk->ninsns; i++)
+		if(blk->insns[i].op || blk->insns[i].bits.text)
+			blk->insns[j++] = blk->insns[i];
+	blk->ninsns = j;
+
+	insns_out += count_insns(blk);
+}
+
+void peephole_stats(FILE *f)
+{
+	size_t i;
+
+	fprintf(f, "peephole: %lu instructions in, %lu out (%lu removed)\n",
+			insns_in, insns_out, insns_in - insns_out);
+
+	for(i = 0; i < countof(patterns); i++)
+		fprintf(f, "  %-16s %lu\n", patterns[i].name, patterns[i].fired);
+}
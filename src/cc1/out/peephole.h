@@ -0,0 +1,12 @@
+#ifndef OUT_PEEPHOLE_H
+#define OUT_PEEPHOLE_H
+
+#include <stdio.h>
+
+#include "forwards.h"
+
+void blk_peephole(out_blk *);
+
+void peephole_stats(FILE *);
+
+#endif
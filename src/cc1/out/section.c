@@ -18,6 +18,8 @@ const struct section section_text = SECTION_INIT(SECTION_TEXT);
 const struct section section_data = SECTION_INIT(SECTION_DATA);
 const struct section section_bss = SECTION_INIT(SECTION_BSS);
 const struct section section_rodata = SECTION_INIT(SECTION_RODATA);
+const struct section section_tdata = SECTION_INIT(SECTION_TDATA);
+const struct section section_tbss = SECTION_INIT(SECTION_TBSS);
 const struct section section_ctors = SECTION_INIT(SECTION_CTORS);
 const struct section section_dtors = SECTION_INIT(SECTION_DTORS);
 const struct section section_dbg_abbrev = SECTION_INIT(SECTION_DBG_ABBREV);
@@ -62,6 +64,8 @@ char *section_name(const struct section *sec, int *const allocated)
 		case SECTION_BSS: return (char *)cc1_target_details.section_names->section_name_bss;
 		case SECTION_RODATA: return (char *)cc1_target_details.section_names->section_name_rodata;
 		case SECTION_RELRO: return (char *)cc1_target_details.section_names->section_name_relro;
+		case SECTION_TDATA: return (char *)cc1_target_details.section_names->section_name_tdata;
+		case SECTION_TBSS: return (char *)cc1_target_details.section_names->section_name_tbss;
 		case SECTION_CTORS: return (char *)cc1_target_details.section_names->section_name_ctors;
 		case SECTION_DTORS: return (char *)cc1_target_details.section_names->section_name_dtors;
 		case SECTION_DBG_ABBREV: return (char *)cc1_target_details.section_names->section_name_dbg_abbrev;
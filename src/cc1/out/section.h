@@ -8,6 +8,8 @@ enum section_builtin
 	SECTION_BSS,
 	SECTION_RODATA,
 	SECTION_RELRO,
+	SECTION_TDATA,
+	SECTION_TBSS,
 	SECTION_CTORS,
 	SECTION_DTORS,
 	SECTION_DBG_ABBREV,
@@ -30,6 +32,7 @@ struct section
 	enum section_flags {
 		SECTION_FLAG_EXECUTABLE = 1 << 0,
 		SECTION_FLAG_RO = 1 << 1,
+		SECTION_FLAG_TLS = 1 << 2,
 	} flags;
 };
 
@@ -72,6 +75,8 @@ struct section
 #define SECTION_DESC_BSS "bss"
 #define SECTION_DESC_RODATA "rodata"
 #define SECTION_DESC_RELRO "relro"
+#define SECTION_DESC_TDATA "tdata"
+#define SECTION_DESC_TBSS "tbss"
 #define SECTION_DESC_CTORS "ctors"
 #define SECTION_DESC_DTORS "dtors"
 #define SECTION_DESC_DBG_ABBREV "dbg_abbrev"
@@ -91,6 +96,8 @@ extern const struct section section_data;
 extern const struct section section_bss;
 extern const struct section section_rodata;
 extern const struct section section_relro;
+extern const struct section section_tdata;
+extern const struct section section_tbss;
 extern const struct section section_ctors;
 extern const struct section section_dtors;
 extern const struct section section_dbg_abbrev;
@@ -1,3 +1,4 @@
+#include <stdio.h>
 #include <stddef.h>
 
 #include "../type.h"
@@ -16,6 +17,11 @@
 
 #include "stack.h"
 
+static struct
+{
+	unsigned long frames, unshared;
+} reuse_stats;
+
 void v_stack_adj_val(out_ctx *octx, const out_val *amt, int sub)
 {
 	out_flush_volatile(
@@ -46,6 +52,10 @@ static void align_sz(unsigned *psz, unsigned align)
 
 void v_set_cur_stack_sz(out_ctx *octx, v_stackt new_sz)
 {
+	/* growth after a reclaim would need fresh space without reuse */
+	if(new_sz > octx->cur_stack_sz)
+		octx->stack_unshared_sz += new_sz - octx->cur_stack_sz;
+
 	octx->cur_stack_sz = new_sz;
 
 	if(new_sz > octx->max_stack_sz)
@@ -59,13 +69,15 @@ const out_val *out_aalloc(
 			in_ty
 			? in_ty
 			: type_nav_btype(cc1_type_nav, type_nchar));
+	v_stackt new_sz;
 
 	align_sz(&sz, align);
 
 	/* packing takes care of everything */
-	pack_next(&octx->cur_stack_sz, NULL, sz, align);
+	new_sz = octx->cur_stack_sz;
+	pack_next(&new_sz, NULL, sz, align);
 
-	v_set_cur_stack_sz(octx, octx->cur_stack_sz);
+	v_set_cur_stack_sz(octx, new_sz);
 
 	return v_new_bp3_below(octx, NULL, ty, octx->cur_stack_sz);
 }
@@ -102,3 +114,17 @@ void v_stack_needalign(out_ctx *octx, unsigned align)
 	 * it might not be at a 16-byte alignment */
 	octx->max_align = MAX(octx->max_align, align);
 }
+
+void stack_reuse_account(out_ctx *octx)
+{
+	reuse_stats.frames += octx->max_stack_sz;
+	reuse_stats.unshared += MAX(octx->stack_unshared_sz, octx->max_stack_sz);
+}
+
+void stack_reuse_stats(FILE *f)
+{
+	fprintf(f, "stack reuse: %lu bytes of frames, %lu without reuse (%lu saved)\n",
+			reuse_stats.frames,
+			reuse_stats.unshared,
+			reuse_stats.unshared - reuse_stats.frames);
+}
@@ -1,6 +1,8 @@
 #ifndef OUT_STACK_H
 #define OUT_STACK_H
 
+#include <stdio.h>
+
 #include "vstack_t.h"
 
 /* emit an actual stack insn */
@@ -14,4 +16,8 @@ void v_aalloc_noop(out_ctx *, unsigned sz, unsigned align, const char *);
 
 void v_set_cur_stack_sz(out_ctx *octx, v_stackt new_sz);
 
+/* frame sizes with and without slot sharing (-fstack-reuse=) */
+void stack_reuse_account(out_ctx *octx);
+void stack_reuse_stats(FILE *);
+
 #endif
@@ -7,6 +7,7 @@
 
 #include "../type.h"
 #include "../type_nav.h"
+#include "../type_is.h"
 #include "../fopt.h"
 
 #include "../macros.h"
@@ -51,7 +52,28 @@ static void v_register(out_ctx *octx, out_val_list *l)
 	octx->val_head = l;
 
 	if(!octx->val_tail)
-		octx->val_tail = l->next;
+		octx->val_tail = l;
+}
+
+static void v_unregister(out_ctx *octx, out_val_list *l)
+{
+	/* dead values leave the list, so register scans only see live ones.
+	 * l->next and l->prev are left intact - an in-progress iteration
+	 * positioned on l will step to its old neighbours, which are either
+	 * live or themselves dead and chained in the same direction */
+	if(l->prev)
+		l->prev->next = l->next;
+	else
+		octx->val_head = l->next;
+
+	if(l->next)
+		l->next->prev = l->prev;
+	else
+		octx->val_tail = l->prev;
+
+	/* out_val pointers may still be held - free at function teardown */
+	l->next_dead = octx->val_dead;
+	octx->val_dead = l;
 }
 
 static void v_init(out_val *v, type *ty)
@@ -65,6 +87,8 @@ out_val *v_new(out_ctx *octx, type *ty)
 	out_val_list *l = umalloc(sizeof *l);
 	out_val *v = &l->val;
 
+	assert((void *)v == (void *)l);
+
 	v_init(v, ty);
 	v_register(octx, l);
 
@@ -201,6 +225,7 @@ static out_val *v_reuse(out_ctx *octx, const out_val *from, type *ty)
 	mut = (out_val *)from;
 
 	mut->t = ty;
+	mut->flags &= ~VAL_FLAG_REGVAR;
 	return mut; /* reuse */
 }
 
@@ -318,9 +343,10 @@ void v_try_stack_reclaim(out_ctx *octx)
 	 * we can reclaim stack-spill space.
 	 * this is a simple algorithm for reclaiming */
 	out_val_list *iter;
-	long lowest = 0;
+	/* never reclaim the prologue's spills, e.g. the variadic save area */
+	long lowest = -(long)octx->initial_stack_sz;
 
-	if(octx->in_prologue || octx->alloca_count)
+	if(octx->in_prologue || octx->alloca_count || cc1_stack_reuse == STACK_REUSE_NONE)
 		return;
 
 	/* only reclaim if we have an empty val list */
@@ -329,12 +355,22 @@ void v_try_stack_reclaim(out_ctx *octx)
 			continue;
 		if(iter->val.phiblock)
 			continue;
+		if(iter->val.flags & VAL_FLAG_REGVAR)
+			continue;
 		switch(iter->val.type){
 			case V_REG:
 			case V_REGOFF:
 			case V_SPILT:
-				if(!impl_reg_frame_const(&iter->val.bits.regoff.reg, 0))
+				if(!impl_reg_frame_const(&iter->val.bits.regoff.reg, 0)){
+					/* a number in a register can't address a stack temporary */
+					if(cc1_stack_reuse == STACK_REUSE_ALL
+					&& iter->val.type == V_REG
+					&& type_is_arith(iter->val.t))
+					{
+						continue;
+					}
 					return;
+				}
 				if(iter->val.bits.regoff.offset < lowest)
 					lowest = iter->val.bits.regoff.offset;
 				break;
@@ -364,6 +400,7 @@ const out_val *out_val_release(out_ctx *octx, const out_val *v)
 	assert(v && "release NULL out_val");
 	assert(mut->retains > 0 && "double release");
 	if(--mut->retains == 0){
+		v_unregister(octx, (out_val_list *)mut);
 		v_try_stack_reclaim(octx);
 
 		return NULL;
@@ -408,6 +445,11 @@ const char *out_get_lbl(const out_val *v)
 	return v->type == V_LBL ? v->bits.lbl.str : NULL;
 }
 
+int out_is_const(const out_val *v)
+{
+	return v->type == V_CONST_I || v->type == V_CONST_F;
+}
+
 int out_is_nonconst_temporary(const out_val *v)
 {
 	switch(v->type){
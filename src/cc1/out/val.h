@@ -74,6 +74,7 @@ enum
 {
 	VAL_FLAG_LIKELY = 1 << 0,
 	VAL_FLAG_UNLIKELY = 1 << 1,
+	VAL_FLAG_REGVAR = 1 << 2, /* the register is the storage, see out_aalloc_reg() */
 };
 
 const char *v_store_to_str(enum out_val_store);
@@ -0,0 +1,72 @@
+#include <stddef.h>
+#include <stdarg.h>
+#include <assert.h>
+
+#include "../type.h"
+#include "../type_is.h"
+
+#include "out.h"
+#include "val.h"
+#include "impl.h"
+
+unsigned out_vec_lanes(out_ctx *octx, type *elem)
+{
+	if(!VEC_BYTES || type_qual(elem) & (qual_volatile | qual_atomic))
+		return 0;
+
+	return impl_vec_lanes(octx, elem);
+}
+
+unsigned out_vec_regs(out_ctx *octx)
+{
+	(void)octx;
+	return N_VEC_REGS;
+}
+
+int out_vec_op_supported(out_ctx *octx, enum op_type op, type *elem)
+{
+	return out_vec_lanes(octx, elem) && impl_vec_op_supported(op, elem);
+}
+
+void out_vec_load(out_ctx *octx, unsigned reg, const out_val *addr)
+{
+	assert(reg < N_VEC_REGS);
+	impl_vec_load(octx, reg, addr, type_is_ptr(addr->t));
+}
+
+void out_vec_store(out_ctx *octx, const out_val *addr, unsigned reg)
+{
+	assert(reg < N_VEC_REGS);
+	impl_vec_store(octx, addr, reg, type_is_ptr(addr->t));
+}
+
+void out_vec_splat(out_ctx *octx, unsigned reg, const out_val *v)
+{
+	assert(reg < N_VEC_REGS);
+	impl_vec_splat(octx, reg, v);
+}
+
+void out_vec_zero(out_ctx *octx, unsigned reg)
+{
+	assert(reg < N_VEC_REGS);
+	impl_vec_zero(octx, reg);
+}
+
+void out_vec_copy(out_ctx *octx, unsigned dest, unsigned src)
+{
+	assert(dest < N_VEC_REGS && src < N_VEC_REGS);
+	impl_vec_copy(octx, dest, src);
+}
+
+void out_vec_op(out_ctx *octx, enum op_type op, type *elem, unsigned dest, unsigned src)
+{
+	assert(dest < N_VEC_REGS && src < N_VEC_REGS);
+	impl_vec_op(octx, op, elem, dest, src);
+}
+
+const out_val *out_vec_reduce(
+		out_ctx *octx, enum op_type op, type *elem, unsigned reg, unsigned scratch)
+{
+	assert(reg < N_VEC_REGS && scratch < N_VEC_REGS && reg != scratch);
+	return impl_vec_reduce(octx, op, elem, reg, scratch);
+}
@@ -4,6 +4,7 @@
 #include <assert.h>
 
 #include "../../util/alloc.h"
+#include "../../util/util.h"
 
 #include "../type.h"
 #include "../type_nav.h"
@@ -11,6 +12,7 @@
 #include "../pack.h"
 
 #include "../cc1.h" /* cc1_mstack_align */
+#include "../fopt.h"
 
 #include "val.h"
 #include "out.h"
@@ -19,6 +21,7 @@
 #include "asm.h"
 #include "impl.h"
 #include "ctrl.h"
+#include "blk.h"
 
 static int v_unused_reg2(
 		out_ctx *octx,
@@ -151,6 +154,55 @@ static void mark_callee_save_reg_as_used(out_ctx *octx, const struct vreg *reg)
 	octx->used_callee_saved[current + 1].is_float = 2;
 }
 
+const out_val *out_aalloc_reg(out_ctx *octx, type *ty)
+{
+	struct vreg r;
+	out_val *v;
+
+	if(type_is_floating(ty))
+		return NULL;
+
+	if(!v_unused_reg2(octx, /*stack*/0, /*fp*/0, &r, NULL, impl_reg_is_callee_save))
+		return NULL;
+
+	/* the callee-save spill block is only linked in with a stack frame */
+	octx->used_stack = 1;
+	mark_callee_save_reg_as_used(octx, &r);
+
+	v = v_new_reg(octx, NULL, type_ptr_to(ty), &r);
+	v->flags |= VAL_FLAG_REGVAR;
+
+	if(cc1_fopt.verbose_asm)
+		out_comment(octx, "regvar %s", out_val_str(v, 1));
+
+	return v;
+}
+
+const out_val *v_regvar_load(out_ctx *octx, const out_val *regvar)
+{
+	type *ty = type_is_ptr(regvar->t);
+	out_val from = *regvar;
+	struct vreg r;
+
+	/* copy out - the result may be modified in place */
+	v_unused_reg(octx, 1, 0, &r, NULL);
+
+	from.t = ty;
+	impl_reg_cp_no_off(octx, &from, &r);
+
+	out_val_release(octx, regvar);
+
+	return v_new_reg(octx, NULL, ty, &r);
+}
+
+void v_regvar_store(out_ctx *octx, const out_val *regvar, const out_val *val)
+{
+	out_val_release(octx,
+			v_to_reg_given(octx, val, &regvar->bits.regoff.reg));
+
+	out_val_release(octx, regvar);
+}
+
 static ucc_wur const out_val *v_save_reg(
 		out_ctx *octx, const out_val *vp, type *fnty)
 {
@@ -205,6 +257,7 @@ static ucc_wur const out_val *v_freeup_regp(out_ctx *octx, const out_val *vp)
 	int got_reg;
 
 	assert(vp->type == V_REG && "not reg");
+	assert(!(vp->flags & VAL_FLAG_REGVAR) && "moving a register variable");
 
 	v_reserve_reg(octx, &vp->bits.regoff.reg);
 
@@ -258,6 +311,25 @@ void v_freeup_reg(out_ctx *octx, const struct vreg *r)
 		out_val_consume(octx, v_freeup_regp(octx, v));
 }
 
+/* v_unused_reg2() tracks occupancy in a single word */
+ucc_static_assert(
+		regs_fit_mask,
+		N_SCRATCH_REGS_I + N_SCRATCH_REGS_F <= sizeof(unsigned long) * 8);
+
+static void v_dump_regalloc(
+		out_ctx *octx, const char *what,
+		const struct vreg *reg, const out_val *victim)
+{
+	fprintf(stderr, "regalloc: %s: %s %%%s",
+			octx->entry_blk ? octx->entry_blk->lbl : "?",
+			what, impl_reg_str(reg));
+
+	if(victim)
+		fprintf(stderr, " (was %s)", out_val_str(victim, 0));
+
+	fputc('\n', stderr);
+}
+
 static int v_unused_reg2(
 		out_ctx *octx,
 		int stack_as_backup, const int fp,
@@ -265,83 +337,103 @@ static int v_unused_reg2(
 		out_val const *to_replace,
 		int regtest(type *, const struct vreg *))
 {
-	unsigned char *used;
-	int nused;
+	unsigned long used = 0;
 	out_val_list *it;
-	const out_val *first;
+	const out_val *victim, *fallback;
 	int i, begin, end;
 
 	/* if the value is in a register, we only need a new register
 	 * if we have other references to it */
 	if(to_replace
 	&& to_replace->retains == 1
+	&& !(to_replace->flags & VAL_FLAG_REGVAR)
 	&& !out_val_is_blockphi(to_replace, NULL)
 	&& to_replace->type == V_REG
 	&& to_replace->bits.regoff.reg.is_float == fp
 	&& !impl_reg_frame_const(&to_replace->bits.regoff.reg, /*sp*/1))
 	{
 		memcpy_safe(out, &to_replace->bits.regoff.reg);
+		if(cc1_fopt.dump_regalloc)
+			v_dump_regalloc(octx, "reuse", out, NULL);
 		return 1;
 	}
 
-	used = v_alloc_reg_reserve(octx, &nused);
-	memcpy(used, octx->reserved_regs, nused * sizeof *used);
-
 	begin = fp ? N_SCRATCH_REGS_I : 0;
-	end = fp ? nused : N_SCRATCH_REGS_I;
-	{
-		int obegin = fp ? 0 : N_SCRATCH_REGS_I;
-		int oend = fp ? N_SCRATCH_REGS_I : nused;
-		for(i = obegin; i < oend; i++)
-			used[i] = 1;
-	}
+	end = fp ? N_SCRATCH_REGS_I + N_SCRATCH_REGS_F : N_SCRATCH_REGS_I;
 
-	first = NULL;
+	for(i = begin; i < end; i++)
+		if(octx->reserved_regs[i])
+			used |= 1ul << i;
 
-	OCTX_ITER_VALS(octx, it){
+	/* the live list only holds retained values. They're consumed in
+	 * roughly LIFO order by the expression walk, so the oldest register
+	 * value has the furthest next use - walk from the tail so that's
+	 * the eviction candidate, preferring it over the value being
+	 * replaced and the current block's phi value */
+	victim = fallback = NULL;
+
+	for(it = octx->val_tail; it; it = it->prev){
 		const out_val *this = &it->val;
-		if(this->retains
-		/*&& !out_val_is_blockphi(this, octx->current_blk)
-		 * we don't want to overwrite phiblock values (so check them in this loop),
-		 * even if we ignore them in other parts of the register liveness code */
-		&& this->type == V_REG
-		&& this->bits.regoff.reg.is_float == fp
-		&& regtest(octx->current_fnty, &this->bits.regoff.reg))
+
+		if(this->type != V_REG
+		|| this->bits.regoff.reg.is_float != fp
+		|| !regtest(octx->current_fnty, &this->bits.regoff.reg))
 		{
-			if(!first)
-				first = this;
-			used[impl_reg_to_idx(&this->bits.regoff.reg)] = 1;
+			continue;
+		}
+
+		/* we don't want to overwrite phiblock values (so mark them here),
+		 * even if we ignore them in other parts of the register liveness code */
+		used |= 1ul << impl_reg_to_idx(&this->bits.regoff.reg);
+
+		if(this->flags & VAL_FLAG_REGVAR)
+			continue; /* its home */
+
+		if(this == to_replace || out_val_is_blockphi(this, octx->current_blk)){
+			if(!fallback)
+				fallback = this;
+		}else if(!victim){
+			victim = this;
 		}
 	}
 
 	for(i = begin; i < end; i++){
-		if(!used[i]){
+		if(!(used & (1ul << i))){
 			/* `i' should be in the `fp' range, since we're going
 			 * from `begin' to `end' */
 			out->is_float = fp;
 			impl_scratch_to_reg(i, out);
 
 			if(regtest(octx->current_fnty, out)){
-				free(used);
+				if(cc1_fopt.dump_regalloc)
+					v_dump_regalloc(octx, "alloc", out, NULL);
 				return 1;
 			}
 		}
 	}
 
-	free(used), used = NULL;
+	if(!victim)
+		victim = fallback;
 
-	if(stack_as_backup){
+	if(stack_as_backup && victim){
 		const out_val *freed;
 
-		/* no free regs, move `first` to the stack and claim its reg */
-		*out = first->bits.regoff.reg;
+		/* no free regs, move `victim` out of the way and claim its reg */
+		*out = victim->bits.regoff.reg;
+
+		if(cc1_fopt.dump_regalloc)
+			v_dump_regalloc(octx, "evict", out, victim);
 
-		freed = v_freeup_regp(octx, first);
+		freed = v_freeup_regp(octx, victim);
 
 		out_val_consume(octx, freed);
 
 		return 1;
 	}
+
+	if(stack_as_backup)
+		ICE("no register to evict");
+
 	return 0;
 }
 
@@ -464,6 +556,8 @@ void v_save_regs(
 			continue;
 		if(v->phiblock)
 			continue; /* phi values are special and don't need to be spilt across jumps */
+		if(v->flags & VAL_FLAG_REGVAR)
+			continue; /* the register is its home, and is callee-save */
 
 		if(v == fnval || val_present(v, ignores)){
 			/* don't save */
@@ -44,6 +44,10 @@ const out_val *v_to_stack_mem(
 const out_val *v_reg_to_stack_mem(
 		out_ctx *octx, struct vreg const *, const out_val *stk);
 
+/* register-resident variables - `regvar' has VAL_FLAG_REGVAR */
+const out_val *v_regvar_load(out_ctx *, const out_val *regvar) ucc_wur;
+void v_regvar_store(out_ctx *, const out_val *regvar, const out_val *val);
+
 /* register saving */
 void v_freeup_reg(out_ctx *, const struct vreg *r);
 
@@ -19,6 +19,7 @@
 #include "val.h"
 #include "ctx.h"
 #include "blk.h"
+#include "insn.h"
 #include "out.h"
 
 #include "../cc1.h" /* cc_out */
@@ -58,7 +59,20 @@ static void add_live_vals(out_ctx *octx)
 	buf = ustrprintf("\t/* live: %s */\n", buf);
 	free(old);
 
-	dynarray_add(&octx->current_blk->insns, buf);
+	insn_add_text(octx->current_blk, buf);
+}
+
+void out_insn(out_ctx *octx, const struct insn *insn)
+{
+	if(!octx->current_blk)
+		return;
+
+	out_dbg_flush(octx);
+
+	if(DUMP_LIVE_VALS)
+		add_live_vals(octx);
+
+	insn_add(octx->current_blk, insn);
 }
 
 void out_asmv(
@@ -72,12 +86,13 @@ void out_asmv(
 
 	out_dbg_flush(octx);
 
-	insn = ustrvprintf(fmt, l);
+	insn = ustrvprintf_tag(UALLOC_INSN, fmt, l);
 
 	if((opts & P_NO_INDENT) == 0
 	|| (opts & P_NO_NL) == 0)
 	{
-		char *new = ustrprintf(
+		char *new = ustrprintf_tag(
+				UALLOC_INSN,
 				"%s%s%s",
 				(opts & P_NO_INDENT) == 0 ? "\t" : "",
 				insn,
@@ -91,7 +106,7 @@ void out_asmv(
 	if((opts & P_NO_LIVEDUMP) == 0 && DUMP_LIVE_VALS)
 		add_live_vals(octx);
 
-	dynarray_add(&octx->current_blk->insns, insn);
+	insn_add_text(octx->current_blk, insn);
 }
 
 void out_asm(out_ctx *octx, const char *fmt, ...)
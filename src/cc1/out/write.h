@@ -6,6 +6,8 @@
 #include "dbg.h"
 #include "asm.h"
 
+struct insn;
+
 enum p_opts
 {
 	P_NO_INDENT = 1 << 0,
@@ -13,6 +15,10 @@ enum p_opts
 	P_NO_LIVEDUMP = 1 << 2,
 };
 
+/* a structured instruction, see insn.h.
+ * out_asm*() lines are kept as text */
+void out_insn(out_ctx *, const struct insn *);
+
 void out_asmv(
 		out_ctx *,
 		enum p_opts opts,
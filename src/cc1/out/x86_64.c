@@ -39,6 +39,7 @@
 
 #include "ctx.h"
 #include "blk.h"
+#include "insn.h"
 
 /* Darwin's `as' can only create movq:s with
  * immediate operands whose highest bit is bit
@@ -54,8 +55,6 @@
 
 #define REG_STR_SZ 8
 
-#define MOV_DEBUG(ch) /* " // " QUOTE(ch) */
-
 static const out_val *pointer_to_GOT(out_ctx *, const out_val *, const struct vreg *, int *hasoffset);
 
 const struct asm_type_table asm_type_table[ASM_TABLE_LEN] = {
@@ -170,29 +169,29 @@ static const struct calling_conv_desc
 	}
 };
 
-static const char *x86_intreg_str(unsigned reg, type *r)
-{
-	static const char *const rnames[][4] = {
+static const char *const x86_intreg_names[][4] = {
 #define REG(x) {  #x "l",  #x "x", "e"#x"x", "r"#x"x" }
-		REG(a), REG(b), REG(c), REG(d),
+	REG(a), REG(b), REG(c), REG(d),
 #undef REG
 
-		{ "dil",  "di", "edi", "rdi" },
-		{ "sil",  "si", "esi", "rsi" },
+	{ "dil",  "di", "edi", "rdi" },
+	{ "sil",  "si", "esi", "rsi" },
 
-		/* r[8 - 15] -> r8b, r8w, r8d,  r8 */
+	/* r[8 - 15] -> r8b, r8w, r8d,  r8 */
 #define REG(x) {  "r" #x "b",  "r" #x "w", "r" #x "d", "r" #x  }
-		REG(8),  REG(9),  REG(10), REG(11),
-		REG(12), REG(13), REG(14), REG(15),
+	REG(8),  REG(9),  REG(10), REG(11),
+	REG(12), REG(13), REG(14), REG(15),
 #undef REG
 
-		{  "bpl", "bp", "ebp", "rbp" },
-		{  "spl", "sp", "esp", "rsp" },
-	};
+	{  "bpl", "bp", "ebp", "rbp" },
+	{  "spl", "sp", "esp", "rsp" },
+};
 
-	UCC_ASSERT(reg < countof(rnames), "invalid x86 int reg %d", reg);
+static const char *x86_intreg_str(unsigned reg, type *r)
+{
+	UCC_ASSERT(reg < countof(x86_intreg_names), "invalid x86 int reg %d", reg);
 
-	return rnames[reg][asm_table_lookup(r)];
+	return x86_intreg_names[reg][asm_table_lookup(r)];
 }
 
 static const char *x86_fpreg_str(unsigned i)
@@ -511,6 +510,299 @@ const char *impl_val_str_r(
 	return buf;
 }
 
+static const char *x86_insn_reg_str(short reg, unsigned sz, char buf[REG_STR_SZ])
+{
+	unsigned j;
+
+	if(reg == X86_INSN_RIP)
+		return "rip";
+
+	if(reg >= X86_INSN_XMM){
+		xsnprintf(buf, REG_STR_SZ, "xmm%d", reg - X86_INSN_XMM);
+		return buf;
+	}
+
+	for(j = 0; (1u << j) < sz; j++);
+	return x86_intreg_names[reg][j];
+}
+
+/* operand builders fill in and return o, for use as x86_insn*() arguments */
+static struct insn_opnd *x86_opnd_new(
+		struct insn_opnd *o, enum insn_opnd_kind kind)
+{
+	memset(o, 0, sizeof *o);
+	o->kind = kind;
+	o->reg = o->idx = INSN_REG_NONE;
+	return o;
+}
+
+static struct insn_opnd *x86_opnd_imm(struct insn_opnd *o, long long n)
+{
+	x86_opnd_new(o, OPND_IMM);
+	o->num = n;
+	return o;
+}
+
+static struct insn_opnd *x86_opnd_xmm(struct insn_opnd *o, unsigned n)
+{
+	x86_opnd_new(o, OPND_REG);
+	o->reg = X86_INSN_XMM + n;
+	o->regsz = 16;
+	return o;
+}
+
+static struct insn_opnd *x86_opnd_reg(
+		struct insn_opnd *o, const struct vreg *reg, type *ty)
+{
+	assert(type_is_floating(ty) == reg->is_float);
+
+	if(reg->is_float)
+		return x86_opnd_xmm(o, reg->idx);
+
+	UCC_ASSERT(reg->idx < countof(x86_intreg_names),
+			"invalid x86 int reg %d", reg->idx);
+
+	x86_opnd_new(o, OPND_REG);
+	o->reg = reg->idx;
+	o->regsz = asm_type_size(ty);
+	return o;
+}
+
+/* (%reg) or off(%reg) */
+static struct insn_opnd *x86_opnd_mem(
+		struct insn_opnd *o, const struct vreg *reg, long off)
+{
+	UCC_ASSERT(!reg->is_float, "dereference float reg");
+
+	x86_opnd_new(o, OPND_MEM);
+	o->reg = reg->idx;
+	o->regsz = 8;
+	o->num = off;
+	return o;
+}
+
+/* branch target or symbol, e.g. call foo@PLT */
+static struct insn_opnd *x86_opnd_sym(
+		struct insn_opnd *o, const char *sym, enum insn_reloc reloc)
+{
+	x86_opnd_new(o, OPND_SYM);
+	o->sym = insn_intern(sym, strlen(sym));
+	o->reloc = reloc;
+	return o;
+}
+
+/* the structured form of impl_val_str_r() */
+static struct insn_opnd *x86_opnd_val(
+		struct insn_opnd *o, const out_val *vs, const int deref)
+{
+	switch(vs->type){
+		case V_CONST_I:
+		{
+			integral_t v = vs->bits.val_i;
+			int is_signed = type_is_signed(vs->t);
+
+			UCC_ASSERT(integral_high_bit(vs->bits.val_i, vs->t) < AS_MAX_MOV_BIT,
+					"can't load 64-bit constants here (0x%llx)", vs->bits.val_i);
+
+			if(vs->t){
+				sintegral_t sv;
+				v = integral_truncate(v, type_size(vs->t, NULL), &sv);
+				if(is_signed)
+					v = sv;
+			}
+
+			/* a dereferenced constant is an absolute address */
+			x86_opnd_new(o, deref ? OPND_SYM : OPND_IMM);
+			o->num = v;
+			o->is_unsigned = !is_signed;
+			return o;
+		}
+
+		case V_CONST_F:
+			ICE("can't stringify float here");
+
+		case V_FLAG:
+			ICE("%s shouldn't be called with cmp-flag data", __func__);
+
+		case V_LBL:
+			if(deref && !strncmp(vs->bits.lbl.str, "%fs:", 4)){
+				/* stack_protector.c's canary slot, %fs:40 */
+				x86_opnd_new(o, OPND_SYM);
+				o->seg = X86_INSN_SEG_FS;
+				o->num = strtol(vs->bits.lbl.str + 4, NULL, 0) + vs->bits.lbl.offset;
+				return o;
+			}
+
+			if(!deref){
+				x86_opnd_new(o, OPND_IMM);
+			}else if(vs->bits.lbl.pic_type & OUT_LBL_PIC){
+				/* see impl_val_str_r() */
+				x86_opnd_new(o, OPND_MEM);
+				o->reg = X86_INSN_RIP;
+				o->regsz = 8;
+				if(!(vs->bits.lbl.pic_type & OUT_LBL_PICLOCAL))
+					o->reloc = INSN_RELOC_GOTPCREL;
+			}else{
+				x86_opnd_new(o, OPND_SYM);
+			}
+			o->sym = insn_intern(vs->bits.lbl.str, strlen(vs->bits.lbl.str));
+			o->num = vs->bits.lbl.offset;
+			return o;
+
+		case V_REG:
+		case V_REGOFF:
+		case V_SPILT:
+			if(deref || vs->bits.regoff.offset)
+				return x86_opnd_mem(o, &vs->bits.regoff.reg, vs->bits.regoff.offset);
+			return x86_opnd_reg(o, &vs->bits.regoff.reg, vs->t);
+	}
+
+	ucc_unreach(o);
+}
+
+/* interned mnemonic */
+static const char *ucc_printflike(1, 2)
+	x86_op(const char *fmt, ...)
+{
+	char buf[32];
+	va_list l;
+	int len;
+
+	va_start(l, fmt);
+	len = vsnprintf(buf, sizeof buf, fmt, l);
+	va_end(l);
+
+	assert((size_t)len < sizeof buf);
+	return insn_intern(buf, len);
+}
+
+static void x86_insn(
+		out_ctx *octx, const char *op, unsigned n,
+		const struct insn_opnd *a,
+		const struct insn_opnd *b,
+		const struct insn_opnd *c)
+{
+	struct insn insn;
+
+	memset(&insn, 0, sizeof insn);
+	insn.op = op;
+	insn.nopnds = n;
+	if(a) insn.bits.opnds[0] = *a;
+	if(b) insn.bits.opnds[1] = *b;
+	if(c) insn.bits.opnds[2] = *c;
+
+	out_insn(octx, &insn);
+}
+
+static void x86_insn0(out_ctx *octx, const char *op)
+{
+	x86_insn(octx, op, 0, NULL, NULL, NULL);
+}
+
+static void x86_insn1(
+		out_ctx *octx, const char *op,
+		const struct insn_opnd *a)
+{
+	x86_insn(octx, op, 1, a, NULL, NULL);
+}
+
+static void x86_insn2(
+		out_ctx *octx, const char *op,
+		const struct insn_opnd *a,
+		const struct insn_opnd *b)
+{
+	x86_insn(octx, op, 2, a, b, NULL);
+}
+
+static void x86_insn3(
+		out_ctx *octx, const char *op,
+		const struct insn_opnd *a,
+		const struct insn_opnd *b,
+		const struct insn_opnd *c)
+{
+	x86_insn(octx, op, 3, a, b, c);
+}
+
+static const char *const x86_relocs[] = {
+	NULL, "PLT", "GOTPCREL", "tpoff", "gottpoff"
+};
+
+#define INSN_APPEND(...) \
+	len += snprintf(buf + (len < n ? len : n), len < n ? n - len : 0, __VA_ARGS__)
+
+static int x86_insn_opnd_str(const struct insn_opnd *o, char *buf, size_t n)
+{
+	char rbuf[REG_STR_SZ];
+	size_t len = 0;
+
+	INSN_APPEND("%s", o->indirect ? "*" : "");
+
+	switch((enum insn_opnd_kind)o->kind){
+		case OPND_NONE:
+			assert(0 && "empty operand");
+
+		case OPND_REG:
+			INSN_APPEND("%%%s", x86_insn_reg_str(o->reg, o->regsz, rbuf));
+			break;
+
+		case OPND_IMM:
+			if(o->sym)
+				INSN_APPEND("$%s", o->sym);
+			if(!o->sym)
+				INSN_APPEND(o->is_unsigned ? "$%llu" : "$%lld", o->num);
+			else if(o->num)
+				INSN_APPEND("%+lld", o->num);
+			break;
+
+		case OPND_MEM:
+		case OPND_SYM:
+			if(o->seg == X86_INSN_SEG_FS)
+				INSN_APPEND("%%fs:");
+			if(o->sym){
+				INSN_APPEND("%s", o->sym);
+				if(o->num)
+					INSN_APPEND("%+lld", o->num);
+			}else if(o->num || o->kind == OPND_SYM){
+				INSN_APPEND(o->is_unsigned ? "%llu" : "%lld", o->num);
+			}
+			if(o->reloc)
+				INSN_APPEND("@%s", x86_relocs[o->reloc]);
+
+			if(o->kind == OPND_SYM)
+				break;
+
+			INSN_APPEND("(");
+			if(o->reg != INSN_REG_NONE)
+				INSN_APPEND("%%%s", x86_insn_reg_str(o->reg, 8, rbuf));
+			if(o->idx != INSN_REG_NONE)
+				INSN_APPEND(",%%%s", x86_insn_reg_str(o->idx, 8, rbuf));
+			if(o->scale)
+				INSN_APPEND(",%u", o->scale);
+			INSN_APPEND(")");
+			break;
+	}
+
+	return len;
+}
+
+int impl_insn_str(const struct insn *i, char *buf, size_t n)
+{
+	size_t len = 0;
+	unsigned k;
+
+	INSN_APPEND("%s", i->op);
+
+	for(k = 0; k < i->nopnds; k++){
+		INSN_APPEND("%s", k ? ", " : " ");
+		len += x86_insn_opnd_str(&i->bits.opnds[k],
+				buf + (len < n ? len : n), len < n ? n - len : 0);
+	}
+
+	return len;
+}
+
+#undef INSN_APPEND
+
 int impl_reg_to_idx(const struct vreg *r)
 {
 	return r->idx + (r->is_float ? N_SCRATCH_REGS_I : 0);
@@ -582,6 +874,39 @@ int impl_reg_is_scratch(type *fnty, const struct vreg *r)
 	return r->is_float || !impl_reg_is_callee_save(fnty, r);
 }
 
+const char *impl_reg_str(const struct vreg *r)
+{
+	return x86_reg_str(r,
+			r->is_float ? type_nav_btype(cc1_type_nav, type_double) : NULL);
+}
+
+int impl_reg_to_dwarf(const struct vreg *r)
+{
+	static const unsigned char dwarf_regs[] = {
+		[X86_64_REG_RAX] = 0,
+		[X86_64_REG_RDX] = 1,
+		[X86_64_REG_RCX] = 2,
+		[X86_64_REG_RBX] = 3,
+		[X86_64_REG_RSI] = 4,
+		[X86_64_REG_RDI] = 5,
+		[X86_64_REG_RBP] = 6,
+		[X86_64_REG_RSP] = 7,
+		[X86_64_REG_R8] = 8,
+		[X86_64_REG_R9] = 9,
+		[X86_64_REG_R10] = 10,
+		[X86_64_REG_R11] = 11,
+		[X86_64_REG_R12] = 12,
+		[X86_64_REG_R13] = 13,
+		[X86_64_REG_R14] = 14,
+		[X86_64_REG_R15] = 15,
+	};
+
+	if(r->is_float)
+		return 17 + r->idx; /* xmm0 */
+
+	return dwarf_regs[r->idx];
+}
+
 int impl_reg_savable(const struct vreg *r)
 {
 	if(r->is_float)
@@ -596,8 +921,14 @@ int impl_reg_savable(const struct vreg *r)
 
 void impl_func_prologue_save_fp(out_ctx *octx)
 {
-	out_asm(octx, "pushq %%rbp");
-	out_asm(octx, "movq %%rsp, %%rbp");
+	const struct vreg rbp = VREG_INIT(X86_64_REG_RBP, 0);
+	const struct vreg rsp = VREG_INIT(X86_64_REG_RSP, 0);
+	struct insn_opnd opnd[2];
+
+	x86_insn1(octx, x86_op("pushq"), x86_opnd_reg(&opnd[0], &rbp, NULL));
+	x86_insn2(octx, x86_op("movq"),
+			x86_opnd_reg(&opnd[0], &rsp, NULL),
+			x86_opnd_reg(&opnd[1], &rbp, NULL));
 	/* a v_alloc_stack_n() is done later to align,
 	 * but not interfere with argument locations */
 }
@@ -813,21 +1144,32 @@ void impl_func_prologue_save_variadic(out_ctx *octx, type *rf)
 	out_adealloc(octx, &stk_spill);
 }
 
-void impl_func_epilogue(out_ctx *octx, type *rf, int clean_stack)
+void impl_func_epilogue(
+		out_ctx *octx, type *rf, int clean_stack,
+		const char *sibling_jmp)
 {
+	struct insn_opnd opnd[1];
+
 	if(clean_stack)
-		out_asm(octx, "leaveq");
+		x86_insn0(octx, x86_op("leaveq"));
 
 	if(cc1_fopt.verbose_asm)
 		out_comment(octx, "stack at %lu bytes", octx->cur_stack_sz);
 
+	if(sibling_jmp){
+		/* same convention as us, checked by impl_call_sibling() */
+		out_asm(octx, "jmp %s", sibling_jmp);
+		return;
+	}
+
 	/* callee cleanup */
 	if(!x86_caller_cleanup(rf)){
 		const int nargs = x86_func_nargs(rf);
 
-		out_asm(octx, "retq $%d", nargs * platform_word_size());
+		x86_insn1(octx, x86_op("retq"),
+				x86_opnd_imm(&opnd[0], nargs * platform_word_size()));
 	}else{
-		out_asm(octx, "retq");
+		x86_insn0(octx, x86_op("retq"));
 	}
 }
 
@@ -936,13 +1278,12 @@ static const out_val *x86_load_iv(
 {
 	const int high_bit = integral_high_bit(from->bits.val_i, from->t);
 	struct vreg r;
+	struct insn_opnd opnd[2];
 
 	assert(from->type == V_CONST_I);
 	assert(!type_is_floating(from->t));
 
 	if(high_bit >= AS_MAX_MOV_BIT){
-		char buf[INTEGRAL_BUF_SIZ];
-
 		if(!reg){
 			reg = &r;
 			v_unused_reg(octx, 1, 0, &r, /*from isn't a reg:*/NULL);
@@ -960,17 +1301,17 @@ static const out_val *x86_load_iv(
 			}
 		}
 
-		integral_str(buf, sizeof buf, from->bits.val_i, NULL);
-
-		out_asm(octx, "movabsq $%s, %%%s", buf, x86_reg_str(reg, NULL));
+		x86_opnd_imm(&opnd[0], from->bits.val_i)->is_unsigned = 1;
+		x86_insn2(octx, x86_op("movabsq"),
+				&opnd[0],
+				x86_opnd_reg(&opnd[1], reg, NULL));
 	}else{
 		if(!reg)
 			return from; /* V_CONST_I is fine */
 
-		out_asm(octx, "mov%s %s, %%%s" MOV_DEBUG(A),
-				x86_suffix(from->t),
-				impl_val_str(from, 0),
-				x86_reg_str(reg, from->t));
+		x86_insn2(octx, x86_op("mov%s", x86_suffix(from->t)),
+				x86_opnd_val(&opnd[0], from, 0),
+				x86_opnd_reg(&opnd[1], reg, from->t));
 	}
 
 	return v_new_reg(octx, from, from->t, reg);
@@ -978,6 +1319,8 @@ static const out_val *x86_load_iv(
 
 static const out_val *x86_load_fp(out_ctx *octx, const out_val *from)
 {
+	struct insn_opnd opnd[2];
+
 	switch(from->type){
 		case V_CONST_I:
 			/* CONST_I shouldn't be entered,
@@ -989,12 +1332,12 @@ static const out_val *x86_load_fp(out_ctx *octx, const out_val *from)
 				type *const ty_fp = from->t;
 				out_val *mut = v_dup_or_reuse(octx, from, from->t);
 				struct vreg r;
-				const char *rstr;
 
 				v_unused_reg(octx, 1, 1, &r, NULL);
-				rstr = x86_reg_str(&r, ty_fp);
 
-				out_asm(octx, "xorp%c %%%s, %%%s", x86_suffix(ty_fp)[1], rstr, rstr);
+				x86_insn2(octx, x86_op("xorp%c", x86_suffix(ty_fp)[1]),
+						x86_opnd_reg(&opnd[0], &r, ty_fp),
+						x86_opnd_reg(&opnd[1], &r, ty_fp));
 				/* "fldz" */
 
 				return v_new_reg(octx, mut, ty_fp, &r);
@@ -1098,6 +1441,8 @@ const out_val *impl_load(
 		const out_val *from,
 		const struct vreg *reg)
 {
+	struct insn_opnd opnd[2];
+
 	if(from->type == V_REG
 	&& vreg_eq(reg, &from->bits.regoff.reg))
 	{
@@ -1109,12 +1454,9 @@ const out_val *impl_load(
 		{
 			type *int_ty = type_nav_btype(cc1_type_nav, type_int);
 			type *char_ty = type_nav_btype(cc1_type_nav, type_nchar);
-			const char *rstr;
 			int flip_parity_ret;
 			int chk_parity;
 
-			rstr = x86_reg_str(reg, char_ty);
-
 			/* check float/orderedness */
 			chk_parity = x86_need_fp_parity_p(&from->bits.flag, &flip_parity_ret);
 
@@ -1126,27 +1468,25 @@ const out_val *impl_load(
 						reg));
 
 			/* actual cmp */
-			out_asm(octx, "set%s %%%s", x86_cmp(&from->bits.flag), rstr);
+			x86_insn1(octx, x86_op("set%s", x86_cmp(&from->bits.flag)),
+					x86_opnd_reg(&opnd[0], reg, char_ty));
 
 			if(chk_parity){
 				struct vreg parity_reg;
-				const char *parity_rstr;
 
 				v_reserve_reg(octx, reg);
 				v_unused_reg(octx, 1, 0, &parity_reg, NULL);
 				v_unreserve_reg(octx, reg);
 
-				parity_rstr = x86_reg_str(&parity_reg, char_ty);
+				x86_insn1(octx, x86_op("set%sp", flip_parity_ret ? "" : "n"),
+						x86_opnd_reg(&opnd[0], &parity_reg, char_ty));
 
-				out_asm(octx, "set%sp %%%s",
-						flip_parity_ret ? "" : "n",
-						parity_rstr);
+				x86_insn2(octx, x86_op("%sb", flip_parity_ret ? "or" : "and"),
+						x86_opnd_reg(&opnd[0], &parity_reg, char_ty),
+						x86_opnd_reg(&opnd[1], reg, char_ty));
 
-				out_asm(octx, "%sb %%%s, %%%s",
-						flip_parity_ret ? "or" : "and",
-						parity_rstr, rstr);
-
-				out_asm(octx, "andb $1, %%%s", rstr);
+				x86_insn2(octx, x86_op("andb"),
+						x86_opnd_imm(&opnd[0], 1), x86_opnd_reg(&opnd[1], reg, char_ty));
 			}
 
 			if(type_size(from->t, NULL) != type_size(char_ty, NULL)){
@@ -1166,6 +1506,10 @@ const out_val *impl_load(
 			return impl_deref(octx, from, reg, NULL);
 
 		case V_REG:
+			if(from->bits.regoff.offset != (int)from->bits.regoff.offset){
+				/* too large for a displacement */
+				from = v_reg_apply_offset(octx, from);
+			}
 			if(from->bits.regoff.offset == 0){
 				/* optimisation: */
 				impl_reg_cp_no_off(octx, from, reg);
@@ -1205,11 +1549,9 @@ lea:
 			}
 
 			/* just go with leaq for small sizes */
-			out_asm(octx, "%s%s %s, %%%s" MOV_DEBUG(B),
-					fp ? "mov" : "lea",
-					x86_suffix(NULL),
-					impl_val_str(from_new, 1),
-					x86_reg_str(reg, from_GOT ? NULL : chosen_ty));
+			x86_insn2(octx, x86_op("%s%s", fp ? "mov" : "lea", x86_suffix(NULL)),
+					x86_opnd_val(&opnd[0], from_new, 1),
+					x86_opnd_reg(&opnd[1], reg, from_GOT ? NULL : chosen_ty));
 
 			return v_new_reg(octx, from_new, from_new->t, reg);
 		}
@@ -1240,7 +1582,7 @@ static const out_val *x86_check_ivfp(out_ctx *octx, const out_val *from)
 
 void impl_store(out_ctx *octx, const out_val *to, const out_val *from)
 {
-	char vbuf[VAL_STR_SZ];
+	struct insn_opnd opnd[2];
 
 	/* from must be either a reg, value or flag */
 	if(from->type == V_FLAG
@@ -1296,10 +1638,9 @@ void impl_store(out_ctx *octx, const out_val *to, const out_val *from)
 		to = gotslot;
 	}
 
-	out_asm(octx, "mov%s %s, %s" MOV_DEBUG(C),
-			x86_suffix(from->t),
-			impl_val_str_r(vbuf, from, 0),
-			impl_val_str(to, 1));
+	x86_insn2(octx, x86_op("mov%s", x86_suffix(from->t)),
+			x86_opnd_val(&opnd[0], from, 0),
+			x86_opnd_val(&opnd[1], to, 1));
 
 	out_val_consume(octx, from);
 	out_val_consume(octx, to);
@@ -1311,15 +1652,16 @@ static void x86_reg_cp(
 		const struct vreg *from,
 		type *typ)
 {
+	struct insn_opnd opnd[2];
+
 	assert(!impl_reg_frame_const(to, /*disallow sp: alloca_pop needs this*/0));
 
 	if(vreg_eq(to, from))
 		return;
 
-	out_asm(octx, "mov%s %%%s, %%%s" MOV_DEBUG(D),
-			x86_suffix(typ),
-			x86_reg_str(from, typ),
-			x86_reg_str(to, typ));
+	x86_insn2(octx, x86_op("mov%s", x86_suffix(typ)),
+			x86_opnd_reg(&opnd[0], from, typ),
+			x86_opnd_reg(&opnd[1], to, typ));
 }
 
 void impl_reg_cp_no_off(
@@ -1348,6 +1690,7 @@ static const out_val *x86_idiv(
 	const struct vreg rdx = { X86_64_REG_RDX, 0 };
 	const struct vreg rax = { X86_64_REG_RAX, 0 };
 	struct vreg result;
+	struct insn_opnd opnd[1];
 
 	/* freeup rdx. rax is freed as below: */
 	v_freeup_reg(octx, &rdx);
@@ -1387,7 +1730,7 @@ static const out_val *x86_idiv(
 					ext = "cqto";
 					break;
 			}
-			out_asm(octx, "%s", ext);
+			x86_insn0(octx, x86_op("%s", ext));
 		}else{
 			/* unsigned - don't sign extend into rdx:
 			 * mov $0, %rdx */
@@ -1396,9 +1739,11 @@ static const out_val *x86_idiv(
 						octx, out_new_zero(octx, r->t), &rdx));
 		}
 
-		out_asm(octx, "idiv%s %s",
-				x86_suffix(r->t),
-				impl_val_str(r, 0));
+		x86_insn1(octx,
+				x86_op("%s%s",
+					type_is_signed(r->t) ? "idiv" : "div",
+					x86_suffix(r->t)),
+				x86_opnd_val(&opnd[0], r, 0));
 
 	}
 	v_unreserve_reg(octx, &rdx);
@@ -1413,12 +1758,93 @@ static const out_val *x86_idiv(
 	return v_new_reg(octx, l, l->t, &result);
 }
 
+/* a plain register, loaded without touching the flags (mov/lea only) */
+static const out_val *x86_select_reg(
+		out_ctx *octx, const out_val *v, int writable)
+{
+	struct vreg r;
+
+	if(v->type == V_REG
+	&& !v->bits.regoff.offset
+	&& !v_is_const_reg(v)
+	&& (!writable || (v->retains == 1 && !(v->flags & VAL_FLAG_REGVAR))))
+	{
+		return v;
+	}
+
+	v_unused_reg(octx, 1, 0, &r, NULL);
+	return v_to_reg_given(octx, v, &r);
+}
+
+const out_val *impl_select(
+		out_ctx *octx, const out_val *cond,
+		const out_val *vtrue, const out_val *vfalse)
+{
+	type *ty = vfalse->t;
+	int flip;
+	struct insn_opnd opnd[2];
+
+	/* cmov has no byte form */
+	if(type_size(ty, NULL) < 2)
+		return NULL;
+
+	if(x86_need_fp_parity_p(&cond->bits.flag, &flip)){
+		/* fold the parity check into an integer */
+		cond = v_to_reg(octx, cond);
+		cond = impl_op(octx, op_ne, cond, out_new_zero(octx, cond->t));
+	}
+
+	vtrue = x86_select_reg(octx, vtrue, 0);
+	vfalse = x86_select_reg(octx, vfalse, 1);
+
+	x86_insn2(octx, x86_op("cmov%s", x86_cmp(&cond->bits.flag)),
+			x86_opnd_val(&opnd[0], vtrue, 0),
+			x86_opnd_val(&opnd[1], vfalse, 0));
+
+	out_val_consume(octx, cond);
+	out_val_consume(octx, vtrue);
+	return vfalse;
+}
+
+const out_val *impl_mulhi(
+		out_ctx *octx, const out_val *l, const out_val *r)
+{
+	/* one-operand [i]mul: rdx:rax = rax * r/m */
+	const struct vreg rdx = { X86_64_REG_RDX, 0 };
+	const struct vreg rax = { X86_64_REG_RAX, 0 };
+	struct vreg result;
+	struct insn_opnd opnd[1];
+
+	v_freeup_reg(octx, &rdx);
+	v_reserve_reg(octx, &rdx);
+	{
+		l = v_to_reg_given_freeup_no_off(octx, l, &rax);
+		l = v_reg_apply_offset(octx, l);
+
+		r = v_to(octx, r, TO_REG | TO_MEM);
+
+		x86_insn1(octx,
+				x86_op("%s%s",
+					type_is_signed(l->t) ? "imul" : "mul",
+					x86_suffix(l->t)),
+				x86_opnd_val(&opnd[0], r, 0));
+	}
+	v_unreserve_reg(octx, &rdx);
+
+	out_val_release(octx, r);
+
+	result.idx = X86_64_REG_RDX;
+	result.is_float = 0;
+
+	return v_new_reg(octx, l, l->t, &result);
+}
+
 static const out_val *x86_shift(
 		out_ctx *octx, enum op_type op,
 		const out_val *l, const out_val *r)
 {
-	char bufv[VAL_STR_SZ], bufs[VAL_STR_SZ];
 	type *nchar;
+	struct insn_opnd opnd[2];
 
 	/* sh[lr] [r/m], [c/r]
 	 * where            ^ must be %cl
@@ -1440,15 +1866,14 @@ static const out_val *x86_shift(
 
 	l = v_to(octx, l, TO_MEM | TO_REG);
 
-	impl_val_str_r(bufv, l, 0);
-	impl_val_str_r(bufs, r, 0);
-
-	out_asm(octx, "%s%s %s, %s",
-			op == op_shiftl
-				? "shl"
-				: type_is_signed(l->t) ? "sar" : "shr",
-			x86_suffix(l->t),
-			bufs, bufv);
+	x86_insn2(octx,
+			x86_op("%s%s",
+				op == op_shiftl
+					? "shl"
+					: type_is_signed(l->t) ? "sar" : "shr",
+				x86_suffix(l->t)),
+			x86_opnd_val(&opnd[0], r, 0),
+			x86_opnd_val(&opnd[1], l, 0));
 
 	out_val_consume(octx, r);
 	return v_dup_or_reuse(octx, l, l->t);
@@ -1487,6 +1912,7 @@ static void maybe_promote(out_ctx *octx, const out_val **pl, const out_val **pr)
 const out_val *impl_op(out_ctx *octx, enum op_type op, const out_val *l, const out_val *r)
 {
 	const char *opc;
+	struct insn_opnd opnd[2];
 
 	l = x86_check_ivfp(octx, l);
 	r = x86_check_ivfp(octx, r);
@@ -1494,15 +1920,12 @@ const out_val *impl_op(out_ctx *octx, enum op_type op, const out_val *l, const o
 	if(type_is_floating(v_get_type(l))){
 		if(op_is_comparison(op)){
 			/* ucomi%s reg_or_mem, reg */
-			char b1[VAL_STR_SZ], b2[VAL_STR_SZ];
-
 			l = v_to(octx, l, TO_REG | TO_MEM);
 			r = v_to_reg(octx, r);
 
-			out_asm(octx, "ucomi%s %s, %s",
-					x86_suffix(l->t),
-					impl_val_str_r(b1, r, 0),
-					impl_val_str_r(b2, l, 0));
+			x86_insn2(octx, x86_op("ucomi%s", x86_suffix(l->t)),
+					x86_opnd_val(&opnd[0], r, 0),
+					x86_opnd_val(&opnd[1], l, 0));
 
 			/* not flag_mod_signed - we want seta, not setgt */
 			return v_new_flag(
@@ -1541,17 +1964,12 @@ const out_val *impl_op(out_ctx *octx, enum op_type op, const out_val *l, const o
 		l = v_to(octx, l, TO_REG);
 		r = v_to(octx, r, TO_REG | TO_MEM);
 
-		{
-			char b1[VAL_STR_SZ], b2[VAL_STR_SZ];
-
-			out_asm(octx, "%s%s %s, %s",
-					opc, x86_suffix(l->t),
-					impl_val_str_r(b1, r, 0),
-					impl_val_str_r(b2, l, 0));
+		x86_insn2(octx, x86_op("%s%s", opc, x86_suffix(l->t)),
+				x86_opnd_val(&opnd[0], r, 0),
+				x86_opnd_val(&opnd[1], l, 0));
 
-			out_val_consume(octx, r);
-			return v_dup_or_reuse(octx, l, l->t);
-		}
+		out_val_consume(octx, r);
+		return v_dup_or_reuse(octx, l, l->t);
 	}
 
 	switch(op){
@@ -1591,7 +2009,6 @@ const out_val *impl_op(out_ctx *octx, enum op_type op, const out_val *l, const o
 					"float cmp should be handled above");
 		{
 			const int is_signed = type_is_signed(l->t);
-			char buf[VAL_STR_SZ];
 			int inv = 0;
 			const out_val *vconst = NULL;
 			enum flag_cmp cmp;
@@ -1609,8 +2026,9 @@ const out_val *impl_op(out_ctx *octx, enum op_type op, const out_val *l, const o
 			&& vconst && vconst->bits.val_i == 0)
 			{
 				const out_val *vother = vconst == l ? r : l;
-				const char *vstr = impl_val_str(vother, 0); /* reg */
-				out_asm(octx, "test%s %s, %s", x86_suffix(vother->t), vstr, vstr);
+				x86_opnd_val(&opnd[0], vother, 0); /* reg */
+				x86_insn2(octx, x86_op("test%s", x86_suffix(vother->t)),
+						&opnd[0], &opnd[0]);
 			}else{
 				/* if we have a const, it must be the first arg */
 				if(l->type == V_CONST_I){
@@ -1625,10 +2043,11 @@ const out_val *impl_op(out_ctx *octx, enum op_type op, const out_val *l, const o
 
 				maybe_promote(octx, &l, &r);
 
-				out_asm(octx, "cmp%s %s, %s",
-						x86_suffix(l->t), /* pick the non-const one (for type-ing) */
-						impl_val_str(r, 0),
-						impl_val_str_r(buf, l, 0));
+				x86_insn2(octx,
+						/* pick the non-const one (for type-ing) */
+						x86_op("cmp%s", x86_suffix(l->t)),
+						x86_opnd_val(&opnd[0], r, 0),
+						x86_opnd_val(&opnd[1], l, 0));
 			}
 
 			cmp = op_to_flag(op);
@@ -1657,7 +2076,6 @@ const out_val *impl_op(out_ctx *octx, enum op_type op, const out_val *l, const o
 	}
 
 	{
-		char buf[VAL_STR_SZ];
 		type *ret_ty;
 
 		/* RHS    LHS
@@ -1752,19 +2170,19 @@ const out_val *impl_op(out_ctx *octx, enum op_type op, const out_val *l, const o
 				&& r->bits.val_i == 1
 				&& l->type == V_REG)
 				{
-					out_asm(octx, "%s%s %s",
-							op == op_plus ? "inc" : "dec",
-							x86_suffix(r->t),
-							impl_val_str(l, 0));
+					x86_insn1(octx,
+							x86_op("%s%s",
+								op == op_plus ? "inc" : "dec",
+								x86_suffix(r->t)),
+							x86_opnd_val(&opnd[0], l, 0));
 					break;
 				}
 			default:
 				/* NOTE: lhs and rhs are switched for AT&T syntax,
 				 * we still use lhs for the v_dup_or_reuse() below */
-				out_asm(octx, "%s%s %s, %s", opc,
-						x86_suffix(l->t),
-						impl_val_str_r(buf, r, 0),
-						impl_val_str(l, 0));
+				x86_insn2(octx, x86_op("%s%s", opc, x86_suffix(l->t)),
+						x86_opnd_val(&opnd[0], r, 0),
+						x86_opnd_val(&opnd[1], l, 0));
 		}
 
 		ret_ty = l->t;
@@ -1782,6 +2200,7 @@ static const out_val *pointer_to_GOT(
 	long offset;
 	out_val *gotslot;
 	struct vreg gotreg;
+	struct insn_opnd opnd[2];
 
 	assert(vp->type == V_LBL);
 
@@ -1799,10 +2218,9 @@ static const out_val *pointer_to_GOT(
 	if(hasoffset)
 		*hasoffset = offset != 0;
 
-	out_asm(octx, "mov%s %s, %%%s" MOV_DEBUG(E),
-			x86_suffix(NULL),
-			impl_val_str(vp, 1),
-			x86_reg_str(&gotreg, NULL));
+	x86_insn2(octx, x86_op("mov%s", x86_suffix(NULL)),
+			x86_opnd_val(&opnd[0], vp, 1),
+			x86_opnd_reg(&opnd[1], &gotreg, NULL));
 
 	gotslot = v_new_reg(octx, vp, vp->t, &gotreg);
 	if(offset){
@@ -1820,6 +2238,7 @@ const out_val *impl_deref(
 {
 	type *tpointed_to = type_dereference_decay(vp->t);
 	const int via_GOT = v_needs_GOT(vp);
+	struct insn_opnd opnd[2];
 
 	if(via_GOT){
 		const out_val *gotslot = pointer_to_GOT(octx, vp, NULL, NULL);
@@ -1829,10 +2248,9 @@ const out_val *impl_deref(
 		return out_deref(octx, gotslot);
 	}
 
-	out_asm(octx, "mov%s %s, %%%s" MOV_DEBUG(F),
-			x86_suffix(tpointed_to),
-			impl_val_str(vp, 1),
-			x86_reg_str(reg, tpointed_to));
+	x86_insn2(octx, x86_op("mov%s", x86_suffix(tpointed_to)),
+			x86_opnd_val(&opnd[0], vp, 1),
+			x86_opnd_reg(&opnd[1], reg, tpointed_to));
 
 	if(done_out_deref)
 		*done_out_deref = 0;
@@ -1843,6 +2261,7 @@ const out_val *impl_deref(
 const out_val *impl_op_unary(out_ctx *octx, enum op_type op, const out_val *val)
 {
 	const char *opc;
+	struct insn_opnd opnd[1];
 
 	switch(op){
 		default:
@@ -1875,9 +2294,8 @@ const out_val *impl_op_unary(out_ctx *octx, enum op_type op, const out_val *val)
 
 	val = v_to(octx, val, TO_REG | TO_MEM);
 
-	out_asm(octx, "%s%s %s", opc,
-			x86_suffix(val->t),
-			impl_val_str(val, 0));
+	x86_insn1(octx, x86_op("%s%s", opc, x86_suffix(val->t)),
+			x86_opnd_val(&opnd[0], val, 0));
 
 	return v_dup_or_reuse(octx, val, val->t);
 }
@@ -1888,7 +2306,7 @@ const out_val *impl_cast_load(
 		int is_signed)
 {
 	/* we are always up-casting here, i.e. int -> long */
-	char buf_small[VAL_STR_SZ];
+	struct insn_opnd from, to;
 
 	UCC_ASSERT(!type_is_floating(small) && !type_is_floating(big),
 			"we don't cast-load floats");
@@ -1904,9 +2322,7 @@ const out_val *impl_cast_load(
 		case V_FLAG:
 			vp = v_to_reg(octx, vp);
 		case V_REG:
-			snprintf(buf_small, sizeof buf_small,
-					"%%%s",
-					x86_reg_str(&vp->bits.regoff.reg, small));
+			x86_opnd_reg(&from, &vp->bits.regoff.reg, small);
 	}
 
 	{
@@ -1926,17 +2342,18 @@ const out_val *impl_cast_load(
 
 		if(!is_signed && *suffix_big == 'q' && *suffix_small == 'l'){
 			out_comment(octx, "movzlq:");
-			out_asm(octx, "movl %s, %%%s",
-					buf_small,
-					x86_reg_str(&r, small));
+			x86_insn2(octx, x86_op("movl"),
+					&from,
+					x86_opnd_reg(&to, &r, small));
 
 		}else{
-			out_asm(octx, "mov%c%s%s %s, %%%s",
-					"zs"[is_signed],
-					suffix_small,
-					suffix_big,
-					buf_small,
-					x86_reg_str(&r, big));
+			x86_insn2(octx,
+					x86_op("mov%c%s%s",
+						"zs"[is_signed],
+						suffix_small,
+						suffix_big),
+					&from,
+					x86_opnd_reg(&to, &r, big));
 		}
 
 		vp_mut->t = big;
@@ -1952,9 +2369,9 @@ static const out_val *x86_fp_conv_signed(
 		type *int_ty,
 		const char *sfrom, const char *sto)
 {
-	char vbuf[VAL_STR_SZ];
 	const int to_integral = type_is_integral(tto);
 	const int truncate = to_integral;
+	struct insn_opnd opnd[2];
 
 	switch(vp->type){
 		case V_CONST_F:
@@ -1971,15 +2388,16 @@ static const out_val *x86_fp_conv_signed(
 			break;
 	}
 
-	out_asm(octx, "cvt%s%s2%s%s %s, %%%s",
-			truncate ? "t" : "",
-			sfrom, sto,
-			/* if we're doing an int-float conversion,
-			 * see if we need to do 64 or 32 bit
-			 */
-			int_ty ? type_size(int_ty, NULL) == 8 ? "q" : "l" : "",
-			impl_val_str_r(vbuf, vp, vp->type == V_REGOFF),
-			x86_reg_str(r, tto));
+	x86_insn2(octx,
+			x86_op("cvt%s%s2%s%s",
+				truncate ? "t" : "",
+				sfrom, sto,
+				/* if we're doing an int-float conversion,
+				 * see if we need to do 64 or 32 bit
+				 */
+				int_ty ? type_size(int_ty, NULL) == 8 ? "q" : "l" : ""),
+			x86_opnd_val(&opnd[0], vp, vp->type == V_REGOFF),
+			x86_opnd_reg(&opnd[1], r, tto));
 
 	return v_new_reg(octx, vp, tto, r);
 }
@@ -2159,16 +2577,11 @@ const out_val *impl_f2f(out_ctx *octx, const out_val *vp, type *from, type *to)
 			x86_suffix(to));
 }
 
-static char *x86_call_jmp_target(
+static struct insn_opnd *x86_call_jmp_target(
 		out_ctx *octx, const out_val **pvp,
 		int prevent_rax,
-		int *const use_plt, int *const is_alloc)
+		struct insn_opnd *o)
 {
-	static char buf[VAL_STR_SZ + 2];
-
-	*use_plt = 0;
-	*is_alloc = 0;
-
 	switch((*pvp)->type){
 		case V_LBL:
 			assert((*pvp)->bits.lbl.offset == 0 && "non-zero label offset in call");
@@ -2176,22 +2589,22 @@ static char *x86_call_jmp_target(
 			if(cc1_target_details.ld_indirect_call_via_plt && v_needs_GOT(*pvp)){
 				if(!cc1_fopt.plt){
 					/* must load from GOT */
-					*is_alloc = 1;
-					return ustrprintf("*%s", impl_val_str(*pvp, 1));
+					x86_opnd_val(o, *pvp, 1)->indirect = 1;
+					return o;
 				}
 
-				*use_plt = 1;
+				return x86_opnd_sym(o, (*pvp)->bits.lbl.str, INSN_RELOC_PLT);
 			}
 
-			return (char *)(*pvp)->bits.lbl.str;
+			return x86_opnd_sym(o, (*pvp)->bits.lbl.str, INSN_RELOC_NONE);
 
 		case V_CONST_F:
 		case V_FLAG:
 			ICE("jmp flag/float?");
 
 		case V_CONST_I:   /* jmp *5 */
-			snprintf(buf, sizeof buf, "*%s", impl_val_str((*pvp), 1));
-			return buf;
+			x86_opnd_val(o, *pvp, 1)->indirect = 1;
+			return o;
 
 		case V_SPILT: /* load, then jmp */
 		case V_REGOFF: /* load, then jmp */
@@ -2210,56 +2623,61 @@ static char *x86_call_jmp_target(
 				memcpy_safe(&((out_val *)*pvp)->bits.regoff.reg, &r);
 			}
 
-			*buf = '*';
-			impl_val_str_r(buf + 1, *pvp, 0);
 			/* FIXME: derereference: 0 - this should check for an lvalue and if so, pass 1 */
-			return buf;
+			x86_opnd_val(o, *pvp, 0)->indirect = 1;
+			return o;
 	}
 
 	ICE("invalid jmp target type 0x%x", (*pvp)->type);
-	return NULL;
+	ucc_unreach(o);
 }
 
-void impl_jmp(const char *lbl)
+void impl_jmp(const struct section *sec, const char *lbl)
 {
-	asm_out_section(&section_text, "\tjmp %s\n", lbl);
+	asm_out_section(sec, "\tjmp %s\n", lbl);
 }
 
 void impl_jmp_expr(out_ctx *octx, const out_val *v)
 {
-	int use_plt, is_alloc;
-	char *jmp = x86_call_jmp_target(octx, &v, 0, &use_plt, &is_alloc);
-	assert(!use_plt && "local jumps shouldn't be PIC");
-	out_asm(octx, "jmp %s", jmp);
+	struct insn_opnd jmp;
+
+	x86_call_jmp_target(octx, &v, 0, &jmp);
+	assert(!jmp.reloc && "local jumps shouldn't be PIC");
+	x86_insn1(octx, x86_op("jmp"), &jmp);
 	out_val_consume(octx, v);
-	if(is_alloc)
-		free(jmp);
 }
 
 void impl_branch(
 		out_ctx *octx, const out_val *cond,
 		out_blk *bt, out_blk *bf,
-		int unlikely)
+		out_blk *unlikely)
 {
 	int flag;
 
 	switch(cond->type){
 		case V_REG:
 		{
-			const char *rstr;
 			char *cmp;
 
 			cond = v_reg_apply_offset(octx, cond);
-			rstr = impl_val_str(cond, 0);
 
-			if(type_is_floating(cond->t))
+			if(type_is_floating(cond->t)){
 				cond = out_normalise(octx, cond);
-			else
-				out_asm(octx, "test %s, %s", rstr, rstr);
+			}else{
+				struct insn_opnd o;
 
-			cmp = ustrprintf("jz %s", bf->lbl);
+				x86_opnd_val(&o, cond, 0);
+				x86_insn2(octx, x86_op("test"), &o, &o);
+			}
 
-			blk_terminate_condjmp(octx, cmp, bf, bt, unlikely);
+			/* fall through to the likely block */
+			if(unlikely == bt && bt != bf){
+				cmp = ustrprintf("jnz %s", bt->lbl);
+				blk_terminate_condjmp(octx, cmp, bt, bf, unlikely);
+			}else{
+				cmp = ustrprintf("jz %s", bf->lbl);
+				blk_terminate_condjmp(octx, cmp, bf, bt, unlikely);
+			}
 
 			out_val_consume(octx, cond);
 			break;
@@ -2267,10 +2685,20 @@ void impl_branch(
 
 		case V_FLAG:
 		{
+			struct flag_opts opts = cond->bits.flag;
 			char *cmpjmp;
 			int parity_chk, flip_parity_ret;
 
-			parity_chk = x86_need_fp_parity_p(&cond->bits.flag, &flip_parity_ret);
+			/* fall through to the likely block - float comparisons
+			 * can't be reversed, since nan compares false both ways */
+			if(unlikely == bf && bt != bf && !(opts.mods & flag_mod_float)){
+				out_blk *tmp = bt;
+				bt = bf;
+				bf = tmp;
+				opts.cmp = v_not_cmp(opts.cmp);
+			}
+
+			parity_chk = x86_need_fp_parity_p(&opts, &flip_parity_ret);
 
 			if(parity_chk){
 				/* nan means false, unless flip_parity_ret */
@@ -2278,7 +2706,7 @@ void impl_branch(
 
 				cmp_insn = ustrprintf(
 						"j%s %s",
-						x86_cmp(&cond->bits.flag),
+						x86_cmp(&opts),
 						bt->lbl);
 
 				parity_insn = ustrprintf("jp %s",
@@ -2292,7 +2720,7 @@ void impl_branch(
 				free(cmp_insn);
 				free(parity_insn);
 			}else{
-				cmpjmp = ustrprintf("j%s %s", x86_cmp(&cond->bits.flag), bt->lbl);
+				cmpjmp = ustrprintf("j%s %s", x86_cmp(&opts), bt->lbl);
 				/* fall thru to false block */
 			}
 
@@ -2331,58 +2759,150 @@ void impl_branch(
 	}
 }
 
-const out_val *impl_call(
-		out_ctx *octx,
-		const out_val *fn, const out_val **args,
-		type *fnty)
+static int x86_call_needs_float_count(type *fnty)
 {
-	type *const retty = type_called(type_is_ptr_or_block(fnty), NULL);
-	type *const arithty = type_nav_btype(cc1_type_nav, type_intptr_t);
-	const unsigned pws = platform_word_size();
-	const unsigned nargs = dynarray_count(args);
-	char *const float_arg = umalloc(nargs);
-	const out_val **local_args = NULL;
-	const out_val *retval_stret;
-	const out_val *stret_spill;
+	funcargs *args = type_funcargs(fnty);
 
-	const struct vreg *call_iregs;
-	unsigned n_call_iregs;
+	return args->variadic || FUNCARGS_EMPTY_NOVOID(args);
+}
 
-	struct
-	{
-		v_stackt bytesz;
-		const out_val *vptr;
-		enum
-		{
-			CLEANUP_NO,
-			CLEANUP_RESTORE_PUSHBACK = 1 << 0,
-			CLEANUP_POP = 1 << 1
-		} need_cleanup;
-	} arg_stack = { 0 };
+static void x86_call_float_count(out_ctx *octx, unsigned nfloats)
+{
+	/* movb $nfloats, %al */
+	struct vreg r;
 
-	unsigned nfloats = 0, nints = 0;
-	unsigned i;
-	enum stret stret_kind;
-	unsigned stret_stack;
+	r.idx = X86_64_REG_RAX;
+	r.is_float = 0;
 
-	dynarray_add_array(&local_args, args);
+	/* only the register arguments - glibc's printf of x86_64 linux
+	 * segfaults if this is 9 or greater */
+	out_flush_volatile(
+			octx,
+			v_to_reg_given(
+				octx,
+				out_new_l(
+					octx,
+					type_nav_btype(cc1_type_nav, type_nchar),
+					MIN(nfloats, N_CALL_REGS_F)),
+				&r));
+}
 
-	x86_call_regs(fnty, &n_call_iregs, &call_iregs);
+static void x86_call_args_to_regs(
+		out_ctx *octx,
+		const out_val **local_args, const char *float_arg, unsigned nargs,
+		const struct vreg *call_iregs, unsigned n_call_iregs,
+		unsigned *const pnints, unsigned *const pnfloats)
+{
+	unsigned i;
 
-	/* pre-scan of arguments - eliminate flags
-	 * (should only be one, since we can only have one flag at a time)
-	 *
-	 * also count floats and ints
-	 */
 	for(i = 0; i < nargs; i++){
-		assert(local_args[i]->retains > 0);
+		const out_val *const vp = local_args[i];
+		/* we use float_arg[i] since vp->t may now be float *,
+		 * if it's been spilt */
+		const int is_float = float_arg[i];
 
-		if(local_args[i]->type == V_FLAG)
-			local_args[i] = v_to_reg(octx, local_args[i]);
+		const struct vreg *rp = NULL;
+		struct vreg r;
 
-		float_arg[i] = type_is_floating(v_get_type(local_args[i]));
+		if(is_float){
+			if(*pnfloats < N_CALL_REGS_F){
+				/* NOTE: don't need to use call_regs_float,
+				 * since it's xmm0 ... 7 */
+				r.idx = *pnfloats;
+				r.is_float = 1;
 
-		if(float_arg[i])
+				rp = &r;
+			}
+			(*pnfloats)++;
+
+		}else{
+			/* integral */
+			if(*pnints < n_call_iregs)
+				rp = &call_iregs[*pnints];
+
+			(*pnints)++;
+		}
+
+		if(rp){
+			/* only bother if it's not already in the register */
+			if(vp->type != V_REG || !vreg_eq(rp, &vp->bits.regoff.reg)){
+				/* need to free it up, as v_to_reg_given doesn't clobber check */
+				v_freeup_reg(octx, rp);
+
+#if 0
+				/* argument retainedness doesn't matter here -
+				 * local arguments and autos are held onto, and
+				 * inline functions hold onto their arguments one extra
+				 */
+				UCC_ASSERT(local_args[i]->retains == 1,
+						"incorrectly retained arg %d: %d",
+						i, local_args[i]->retains);
+#endif
+
+
+				local_args[i] = v_to_reg_given(octx, local_args[i], rp);
+			}
+			if(local_args[i]->type == V_REG && local_args[i]->bits.regoff.offset){
+				/* need to ensure offsets are flushed */
+				local_args[i] = v_reg_apply_offset(octx, local_args[i]);
+			}
+		}
+		/* else already pushed */
+	}
+}
+
+const out_val *impl_call(
+		out_ctx *octx,
+		const out_val *fn, const out_val **args,
+		type *fnty)
+{
+	type *const retty = type_called(type_is_ptr_or_block(fnty), NULL);
+	type *const arithty = type_nav_btype(cc1_type_nav, type_intptr_t);
+	const unsigned pws = platform_word_size();
+	const unsigned nargs = dynarray_count(args);
+	char *const float_arg = umalloc(nargs);
+	const out_val **local_args = NULL;
+	const out_val *retval_stret;
+	const out_val *stret_spill;
+
+	const struct vreg *call_iregs;
+	unsigned n_call_iregs;
+
+	struct
+	{
+		v_stackt bytesz;
+		const out_val *vptr;
+		enum
+		{
+			CLEANUP_NO,
+			CLEANUP_RESTORE_PUSHBACK = 1 << 0,
+			CLEANUP_POP = 1 << 1
+		} need_cleanup;
+	} arg_stack = { 0 };
+
+	unsigned nfloats = 0, nints = 0;
+	unsigned i;
+	enum stret stret_kind;
+	unsigned stret_stack;
+
+	dynarray_add_array(&local_args, args);
+
+	x86_call_regs(fnty, &n_call_iregs, &call_iregs);
+
+	/* pre-scan of arguments - eliminate flags
+	 * (should only be one, since we can only have one flag at a time)
+	 *
+	 * also count floats and ints
+	 */
+	for(i = 0; i < nargs; i++){
+		assert(local_args[i]->retains > 0);
+
+		if(local_args[i]->type == V_FLAG)
+			local_args[i] = v_to_reg(octx, local_args[i]);
+
+		float_arg[i] = type_is_floating(v_get_type(local_args[i]));
+
+		if(float_arg[i])
 			nfloats++;
 		else
 			nints++;
@@ -2504,94 +3024,23 @@ const out_val *impl_call(
 		out_flush_volatile(octx, v_to_reg_given(octx, stret_spill, stret_reg));
 	}
 
-	for(i = 0; i < nargs; i++){
-		const out_val *const vp = local_args[i];
-		/* we use float_arg[i] since vp->t may now be float *,
-		 * if it's been spilt */
-		const int is_float = float_arg[i];
-
-		const struct vreg *rp = NULL;
-		struct vreg r;
-
-		if(is_float){
-			if(nfloats < N_CALL_REGS_F){
-				/* NOTE: don't need to use call_regs_float,
-				 * since it's xmm0 ... 7 */
-				r.idx = nfloats;
-				r.is_float = 1;
-
-				rp = &r;
-			}
-			nfloats++;
-
-		}else{
-			/* integral */
-			if(nints < n_call_iregs)
-				rp = &call_iregs[nints];
-
-			nints++;
-		}
-
-		if(rp){
-			/* only bother if it's not already in the register */
-			if(vp->type != V_REG || !vreg_eq(rp, &vp->bits.regoff.reg)){
-				/* need to free it up, as v_to_reg_given doesn't clobber check */
-				v_freeup_reg(octx, rp);
-
-#if 0
-				/* argument retainedness doesn't matter here -
-				 * local arguments and autos are held onto, and
-				 * inline functions hold onto their arguments one extra
-				 */
-				UCC_ASSERT(local_args[i]->retains == 1,
-						"incorrectly retained arg %d: %d",
-						i, local_args[i]->retains);
-#endif
-
-
-				local_args[i] = v_to_reg_given(octx, local_args[i], rp);
-			}
-			if(local_args[i]->type == V_REG && local_args[i]->bits.regoff.offset){
-				/* need to ensure offsets are flushed */
-				local_args[i] = v_reg_apply_offset(octx, local_args[i]);
-			}
-		}
-		/* else already pushed */
-	}
+	x86_call_args_to_regs(octx,
+			local_args, float_arg, nargs,
+			call_iregs, n_call_iregs,
+			&nints, &nfloats);
 
 	{
-		funcargs *args = type_funcargs(fnty);
-		int need_float_count =
-			args->variadic
-			|| FUNCARGS_EMPTY_NOVOID(args);
+		int need_float_count = x86_call_needs_float_count(fnty);
 		/* jtarget must be assigned before "movb $0, %al" */
-		int use_plt, is_alloc;
-		char *jtarget = x86_call_jmp_target(octx, &fn, need_float_count, &use_plt, &is_alloc);
-
-		/* if x(...) or x() */
-		if(need_float_count){
-			/* movb $nfloats, %al */
-			struct vreg r;
+		struct insn_opnd jtarget;
 
-			r.idx = X86_64_REG_RAX;
-			r.is_float = 0;
+		x86_call_jmp_target(octx, &fn, need_float_count, &jtarget);
 
-			/* only the register arguments - glibc's printf of x86_64 linux
-			 * segfaults if this is 9 or greater */
-			out_flush_volatile(
-					octx,
-					v_to_reg_given(
-						octx,
-						out_new_l(
-							octx,
-							type_nav_btype(cc1_type_nav, type_nchar),
-							MIN(nfloats, N_CALL_REGS_F)),
-						&r));
-		}
+		/* if x(...) or x() */
+		if(need_float_count)
+			x86_call_float_count(octx, nfloats);
 
-		out_asm(octx, "callq %s%s", jtarget, use_plt ? "@PLT" : "");
-		if(is_alloc)
-			free(jtarget);
+		x86_insn1(octx, x86_op("callq"), &jtarget);
 	}
 
 	if(arg_stack.bytesz){
@@ -2655,15 +3104,684 @@ const out_val *impl_call(
 	}
 }
 
+char *impl_call_sibling(
+		out_ctx *octx,
+		const out_val *fn, const out_val **args,
+		type *fnty)
+{
+	type *const retty = type_called(type_is_ptr_or_block(fnty), NULL);
+	const unsigned nargs = dynarray_count(args);
+	const struct vreg *call_iregs;
+	unsigned n_call_iregs;
+	unsigned nfloats = 0, nints = 0;
+	const out_val **local_args = NULL;
+	char *float_arg;
+	unsigned stret_stack;
+	struct insn_opnd jtarget;
+	char buf[INSN_LINE_MAX], *jmp;
+	unsigned i;
+
+	/* the callee must restore what we would, and pop nothing */
+	if(x86_conv_lookup(fnty) != x86_conv_lookup(octx->current_fnty)
+	|| !x86_caller_cleanup(fnty)
+	|| x86_stret(retty, &stret_stack) != stret_scalar)
+	{
+		return NULL;
+	}
+
+	x86_call_regs(fnty, &n_call_iregs, &call_iregs);
+
+	for(i = 0; i < nargs; i++){
+		if(type_is_floating(v_get_type(args[i])))
+			nfloats++;
+		else
+			nints++;
+	}
+
+	/* stack arguments would live in our caller's frame */
+	if(nints > n_call_iregs || nfloats > N_CALL_REGS_F)
+		return NULL;
+
+	/* a register target must survive the callee-save restores */
+	if(fn->type != V_LBL && fn->type != V_CONST_I){
+		const struct vreg r11 = VREG_INIT(X86_64_REG_R11, 0);
+
+		if(fn->type != V_REG || !vreg_eq(&r11, &fn->bits.regoff.reg))
+			v_freeup_reg(octx, &r11);
+		fn = v_reg_apply_offset(octx, v_to_reg_given(octx, fn, &r11));
+	}
+
+	float_arg = umalloc(nargs);
+	dynarray_add_array(&local_args, args);
+
+	for(i = 0; i < nargs; i++){
+		if(local_args[i]->type == V_FLAG)
+			local_args[i] = v_to_reg(octx, local_args[i]);
+
+		float_arg[i] = type_is_floating(v_get_type(local_args[i]));
+	}
+
+	nints = nfloats = 0;
+	x86_call_args_to_regs(octx,
+			local_args, float_arg, nargs,
+			call_iregs, n_call_iregs,
+			&nints, &nfloats);
+
+	x86_call_jmp_target(octx, &fn, 0, &jtarget);
+	x86_insn_opnd_str(&jtarget, buf, sizeof buf);
+	jmp = ustrdup(buf);
+
+	if(x86_call_needs_float_count(fnty))
+		x86_call_float_count(octx, nfloats);
+
+	for(i = 0; i < nargs; i++)
+		out_val_consume(octx, local_args[i]);
+	dynarray_free(const out_val **, local_args, NULL);
+	free(float_arg);
+
+	out_val_consume(octx, fn);
+
+	return jmp;
+}
+
+static void x86_reserve_addr(out_ctx *octx, const out_val *v, int reserve)
+{
+	const struct vreg *r = &v->bits.regoff.reg;
+
+	if(impl_reg_frame_const(r, /*sp*/1))
+		return;
+
+	if(reserve)
+		v_reserve_reg(octx, r);
+	else
+		v_unreserve_reg(octx, r);
+}
+
+void impl_mem_vec(out_ctx *octx, const out_val *dest, const out_val *src)
+{
+	struct vreg r;
+	struct insn_opnd opnd[2];
+
+	dest = v_to_reg(octx, dest);
+
+	/* keep dest's register while src is loaded */
+	x86_reserve_addr(octx, dest, 1);
+	if(src)
+		src = v_to_reg(octx, src);
+	x86_reserve_addr(octx, dest, 0);
+
+	v_unused_reg(octx, 1, /*fp*/1, &r, NULL);
+
+	if(src){
+		x86_insn2(octx, x86_op("movdqu"),
+				x86_opnd_val(&opnd[0], src, 1),
+				x86_opnd_xmm(&opnd[1], r.idx));
+		out_val_release(octx, src);
+	}else{
+		x86_opnd_xmm(&opnd[0], r.idx);
+		x86_insn2(octx, x86_op("pxor"), &opnd[0], &opnd[0]);
+	}
+
+	x86_insn2(octx, x86_op("movdqu"),
+			x86_opnd_xmm(&opnd[0], r.idx),
+			x86_opnd_val(&opnd[1], dest, 1));
+	out_val_release(octx, dest);
+}
+
+void impl_mem_rep(
+		out_ctx *octx,
+		const out_val **dest, const out_val **src,
+		unsigned long nwords)
+{
+	/* rep movsq: copy %rcx quads from (%rsi) to (%rdi)
+	 * rep stosq: store %rcx copies of %rax to (%rdi)
+	 * %rdi and %rsi are left pointing after the last quad */
+	const struct vreg rdi = { X86_64_REG_RDI, 0 };
+	const struct vreg rsi = { X86_64_REG_RSI, 0 };
+	const struct vreg rcx = { X86_64_REG_RCX, 0 };
+	const struct vreg rax = { X86_64_REG_RAX, 0 };
+	const struct vreg *other = src ? &rsi : &rax;
+	type *long_ty = type_nav_btype(cc1_type_nav, type_long);
+
+	v_freeup_reg(octx, &rdi);
+	v_reserve_reg(octx, &rdi);
+	v_freeup_reg(octx, other);
+	v_reserve_reg(octx, other);
+
+	*dest = v_to_reg_given(octx, *dest, &rdi);
+	if(src)
+		*src = v_to_reg_given(octx, *src, &rsi);
+	else
+		out_flush_volatile(octx,
+				v_to_reg_given(octx, out_new_zero(octx, long_ty), &rax));
+
+	/* after the pointers, which may have been in %rcx */
+	v_freeup_reg(octx, &rcx);
+	v_reserve_reg(octx, &rcx);
+
+	out_flush_volatile(octx,
+			v_to_reg_given(octx, out_new_l(octx, long_ty, nwords), &rcx));
+
+	out_asm(octx, "rep %s", src ? "movsq" : "stosq");
+
+	v_unreserve_reg(octx, &rcx);
+	v_unreserve_reg(octx, other);
+	v_unreserve_reg(octx, &rdi);
+}
+
 void impl_undefined(out_ctx *octx)
 {
-	out_asm(octx, "ud2");
+	x86_insn0(octx, x86_op("ud2"));
 	blk_terminate_undef(octx->current_blk);
 }
 
 void impl_debugtrap(out_ctx *octx)
 {
-	out_asm(octx, "int3");
+	x86_insn0(octx, x86_op("int3"));
+}
+
+const out_val *impl_bitop(out_ctx *octx, enum out_bitop op, const out_val *v)
+{
+	type *ty = v->t;
+	const char *sfx = x86_suffix(ty);
+	struct insn_opnd from, dst, t, imm;
+	const char *insn = NULL;
+	struct vreg r, tmp;
+
+	switch(op){
+		case OUT_BITOP_POPCOUNT:
+			if(!(mopt_mode & MOPT_POPCNT))
+				return NULL;
+			insn = "popcnt";
+			break;
+		case OUT_BITOP_CLZ:
+			/* bsr gives the index of the top bit, size-1 - index = clz */
+			insn = mopt_mode & MOPT_LZCNT ? "lzcnt" : "bsr";
+			break;
+		case OUT_BITOP_CTZ:
+			insn = mopt_mode & MOPT_BMI ? "tzcnt" : "bsf";
+			break;
+		case OUT_BITOP_FFS:
+			insn = "bsf";
+			break;
+		case OUT_BITOP_BSWAP:
+			break;
+	}
+
+	v = v_to(octx, v, FOPT_PIC(&cc1_fopt) ? TO_REG : TO_REG | TO_MEM);
+	x86_opnd_val(&from, v, 0);
+
+	v_unused_reg(octx, 1, 0, &r, v);
+	x86_opnd_reg(&dst, &r, ty);
+
+	if(op == OUT_BITOP_FFS){
+		/* bsf leaves ZF set and the destination undefined for zero */
+		v_reserve_reg(octx, &r);
+		v_unused_reg(octx, 1, 0, &tmp, NULL);
+		v_unreserve_reg(octx, &r);
+
+		x86_opnd_reg(&t, &tmp, ty);
+		x86_insn2(octx, x86_op("mov%s", sfx), x86_opnd_imm(&imm, -1), &t);
+	}
+
+	if(insn){
+		x86_insn2(octx, x86_op("%s%s", insn, sfx), &from, &dst);
+	}else{
+		if(v->type != V_REG || !vreg_eq(&v->bits.regoff.reg, &r))
+			x86_insn2(octx, x86_op("mov%s", sfx), &from, &dst);
+
+		if(type_size(ty, NULL) == 2)
+			x86_insn2(octx, x86_op("rolw"), x86_opnd_imm(&imm, 8), &dst);
+		else
+			x86_insn1(octx, x86_op("bswap%s", sfx), &dst);
+	}
+
+	switch(op){
+		case OUT_BITOP_CLZ:
+			if(!(mopt_mode & MOPT_LZCNT))
+				x86_insn2(octx, x86_op("xor%s", sfx),
+						x86_opnd_imm(&imm, type_size(ty, NULL) * CHAR_BIT - 1),
+						&dst);
+			break;
+		case OUT_BITOP_FFS:
+			x86_insn2(octx, x86_op("cmovz%s", sfx), &t, &dst);
+			x86_insn2(octx, x86_op("add%s", sfx), x86_opnd_imm(&imm, 1), &dst);
+			break;
+		default:
+			break;
+	}
+
+	return v_new_reg(octx, v, ty, &r);
+}
+
+void impl_prefetch(out_ctx *octx, const out_val *addr, int write, int locality)
+{
+	/* prefetchw needs 3DNow!/PRFCHW, so writes get the read hint */
+	static const char *const hints[] = { "nta", "t2", "t1", "t0" };
+	struct insn_opnd opnd[1];
+
+	(void)write;
+	assert(0 <= locality && locality < (int)countof(hints));
+
+	addr = v_to(octx, addr, TO_REG);
+
+	x86_insn1(octx, x86_op("prefetch%s", hints[locality]),
+			x86_opnd_val(&opnd[0], addr, 1));
+	out_val_release(octx, addr);
+}
+
+/* vector registers are xmm8 upwards */
+#define X86_VEC_REG(i) (8 + (i))
+
+static const char *x86_vec_mov(type *elem)
+{
+	if(!type_is_floating(elem))
+		return "movdqu";
+	return type_size(elem, NULL) == 4 ? "movups" : "movupd";
+}
+
+static const char *x86_vec_op_str(enum op_type op, type *elem)
+{
+	if(type_is_floating(elem)){
+		const int single = type_size(elem, NULL) == 4;
+
+		switch(op){
+			case op_plus: return single ? "addps" : "addpd";
+			case op_minus: return single ? "subps" : "subpd";
+			case op_multiply: return single ? "mulps" : "mulpd";
+			case op_divide: return single ? "divps" : "divpd";
+			default: return NULL;
+		}
+	}
+
+	/* no pmulld before SSE4.1 */
+	switch(op){
+		case op_plus: return "paddd";
+		case op_minus: return "psubd";
+		case op_and: return "pand";
+		case op_or: return "por";
+		case op_xor: return "pxor";
+		default: return NULL;
+	}
+}
+
+unsigned impl_vec_lanes(out_ctx *octx, type *elem)
+{
+	const unsigned sz = type_size(elem, NULL);
+
+	/* xmm8 and up are callee-save for ms_abi */
+	if(x86_conv_lookup(octx->current_fnty) != &calling_convs[conv_x64_sysv])
+		return 0;
+
+	if(type_is_floating(elem) ? sz != 4 && sz != 8 : !type_is_integral(elem) || sz != 4)
+		return 0;
+
+	return VEC_BYTES / sz;
+}
+
+int impl_vec_op_supported(enum op_type op, type *elem)
+{
+	return !!x86_vec_op_str(op, elem);
+}
+
+void impl_vec_load(out_ctx *octx, unsigned reg, const out_val *addr, type *elem)
+{
+	struct insn_opnd opnd[2];
+
+	addr = v_to_reg(octx, addr);
+
+	x86_insn2(octx, x86_op("%s", x86_vec_mov(elem)),
+			x86_opnd_val(&opnd[0], addr, 1),
+			x86_opnd_xmm(&opnd[1], X86_VEC_REG(reg)));
+
+	out_val_release(octx, addr);
+}
+
+void impl_vec_store(out_ctx *octx, const out_val *addr, unsigned reg, type *elem)
+{
+	struct insn_opnd opnd[2];
+
+	addr = v_to_reg(octx, addr);
+
+	x86_insn2(octx, x86_op("%s", x86_vec_mov(elem)),
+			x86_opnd_xmm(&opnd[0], X86_VEC_REG(reg)),
+			x86_opnd_val(&opnd[1], addr, 1));
+
+	out_val_release(octx, addr);
+}
+
+void impl_vec_splat(out_ctx *octx, unsigned reg, const out_val *v)
+{
+	struct insn_opnd xmm, src, imm;
+	type *ty = v->t;
+
+	v = v_reg_apply_offset(octx, v_to_reg(octx, v));
+
+	x86_opnd_xmm(&xmm, X86_VEC_REG(reg));
+	x86_opnd_val(&src, v, 0);
+	x86_opnd_imm(&imm, 0);
+
+	if(!type_is_floating(ty)){
+		x86_insn2(octx, x86_op("movd"), &src, &xmm);
+		x86_insn3(octx, x86_op("pshufd"), &imm, &xmm, &xmm);
+	}else if(type_size(ty, NULL) == 4){
+		x86_insn2(octx, x86_op("movaps"), &src, &xmm);
+		x86_insn3(octx, x86_op("shufps"), &imm, &xmm, &xmm);
+	}else{
+		x86_insn2(octx, x86_op("movapd"), &src, &xmm);
+		x86_insn2(octx, x86_op("unpcklpd"), &xmm, &xmm);
+	}
+
+	out_val_release(octx, v);
+}
+
+void impl_vec_zero(out_ctx *octx, unsigned reg)
+{
+	struct insn_opnd xmm;
+
+	x86_opnd_xmm(&xmm, X86_VEC_REG(reg));
+	x86_insn2(octx, x86_op("pxor"), &xmm, &xmm);
+}
+
+void impl_vec_copy(out_ctx *octx, unsigned dest, unsigned src)
+{
+	struct insn_opnd opnd[2];
+
+	x86_insn2(octx, x86_op("movaps"),
+			x86_opnd_xmm(&opnd[0], X86_VEC_REG(src)),
+			x86_opnd_xmm(&opnd[1], X86_VEC_REG(dest)));
+}
+
+void impl_vec_op(out_ctx *octx, enum op_type op, type *elem, unsigned dest, unsigned src)
+{
+	const char *insn = x86_vec_op_str(op, elem);
+	struct insn_opnd opnd[2];
+
+	assert(insn);
+	x86_insn2(octx, x86_op("%s", insn),
+			x86_opnd_xmm(&opnd[0], X86_VEC_REG(src)),
+			x86_opnd_xmm(&opnd[1], X86_VEC_REG(dest)));
+}
+
+const out_val *impl_vec_reduce(
+		out_ctx *octx, enum op_type op, type *elem, unsigned reg, unsigned scratch)
+{
+	const char *insn = x86_vec_op_str(op, elem);
+	struct insn_opnd xmm, tmp, imm, dst;
+	struct vreg r;
+
+	/* integer lanes only - reassociating float sums changes the result */
+	assert(insn && !type_is_floating(elem));
+	insn = x86_op("%s", insn);
+
+	x86_opnd_xmm(&xmm, X86_VEC_REG(reg));
+	x86_opnd_xmm(&tmp, X86_VEC_REG(scratch));
+
+	/* fold the high half onto the low, then the odd lane onto the even */
+	x86_insn3(octx, x86_op("pshufd"), x86_opnd_imm(&imm, 0x4e), &xmm, &tmp);
+	x86_insn2(octx, insn, &tmp, &xmm);
+	x86_insn3(octx, x86_op("pshufd"), x86_opnd_imm(&imm, 0xb1), &xmm, &tmp);
+	x86_insn2(octx, insn, &tmp, &xmm);
+
+	v_unused_reg(octx, 1, 0, &r, NULL);
+	x86_insn2(octx, x86_op("movd"), &xmm, x86_opnd_reg(&dst, &r, elem));
+
+	return v_new_reg(octx, NULL, elem, &r);
+}
+
+const out_val *impl_atomic_load(
+		out_ctx *octx, const out_val *ptr, enum out_memorder mo)
+{
+	/* aligned loads are atomic and have acquire semantics on x86,
+	 * seq_cst stores pay for the full barrier instead */
+	(void)mo;
+	return v_to_reg(octx, out_deref(octx, ptr));
+}
+
+void impl_atomic_store(
+		out_ctx *octx, const out_val *ptr, const out_val *val,
+		enum out_memorder mo)
+{
+	if(mo == OUT_MO_SEQ_CST && !type_is_floating(val->t)){
+		/* xchg is implicitly locked, cheaper than mov + mfence */
+		out_val_consume(octx, impl_atomic_exchange(octx, ptr, val));
+		return;
+	}
+
+	out_store(octx, ptr, val);
+
+	if(mo == OUT_MO_SEQ_CST)
+		impl_atomic_fence(octx, mo);
+}
+
+/* val in a register we may clobber, kept clear of ptr's */
+static const out_val *x86_atomic_operands(
+		out_ctx *octx,
+		const out_val **ptr, const out_val *val,
+		struct vreg *r)
+{
+	*ptr = v_to(octx, *ptr, TO_REG);
+
+	x86_reserve_addr(octx, *ptr, 1);
+	val = v_to(octx, val, TO_REG);
+	v_unused_reg(octx, 1, 0, r, val);
+	x86_reserve_addr(octx, *ptr, 0);
+
+	impl_reg_cp_no_off(octx, val, r);
+	return val;
+}
+
+const out_val *impl_atomic_exchange(
+		out_ctx *octx, const out_val *ptr, const out_val *val)
+{
+	type *ty = val->t;
+	struct vreg r;
+	struct insn_opnd opnd[2];
+
+	val = x86_atomic_operands(octx, &ptr, val, &r);
+
+	x86_insn2(octx, x86_op("xchg%s", x86_suffix(ty)),
+			x86_opnd_reg(&opnd[0], &r, ty),
+			x86_opnd_val(&opnd[1], ptr, 1));
+
+	out_val_release(octx, ptr);
+	return v_new_reg(octx, val, ty, &r);
+}
+
+static const out_val *x86_atomic_cas_loop(
+		out_ctx *octx, enum op_type op,
+		const out_val *ptr, const out_val *val)
+{
+	/* no instruction hands back the old value of a locked and/or/xor:
+	 *   mov (p), %rax
+	 * 1:mov %rax, t ; op v, t ; [not t]
+	 *   lock cmpxchg t, (p) ; jne 1b
+	 * the operands live in reserved registers so the transfers
+	 * into and out of the loop don't spill them */
+	const struct vreg rax = { X86_64_REG_RAX, 0 };
+	type *ty = val->t;
+	type *ptr_ty = ptr->t;
+	const char *sfx = x86_suffix(ty);
+	const char *insn = NULL;
+	struct insn_opnd tp, tv, tt, tax;
+	const char *pstr, *tstr;
+	struct vreg p, v, t;
+	out_blk *retry, *done;
+
+	switch(op){
+		case op_and:
+		case op_bnot:
+			insn = "and";
+			break;
+		case op_or:
+			insn = "or";
+			break;
+		case op_xor:
+			insn = "xor";
+			break;
+		default:
+			assert(0 && "bad atomic op");
+	}
+
+	v_freeup_reg(octx, &rax);
+	v_reserve_reg(octx, &rax);
+
+	v_unused_reg(octx, 1, 0, &p, NULL);
+	out_val_release(octx, v_to_reg_given(octx, ptr, &p));
+	v_reserve_reg(octx, &p);
+
+	v_unused_reg(octx, 1, 0, &v, NULL);
+	out_val_release(octx, v_to_reg_given(octx, val, &v));
+	v_reserve_reg(octx, &v);
+
+	v_unused_reg(octx, 1, 0, &t, NULL);
+	v_reserve_reg(octx, &t);
+
+	x86_opnd_mem(&tp, &p, 0);
+	x86_opnd_reg(&tv, &v, ty);
+	x86_opnd_reg(&tt, &t, ty);
+	x86_opnd_reg(&tax, &rax, ty);
+
+	x86_insn2(octx, x86_op("mov%s", sfx), &tp, &tax);
+
+	retry = out_blk_new(octx, "atomic_retry");
+	done = out_blk_new(octx, "atomic_done");
+
+	out_ctrl_transfer_make_current(octx, retry);
+	x86_insn2(octx, x86_op("mov%s", sfx), &tax, &tt);
+	x86_insn2(octx, x86_op("%s%s", insn, sfx), &tv, &tt);
+	if(op == op_bnot)
+		x86_insn1(octx, x86_op("not%s", sfx), &tt);
+
+	/* prefixed, kept as text */
+	pstr = x86_reg_str(&p, ptr_ty);
+	tstr = x86_reg_str(&t, ty);
+	out_asm(octx, "lock cmpxchg%s %%%s, (%%%s)", sfx, tstr, pstr);
+
+	/* on failure, %rax holds the current value for the next attempt */
+	out_ctrl_branch(octx, v_new_flag(octx, NULL, flag_eq, 0), done, retry);
+
+	v_unreserve_reg(octx, &t);
+	v_unreserve_reg(octx, &v);
+	v_unreserve_reg(octx, &p);
+	v_unreserve_reg(octx, &rax);
+
+	return v_new_reg(octx, NULL, ty, &rax);
+}
+
+const out_val *impl_atomic_fetch_op(
+		out_ctx *octx, enum op_type op,
+		const out_val *ptr, const out_val *val)
+{
+	char bufp[VAL_STR_SZ];
+	type *ty = val->t;
+	const char *sfx = x86_suffix(ty);
+	struct vreg r;
+	struct insn_opnd opnd[1];
+
+	if(op != op_plus && op != op_minus)
+		return x86_atomic_cas_loop(octx, op, ptr, val);
+
+	val = x86_atomic_operands(octx, &ptr, val, &r);
+
+	if(op == op_minus)
+		x86_insn1(octx, x86_op("neg%s", sfx), x86_opnd_reg(&opnd[0], &r, ty));
+
+	out_asm(octx, "lock xadd%s %%%s, %s",
+			sfx, x86_reg_str(&r, ty),
+			impl_val_str_r(bufp, ptr, 1));
+
+	out_val_release(octx, ptr);
+	return v_new_reg(octx, val, ty, &r);
+}
+
+const out_val *impl_atomic_cmpxchg(
+		out_ctx *octx, const out_val *ptr,
+		const out_val *expected, const out_val *desired,
+		const out_val **success)
+{
+	/* lock cmpxchg desired, (ptr)
+	 * compares with %rax, which is left holding the old value */
+	const struct vreg rax = { X86_64_REG_RAX, 0 };
+	char bufp[VAL_STR_SZ];
+	type *ty = expected->t;
+
+	v_freeup_reg(octx, &rax);
+	v_reserve_reg(octx, &rax);
+
+	ptr = v_to(octx, ptr, TO_REG);
+	x86_reserve_addr(octx, ptr, 1);
+	desired = v_to(octx, desired, TO_REG);
+	x86_reserve_addr(octx, desired, 1);
+
+	expected = v_to_reg_given(octx, expected, &rax);
+
+	out_asm(octx, "lock cmpxchg%s %%%s, %s",
+			x86_suffix(ty),
+			x86_reg_str(&desired->bits.regoff.reg, ty),
+			impl_val_str_r(bufp, ptr, 1));
+
+	x86_reserve_addr(octx, desired, 0);
+	x86_reserve_addr(octx, ptr, 0);
+	out_val_release(octx, desired);
+	out_val_release(octx, ptr);
+	v_unreserve_reg(octx, &rax);
+
+	*success = v_new_flag(octx, NULL, flag_eq, 0);
+	return v_new_reg(octx, expected, ty, &rax);
+}
+
+void impl_atomic_fence(out_ctx *octx, enum out_memorder mo)
+{
+	/* x86 only reorders stores after later loads */
+	if(mo == OUT_MO_SEQ_CST)
+		x86_insn0(octx, x86_op("mfence"));
+}
+
+const out_val *impl_tls_addr(
+		out_ctx *octx, type *ty, const char *lbl, enum out_tls_model model)
+{
+	struct vreg r;
+	struct insn_opnd tlsoff, dst;
+
+	if(model == OUT_TLS_GLOBAL_DYNAMIC){
+		/* the padding prefixes are part of the ABI - they give the
+		 * linker room to relax this to initial- or local-exec */
+		const struct vreg rax = VREG_INIT(X86_64_REG_RAX, 0);
+
+		v_save_regs(octx, octx->current_fnty, NULL, NULL);
+		v_stack_needalign(octx, 16);
+
+		out_asm(octx, ".byte 0x66");
+		out_asm(octx, "leaq %s@tlsgd(%%rip), %%rdi", lbl);
+		out_asm(octx, ".value 0x6666");
+		out_asm(octx, ".byte 0x48"); /* rex64 */
+		out_asm(octx, "callq __tls_get_addr@PLT");
+
+		return v_new_reg(octx, NULL, ty, &rax);
+	}
+
+	v_unused_reg(octx, 1, 0, &r, NULL);
+
+	/* %fs:0 holds the thread pointer itself */
+	x86_opnd_new(&tlsoff, OPND_SYM)->seg = X86_INSN_SEG_FS;
+	x86_opnd_reg(&dst, &r, NULL);
+	x86_insn2(octx, x86_op("movq"), &tlsoff, &dst);
+
+	x86_opnd_new(&tlsoff, OPND_MEM);
+	tlsoff.sym = insn_intern(lbl, strlen(lbl));
+	tlsoff.regsz = 8;
+	if(model == OUT_TLS_LOCAL_EXEC){
+		tlsoff.reloc = INSN_RELOC_TPOFF;
+		tlsoff.reg = r.idx;
+		x86_insn2(octx, x86_op("leaq"), &tlsoff, &dst);
+	}else{
+		tlsoff.reloc = INSN_RELOC_GOTTPOFF;
+		tlsoff.reg = X86_INSN_RIP;
+		x86_insn2(octx, x86_op("addq"), &tlsoff, &dst);
+	}
+
+	return v_new_reg(octx, NULL, ty, &r);
 }
 
 static const out_val *impl_test(out_ctx *octx, const out_val **eval, enum flag_cmp flag)
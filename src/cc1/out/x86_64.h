@@ -43,6 +43,18 @@
 
 #define REDZONE_BYTES 128
 
+#define MEM_VEC_BYTES 16 /* movdqu - SSE2 is baseline */
+#define MEM_REP_BYTES 8 /* rep movsq / rep stosq */
+
+#define VEC_BYTES 16 /* SSE2 */
+#define N_VEC_REGS 8 /* xmm8-xmm15, which the register allocator doesn't use */
+
 #define VAL_STR_SZ 128
 
+/* instruction records - registers are numbered as X86_64_REG_*,
+ * then xmm registers from X86_INSN_XMM, then %rip */
+#define X86_INSN_XMM 32
+#define X86_INSN_RIP 48
+#define X86_INSN_SEG_FS 1 /* insn_opnd.seg */
+
 #endif
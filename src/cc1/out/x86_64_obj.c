@@ -0,0 +1,1867 @@
+/* x86-64 instruction encoder for the integrated assembler (-emit=obj)
+ * encodes cc1's instruction records directly, and parses the AT&T
+ * subset cc1 emits as text, plus common inline-asm forms */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+
+#include "../../util/macros.h"
+#include "../../util/alloc.h"
+#include "../../util/dynmap.h"
+
+#include "obj_impl.h"
+#include "elf.h"
+#include "insn.h"
+#include "x86_64.h"
+
+#define X86_MAX_OPNDS 3
+
+#define REX_W 8
+#define REX_R 4
+#define REX_X 2
+#define REX_B 1
+
+#define SZ_B 1
+#define SZ_W 2
+#define SZ_L 4
+#define SZ_Q 8
+#define SZ_WLQ (SZ_W | SZ_L | SZ_Q)
+#define SZ_BWLQ (SZ_B | SZ_WLQ)
+
+#define X86_NOREG -1
+
+enum x86_opnd_kind
+{
+	XO_REG,
+	XO_XMM,
+	XO_IMM,
+	XO_MEM
+};
+
+struct x86_opnd
+{
+	enum x86_opnd_kind kind;
+	int indirect; /* `*' */
+
+	/* XO_REG, XO_XMM */
+	int reg;
+	unsigned size;
+	int rex_byte; /* %spl, %bpl, %sil, %dil */
+	int high_byte; /* %ah, %ch, %dh, %bh */
+
+	/* XO_MEM */
+	int base, index, scale;
+	int riprel;
+	unsigned char seg;
+
+	/* XO_MEM displacement / XO_IMM value */
+	struct obj_expr expr;
+};
+
+enum x86_kind
+{
+	X86_FIXED,    /* opcode bytes only */
+	X86_PREFIX,   /* lock, rep... */
+	X86_ALU,      /* add/or/adc/sbb/and/sub/xor/cmp, ext = /digit */
+	X86_TEST,
+	X86_MOV,
+	X86_MOVABS,
+	X86_MOVX,     /* movz/movs, ext = source size */
+	X86_LEA,
+	X86_GRP3,     /* not/neg/mul/div/idiv: f6/f7 /ext */
+	X86_INCDEC,   /* fe/ff /ext */
+	X86_IMUL,
+	X86_SHIFT,    /* /ext */
+	X86_PUSH,
+	X86_POP,
+	X86_CALL,
+	X86_JMP,
+	X86_RM_R,     /* reg <- r/m */
+	X86_R_RM,     /* r/m <- reg, byte form is opcode - 1 */
+	X86_BSWAP,
+	X86_MEM_EXT,  /* m8, ext = /digit */
+	X86_STRING,   /* byte form opcode, size from suffix */
+	X86_SSE,      /* xmm <- xmm/m */
+	X86_SSE_IMM,  /* xmm <- xmm/m, imm8 */
+	X86_SSE_MOV,  /* op[1]: load, op[2]: store */
+	X86_CVT_I2F,  /* xmm <- r/m32/64 */
+	X86_CVT_F2I,  /* r32/64 <- xmm/m */
+	X86_MOVD      /* movd/movq, gpr <-> xmm */
+};
+
+struct x86_op
+{
+	const char *name;
+	unsigned char kind;
+	unsigned char sizes; /* SZ_*, operand sizes accepted as a suffix */
+	unsigned char pfx; /* mandatory prefix */
+	unsigned char ext;
+	unsigned char nop;
+	unsigned char op[3];
+};
+
+static const struct x86_op x86_ops[] = {
+	{ "add", X86_ALU, SZ_BWLQ, 0, 0, 0, { 0 } },
+	{ "or",  X86_ALU, SZ_BWLQ, 0, 1, 0, { 0 } },
+	{ "adc", X86_ALU, SZ_BWLQ, 0, 2, 0, { 0 } },
+	{ "sbb", X86_ALU, SZ_BWLQ, 0, 3, 0, { 0 } },
+	{ "and", X86_ALU, SZ_BWLQ, 0, 4, 0, { 0 } },
+	{ "sub", X86_ALU, SZ_BWLQ, 0, 5, 0, { 0 } },
+	{ "xor", X86_ALU, SZ_BWLQ, 0, 6, 0, { 0 } },
+	{ "cmp", X86_ALU, SZ_BWLQ, 0, 7, 0, { 0 } },
+
+	{ "test", X86_TEST, SZ_BWLQ, 0, 0, 0, { 0 } },
+	{ "mov", X86_MOV, SZ_BWLQ, 0, 0, 0, { 0 } },
+	{ "movabs", X86_MOVABS, SZ_Q, 0, 0, 0, { 0 } },
+
+	{ "movzb", X86_MOVX, SZ_WLQ, 0, 1, 2, { 0x0f, 0xb6 } },
+	{ "movzw", X86_MOVX, SZ_L | SZ_Q, 0, 2, 2, { 0x0f, 0xb7 } },
+	{ "movsb", X86_MOVX, SZ_WLQ, 0, 1, 2, { 0x0f, 0xbe } },
+	{ "movsw", X86_MOVX, SZ_L | SZ_Q, 0, 2, 2, { 0x0f, 0xbf } },
+	{ "movsl", X86_MOVX, SZ_Q, 0, 4, 1, { 0x63 } },
+
+	{ "lea", X86_LEA, SZ_WLQ, 0, 0, 1, { 0x8d } },
+
+	{ "not",  X86_GRP3, SZ_BWLQ, 0, 2, 0, { 0 } },
+	{ "neg",  X86_GRP3, SZ_BWLQ, 0, 3, 0, { 0 } },
+	{ "mul",  X86_GRP3, SZ_BWLQ, 0, 4, 0, { 0 } },
+	{ "div",  X86_GRP3, SZ_BWLQ, 0, 6, 0, { 0 } },
+	{ "idiv", X86_GRP3, SZ_BWLQ, 0, 7, 0, { 0 } },
+	{ "inc",  X86_INCDEC, SZ_BWLQ, 0, 0, 0, { 0 } },
+	{ "dec",  X86_INCDEC, SZ_BWLQ, 0, 1, 0, { 0 } },
+	{ "imul", X86_IMUL, SZ_BWLQ, 0, 5, 0, { 0 } },
+
+	{ "rol", X86_SHIFT, SZ_BWLQ, 0, 0, 0, { 0 } },
+	{ "ror", X86_SHIFT, SZ_BWLQ, 0, 1, 0, { 0 } },
+	{ "rcl", X86_SHIFT, SZ_BWLQ, 0, 2, 0, { 0 } },
+	{ "rcr", X86_SHIFT, SZ_BWLQ, 0, 3, 0, { 0 } },
+	{ "shl", X86_SHIFT, SZ_BWLQ, 0, 4, 0, { 0 } },
+	{ "sal", X86_SHIFT, SZ_BWLQ, 0, 4, 0, { 0 } },
+	{ "shr", X86_SHIFT, SZ_BWLQ, 0, 5, 0, { 0 } },
+	{ "sar", X86_SHIFT, SZ_BWLQ, 0, 7, 0, { 0 } },
+
+	{ "push", X86_PUSH, SZ_Q, 0, 0, 0, { 0 } },
+	{ "pop", X86_POP, SZ_Q, 0, 0, 0, { 0 } },
+	{ "call", X86_CALL, SZ_Q, 0, 0, 0, { 0 } },
+	{ "jmp", X86_JMP, SZ_Q, 0, 0, 0, { 0 } },
+
+	{ "bsf", X86_RM_R, SZ_WLQ, 0, 0, 2, { 0x0f, 0xbc } },
+	{ "bsr", X86_RM_R, SZ_WLQ, 0, 0, 2, { 0x0f, 0xbd } },
+	{ "popcnt", X86_RM_R, SZ_WLQ, 0xf3, 0, 2, { 0x0f, 0xb8 } },
+	{ "lzcnt", X86_RM_R, SZ_WLQ, 0xf3, 0, 2, { 0x0f, 0xbd } },
+	{ "tzcnt", X86_RM_R, SZ_WLQ, 0xf3, 0, 2, { 0x0f, 0xbc } },
+	{ "xchg", X86_R_RM, SZ_BWLQ, 0, 0, 1, { 0x87 } },
+	{ "xadd", X86_R_RM, SZ_BWLQ, 0, 0, 2, { 0x0f, 0xc1 } },
+	{ "cmpxchg", X86_R_RM, SZ_BWLQ, 0, 0, 2, { 0x0f, 0xb1 } },
+	{ "bswap", X86_BSWAP, SZ_L | SZ_Q, 0, 0, 2, { 0x0f, 0xc8 } },
+	{ "prefetchnta", X86_MEM_EXT, 0, 0, 0, 2, { 0x0f, 0x18 } },
+	{ "prefetcht0", X86_MEM_EXT, 0, 0, 1, 2, { 0x0f, 0x18 } },
+	{ "prefetcht1", X86_MEM_EXT, 0, 0, 2, 2, { 0x0f, 0x18 } },
+	{ "prefetcht2", X86_MEM_EXT, 0, 0, 3, 2, { 0x0f, 0x18 } },
+
+	{ "movs", X86_STRING, SZ_BWLQ, 0, 0, 1, { 0xa4 } },
+	{ "cmps", X86_STRING, SZ_BWLQ, 0, 0, 1, { 0xa6 } },
+	{ "stos", X86_STRING, SZ_BWLQ, 0, 0, 1, { 0xaa } },
+	{ "lods", X86_STRING, SZ_BWLQ, 0, 0, 1, { 0xac } },
+	{ "scas", X86_STRING, SZ_BWLQ, 0, 0, 1, { 0xae } },
+
+	{ "ret", X86_FIXED, SZ_Q, 0, 0, 1, { 0xc3 } },
+	{ "leave", X86_FIXED, SZ_Q, 0, 0, 1, { 0xc9 } },
+	{ "nop", X86_FIXED, 0, 0, 0, 1, { 0x90 } },
+	{ "hlt", X86_FIXED, 0, 0, 0, 1, { 0xf4 } },
+	{ "int3", X86_FIXED, 0, 0, 0, 1, { 0xcc } },
+	{ "ud2", X86_FIXED, 0, 0, 0, 2, { 0x0f, 0x0b } },
+	{ "cbtw", X86_FIXED, 0, 0x66, 0, 1, { 0x98 } },
+	{ "cwtl", X86_FIXED, 0, 0, 0, 1, { 0x98 } },
+	{ "cltq", X86_FIXED, 0, 0, 0, 2, { 0x48, 0x98 } },
+	{ "cwtd", X86_FIXED, 0, 0x66, 0, 1, { 0x99 } },
+	{ "cltd", X86_FIXED, 0, 0, 0, 1, { 0x99 } },
+	{ "cqto", X86_FIXED, 0, 0, 0, 2, { 0x48, 0x99 } },
+	{ "cld", X86_FIXED, 0, 0, 0, 1, { 0xfc } },
+	{ "std", X86_FIXED, 0, 0, 0, 1, { 0xfd } },
+	{ "pause", X86_FIXED, 0, 0xf3, 0, 1, { 0x90 } },
+	{ "mfence", X86_FIXED, 0, 0, 0, 3, { 0x0f, 0xae, 0xf0 } },
+	{ "lfence", X86_FIXED, 0, 0, 0, 3, { 0x0f, 0xae, 0xe8 } },
+	{ "sfence", X86_FIXED, 0, 0, 0, 3, { 0x0f, 0xae, 0xf8 } },
+	{ "rdtsc", X86_FIXED, 0, 0, 0, 2, { 0x0f, 0x31 } },
+	{ "cpuid", X86_FIXED, 0, 0, 0, 2, { 0x0f, 0xa2 } },
+	{ "syscall", X86_FIXED, 0, 0, 0, 2, { 0x0f, 0x05 } },
+
+	{ "lock", X86_PREFIX, 0, 0, 0, 1, { 0xf0 } },
+	{ "rep", X86_PREFIX, 0, 0, 0, 1, { 0xf3 } },
+	{ "repe", X86_PREFIX, 0, 0, 0, 1, { 0xf3 } },
+	{ "repz", X86_PREFIX, 0, 0, 0, 1, { 0xf3 } },
+	{ "repne", X86_PREFIX, 0, 0, 0, 1, { 0xf2 } },
+	{ "repnz", X86_PREFIX, 0, 0, 0, 1, { 0xf2 } },
+
+	{ "movss", X86_SSE_MOV, 0, 0xf3, 0, 3, { 0x0f, 0x10, 0x11 } },
+	{ "movsd", X86_SSE_MOV, 0, 0xf2, 0, 3, { 0x0f, 0x10, 0x11 } },
+	{ "movaps", X86_SSE_MOV, 0, 0, 0, 3, { 0x0f, 0x28, 0x29 } },
+	{ "movapd", X86_SSE_MOV, 0, 0x66, 0, 3, { 0x0f, 0x28, 0x29 } },
+	{ "movups", X86_SSE_MOV, 0, 0, 0, 3, { 0x0f, 0x10, 0x11 } },
+	{ "movupd", X86_SSE_MOV, 0, 0x66, 0, 3, { 0x0f, 0x10, 0x11 } },
+	{ "movdqa", X86_SSE_MOV, 0, 0x66, 0, 3, { 0x0f, 0x6f, 0x7f } },
+	{ "movdqu", X86_SSE_MOV, 0, 0xf3, 0, 3, { 0x0f, 0x6f, 0x7f } },
+
+#define SSE_ARITH(nam, opc) \
+	{ nam "ss", X86_SSE, 0, 0xf3, 0, 2, { 0x0f, opc } }, \
+	{ nam "sd", X86_SSE, 0, 0xf2, 0, 2, { 0x0f, opc } }, \
+	{ nam "ps", X86_SSE, 0, 0, 0, 2, { 0x0f, opc } }, \
+	{ nam "pd", X86_SSE, 0, 0x66, 0, 2, { 0x0f, opc } }
+	SSE_ARITH("add", 0x58),
+	SSE_ARITH("mul", 0x59),
+	SSE_ARITH("sub", 0x5c),
+	SSE_ARITH("min", 0x5d),
+	SSE_ARITH("div", 0x5e),
+	SSE_ARITH("max", 0x5f),
+	SSE_ARITH("sqrt", 0x51),
+#undef SSE_ARITH
+
+#define SSE_LOGIC(nam, opc) \
+	{ nam "ps", X86_SSE, 0, 0, 0, 2, { 0x0f, opc } }, \
+	{ nam "pd", X86_SSE, 0, 0x66, 0, 2, { 0x0f, opc } }
+	SSE_LOGIC("and", 0x54),
+	SSE_LOGIC("andn", 0x55),
+	SSE_LOGIC("or", 0x56),
+	SSE_LOGIC("xor", 0x57),
+	SSE_LOGIC("unpckl", 0x14),
+	SSE_LOGIC("unpckh", 0x15),
+#undef SSE_LOGIC
+
+	{ "ucomiss", X86_SSE, 0, 0, 0, 2, { 0x0f, 0x2e } },
+	{ "ucomisd", X86_SSE, 0, 0x66, 0, 2, { 0x0f, 0x2e } },
+	{ "comiss", X86_SSE, 0, 0, 0, 2, { 0x0f, 0x2f } },
+	{ "comisd", X86_SSE, 0, 0x66, 0, 2, { 0x0f, 0x2f } },
+	{ "cvtss2sd", X86_SSE, 0, 0xf3, 0, 2, { 0x0f, 0x5a } },
+	{ "cvtsd2ss", X86_SSE, 0, 0xf2, 0, 2, { 0x0f, 0x5a } },
+	{ "cvtps2pd", X86_SSE, 0, 0, 0, 2, { 0x0f, 0x5a } },
+	{ "cvtpd2ps", X86_SSE, 0, 0x66, 0, 2, { 0x0f, 0x5a } },
+	{ "cvtdq2ps", X86_SSE, 0, 0, 0, 2, { 0x0f, 0x5b } },
+	{ "cvttps2dq", X86_SSE, 0, 0xf3, 0, 2, { 0x0f, 0x5b } },
+	{ "cvtdq2pd", X86_SSE, 0, 0xf3, 0, 2, { 0x0f, 0xe6 } },
+	{ "cvttpd2dq", X86_SSE, 0, 0x66, 0, 2, { 0x0f, 0xe6 } },
+
+#define SSE_INT(nam, opc) \
+	{ nam, X86_SSE, 0, 0x66, 0, 2, { 0x0f, opc } }
+	SSE_INT("paddb", 0xfc),
+	SSE_INT("paddw", 0xfd),
+	SSE_INT("paddd", 0xfe),
+	SSE_INT("paddq", 0xd4),
+	SSE_INT("psubb", 0xf8),
+	SSE_INT("psubw", 0xf9),
+	SSE_INT("psubd", 0xfa),
+	SSE_INT("psubq", 0xfb),
+	SSE_INT("pmullw", 0xd5),
+	SSE_INT("pmuludq", 0xf4),
+	SSE_INT("pand", 0xdb),
+	SSE_INT("pandn", 0xdf),
+	SSE_INT("por", 0xeb),
+	SSE_INT("pxor", 0xef),
+	SSE_INT("pcmpeqb", 0x74),
+	SSE_INT("pcmpeqw", 0x75),
+	SSE_INT("pcmpeqd", 0x76),
+	SSE_INT("pcmpgtb", 0x64),
+	SSE_INT("pcmpgtw", 0x65),
+	SSE_INT("pcmpgtd", 0x66),
+	SSE_INT("punpcklbw", 0x60),
+	SSE_INT("punpcklwd", 0x61),
+	SSE_INT("punpckldq", 0x62),
+	SSE_INT("punpcklqdq", 0x6c),
+	SSE_INT("punpckhqdq", 0x6d),
+#undef SSE_INT
+
+	{ "pshufd", X86_SSE_IMM, 0, 0x66, 0, 2, { 0x0f, 0x70 } },
+	{ "shufps", X86_SSE_IMM, 0, 0, 0, 2, { 0x0f, 0xc6 } },
+	{ "shufpd", X86_SSE_IMM, 0, 0x66, 0, 2, { 0x0f, 0xc6 } },
+
+	{ "cvtsi2ss", X86_CVT_I2F, SZ_L | SZ_Q, 0xf3, 0, 2, { 0x0f, 0x2a } },
+	{ "cvtsi2sd", X86_CVT_I2F, SZ_L | SZ_Q, 0xf2, 0, 2, { 0x0f, 0x2a } },
+	{ "cvttss2si", X86_CVT_F2I, SZ_L | SZ_Q, 0xf3, 0, 2, { 0x0f, 0x2c } },
+	{ "cvttsd2si", X86_CVT_F2I, SZ_L | SZ_Q, 0xf2, 0, 2, { 0x0f, 0x2c } },
+	{ "cvtss2si", X86_CVT_F2I, SZ_L | SZ_Q, 0xf3, 0, 2, { 0x0f, 0x2d } },
+	{ "cvtsd2si", X86_CVT_F2I, SZ_L | SZ_Q, 0xf2, 0, 2, { 0x0f, 0x2d } },
+
+	{ "movd", X86_MOVD, 0, 0x66, 0, 0, { 0 } },
+};
+
+static const char x86_regs64[][4] = {
+	"rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi"
+};
+static const char x86_regs32[][4] = {
+	"eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi"
+};
+static const char x86_regs16[][3] = {
+	"ax", "cx", "dx", "bx", "sp", "bp", "si", "di"
+};
+static const char x86_regs8[][4] = {
+	"al", "cl", "dl", "bl", "spl", "bpl", "sil", "dil"
+};
+static const char x86_regs8h[][3] = {
+	"ah", "ch", "dh", "bh"
+};
+static const struct
+{
+	char name[3];
+	unsigned char prefix;
+} x86_segs[] = {
+	{ "es", 0x26 }, { "cs", 0x2e }, { "ss", 0x36 },
+	{ "ds", 0x3e }, { "fs", 0x64 }, { "gs", 0x65 },
+};
+
+static const char x86_conds[][4] = {
+	"o", "no", "b", "ae", "e", "ne", "be", "a",
+	"s", "ns", "p", "np", "l", "ge", "le", "g"
+};
+static const struct
+{
+	char name[4];
+	unsigned char cc;
+} x86_cond_aliases[] = {
+	{ "c", 2 }, { "nae", 2 }, { "nb", 3 }, { "nc", 3 },
+	{ "z", 4 }, { "nz", 5 }, { "na", 6 }, { "nbe", 7 },
+	{ "pe", 10 }, { "po", 11 }, { "nge", 12 }, { "nl", 13 },
+	{ "ng", 14 }, { "nle", 15 },
+};
+
+/* instruction being built */
+struct x86_enc
+{
+	unsigned char prefixes[4];
+	unsigned nprefixes;
+	int opsize16;
+	unsigned char mandatory;
+	unsigned rex;
+	int need_rex, forbid_rex;
+
+	unsigned char op[3];
+	unsigned nop;
+
+	int has_modrm, has_sib;
+	unsigned char modrm, sib;
+
+	unsigned disp_size;
+	int disp_riprel;
+	struct obj_expr disp;
+
+	unsigned imm_size;
+	int imm_signed;
+	struct obj_expr imm;
+
+	int has_rel;
+	struct obj_expr rel;
+};
+
+static int x86_parse_reg(const char **pp, struct x86_opnd *o)
+{
+	const char *p = *pp, *start;
+	size_t len, i;
+
+	start = p;
+	while(isalnum(*p))
+		p++;
+	len = p - start;
+	*pp = p;
+
+	memset(o, 0, sizeof *o);
+	o->kind = XO_REG;
+
+#define REG_IS(s) (len == strlen(s) && !strncmp(start, s, len))
+	for(i = 0; i < 8; i++){
+		if(REG_IS(x86_regs64[i])){ o->reg = i; o->size = 8; return 0; }
+		if(REG_IS(x86_regs32[i])){ o->reg = i; o->size = 4; return 0; }
+		if(REG_IS(x86_regs16[i])){ o->reg = i; o->size = 2; return 0; }
+		if(REG_IS(x86_regs8[i])){
+			o->reg = i;
+			o->size = 1;
+			o->rex_byte = i >= 4;
+			return 0;
+		}
+		if(i < 4 && REG_IS(x86_regs8h[i])){
+			o->reg = i + 4;
+			o->size = 1;
+			o->high_byte = 1;
+			return 0;
+		}
+	}
+#undef REG_IS
+
+	if(len >= 2 && start[0] == 'r' && isdigit(start[1])){
+		char *end;
+		unsigned long n = strtoul(start + 1, &end, 10);
+
+		if(8 <= n && n <= 15){
+			o->reg = n;
+			if(end == p){
+				o->size = 8;
+				return 0;
+			}
+			if(end + 1 == p){
+				switch(*end){
+					case 'd': o->size = 4; return 0;
+					case 'w': o->size = 2; return 0;
+					case 'b':
+					case 'l': o->size = 1; return 0;
+				}
+			}
+		}
+	}
+
+	if(len >= 4 && !strncmp(start, "xmm", 3)){
+		char *end;
+		unsigned long n = strtoul(start + 3, &end, 10);
+
+		if(end == p && n <= 15){
+			o->kind = XO_XMM;
+			o->reg = n;
+			o->size = 16;
+			return 0;
+		}
+	}
+
+	obj_error("unknown register \"%%%.*s\"", (int)len, start);
+	return 1;
+}
+
+static int x86_parse_seg(const char *p, size_t len, unsigned char *prefix)
+{
+	size_t i;
+
+	for(i = 0; i < countof(x86_segs); i++){
+		if(len == 2 && !strncmp(p, x86_segs[i].name, 2)){
+			*prefix = x86_segs[i].prefix;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static int x86_parse_mem_reg(const char **pp, int *reg, int allow_rip)
+{
+	struct x86_opnd r;
+	const char *p = *pp;
+
+	if(*p != '%'){
+		obj_error("expected register in memory operand");
+		return 1;
+	}
+	p++;
+
+	if(allow_rip && !strncmp(p, "rip", 3) && !isalnum(p[3])){
+		*reg = -2;
+		*pp = p + 3;
+		return 0;
+	}
+
+	if(x86_parse_reg(&p, &r))
+		return 1;
+	if(r.kind != XO_REG || r.size != 8){
+		obj_error("memory operand registers must be 64-bit");
+		return 1;
+	}
+
+	*reg = r.reg;
+	*pp = p;
+	return 0;
+}
+
+static int x86_parse_mem(const char *p, struct x86_opnd *o)
+{
+	o->kind = XO_MEM;
+	o->base = o->index = X86_NOREG;
+	o->scale = 1;
+
+	while(*p == ' ')
+		p++;
+
+	if(!(*p == '(' && (p[1] == '%' || p[1] == ','))){
+		if(obj_expr_parse(&p, &o->expr))
+			return 1;
+	}
+
+	if(*p == '('){
+		p++;
+		while(*p == ' ')
+			p++;
+
+		if(*p == '%'){
+			if(x86_parse_mem_reg(&p, &o->base, 1))
+				return 1;
+			if(o->base == -2){
+				o->base = X86_NOREG;
+				o->riprel = 1;
+			}
+		}
+
+		while(*p == ' ')
+			p++;
+		if(*p == ','){
+			p++;
+			while(*p == ' ')
+				p++;
+			if(o->riprel){
+				obj_error("%%rip can't be indexed");
+				return 1;
+			}
+			if(x86_parse_mem_reg(&p, &o->index, 0))
+				return 1;
+			if(o->index == 4){
+				obj_error("%%rsp can't be an index register");
+				return 1;
+			}
+
+			while(*p == ' ')
+				p++;
+			if(*p == ','){
+				struct obj_expr scale;
+
+				p++;
+				if(obj_expr_parse(&p, &scale))
+					return 1;
+				if(!obj_expr_is_const(&scale)
+				|| (scale.num != 1 && scale.num != 2 && scale.num != 4 && scale.num != 8))
+				{
+					obj_error("scale must be 1, 2, 4 or 8");
+					return 1;
+				}
+				o->scale = scale.num;
+			}
+		}
+
+		while(*p == ' ')
+			p++;
+		if(*p != ')'){
+			obj_error("expected ')' in memory operand");
+			return 1;
+		}
+		p++;
+	}
+
+	while(*p == ' ')
+		p++;
+	if(*p){
+		obj_error("junk after operand: \"%s\"", p);
+		return 1;
+	}
+
+	return 0;
+}
+
+static int x86_parse_opnd(const char *p, struct x86_opnd *o)
+{
+	int indirect = 0;
+
+	memset(o, 0, sizeof *o);
+
+	if(*p == '*'){
+		indirect = 1;
+		p++;
+	}
+
+	if(*p == '$'){
+		p++;
+		o->kind = XO_IMM;
+		if(obj_expr_parse(&p, &o->expr))
+			return 1;
+		if(*p){
+			obj_error("junk after immediate: \"%s\"", p);
+			return 1;
+		}
+
+	}else if(*p == '%'){
+		const char *start = ++p;
+		unsigned char seg;
+
+		while(isalnum(*p))
+			p++;
+
+		if(*p == ':' && x86_parse_seg(start, p - start, &seg)){
+			if(x86_parse_mem(p + 1, o))
+				return 1;
+			o->seg = seg;
+		}else{
+			p = start;
+			if(x86_parse_reg(&p, o))
+				return 1;
+			while(*p == ' ')
+				p++;
+			if(*p){
+				obj_error("junk after register: \"%s\"", p);
+				return 1;
+			}
+		}
+
+	}else if(x86_parse_mem(p, o)){
+		return 1;
+	}
+
+	o->indirect = indirect;
+	return 0;
+}
+
+/* split on commas outside parentheses */
+static int x86_parse_opnds(const char *p, struct x86_opnd *opnds, unsigned *n)
+{
+	*n = 0;
+
+	while(*p == ' ' || *p == '\t')
+		p++;
+
+	while(*p){
+		char buf[256];
+		const char *start = p;
+		int depth = 0;
+		size_t len;
+
+		for(; *p && (depth || *p != ','); p++){
+			if(*p == '(')
+				depth++;
+			else if(*p == ')')
+				depth--;
+		}
+
+		len = p - start;
+		while(len && (start[len - 1] == ' ' || start[len - 1] == '\t'))
+			len--;
+		if(len >= sizeof buf){
+			obj_error("operand too long");
+			return 1;
+		}
+		if(*n == X86_MAX_OPNDS){
+			obj_error("too many operands");
+			return 1;
+		}
+
+		memcpy(buf, start, len);
+		buf[len] = '\0';
+		if(x86_parse_opnd(buf, &opnds[(*n)++]))
+			return 1;
+
+		if(*p == ','){
+			p++;
+			while(*p == ' ' || *p == '\t')
+				p++;
+			if(!*p){
+				obj_error("missing operand after ','");
+				return 1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+static int x86_cond(const char *s, size_t len)
+{
+	size_t i;
+
+	for(i = 0; i < countof(x86_conds); i++)
+		if(strlen(x86_conds[i]) == len && !strncmp(x86_conds[i], s, len))
+			return i;
+
+	for(i = 0; i < countof(x86_cond_aliases); i++)
+		if(strlen(x86_cond_aliases[i].name) == len && !strncmp(x86_cond_aliases[i].name, s, len))
+			return x86_cond_aliases[i].cc;
+
+	return -1;
+}
+
+static unsigned x86_suffix_size(char c)
+{
+	switch(c){
+		case 'b': return 1;
+		case 'w': return 2;
+		case 'l': return 4;
+		case 'q': return 8;
+	}
+	return 0;
+}
+
+static const struct x86_op *x86_lookup(const char *mn, size_t len, unsigned *sz)
+{
+	size_t i;
+
+	*sz = 0;
+
+	for(i = 0; i < countof(x86_ops); i++)
+		if(strlen(x86_ops[i].name) == len && !strncmp(x86_ops[i].name, mn, len))
+			return &x86_ops[i];
+
+	if(len > 1){
+		unsigned suffix = x86_suffix_size(mn[len - 1]);
+
+		if(suffix){
+			for(i = 0; i < countof(x86_ops); i++){
+				if(strlen(x86_ops[i].name) == len - 1
+				&& !strncmp(x86_ops[i].name, mn, len - 1)
+				&& (x86_ops[i].sizes & suffix))
+				{
+					*sz = suffix;
+					return &x86_ops[i];
+				}
+			}
+		}
+	}
+
+	return NULL;
+}
+
+/* ---- encoding ---- */
+
+static void x86_byte_reg_check(struct x86_enc *e, const struct x86_opnd *o)
+{
+	if(o->kind != XO_REG || o->size != 1)
+		return;
+	if(o->rex_byte)
+		e->need_rex = 1;
+	if(o->high_byte)
+		e->forbid_rex = 1;
+}
+
+static void x86_modrm(struct x86_enc *e, int regfield, const struct x86_opnd *rm)
+{
+	unsigned reg3 = (regfield & 7) << 3;
+
+	if(regfield & 8)
+		e->rex |= REX_R;
+
+	e->has_modrm = 1;
+
+	if(rm->kind == XO_REG || rm->kind == XO_XMM){
+		e->modrm = 0xc0 | reg3 | (rm->reg & 7);
+		if(rm->reg & 8)
+			e->rex |= REX_B;
+		x86_byte_reg_check(e, rm);
+		return;
+	}
+
+	if(rm->seg)
+		e->prefixes[e->nprefixes++] = rm->seg;
+
+	e->disp = rm->expr;
+
+	if(rm->riprel){
+		e->modrm = 0x05 | reg3;
+		e->disp_size = 4;
+		e->disp_riprel = 1;
+		return;
+	}
+
+	if(rm->base == X86_NOREG){
+		/* absolute or index-only: SIB with no base, disp32 */
+		unsigned index = rm->index == X86_NOREG ? 4 : rm->index;
+
+		e->modrm = 0x04 | reg3;
+		e->has_sib = 1;
+		e->sib = (ffs(rm->scale) - 1) << 6 | (index & 7) << 3 | 5;
+		if(index & 8)
+			e->rex |= REX_X;
+		e->disp_size = 4;
+		return;
+	}
+
+	{
+		unsigned mod;
+
+		if(!obj_expr_is_const(&rm->expr))
+			mod = 2;
+		else if(rm->expr.num == 0 && (rm->base & 7) != 5)
+			mod = 0;
+		else if(-128 <= rm->expr.num && rm->expr.num <= 127)
+			mod = 1;
+		else
+			mod = 2;
+
+		e->disp_size = mod == 0 ? 0 : mod == 1 ? 1 : 4;
+
+		if(rm->base & 8)
+			e->rex |= REX_B;
+
+		if(rm->index != X86_NOREG || (rm->base & 7) == 4){
+			unsigned index = rm->index == X86_NOREG ? 4 : rm->index;
+
+			e->modrm = mod << 6 | reg3 | 4;
+			e->has_sib = 1;
+			e->sib = (ffs(rm->scale) - 1) << 6 | (index & 7) << 3 | (rm->base & 7);
+			if(index & 8)
+				e->rex |= REX_X;
+		}else{
+			e->modrm = mod << 6 | reg3 | (rm->base & 7);
+		}
+	}
+}
+
+static void x86_op_set(struct x86_enc *e, const unsigned char *op, unsigned n)
+{
+	memcpy(e->op, op, n);
+	e->nop = n;
+}
+
+static void x86_op1(struct x86_enc *e, unsigned char op)
+{
+	e->op[0] = op;
+	e->nop = 1;
+}
+
+static void x86_size_prefix(struct x86_enc *e, unsigned sz)
+{
+	if(sz == 2)
+		e->opsize16 = 1;
+	else if(sz == 8)
+		e->rex |= REX_W;
+}
+
+static int x86_imm_fits(const struct obj_expr *ex, unsigned size, int is_signed)
+{
+	long long lo, hi;
+
+	if(!obj_expr_is_const(ex) || size >= 8)
+		return 1;
+
+	lo = -(1LL << (size * 8 - 1));
+	hi = is_signed ? (1LL << (size * 8 - 1)) - 1 : (1LL << (size * 8)) - 1;
+
+	return lo <= ex->num && ex->num <= hi;
+}
+
+static int x86_is_imm8(const struct x86_opnd *o)
+{
+	return obj_expr_is_const(&o->expr) && -128 <= o->expr.num && o->expr.num <= 127;
+}
+
+static int x86_set_imm(struct x86_enc *e, const struct x86_opnd *o, unsigned size, int is_signed)
+{
+	if(!x86_imm_fits(&o->expr, size, is_signed)){
+		obj_error("immediate %lld out of range for %u-byte operand", o->expr.num, size);
+		return 1;
+	}
+	e->imm = o->expr;
+	e->imm_size = size;
+	e->imm_signed = is_signed;
+	return 0;
+}
+
+/* operand size from the suffix, or failing that, the registers */
+static int x86_size(unsigned sz, const struct x86_opnd *opnds, unsigned n, unsigned *out)
+{
+	unsigned i;
+
+	for(i = 0; i < n; i++){
+		if(opnds[i].kind != XO_REG)
+			continue;
+		if(!sz){
+			sz = opnds[i].size;
+		}else if(opnds[i].size != sz){
+			obj_error("operand size mismatch");
+			return 1;
+		}
+	}
+
+	if(!sz){
+		obj_error("can't determine operand size, need a suffix");
+		return 1;
+	}
+
+	*out = sz;
+	return 0;
+}
+
+static int x86_want(const struct x86_opnd *o, unsigned kinds)
+{
+	return !!(kinds & (1u << o->kind));
+}
+
+#define WANT_REG (1u << XO_REG)
+#define WANT_XMM (1u << XO_XMM)
+#define WANT_IMM (1u << XO_IMM)
+#define WANT_MEM (1u << XO_MEM)
+#define WANT_RM (WANT_REG | WANT_MEM)
+#define WANT_XM (WANT_XMM | WANT_MEM)
+
+static int x86_check(const struct x86_opnd *opnds, unsigned n, unsigned expected, ...)
+{
+	va_list l;
+	unsigned i;
+	int bad = n != expected;
+
+	va_start(l, expected);
+	for(i = 0; i < n && !bad; i++){
+		unsigned kinds = va_arg(l, unsigned);
+		if(!x86_want(&opnds[i], kinds) || opnds[i].indirect)
+			bad = 1;
+	}
+	va_end(l);
+
+	if(bad)
+		obj_error("invalid operands");
+	return bad;
+}
+
+static int x86_encode_op(
+		struct x86_enc *e, const struct x86_op *op, unsigned sz,
+		struct x86_opnd *opnds, unsigned n)
+{
+	struct x86_opnd *src = &opnds[0], *dst = &opnds[n - 1];
+
+	if(op->pfx == 0x66 && op->kind != X86_FIXED)
+		e->mandatory = 0x66;
+	else if(op->pfx)
+		e->mandatory = op->pfx;
+
+	switch((enum x86_kind)op->kind){
+		case X86_FIXED:
+			if(n){
+				obj_error("\"%s\" takes no operands", op->name);
+				return 1;
+			}
+			if(op->pfx)
+				e->prefixes[e->nprefixes++] = op->pfx;
+			e->mandatory = 0;
+			x86_op_set(e, op->op, op->nop);
+			return 0;
+
+		case X86_PREFIX:
+			/* handled by the caller */
+			return 1;
+
+		case X86_ALU:
+			if(n != 2
+			|| !x86_want(src, WANT_IMM | WANT_RM)
+			|| !x86_want(dst, WANT_RM)
+			|| (src->kind == XO_MEM && dst->kind == XO_MEM))
+			{
+				obj_error("invalid operands");
+				return 1;
+			}
+			if(x86_size(sz, opnds, n, &sz))
+				return 1;
+			x86_size_prefix(e, sz);
+
+			if(src->kind == XO_IMM){
+				if(sz == 1){
+					x86_op1(e, 0x80);
+					if(x86_set_imm(e, src, 1, 0))
+						return 1;
+				}else if(x86_is_imm8(src)){
+					x86_op1(e, 0x83);
+					if(x86_set_imm(e, src, 1, 1))
+						return 1;
+				}else{
+					x86_op1(e, 0x81);
+					if(x86_set_imm(e, src, sz == 2 ? 2 : 4, sz == 8))
+						return 1;
+				}
+				x86_modrm(e, op->ext, dst);
+			}else if(src->kind == XO_REG){
+				x86_op1(e, op->ext * 8 + (sz == 1 ? 0 : 1));
+				x86_byte_reg_check(e, src);
+				x86_modrm(e, src->reg, dst);
+			}else{
+				x86_op1(e, op->ext * 8 + (sz == 1 ? 2 : 3));
+				x86_byte_reg_check(e, dst);
+				x86_modrm(e, dst->reg, src);
+			}
+			return 0;
+
+		case X86_TEST:
+			if(n != 2
+			|| !x86_want(src, WANT_IMM | WANT_RM)
+			|| !x86_want(dst, WANT_RM)
+			|| (src->kind == XO_MEM && dst->kind == XO_MEM))
+			{
+				obj_error("invalid operands");
+				return 1;
+			}
+			if(x86_size(sz, opnds, n, &sz))
+				return 1;
+			x86_size_prefix(e, sz);
+
+			if(src->kind == XO_IMM){
+				x86_op1(e, sz == 1 ? 0xf6 : 0xf7);
+				if(x86_set_imm(e, src, sz == 1 ? 1 : sz == 2 ? 2 : 4, sz == 8))
+					return 1;
+				x86_modrm(e, 0, dst);
+			}else{
+				struct x86_opnd *reg = src->kind == XO_REG ? src : dst;
+				struct x86_opnd *rm = reg == src ? dst : src;
+
+				x86_op1(e, sz == 1 ? 0x84 : 0x85);
+				x86_byte_reg_check(e, reg);
+				x86_modrm(e, reg->reg, rm);
+			}
+			return 0;
+
+		case X86_MOV:
+			if(n != 2
+			|| !x86_want(src, WANT_IMM | WANT_RM)
+			|| !x86_want(dst, WANT_RM)
+			|| (src->kind == XO_MEM && dst->kind == XO_MEM))
+			{
+				obj_error("invalid operands");
+				return 1;
+			}
+			if(x86_size(sz, opnds, n, &sz))
+				return 1;
+			x86_size_prefix(e, sz);
+
+			if(src->kind == XO_IMM){
+				if(dst->kind == XO_REG && sz != 8){
+					x86_op1(e, (sz == 1 ? 0xb0 : 0xb8) + (dst->reg & 7));
+					if(dst->reg & 8)
+						e->rex |= REX_B;
+					x86_byte_reg_check(e, dst);
+					return x86_set_imm(e, src, sz, 0);
+				}
+				if(dst->kind == XO_REG && !x86_imm_fits(&src->expr, 4, 1)){
+					/* movq $big, %reg: movabs */
+					x86_op1(e, 0xb8 + (dst->reg & 7));
+					if(dst->reg & 8)
+						e->rex |= REX_B;
+					return x86_set_imm(e, src, 8, 0);
+				}
+				x86_op1(e, sz == 1 ? 0xc6 : 0xc7);
+				if(x86_set_imm(e, src, sz == 1 ? 1 : sz == 2 ? 2 : 4, sz == 8))
+					return 1;
+				x86_modrm(e, 0, dst);
+			}else if(src->kind == XO_REG){
+				x86_op1(e, sz == 1 ? 0x88 : 0x89);
+				x86_byte_reg_check(e, src);
+				x86_modrm(e, src->reg, dst);
+			}else{
+				x86_op1(e, sz == 1 ? 0x8a : 0x8b);
+				x86_byte_reg_check(e, dst);
+				x86_modrm(e, dst->reg, src);
+			}
+			return 0;
+
+		case X86_MOVABS:
+			if(x86_check(opnds, n, 2, WANT_IMM, WANT_REG))
+				return 1;
+			if(x86_size(8, opnds + 1, 1, &sz))
+				return 1;
+			e->rex |= REX_W;
+			x86_op1(e, 0xb8 + (dst->reg & 7));
+			if(dst->reg & 8)
+				e->rex |= REX_B;
+			return x86_set_imm(e, src, 8, 0);
+
+		case X86_MOVX:
+			if(x86_check(opnds, n, 2, WANT_RM, WANT_REG))
+				return 1;
+			if(src->kind == XO_REG && src->size != op->ext){
+				obj_error("operand size mismatch");
+				return 1;
+			}
+			if(x86_size(sz, opnds + 1, 1, &sz))
+				return 1;
+			x86_size_prefix(e, sz);
+			x86_op_set(e, op->op, op->nop);
+			x86_modrm(e, dst->reg, src);
+			return 0;
+
+		case X86_LEA:
+			if(x86_check(opnds, n, 2, WANT_MEM, WANT_REG)
+			|| x86_size(sz, opnds + 1, 1, &sz))
+			{
+				return 1;
+			}
+			x86_size_prefix(e, sz);
+			x86_op_set(e, op->op, op->nop);
+			x86_modrm(e, dst->reg, src);
+			return 0;
+
+		case X86_GRP3:
+		case X86_INCDEC:
+			if(x86_check(opnds, n, 1, WANT_RM) || x86_size(sz, opnds, n, &sz))
+				return 1;
+			x86_size_prefix(e, sz);
+			if(op->kind == X86_GRP3)
+				x86_op1(e, sz == 1 ? 0xf6 : 0xf7);
+			else
+				x86_op1(e, sz == 1 ? 0xfe : 0xff);
+			x86_modrm(e, op->ext, src);
+			return 0;
+
+		case X86_IMUL:
+			if(n == 1){
+				if(x86_size(sz, opnds, n, &sz))
+					return 1;
+				x86_size_prefix(e, sz);
+				x86_op1(e, sz == 1 ? 0xf6 : 0xf7);
+				x86_modrm(e, op->ext, src);
+				return 0;
+			}
+			if(n == 2 && src->kind != XO_IMM){
+				static const unsigned char imul_rm[] = { 0x0f, 0xaf };
+
+				if(x86_check(opnds, n, 2, WANT_RM, WANT_REG) || x86_size(sz, opnds, n, &sz))
+					return 1;
+				if(sz == 1){
+					obj_error("invalid operand size");
+					return 1;
+				}
+				x86_size_prefix(e, sz);
+				x86_op_set(e, imul_rm, 2);
+				x86_modrm(e, dst->reg, src);
+				return 0;
+			}
+			/* imul $imm, [r/m,] reg */
+			if(n == 2 ? x86_check(opnds, n, 2, WANT_IMM, WANT_REG)
+			          : x86_check(opnds, n, 3, WANT_IMM, WANT_RM, WANT_REG))
+			{
+				return 1;
+			}
+			if(x86_size(sz, opnds + 1, n - 1, &sz))
+				return 1;
+			if(sz == 1){
+				obj_error("invalid operand size");
+				return 1;
+			}
+			x86_size_prefix(e, sz);
+			if(x86_is_imm8(src)){
+				x86_op1(e, 0x6b);
+				if(x86_set_imm(e, src, 1, 1))
+					return 1;
+			}else{
+				x86_op1(e, 0x69);
+				if(x86_set_imm(e, src, sz == 2 ? 2 : 4, sz == 8))
+					return 1;
+			}
+			/* two operand form: the register is both source and destination */
+			x86_modrm(e, dst->reg, n == 2 ? dst : &opnds[1]);
+			return 0;
+
+		case X86_SHIFT:
+		{
+			const struct x86_opnd *count = n == 2 ? src : NULL;
+
+			if(n == 1 ? x86_check(opnds, n, 1, WANT_RM)
+			          : x86_check(opnds, n, 2, WANT_IMM | WANT_REG, WANT_RM))
+			{
+				return 1;
+			}
+			if(count && count->kind == XO_REG && (count->reg != 1 || count->size != 1)){
+				obj_error("shift count register must be %%cl");
+				return 1;
+			}
+			if(x86_size(sz, &opnds[n - 1], 1, &sz))
+				return 1;
+			x86_size_prefix(e, sz);
+
+			if(!count || (count->kind == XO_IMM && obj_expr_is_const(&count->expr) && count->expr.num == 1)){
+				x86_op1(e, sz == 1 ? 0xd0 : 0xd1);
+			}else if(count->kind == XO_REG){
+				x86_op1(e, sz == 1 ? 0xd2 : 0xd3);
+			}else{
+				x86_op1(e, sz == 1 ? 0xc0 : 0xc1);
+				if(x86_set_imm(e, count, 1, 0))
+					return 1;
+			}
+			x86_modrm(e, op->ext, dst);
+			return 0;
+		}
+
+		case X86_PUSH:
+			if(x86_check(opnds, n, 1, WANT_IMM | WANT_RM))
+				return 1;
+			if(src->kind == XO_IMM){
+				if(x86_is_imm8(src)){
+					x86_op1(e, 0x6a);
+					return x86_set_imm(e, src, 1, 1);
+				}
+				x86_op1(e, 0x68);
+				return x86_set_imm(e, src, 4, 1);
+			}
+			if(src->kind == XO_REG){
+				if(src->size != 8){
+					obj_error("push needs a 64-bit register");
+					return 1;
+				}
+				x86_op1(e, 0x50 + (src->reg & 7));
+				if(src->reg & 8)
+					e->rex |= REX_B;
+				return 0;
+			}
+			x86_op1(e, 0xff);
+			x86_modrm(e, 6, src);
+			return 0;
+
+		case X86_POP:
+			if(x86_check(opnds, n, 1, WANT_RM))
+				return 1;
+			if(src->kind == XO_REG){
+				if(src->size != 8){
+					obj_error("pop needs a 64-bit register");
+					return 1;
+				}
+				x86_op1(e, 0x58 + (src->reg & 7));
+				if(src->reg & 8)
+					e->rex |= REX_B;
+				return 0;
+			}
+			x86_op1(e, 0x8f);
+			x86_modrm(e, 0, src);
+			return 0;
+
+		case X86_CALL:
+		case X86_JMP:
+			if(n != 1 || src->kind == XO_IMM || src->kind == XO_XMM){
+				obj_error("invalid operands");
+				return 1;
+			}
+			if(src->indirect){
+				if(src->kind == XO_REG && src->size != 8){
+					obj_error("indirect branch needs a 64-bit register");
+					return 1;
+				}
+				x86_op1(e, 0xff);
+				x86_modrm(e, op->kind == X86_CALL ? 2 : 4, src);
+				return 0;
+			}
+			if(src->kind != XO_MEM || src->base != X86_NOREG || src->index != X86_NOREG || src->riprel || src->seg){
+				obj_error("branch target must be a symbol, or indirect with '*'");
+				return 1;
+			}
+			x86_op1(e, op->kind == X86_CALL ? 0xe8 : 0xe9);
+			e->has_rel = 1;
+			e->rel = src->expr;
+			return 0;
+
+		case X86_RM_R:
+			if(x86_check(opnds, n, 2, WANT_RM, WANT_REG) || x86_size(sz, opnds, n, &sz))
+				return 1;
+			if(sz == 1){
+				obj_error("invalid operand size");
+				return 1;
+			}
+			x86_size_prefix(e, sz);
+			x86_op_set(e, op->op, op->nop);
+			x86_modrm(e, dst->reg, src);
+			return 0;
+
+		case X86_R_RM:
+			if(x86_check(opnds, n, 2, WANT_REG, WANT_RM) || x86_size(sz, opnds, n, &sz))
+				return 1;
+			x86_size_prefix(e, sz);
+			x86_op_set(e, op->op, op->nop);
+			if(sz == 1)
+				e->op[e->nop - 1]--;
+			x86_byte_reg_check(e, src);
+			x86_modrm(e, src->reg, dst);
+			return 0;
+
+		case X86_BSWAP:
+			if(x86_check(opnds, n, 1, WANT_REG) || x86_size(sz, opnds, n, &sz))
+				return 1;
+			if(sz < 4){
+				obj_error("invalid operand size");
+				return 1;
+			}
+			x86_size_prefix(e, sz);
+			x86_op_set(e, op->op, op->nop);
+			e->op[1] += src->reg & 7;
+			if(src->reg & 8)
+				e->rex |= REX_B;
+			return 0;
+
+		case X86_MEM_EXT:
+			if(x86_check(opnds, n, 1, WANT_MEM))
+				return 1;
+			x86_op_set(e, op->op, op->nop);
+			x86_modrm(e, op->ext, src);
+			return 0;
+
+		case X86_STRING:
+			/* explicit operands are the implicit %rsi/%rdi - ignore them */
+			if(!sz){
+				obj_error("\"%s\" needs a size suffix", op->name);
+				return 1;
+			}
+			x86_size_prefix(e, sz);
+			x86_op1(e, op->op[0] + (sz != 1));
+			return 0;
+
+		case X86_SSE:
+			if(x86_check(opnds, n, 2, WANT_XM, WANT_XMM))
+				return 1;
+			x86_op_set(e, op->op, op->nop);
+			x86_modrm(e, dst->reg, src);
+			return 0;
+
+		case X86_SSE_IMM:
+			if(x86_check(opnds, n, 3, WANT_IMM, WANT_XM, WANT_XMM))
+				return 1;
+			x86_op_set(e, op->op, op->nop);
+			x86_modrm(e, dst->reg, &opnds[1]);
+			return x86_set_imm(e, src, 1, 0);
+
+		case X86_SSE_MOV:
+			if(n != 2 || src->indirect || dst->indirect){
+				obj_error("invalid operands");
+				return 1;
+			}
+			if(dst->kind == XO_XMM && x86_want(src, WANT_XM)){
+				x86_op_set(e, op->op, 2);
+				x86_modrm(e, dst->reg, src);
+				return 0;
+			}
+			if(src->kind == XO_XMM && dst->kind == XO_MEM){
+				e->op[0] = op->op[0];
+				e->op[1] = op->op[2];
+				e->nop = 2;
+				x86_modrm(e, src->reg, dst);
+				return 0;
+			}
+			obj_error("invalid operands");
+			return 1;
+
+		case X86_CVT_I2F:
+			if(x86_check(opnds, n, 2, WANT_RM, WANT_XMM))
+				return 1;
+			if(!sz && src->kind == XO_REG)
+				sz = src->size;
+			if(!sz)
+				sz = 4;
+			if((sz != 4 && sz != 8) || (src->kind == XO_REG && src->size != sz)){
+				obj_error("operand size mismatch");
+				return 1;
+			}
+			if(sz == 8)
+				e->rex |= REX_W;
+			x86_op_set(e, op->op, op->nop);
+			x86_modrm(e, dst->reg, src);
+			return 0;
+
+		case X86_CVT_F2I:
+			if(x86_check(opnds, n, 2, WANT_XM, WANT_REG) || x86_size(sz, opnds + 1, 1, &sz))
+				return 1;
+			if(sz != 4 && sz != 8){
+				obj_error("operand size mismatch");
+				return 1;
+			}
+			if(sz == 8)
+				e->rex |= REX_W;
+			x86_op_set(e, op->op, op->nop);
+			x86_modrm(e, dst->reg, src);
+			return 0;
+
+		case X86_MOVD:
+		{
+			/* sz is 4 for movd, 8 for movq */
+			static const unsigned char to_xmm[] = { 0x0f, 0x6e }, from_xmm[] = { 0x0f, 0x7e };
+
+			if(n != 2 || src->indirect || dst->indirect){
+				obj_error("invalid operands");
+				return 1;
+			}
+
+			if(sz == 8 && dst->kind == XO_XMM && x86_want(src, WANT_XM)){
+				static const unsigned char load[] = { 0x0f, 0x7e };
+				e->mandatory = 0xf3;
+				x86_op_set(e, load, 2);
+				x86_modrm(e, dst->reg, src);
+				return 0;
+			}
+			if(sz == 8 && src->kind == XO_XMM && dst->kind == XO_MEM){
+				static const unsigned char store[] = { 0x0f, 0xd6 };
+				x86_op_set(e, store, 2);
+				x86_modrm(e, src->reg, dst);
+				return 0;
+			}
+
+			if(sz == 8)
+				e->rex |= REX_W;
+
+			if(dst->kind == XO_XMM && x86_want(src, WANT_RM)){
+				if(src->kind == XO_REG && src->size != sz){
+					obj_error("operand size mismatch");
+					return 1;
+				}
+				x86_op_set(e, to_xmm, 2);
+				x86_modrm(e, dst->reg, src);
+				return 0;
+			}
+			if(src->kind == XO_XMM && x86_want(dst, WANT_RM)){
+				if(dst->kind == XO_REG && dst->size != sz){
+					obj_error("operand size mismatch");
+					return 1;
+				}
+				x86_op_set(e, from_xmm, 2);
+				x86_modrm(e, src->reg, dst);
+				return 0;
+			}
+			obj_error("invalid operands");
+			return 1;
+		}
+	}
+
+	obj_error("unhandled instruction \"%s\"", op->name);
+	return 1;
+}
+
+static int x86_encode_cond(
+		struct x86_enc *e, const char *family, int cc, unsigned sz,
+		struct x86_opnd *opnds, unsigned n)
+{
+	struct x86_opnd *src = &opnds[0], *dst = &opnds[n - 1];
+
+	switch(*family){
+		case 'j':
+			if(n != 1 || src->kind != XO_MEM || src->indirect
+			|| src->base != X86_NOREG || src->index != X86_NOREG || src->riprel)
+			{
+				obj_error("conditional jump target must be a symbol");
+				return 1;
+			}
+			e->op[0] = 0x0f;
+			e->op[1] = 0x80 + cc;
+			e->nop = 2;
+			e->has_rel = 1;
+			e->rel = src->expr;
+			return 0;
+
+		case 's': /* setcc */
+			if(x86_check(opnds, n, 1, WANT_RM))
+				return 1;
+			if(src->kind == XO_REG && src->size != 1){
+				obj_error("setcc needs a byte register");
+				return 1;
+			}
+			e->op[0] = 0x0f;
+			e->op[1] = 0x90 + cc;
+			e->nop = 2;
+			x86_modrm(e, 0, src);
+			return 0;
+
+		case 'c': /* cmovcc */
+			if(x86_check(opnds, n, 2, WANT_RM, WANT_REG) || x86_size(sz, opnds, n, &sz))
+				return 1;
+			if(sz == 1){
+				obj_error("invalid operand size");
+				return 1;
+			}
+			x86_size_prefix(e, sz);
+			e->op[0] = 0x0f;
+			e->op[1] = 0x40 + cc;
+			e->nop = 2;
+			x86_modrm(e, dst->reg, src);
+			return 0;
+	}
+
+	return 1;
+}
+
+static void x86_fixup(
+		struct obj_insn *insn, unsigned size,
+		enum obj_fixup_flags flags, const struct obj_expr *ex)
+{
+	struct obj_insn_fixup *f = &insn->fixups[insn->nfixups++];
+
+	f->off = insn->len;
+	f->size = size;
+	f->flags = flags;
+	f->expr = *ex;
+}
+
+static void x86_put(struct obj_insn *insn, unsigned long long v, unsigned size)
+{
+	unsigned i;
+
+	for(i = 0; i < size; i++)
+		insn->bytes[insn->len++] = v >> (8 * i);
+}
+
+static int x86_emit(struct x86_enc *e, struct obj_insn *insn)
+{
+	unsigned i;
+
+	if(e->forbid_rex && (e->rex || e->need_rex)){
+		obj_error("can't use %%ah/%%bh/%%ch/%%dh with a REX prefix");
+		return 1;
+	}
+
+	for(i = 0; i < e->nprefixes; i++)
+		insn->bytes[insn->len++] = e->prefixes[i];
+	if(e->opsize16)
+		insn->bytes[insn->len++] = 0x66;
+	if(e->mandatory)
+		insn->bytes[insn->len++] = e->mandatory;
+	if(e->rex || e->need_rex)
+		insn->bytes[insn->len++] = 0x40 | e->rex;
+
+	for(i = 0; i < e->nop; i++)
+		insn->bytes[insn->len++] = e->op[i];
+
+	if(e->has_modrm)
+		insn->bytes[insn->len++] = e->modrm;
+	if(e->has_sib)
+		insn->bytes[insn->len++] = e->sib;
+
+	if(e->disp_size){
+		if(obj_expr_is_const(&e->disp) && !(e->disp_riprel && !obj_expr_is_const(&e->disp))){
+			if(e->disp_size == 4 && !x86_imm_fits(&e->disp, 4, 1)){
+				obj_error("displacement %lld out of range", e->disp.num);
+				return 1;
+			}
+			x86_put(insn, e->disp.num, e->disp_size);
+		}else{
+			x86_fixup(insn, 4,
+					e->disp_riprel ? OBJ_FIX_PCREL | OBJ_FIX_SIGNED : OBJ_FIX_SIGNED,
+					&e->disp);
+			x86_put(insn, 0, 4);
+		}
+	}
+
+	if(e->has_rel){
+		x86_fixup(insn, 4, OBJ_FIX_PCREL | OBJ_FIX_SIGNED | OBJ_FIX_BRANCH, &e->rel);
+		x86_put(insn, 0, 4);
+	}
+
+	if(e->imm_size){
+		if(obj_expr_is_const(&e->imm)){
+			x86_put(insn, e->imm.num, e->imm_size);
+		}else{
+			x86_fixup(insn, e->imm_size, e->imm_signed ? OBJ_FIX_SIGNED : 0, &e->imm);
+			x86_put(insn, 0, e->imm_size);
+		}
+	}
+
+	return 0;
+}
+
+/* how a mnemonic encodes - looked up once per distinct record mnemonic */
+struct x86_mnemonic
+{
+	const struct x86_op *op;
+	unsigned sz;
+	int cc;
+	const char *family;
+};
+
+static void x86_mnemonic_lookup(const char *mn, size_t len, struct x86_mnemonic *m)
+{
+	m->op = x86_lookup(mn, len, &m->sz);
+	m->cc = -1;
+	m->family = NULL;
+
+	if(len > 1 && mn[0] == 'j'){
+		m->cc = x86_cond(mn + 1, len - 1);
+		m->family = "j";
+	}else if(len > 3 && !strncmp(mn, "set", 3)){
+		m->cc = x86_cond(mn + 3, len - 3);
+		if(m->cc < 0 && mn[len - 1] == 'b')
+			m->cc = x86_cond(mn + 3, len - 4);
+		m->family = "set";
+	}else if(len > 4 && !strncmp(mn, "cmov", 4)){
+		m->cc = x86_cond(mn + 4, len - 4);
+		m->sz = 0;
+		if(m->cc < 0 && x86_suffix_size(mn[len - 1]) > 1){
+			m->cc = x86_cond(mn + 4, len - 5);
+			m->sz = x86_suffix_size(mn[len - 1]);
+		}
+		m->family = "cmov";
+	}
+}
+
+static int x86_encode_mnemonic(
+		struct x86_enc *e,
+		const char *mn, size_t len, const struct x86_mnemonic *m,
+		struct x86_opnd *opnds, unsigned n,
+		struct obj_insn *insn)
+{
+	const struct x86_op *op = m->op;
+	unsigned sz = m->sz;
+
+	if(m->cc >= 0){
+		if(x86_encode_cond(e, m->family, m->cc, sz, opnds, n))
+			return 1;
+		return x86_emit(e, insn);
+	}
+
+	/* movq/movd with an xmm operand */
+	if((len == 4 && (!strncmp(mn, "movq", 4) || !strncmp(mn, "movd", 4)))){
+		unsigned i;
+		int xmm = 0;
+
+		for(i = 0; i < n; i++)
+			if(opnds[i].kind == XO_XMM)
+				xmm = 1;
+
+		if(xmm){
+			static const struct x86_op movd = { "movd", X86_MOVD, 0, 0x66, 0, 0, { 0 } };
+
+			if(x86_encode_op(e, &movd, mn[3] == 'q' ? 8 : 4, opnds, n))
+				return 1;
+			return x86_emit(e, insn);
+		}
+	}
+
+	/* string instructions: movsb/movsw/movsl/movsq, movsd without operands */
+	if(n == 0 && len == 5 && !strncmp(mn, "movs", 4)){
+		static const struct x86_op *movs;
+		unsigned strsz = mn[4] == 'd' ? 4 : x86_suffix_size(mn[4]);
+
+		if(strsz){
+			movs = x86_lookup("movs", 4, &sz);
+			if(x86_encode_op(e, movs, strsz, opnds, n))
+				return 1;
+			return x86_emit(e, insn);
+		}
+	}
+
+	if(!op || (op->kind == X86_MOVX && n == 0)){
+		obj_error("unknown instruction \"%.*s\"", (int)len, mn);
+		return 1;
+	}
+
+	if(x86_encode_op(e, op, sz, opnds, n))
+		return 1;
+
+	return x86_emit(e, insn);
+}
+
+int impl_obj_encode(const char *stmt, struct obj_insn *insn)
+{
+	struct x86_enc e;
+	struct x86_opnd opnds[X86_MAX_OPNDS];
+	struct x86_mnemonic m;
+	const char *p = stmt, *mn;
+	unsigned n;
+	size_t len;
+
+	memset(&e, 0, sizeof e);
+
+	for(;;){
+		mn = p;
+		while(isalnum(*p))
+			p++;
+		len = p - mn;
+
+		if(!len){
+			obj_error("expected instruction");
+			return 1;
+		}
+
+		x86_mnemonic_lookup(mn, len, &m);
+		if(!m.op || m.op->kind != X86_PREFIX)
+			break;
+
+		if(e.nprefixes == countof(e.prefixes) - 1){
+			obj_error("too many prefixes");
+			return 1;
+		}
+		e.prefixes[e.nprefixes++] = m.op->op[0];
+
+		while(*p == ' ' || *p == '\t')
+			p++;
+		if(!*p){
+			/* prefix on its own line applies to the next instruction */
+			x86_put(insn, e.prefixes[0], 1);
+			for(n = 1; n < e.nprefixes; n++)
+				x86_put(insn, e.prefixes[n], 1);
+			return 0;
+		}
+	}
+
+	if(*p && *p != ' ' && *p != '\t'){
+		obj_error("bad instruction \"%s\"", stmt);
+		return 1;
+	}
+
+	if(x86_parse_opnds(p, opnds, &n))
+		return 1;
+
+	return x86_encode_mnemonic(&e, mn, len, &m, opnds, n, insn);
+}
+
+/* ---- instruction records ---- */
+
+/* X86_64_REG_* to register encodings */
+static const unsigned char x86_insn_regs[] = {
+	0, 3, 1, 2, /* rax, rbx, rcx, rdx */
+	7, 6, /* rdi, rsi */
+	8, 9, 10, 11, 12, 13, 14, 15,
+	5, 4, /* rbp, rsp */
+};
+
+static const enum obj_modifier x86_insn_mods[] = {
+	OBJ_MOD_NONE,
+	OBJ_MOD_PLT,
+	OBJ_MOD_GOTPCREL,
+	OBJ_MOD_TPOFF,
+	OBJ_MOD_GOTTPOFF
+};
+
+static unsigned x86_mnemonic_hash(const char *p)
+{
+	return (unsigned)(intptr_t)p ^ (unsigned)((intptr_t)p >> 16);
+}
+
+static int x86_insn_reg(int reg, const char *what)
+{
+	if(reg < 0 || (unsigned)reg >= countof(x86_insn_regs)){
+		obj_error("bad %s register %d in instruction record", what, reg);
+		return -1;
+	}
+	return x86_insn_regs[reg];
+}
+
+static int x86_opnd_from_insn(const struct insn_opnd *io, struct x86_opnd *o)
+{
+	memset(o, 0, sizeof *o);
+	o->indirect = io->indirect;
+
+	switch((enum insn_opnd_kind)io->kind){
+		case OPND_NONE:
+			break;
+
+		case OPND_REG:
+			if(io->reg >= X86_INSN_XMM){
+				o->kind = XO_XMM;
+				o->reg = io->reg - X86_INSN_XMM;
+				o->size = 16;
+				return 0;
+			}
+			o->kind = XO_REG;
+			o->reg = x86_insn_reg(io->reg, "operand");
+			o->size = io->regsz;
+			o->rex_byte = o->size == 1 && o->reg >= 4 && o->reg < 8;
+			return o->reg < 0;
+
+		case OPND_IMM:
+		case OPND_MEM:
+		case OPND_SYM:
+			if(io->sym)
+				o->expr.add = obj_sym_ref(io->sym);
+			o->expr.num = io->num;
+			o->expr.mod = x86_insn_mods[io->reloc];
+
+			if(io->kind == OPND_IMM){
+				o->kind = XO_IMM;
+				return 0;
+			}
+
+			/* a bare symbol is an absolute memory operand */
+			o->kind = XO_MEM;
+			if(io->seg == X86_INSN_SEG_FS)
+				o->seg = 0x64;
+			o->base = o->index = X86_NOREG;
+			o->scale = io->scale ? io->scale : 1;
+
+			if(io->reg == X86_INSN_RIP)
+				o->riprel = 1;
+			else if(io->reg != INSN_REG_NONE && (o->base = x86_insn_reg(io->reg, "base")) < 0)
+				return 1;
+
+			if(io->idx != INSN_REG_NONE && (o->index = x86_insn_reg(io->idx, "index")) < 0)
+				return 1;
+			return 0;
+	}
+
+	obj_error("empty operand in instruction record");
+	return 1;
+}
+
+int impl_obj_encode_insn(const struct insn *i, struct obj_insn *insn)
+{
+	static dynmap *mnemonics;
+	struct x86_enc e;
+	struct x86_opnd opnds[X86_MAX_OPNDS];
+	struct x86_mnemonic *m;
+	unsigned k;
+
+	if(!mnemonics)
+		mnemonics = dynmap_new(const char *, NULL, x86_mnemonic_hash);
+
+	/* mnemonics are interned, so each is only looked up once */
+	m = dynmap_get(const char *, struct x86_mnemonic *, mnemonics, i->op);
+	if(!m){
+		m = umalloc_tag(sizeof *m, UALLOC_OBJ);
+		x86_mnemonic_lookup(i->op, strlen(i->op), m);
+		(void)dynmap_set(const char *, struct x86_mnemonic *, mnemonics, i->op, m);
+	}
+
+	for(k = 0; k < i->nopnds; k++)
+		if(x86_opnd_from_insn(&i->bits.opnds[k], &opnds[k]))
+			return 1;
+
+	memset(&e, 0, sizeof e);
+	return x86_encode_mnemonic(&e, i->op, strlen(i->op), m, opnds, i->nopnds, insn);
+}
+
+unsigned impl_obj_reloc_type(unsigned size, enum obj_fixup_flags flags, enum obj_modifier mod)
+{
+	const int pcrel = !!(flags & OBJ_FIX_PCREL);
+
+	switch(mod){
+		case OBJ_MOD_NONE:
+			if(pcrel){
+				switch(size){
+					case 1: return R_X86_64_PC8;
+					case 2: return R_X86_64_PC16;
+					case 4: return flags & OBJ_FIX_BRANCH ? R_X86_64_PLT32 : R_X86_64_PC32;
+					case 8: return R_X86_64_PC64;
+				}
+			}else{
+				switch(size){
+					case 1: return R_X86_64_8;
+					case 2: return R_X86_64_16;
+					case 4: return flags & OBJ_FIX_SIGNED ? R_X86_64_32S : R_X86_64_32;
+					case 8: return R_X86_64_64;
+				}
+			}
+			break;
+
+		case OBJ_MOD_PLT:
+			if(pcrel && size == 4)
+				return R_X86_64_PLT32;
+			break;
+		case OBJ_MOD_GOTPCREL:
+			if(pcrel && size == 4)
+				return R_X86_64_GOTPCREL;
+			break;
+		case OBJ_MOD_GOTOFF:
+			if(!pcrel && size == 8)
+				return R_X86_64_GOTOFF64;
+			break;
+		case OBJ_MOD_GOTTPOFF:
+			if(pcrel && size == 4)
+				return R_X86_64_GOTTPOFF;
+			break;
+		case OBJ_MOD_TLSGD:
+			if(pcrel && size == 4)
+				return R_X86_64_TLSGD;
+			break;
+		case OBJ_MOD_TLSLD:
+			if(pcrel && size == 4)
+				return R_X86_64_TLSLD;
+			break;
+		case OBJ_MOD_TPOFF:
+			if(!pcrel && size == 4)
+				return R_X86_64_TPOFF32;
+			if(!pcrel && size == 8)
+				return R_X86_64_TPOFF64;
+			break;
+		case OBJ_MOD_DTPOFF:
+			if(!pcrel && size == 4)
+				return R_X86_64_DTPOFF32;
+			if(!pcrel && size == 8)
+				return R_X86_64_DTPOFF64;
+			break;
+	}
+
+	return 0;
+}
+
+void impl_obj_fill_nops(unsigned char *p, size_t n)
+{
+	memset(p, 0x90, n);
+}
+
+unsigned impl_obj_machine(void)
+{
+	return EM_X86_64;
+}
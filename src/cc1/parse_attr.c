@@ -286,6 +286,10 @@ EMPTY(attr_no_stack_protector)
 EMPTY(attr_returns_nonnull)
 EMPTY(attr_fallthrough)
 EMPTY(attr_flatten)
+EMPTY(attr_hot)
+EMPTY(attr_cold)
+EMPTY(attr_pure)
+EMPTY(attr_const)
 
 #undef EMPTY
 
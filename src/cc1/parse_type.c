@@ -455,6 +455,7 @@ int parse_at_decl(symtable *scope, int include_attribute)
 		case token_unsigned:
 		case token_inline:
 		case token__Noreturn:
+		case token__Thread_local:
 		case token_struct:
 		case token_union:
 		case token_enum:
@@ -590,7 +591,39 @@ static type *parse_btype(
 	for(;;){
 		decl *tdef_decl_test;
 
-		if(curtok_is_type_qual()){
+		if(curtok == token__Atomic){
+			EAT(token__Atomic);
+
+			if(accept(token_open_paren)){
+				/* _Atomic(type-name) specifier, behaves as a typeof */
+				type *of;
+
+				if(primitive_mode != NONE)
+					die_at(NULL, "_Atomic() specifier after previous specifier");
+
+				of = parse_type(0, scope);
+				if(!of)
+					die_at(NULL, "type expected for _Atomic()");
+				EAT(token_close_paren);
+
+				if(type_is_array(of) || type_is_func_or_block(of) || type_qual(of)){
+					warn_at_print_error(NULL, "_Atomic() of %s type '%s'",
+							type_is_array(of) ? "array"
+							: type_qual(of) ? "qualified"
+							: "function",
+							type_to_str(of));
+					parse_had_error = 1;
+				}
+
+				tdef_typeof = expr_new_sizeof_type(of, what_typeof);
+				primitive_mode = TYPEOF;
+			}else if(qual & qual_atomic){
+				emit_duplicate_qual_warning(NULL, qual_atomic);
+			}
+
+			qual |= qual_atomic;
+
+		}else if(curtok_is_type_qual()){
 			enum type_qualifier q = curtok_to_type_qualifier();
 
 			if(qual & q)
@@ -690,6 +723,14 @@ static type *parse_btype(
 			is_noreturn = 1;
 			EAT(curtok);
 
+		}else if(curtok == token__Thread_local){
+			if(store)
+				*store |= store_thread;
+			else
+				die_at(NULL, "_Thread_local not wanted");
+
+			EAT(curtok);
+
 		}else if(curtok == token_struct
 				|| curtok == token_union
 				|| curtok == token_enum)
@@ -2061,6 +2102,18 @@ static void check_var_storage_redef(decl *new, decl *old)
 	old = decl_proto(old);
 	is_fn = !!type_is(old->ref, type_func);
 
+	if(!is_fn && !(new->store & store_thread) != !(old->store & store_thread)){
+		char buf[WHERE_BUF_SIZ];
+		warn_at_print_error(&new->where,
+				"%sthread-local declaration of \"%s\" follows %sthread-local declaration\n"
+				"%s: note: previous declaration",
+				new->store & store_thread ? "" : "non-",
+				new->spel,
+				old->store & store_thread ? "" : "non-",
+				where_str_r(buf, &old->where));
+		fold_had_error = 1;
+	}
+
 	first_is_static = (store_static == (enum decl_storage)(old->store & STORE_MASK_STORE));
 
 	switch((enum decl_storage)(new->store & STORE_MASK_STORE)){
@@ -24,6 +24,7 @@
 #include "type_nav.h"
 
 #include "pass1.h"
+#include "time_report.h"
 
 static void link_gasms(symtable_gasm ***plast_gasms, decl *prev)
 {
@@ -51,6 +52,8 @@ int parse_and_fold(symtable_global *globals)
 {
 	symtable_gasm **last_gasms = NULL;
 
+	time_report_push(TIME_PARSE);
+
 	while(curtok != token_eof){
 		where semi;
 		decl **new = NULL;
@@ -66,8 +69,10 @@ int parse_and_fold(symtable_global *globals)
 				&globals->stab,
 				&globals->stab, &new);
 
+		time_report_push(TIME_FOLD);
+
 		/* global struct layout-ing */
-		symtab_fold_sues(&globals->stab);
+		symtabg_fold_sues(globals);
 
 		if(new){
 			link_gasms(&last_gasms, *new);
@@ -81,6 +86,8 @@ int parse_and_fold(symtable_global *globals)
 			cont = 1;
 		}
 
+		time_report_pop(TIME_FOLD);
+
 		cont |= parse_add_gasms(&last_gasms);
 		dynarray_add_array(&globals->gasms, last_gasms);
 
@@ -95,17 +102,23 @@ int parse_and_fold(symtable_global *globals)
 
 	EAT(token_eof);
 
-	symtab_fold_sues(&globals->stab); /* superflous except for empty
-	                                  * files/trailing struct defs */
+	time_report_push(TIME_FOLD);
+
+	symtabg_fold_sues(globals); /* superflous except for empty
+	                             * files/trailing struct defs */
 	symtab_fold_decls(&globals->stab); /* check for dups */
 	symtab_check_rw(&globals->stab); /* basic static analysis */
 	symtab_check_static_asserts(&globals->stab);
 
 	fold_merge_tenatives(&globals->stab);
 
+	time_report_pop(TIME_FOLD);
+
 	dynarray_free(symtable_gasm **, last_gasms, NULL);
 
 	UCC_ASSERT(!globals->stab.parent, "scope leak during parse");
 
+	time_report_pop(TIME_PARSE);
+
 	return parse_had_error || fold_had_error;
 }
@@ -0,0 +1,392 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "../util/alloc.h"
+#include "../util/dynmap.h"
+
+#include "cc1.h"
+#include "fopt.h"
+#include "decl.h"
+#include "stmt.h"
+#include "type_nav.h"
+#include "warn.h"
+#include "out/out.h"
+#include "out/asm.h"
+#include "out/lbl.h"
+#include "out/section.h"
+
+#include "profile.h"
+
+/* a branch is annotated once one side is taken this many times more often */
+#define PROFILE_SKEW 4
+/* functions entered within 1/PROFILE_HOT_FRACTION of the hottest are hot */
+#define PROFILE_HOT_FRACTION 10
+
+#define PROFILE_NAME_MAX 4096
+#define PROFILE_SECTION "ucc_profile" /* a C identifier, for __start_/__stop_ */
+
+struct profile_func
+{
+	const char *spel;
+	unsigned ncounters;
+	char *lbl; /* counter array, with -fprofile-generate */
+	const unsigned long *counts; /* with -fprofile-use, if the profile matches */
+};
+
+struct profile_point
+{
+	struct profile_func *func;
+	unsigned idx;
+};
+
+struct profile_record
+{
+	unsigned long n;
+	unsigned long *counts;
+};
+
+const char *cc1_profile_generate_path;
+const char *cc1_profile_use_path;
+
+static const char *profile_unit;
+static dynmap *profile_funcs; /* stmt (function code) => profile_func */
+static dynmap *profile_points; /* stmt => profile_point */
+static dynmap *profile_records; /* spel => profile_record */
+static unsigned long profile_max_entry;
+
+static unsigned profile_stmt_counters(const stmt *s)
+{
+	if(stmt_kind(s, if)
+	|| stmt_kind(s, while)
+	|| stmt_kind(s, for)
+	|| stmt_kind(s, do))
+	{
+		return 2;
+	}
+
+	if(stmt_kind(s, case) || stmt_kind(s, case_range) || stmt_kind(s, default))
+		return 1;
+
+	return 0;
+}
+
+static unsigned profile_ptr_hash(const void *p)
+{
+	return (unsigned)(intptr_t)p ^ (unsigned)((intptr_t)p >> 16);
+}
+
+static int profile_str_cmp(const char *a, const char *b)
+{
+	return strcmp(a, b);
+}
+
+static void profile_number(stmt *s, int *stop, int *descend, void *ctx)
+{
+	struct profile_func *fn = ctx;
+	unsigned n = profile_stmt_counters(s);
+	struct profile_point *pt;
+
+	(void)stop;
+	(void)descend;
+
+	if(!n)
+		return;
+
+	pt = umalloc(sizeof *pt);
+	pt->func = fn;
+	pt->idx = fn->ncounters;
+	fn->ncounters += n;
+
+	(void)dynmap_set(const stmt *, struct profile_point *, profile_points, (const stmt *)s, pt);
+}
+
+static void profile_load(const char *path)
+{
+	FILE *f = fopen(path, "r");
+	char *unit, *spel;
+	unsigned long n, i;
+
+	if(!f){
+		cc1_warn_at(NULL, missing_profile,
+				"profile \"%s\" not found: %s", path, strerror(errno));
+		return;
+	}
+
+	unit = umalloc(PROFILE_NAME_MAX);
+	spel = umalloc(PROFILE_NAME_MAX);
+
+	/* <unit> <function> <ncounters> <counter>... */
+	while(fscanf(f, "%4095s %4095s %lu", unit, spel, &n) == 3){
+		struct profile_record *rec = NULL;
+		const int ours = !strcmp(unit, profile_unit);
+
+		if(ours){
+			rec = umalloc(sizeof *rec);
+			rec->n = n;
+			rec->counts = umalloc((n ? n : 1) * sizeof *rec->counts);
+		}
+
+		for(i = 0; i < n; i++){
+			unsigned long count;
+
+			if(fscanf(f, "%lu", &count) != 1){
+				cc1_warn_at(NULL, coverage_mismatch,
+						"profile \"%s\" is truncated", path);
+				if(rec)
+					free(rec->counts), free(rec);
+				goto out;
+			}
+			if(rec)
+				rec->counts[i] = count;
+		}
+
+		if(!rec)
+			continue;
+
+		if(n && rec->counts[0] > profile_max_entry)
+			profile_max_entry = rec->counts[0];
+
+		(void)dynmap_set(char *, struct profile_record *,
+				profile_records, ustrdup(spel), rec);
+	}
+
+out:
+	free(unit);
+	free(spel);
+	fclose(f);
+}
+
+void profile_begin(const char *unit)
+{
+	if(!cc1_fopt.profile_generate && !cc1_fopt.profile_use)
+		return;
+
+	profile_unit = unit;
+	profile_funcs = dynmap_new(const stmt *, NULL, profile_ptr_hash);
+	profile_points = dynmap_new(const stmt *, NULL, profile_ptr_hash);
+	profile_records = dynmap_new(char *, profile_str_cmp, dynmap_strhash);
+
+	if(cc1_fopt.profile_use)
+		profile_load(cc1_profile_use_path ? cc1_profile_use_path : PROFILE_DEFAULT_PATH);
+}
+
+static struct profile_func *profile_func_get(decl *d, stmt *code)
+{
+	struct profile_func *fn;
+	struct profile_record *rec;
+
+	fn = dynmap_get(const stmt *, struct profile_func *, profile_funcs, (const stmt *)code);
+	if(fn)
+		return fn;
+
+	fn = umalloc(sizeof *fn);
+	fn->spel = decl_asm_spel(d);
+	fn->ncounters = 1; /* entry */
+	stmt_walk(code, profile_number, NULL, fn);
+
+	if(cc1_fopt.profile_generate)
+		fn->lbl = out_label_code("prof_ctrs");
+
+	rec = dynmap_get(char *, struct profile_record *, profile_records, (char *)fn->spel);
+	if(rec){
+		if(rec->n == fn->ncounters)
+			fn->counts = rec->counts;
+		else
+			cc1_warn_at(&d->where, coverage_mismatch,
+					"profile for '%s' doesn't match its source, ignoring",
+					d->spel);
+	}
+
+	(void)dynmap_set(const stmt *, struct profile_func *, profile_funcs, (const stmt *)code, fn);
+	return fn;
+}
+
+static void profile_increment(struct profile_func *fn, unsigned idx, out_ctx *octx)
+{
+	type *ty_ulong = type_nav_btype(cc1_type_nav, type_ulong);
+	const out_val *ctr, *v;
+
+	ctr = out_new_lbl(octx, type_ptr_to(ty_ulong), fn->lbl, OUT_LBL_PIC | OUT_LBL_PICLOCAL);
+	ctr = out_op(octx, op_plus, ctr,
+			out_new_l(octx, type_nav_btype(cc1_type_nav, type_long), idx));
+
+	out_val_retain(octx, ctr);
+	v = out_deref(octx, ctr);
+	v = out_op(octx, op_plus, v, out_new_l(octx, ty_ulong, 1));
+	out_store(octx, ctr, v);
+}
+
+void profile_func_entry(decl *d, stmt *code, out_ctx *octx)
+{
+	struct profile_func *fn;
+
+	if(!profile_funcs)
+		return;
+
+	fn = profile_func_get(d, code);
+
+	if(cc1_fopt.profile_generate)
+		profile_increment(fn, 0, octx);
+}
+
+void profile_count(const stmt *s, unsigned n, out_ctx *octx)
+{
+	struct profile_point *pt;
+
+	if(!cc1_fopt.profile_generate || !profile_points)
+		return;
+
+	pt = dynmap_get(const stmt *, struct profile_point *, profile_points, s);
+	if(pt)
+		profile_increment(pt->func, pt->idx + n, octx);
+}
+
+int profile_stmt_count(const stmt *s, unsigned n, unsigned long *count)
+{
+	struct profile_point *pt;
+
+	if(!cc1_fopt.profile_use || !profile_points)
+		return 0;
+
+	pt = dynmap_get(const stmt *, struct profile_point *, profile_points, s);
+	if(!pt || !pt->func->counts)
+		return 0;
+
+	*count = pt->func->counts[pt->idx + n];
+	return 1;
+}
+
+const out_val *profile_branch(const stmt *s, const out_val *cond, out_ctx *octx)
+{
+	unsigned long taken, not_taken;
+
+	if(!profile_stmt_count(s, 0, &taken) || !profile_stmt_count(s, 1, &not_taken))
+		return cond;
+
+	if(stmt_kind(s, do)){
+		/* the condition of a do-loop is tested after each body,
+		 * and is false once per entry */
+		taken = taken > not_taken ? taken - not_taken : 0;
+	}
+
+	if(taken == not_taken)
+		return cond;
+
+	if(taken >= not_taken * PROFILE_SKEW)
+		return out_annotate_likely(octx, cond, 0);
+	if(not_taken >= taken * PROFILE_SKEW)
+		return out_annotate_likely(octx, cond, 1);
+
+	return cond;
+}
+
+int profile_func_hotness(decl *d)
+{
+	struct profile_record *rec;
+
+	if(!cc1_fopt.profile_use || !profile_records)
+		return 0;
+
+	rec = dynmap_get(char *, struct profile_record *, profile_records, (char *)decl_asm_spel(d));
+	if(!rec || !rec->n)
+		return 0;
+
+	if(rec->counts[0] == 0)
+		return -1;
+
+	if(rec->counts[0] * PROFILE_HOT_FRACTION >= profile_max_entry)
+		return 1;
+
+	return 0;
+}
+
+static void profile_asciz(const struct section *sec, const char *lbl, const char *s)
+{
+	asm_nam_begin3(sec, lbl, 1);
+	asm_out_section(sec, ".asciz \"");
+	for(; *s; s++){
+		if(*s == '"' || *s == '\\')
+			asm_out_section(sec, "\\%c", *s);
+		else if(*s < ' ' || *s > '~')
+			asm_out_section(sec, "\\%03o", (unsigned char)*s);
+		else
+			asm_out_section(sec, "%c", *s);
+	}
+	asm_out_section(sec, "\"\n");
+}
+
+static void profile_emit(void)
+{
+	type *ty_ptr = type_nav_btype(cc1_type_nav, type_intptr_t);
+	type *ty_ulong = type_nav_btype(cc1_type_nav, type_ulong);
+	const char *ptr = asm_type_directive(ty_ptr);
+	const char *ulong = asm_type_directive(ty_ulong);
+	const unsigned ptr_align = type_align(ty_ptr, NULL);
+	const unsigned ulong_size = type_size(ty_ulong, NULL);
+	const enum section_flags flags = 0; /* writable data */
+	struct section sec_unit;
+	struct profile_func *fn;
+	char **names;
+	char *funcs_lbl, *path_lbl, *unit_lbl;
+	size_t i, nfuncs = 0;
+
+	while(dynmap_value(struct profile_func *, profile_funcs, nfuncs))
+		nfuncs++;
+
+	if(!nfuncs)
+		return;
+
+	names = umalloc(nfuncs * sizeof *names);
+	for(i = 0; (fn = dynmap_value(struct profile_func *, profile_funcs, i)); i++){
+		asm_nam_begin3(&section_bss, fn->lbl, ulong_size);
+		asm_out_section(&section_bss, ".space %lu\n",
+				(unsigned long)fn->ncounters * ulong_size);
+
+		names[i] = out_label_code("prof_name");
+		profile_asciz(&section_rodata, names[i], fn->spel);
+	}
+
+	path_lbl = out_label_code("prof_path");
+	profile_asciz(&section_rodata,
+			path_lbl,
+			cc1_profile_generate_path ? cc1_profile_generate_path : PROFILE_DEFAULT_PATH);
+
+	unit_lbl = out_label_code("prof_unit");
+	profile_asciz(&section_rodata, unit_lbl, profile_unit);
+
+	/* { name, ncounters, counters } */
+	funcs_lbl = out_label_code("prof_funcs");
+	asm_nam_begin3(&section_data, funcs_lbl, ptr_align);
+	for(i = 0; (fn = dynmap_value(struct profile_func *, profile_funcs, i)); i++){
+		asm_out_section(&section_data, ".%s %s\n", ptr, names[i]);
+		asm_out_section(&section_data, ".%s %u\n", ulong, fn->ncounters);
+		asm_out_section(&section_data, ".%s %s\n", ptr, fn->lbl);
+	}
+
+	/* { path, unit, nfuncs, funcs }, found by the runtime
+	 * between __start_ucc_profile and __stop_ucc_profile */
+	SECTION_FROM_NAME(&sec_unit, PROFILE_SECTION, flags);
+	asm_out_align(&sec_unit, ptr_align);
+	asm_out_section(&sec_unit, ".%s %s\n", ptr, path_lbl);
+	asm_out_section(&sec_unit, ".%s %s\n", ptr, unit_lbl);
+	asm_out_section(&sec_unit, ".%s %lu\n", ulong, (unsigned long)nfuncs);
+	asm_out_section(&sec_unit, ".%s %s\n", ptr, funcs_lbl);
+
+	for(i = 0; i < nfuncs; i++)
+		free(names[i]);
+	free(names);
+	free(funcs_lbl);
+	free(path_lbl);
+	free(unit_lbl);
+}
+
+void profile_end(void)
+{
+	if(!profile_funcs)
+		return;
+
+	if(cc1_fopt.profile_generate)
+		profile_emit();
+}
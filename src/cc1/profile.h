@@ -0,0 +1,39 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "out/forwards.h"
+
+/* -fprofile-generate / -fprofile-use
+ *
+ * counters are numbered per function, by a walk of its code:
+ *   0: function entry
+ *   if: then, else
+ *   while/for/do: body executions, loop entries
+ *   case/case-range/default: executions of the label
+ * so an inlined body bumps the same counters as its out-of-line copy */
+
+#define PROFILE_DEFAULT_PATH "ucc.prof"
+
+extern const char *cc1_profile_generate_path;
+extern const char *cc1_profile_use_path;
+
+void profile_begin(const char *unit);
+void profile_end(void);
+
+/* start of a function body, out-of-line or inlined */
+void profile_func_entry(struct decl *, struct stmt *code, out_ctx *);
+
+/* bump counter `n' of `s' in the current block */
+void profile_count(const struct stmt *, unsigned n, out_ctx *);
+
+/* annotate a loop/if condition with its recorded direction */
+ucc_wur const out_val *profile_branch(
+		const struct stmt *, const out_val *cond, out_ctx *);
+
+/* returns 0 when there's no profile data */
+int profile_stmt_count(const struct stmt *, unsigned n, unsigned long *count);
+
+/* -1: never executed, 0: no data or lukewarm, 1: one of the hottest functions */
+int profile_func_hotness(struct decl *);
+
+#endif
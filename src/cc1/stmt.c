@@ -11,7 +11,7 @@
 
 stmt_flow *stmt_flow_new(symtable *parent)
 {
-	stmt_flow *t = umalloc(sizeof *t);
+	stmt_flow *t = umalloc_tag(sizeof *t, UALLOC_STMT);
 	t->for_init_symtab = parent;
 	return t;
 }
@@ -25,7 +25,7 @@ stmt *stmt_new(
 		void (*init)(stmt *),
 		symtable *stab)
 {
-	stmt *s = umalloc(sizeof *s);
+	stmt *s = umalloc_tag(sizeof *s, UALLOC_STMT);
 	where_cc1_current(&s->where);
 
 	UCC_ASSERT(stab, "no symtable for statement");
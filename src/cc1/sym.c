@@ -290,7 +290,7 @@ unsigned symtab_decl_bytes(
 		int array_only,
 		int *const addr_taken)
 {
-	unsigned total = 0;
+	unsigned total = 0, nested = 0;
 	symtable **si;
 	decl **di;
 
@@ -309,10 +309,14 @@ unsigned symtab_decl_bytes(
 			total += decl_size(d);
 	}
 
-	for(si = stab->children; si && *si; si++)
-		total += symtab_decl_bytes(*si, vla_cost, array_only, addr_taken);
+	/* sibling scopes are disjoint and share stack space */
+	for(si = stab->children; si && *si; si++){
+		unsigned child = symtab_decl_bytes(*si, vla_cost, array_only, addr_taken);
+		if(child > nested)
+			nested = child;
+	}
 
-	return total;
+	return total + nested;
 }
 
 const struct out_val *sym_outval(sym *s)
@@ -30,6 +30,9 @@ struct sym
 
 	/* static analysis */
 	unsigned nreads, nwrites;
+
+	/* scalar, never address-taken - may live in a register (-fmem2reg) */
+	int regvar;
 };
 
 typedef struct static_assert static_assert;
@@ -96,6 +99,10 @@ struct symtable_global
 	symtable_gasm **gasms;
 	dynmap *literals;
 	dynmap *unrecog_attrs;
+
+	/* global layout worklist - see symtabg_fold_sues() */
+	struct struct_union_enum_st **sues_pending;
+	size_t sues_seen;
 };
 
 sym *sym_new(decl *d, enum sym_type t);
@@ -11,6 +11,8 @@ static const struct target_section_names section_names[] = {
 		".bss",
 		".rodata",
 		".data.rel.ro", /* .data.rel.ro[.local] */
+		".tdata",
+		".tbss",
 		".init_array,\"aw\"",
 		".fini_array,\"aw\"",
 		".debug_abbrev",
@@ -23,6 +25,8 @@ static const struct target_section_names section_names[] = {
 		".bss",
 		".rodata",
 		".data.rel.ro", /* .data.rel.ro[.local] */
+		".tdata",
+		".tbss",
 		".init_array,\"aw\"",
 		".fini_array,\"aw\"",
 		".debug_abbrev",
@@ -35,6 +39,8 @@ static const struct target_section_names section_names[] = {
 		"__BSS,__bss",
 		"__TEXT,__const", /* no relocs required (oddly text) */
 		"__DATA,__const", /* relocs required */
+		"__DATA,__thread_data,thread_local_regular",
+		"__DATA,__thread_bss,thread_local_zerofill",
 		"__DATA,__mod_init_func,mod_init_funcs",
 		"__DATA,__mod_term_func,mod_term_funcs",
 		"__DWARF,__debug_abbrev,regular,debug",
@@ -47,6 +53,8 @@ static const struct target_section_names section_names[] = {
 		".bss",
 		".rodata",
 		".data.rel.ro",
+		".tdata",
+		".tbss",
 		".ctors,\"w\"",
 		".dtors,\"w\"",
 		".debug_abbrev",
@@ -12,6 +12,8 @@ struct target_details
 		const char *section_name_bss;
 		const char *section_name_rodata;
 		const char *section_name_relro;
+		const char *section_name_tdata;
+		const char *section_name_tbss;
 		const char *section_name_ctors;
 		const char *section_name_dtors;
 		const char *section_name_dbg_abbrev;
@@ -33,7 +33,10 @@ char *cc1_sanitize_handler_fn;
 enum visibility cc1_visibility_default;
 struct target_details cc1_target_details;
 enum stringop_strategy cc1_mstringop_strategy = STRINGOP_STRATEGY_THRESHOLD;
-unsigned cc1_mstringop_threshold = 16;
+unsigned cc1_mstringop_threshold = 256;
+
+enum stack_reuse cc1_stack_reuse = STACK_REUSE_ALL;
+enum cc1_tls_model cc1_tls_model;
 
 int where_in_sysheader(const where *w)
 {
@@ -392,6 +395,7 @@ int main(void)
 
 	/* builtin tests */
 	test_out_out();
+	test_out_divconst();
 
 	return ec;
 }
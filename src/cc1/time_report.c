@@ -0,0 +1,187 @@
+#define _POSIX_C_SOURCE 199309L /* clock_gettime */
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include "../util/util.h"
+#include "../util/alloc.h"
+
+#include "time_report.h"
+#include "fopt.h"
+#include "cc1.h"
+
+#define MAX_DEPTH 64
+
+struct phase_stats
+{
+	double self, total; /* seconds */
+	unsigned long allocs, alloc_bytes;
+	unsigned long entries;
+	unsigned depth; /* for recursive phases, e.g. nested inlining */
+};
+
+static const char *const phase_names[] = {
+#define X(name, desc) desc,
+	TIME_PHASES
+#undef X
+};
+
+const char *cc1_time_report_json;
+
+static struct phase_stats stats[TIME_PHASE_COUNT];
+
+static struct
+{
+	enum time_phase phase;
+	double start;
+} stack[MAX_DEPTH];
+static unsigned stack_n;
+
+static double last_switch, time_start;
+static unsigned long last_allocs, last_alloc_bytes;
+
+static double now(void)
+{
+	struct timespec ts;
+
+	if(clock_gettime(CLOCK_MONOTONIC, &ts))
+		return 0;
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* charge everything since the last push/pop to the current innermost phase */
+static double charge_current(void)
+{
+	double t = now();
+	unsigned long allocs, alloc_bytes;
+
+	ualloc_counts(&allocs, &alloc_bytes);
+
+	if(stack_n > 0 && stack_n <= MAX_DEPTH){
+		struct phase_stats *cur = &stats[stack[stack_n - 1].phase];
+
+		cur->self += t - last_switch;
+		cur->allocs += allocs - last_allocs;
+		cur->alloc_bytes += alloc_bytes - last_alloc_bytes;
+	}
+
+	last_switch = t;
+	last_allocs = allocs;
+	last_alloc_bytes = alloc_bytes;
+
+	return t;
+}
+
+void time_report_init(void)
+{
+	time_start = last_switch = now();
+	ualloc_counts(&last_allocs, &last_alloc_bytes);
+}
+
+void time_report_push(enum time_phase phase)
+{
+	double t;
+
+	if(!cc1_fopt.time_report)
+		return;
+
+	t = charge_current();
+
+	if(stack_n < MAX_DEPTH){
+		stack[stack_n].phase = phase;
+		stack[stack_n].start = t;
+	}
+	stack_n++;
+
+	stats[phase].entries++;
+	stats[phase].depth++;
+}
+
+void time_report_pop(enum time_phase phase)
+{
+	double t;
+
+	if(!cc1_fopt.time_report)
+		return;
+
+	t = charge_current();
+
+	UCC_ASSERT(stack_n > 0, "time report underflow");
+	stack_n--;
+
+	if(stack_n < MAX_DEPTH){
+		UCC_ASSERT(stack[stack_n].phase == phase,
+				"mismatched time report phase (%s vs %s)",
+				phase_names[stack[stack_n].phase], phase_names[phase]);
+
+		/* only the outermost instance of a phase counts towards its total */
+		if(stats[phase].depth == 1)
+			stats[phase].total += t - stack[stack_n].start;
+	}
+
+	stats[phase].depth--;
+}
+
+void time_report_print(FILE *f)
+{
+	const double wall = now() - time_start;
+	double self_sum = 0;
+	int i;
+
+	fprintf(f, "Execution times (seconds)\n");
+	fprintf(f, " %-18s %10s %6s %10s %10s %12s\n",
+			"phase", "self", "%", "total", "allocs", "alloc bytes");
+
+	for(i = 0; i < TIME_PHASE_COUNT; i++){
+		const struct phase_stats *p = &stats[i];
+
+		self_sum += p->self;
+
+		if(!p->entries)
+			continue;
+
+		fprintf(f, " %-18s %10.4f %5.1f%% %10.4f %10lu %12lu\n",
+				phase_names[i],
+				p->self,
+				wall > 0 ? 100 * p->self / wall : 0.0,
+				p->total,
+				p->allocs,
+				p->alloc_bytes);
+	}
+
+	fprintf(f, " %-18s %10.4f\n", "other", wall - self_sum);
+	fprintf(f, " %-18s %10.4f\n", "TOTAL", wall);
+}
+
+void time_report_json(const char *fname)
+{
+	const double wall = now() - time_start;
+	FILE *f = fopen(fname, "w");
+	int i;
+
+	if(!f){
+		fprintf(stderr, "open %s: %s\n", fname, strerror(errno));
+		return;
+	}
+
+	fprintf(f, "{\n  \"total\": %f,\n  \"phases\": [\n", wall);
+
+	for(i = 0; i < TIME_PHASE_COUNT; i++){
+		const struct phase_stats *p = &stats[i];
+
+		fprintf(f,
+				"    { \"name\": \"%s\", \"self\": %f, \"total\": %f, "
+				"\"entries\": %lu, \"allocs\": %lu, \"alloc_bytes\": %lu }%s\n",
+				phase_names[i], p->self, p->total,
+				p->entries, p->allocs, p->alloc_bytes,
+				i == TIME_PHASE_COUNT - 1 ? "" : ",");
+	}
+
+	fprintf(f, "  ]\n}\n");
+
+	if(fclose(f))
+		fprintf(stderr, "close %s: %s\n", fname, strerror(errno));
+}
@@ -0,0 +1,36 @@
+#ifndef TIME_REPORT_H
+#define TIME_REPORT_H
+
+#include <stdio.h>
+
+/* phases, in reporting order. time is attributed to the innermost
+ * (most recently pushed) phase, e.g. inlining during code generation */
+#define TIME_PHASES \
+	X(TIME_LEX, "tokenise") \
+	X(TIME_PARSE, "parse") \
+	X(TIME_FOLD, "fold") \
+	X(TIME_GEN, "code generation") \
+	X(TIME_INLINE, "inlining") \
+	X(TIME_BLK_FLUSH, "block flush") \
+	X(TIME_DBG, "dwarf emission") \
+	X(TIME_IO_FIN, "output finalise")
+
+enum time_phase
+{
+#define X(name, desc) name,
+	TIME_PHASES
+#undef X
+	TIME_PHASE_COUNT
+};
+
+extern const char *cc1_time_report_json;
+
+void time_report_init(void);
+
+void time_report_push(enum time_phase);
+void time_report_pop(enum time_phase);
+
+void time_report_print(FILE *);
+void time_report_json(const char *fname);
+
+#endif
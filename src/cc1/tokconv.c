@@ -41,6 +41,7 @@ enum type_qualifier curtok_to_type_qualifier(void)
 		case token_const:    return qual_const;
 		case token_volatile: return qual_volatile;
 		case token_restrict: return qual_restrict;
+		case token__Atomic:  return qual_atomic;
 		default:             return qual_none;
 	}
 }
@@ -169,11 +170,13 @@ char *token_to_str(enum token t)
 		/* sort-of storage */
 		CASE_STR_PREFIX(token,  inline);
 		CASE_STR_PREFIX(token,  _Noreturn);
+		CASE_STR_PREFIX(token,  _Thread_local);
 
 		/* type-qual */
 		CASE_STR_PREFIX(token,  const);
 		CASE_STR_PREFIX(token,  volatile);
 		CASE_STR_PREFIX(token,  restrict);
+		CASE_STR_PREFIX(token,  _Atomic);
 
 		/* type */
 		CASE_STR_PREFIX(token,  void);
@@ -291,9 +294,11 @@ char *eat_curtok_to_identifier(int *alloc, where *loc)
 		case token__Alignas:
 		case token_inline:
 		case token__Noreturn:
+		case token__Thread_local:
 		case token_const:
 		case token_volatile:
 		case token_restrict:
+		case token__Atomic:
 		case token_void:
 		case token_char:
 		case token_short:
@@ -20,6 +20,7 @@
 #include "fopt.h"
 #include "tokconv.h"
 #include "pragma.h"
+#include "time_report.h"
 
 #define DEBUG_LINE_DIRECTIVE 0
 
@@ -81,6 +82,7 @@ static const struct keyword
 	KEYWORD__ALL(KW_ALL, const),
 	KEYWORD__ALL(KW_ALL, volatile),
 	KEYWORD__ALL(KW_C99, restrict),
+	KEYWORD(KW_ALL, _Atomic),
 
 	KEYWORD__ALL(KW_ALL, signed),
 	KEYWORD__ALL(KW_ALL, unsigned),
@@ -92,6 +94,8 @@ static const struct keyword
 
 	KEYWORD(KW_ALL, _Bool), /* reserved namespace - fine for C89 */
 	KEYWORD(KW_ALL, _Noreturn),
+	KEYWORD(KW_ALL, _Thread_local),
+	{ "__thread", token__Thread_local, KW_ALL },
 
 	KEYWORD(KW_ALL, _Alignof),
 	KEYWORD__(alignof, token___alignof),
@@ -136,12 +140,6 @@ static int ungetch = EOF;
 
 static int in_comment;
 
-static struct line_list
-{
-	char *line;
-	struct line_list *next;
-} *store_lines, **store_line_last = &store_lines;
-
 static int in_sysh;
 
 /* -- */
@@ -161,14 +159,17 @@ struct loc loc_tok;
 
 char *current_line_str = NULL;
 int current_line_str_used = 0;
+static int current_line_str_owned = 0;
 
-#define SET_CURRENT(ty, new) do{\
-	if(!current_ ## ty ## _used)  \
-		free(current_ ## ty);       \
-	current_## ty = new;          \
-	current_## ty ##_used = 0; }while(0)
+static void set_current_line_str(char *new, int owned)
+{
+	if(current_line_str_owned && !current_line_str_used)
+		free(current_line_str);
 
-#define SET_CURRENT_LINE_STR(new) SET_CURRENT(line_str, new)
+	current_line_str = new;
+	current_line_str_used = 0;
+	current_line_str_owned = owned;
+}
 
 
 struct where *where_cc1_current(struct where *w)
@@ -423,35 +424,24 @@ void include_bt(FILE *f)
 	}
 }
 
-static void add_store_line(char *l)
-{
-	struct line_list *new = umalloc(sizeof *new);
-	new->line = l;
-
-	*store_line_last = new;
-	store_line_last = &new->next;
-}
-
-static ucc_wur char *tokenise_read_line(void)
+static ucc_wur char *tokenise_read_line(const char **persistent)
 {
 	char *l;
 
 	if(buffereof)
 		return NULL;
 
-	l = in_func();
+	*persistent = NULL;
+	l = in_func(persistent);
 	if(!l){
 		buffereof = 1;
 	}else{
 		/* check for preprocessor line info */
-		/* but first - add to store_lines */
-		if(cc1_fopt.show_line)
-			add_store_line(l);
-
 		/* format is # line? [0-9] "filename" ([0-9])* */
 		if(!in_comment && *l == '#'){
 			parse_line_directive(l);
-			return tokenise_read_line();
+			free(l);
+			return tokenise_read_line(persistent);
 		}
 
 		loc_now.chr = 0;
@@ -467,16 +457,22 @@ static ucc_wur char *tokenise_read_line(void)
 
 static void tokenise_next_line(void)
 {
-	char *new = tokenise_read_line();
-
-	if(new)
-		SET_CURRENT_LINE_STR(ustrdup(new));
+	const char *persistent;
+	char *new = tokenise_read_line(&persistent);
 
-	if(buffer){
+	if(new){
+		/* diagnostics refer to the input's copy of the line if it has one,
+		 * so we don't retain a copy of every line just in case */
 		if(!cc1_fopt.show_line)
-			free(buffer);
+			set_current_line_str(NULL, 0);
+		else if(persistent)
+			set_current_line_str((char *)persistent, 0);
+		else
+			set_current_line_str(ustrdup_tag(new, UALLOC_LINE), 1);
 	}
 
+	free(buffer);
+
 	bufferpos = buffer = new;
 }
 
@@ -496,7 +492,7 @@ void tokenise_set_input(tokenise_line_f *func, const char *nam)
 	else
 		set_current_fname(nam_dup, 0);
 
-	SET_CURRENT_LINE_STR(NULL);
+	set_current_line_str(NULL, 0);
 
 	loc_now.line = buffereof = parse_finished = 0;
 	nexttoken();
@@ -575,7 +571,8 @@ int tok_at_label(void)
 
 	/* read the next line in */
 	{
-		char *const new = tokenise_read_line();
+		const char *persistent;
+		char *const new = tokenise_read_line(&persistent);
 
 		if(new){
 			size_t const newlen = strlen(new);
@@ -585,6 +582,7 @@ int tok_at_label(void)
 			buffer = urealloc1(buffer, len + 1);
 			p = buffer + poff;
 			memcpy(p, new, newlen + 1);
+			free(new);
 			update_bufferpos(p);
 			return tok_at_label();
 		}
@@ -1117,7 +1115,7 @@ static void read_number(const int first)
 	curtok = (currentval.suffix & VAL_FLOATING ? token_floater : token_integer);
 }
 
-void nexttoken(void)
+static void nexttoken_1(void)
 {
 	int c;
 
@@ -1224,7 +1222,7 @@ void nexttoken(void)
 
 		/* not found, wap into currentspelling */
 		free(currentspelling);
-		currentspelling = umalloc(len + 1);
+		currentspelling = umalloc_tag(len + 1, UALLOC_TOKEN);
 
 		strncpy(currentspelling, start, len);
 		currentspelling[len] = '\0';
@@ -1405,3 +1403,10 @@ void nexttoken(void)
 		curtok = curtok_to_xequal(); /* '+' '=' -> "+=" */
 	}
 }
+
+void nexttoken(void)
+{
+	time_report_push(TIME_LEX);
+	nexttoken_1();
+	time_report_pop(TIME_LEX);
+}
@@ -49,11 +49,13 @@ enum token
 
 	token_inline,
 	token__Noreturn,
+	token__Thread_local,
 
 	token_const,
 	token_volatile,
 	/**/
 	token_restrict, /* sort of a type-qual */
+	token__Atomic, /* qualifier, or _Atomic(type) specifier */
 	/**/
 	token_signed,
 	token_unsigned,
@@ -119,7 +121,11 @@ enum token
 	token_unknown
 };
 
-typedef char *tokenise_line_f(void);
+/* returns a line to tokenise, which the tokeniser frees. if the input
+ * outlives the compile (e.g. it's mapped), *persistent may be pointed at
+ * the line's ('\n'-terminated) location in it, to be referenced from
+ * diagnostics instead of keeping a copy of the line */
+typedef char *tokenise_line_f(const char **persistent);
 
 void tokenise_set_input(
 		tokenise_line_f *,
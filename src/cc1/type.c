@@ -54,7 +54,7 @@ static int type_qual_cmp(enum type_qualifier a, enum type_qualifier b)
 	if(a == b)
 		return 0;
 
-	/* check const, then volatile */
+	/* check const, then volatile, then _Atomic */
 	r = type_qual_cmp_1(a, b, qual_const);
 	if(r)
 		return r;
@@ -63,6 +63,10 @@ static int type_qual_cmp(enum type_qualifier a, enum type_qualifier b)
 	if(r)
 		return r;
 
+	r = type_qual_cmp_1(a, b, qual_atomic);
+	if(r)
+		return r;
+
 	/* should be unreachable, or we've missed a qual_* */
 	return 0;
 }
@@ -324,13 +328,32 @@ integral_t type_max(type *r, where *from)
 	return max;
 }
 
-unsigned type_size(type *r, const where *from)
+static unsigned long layout_cache_hits, layout_cache_misses;
+
+void type_layout_cache_stats(unsigned long *hits, unsigned long *misses)
+{
+	*hits = layout_cache_hits;
+	*misses = layout_cache_misses;
+}
+
+static int sue_layout_cacheable(struct_union_enum_st *sue)
+{
+	/* incomplete sues aren't cached, so completing one needs no invalidation */
+	return !sue || sue_is_complete(sue);
+}
+
+static unsigned type_size_r(type *r, const where *from, int *const cacheable);
+
+static unsigned type_size_uncached(
+		type *r, const where *from, int *const cacheable)
 {
 	switch(r->type){
 		case type_auto:
 			ICE("__auto_type");
 
 		case type_btype:
+			if(!sue_layout_cacheable(r->bits.type->sue))
+				*cacheable = 0;
 			return btype_size(r->bits.type, from);
 
 		case type_tdef:
@@ -339,17 +362,17 @@ unsigned type_size(type *r, const where *from)
 			type *sub;
 
 			if(d)
-				return type_size(d->ref, from);
+				return type_size_r(d->ref, from, cacheable);
 
 			sub = r->bits.tdef.type_of->tree_type;
 			UCC_ASSERT(sub, "type_size for unfolded typedef");
-			return type_size(sub, from);
+			return type_size_r(sub, from, cacheable);
 		}
 
 		case type_attr:
 		case type_cast:
 		case type_where:
-			return type_size(r->ref, from);
+			return type_size_r(r->ref, from, cacheable);
 
 		case type_ptr:
 		case type_block:
@@ -369,16 +392,52 @@ unsigned type_size(type *r, const where *from)
 			if(!r->bits.array.size)
 				die_at(from, "array has an incomplete size");
 
+			if(r->bits.array.vla_kind != VLA_NO)
+				*cacheable = 0;
+
 			sz = const_fold_val_i(r->bits.array.size);
 
-			return sz * type_size(r->ref, from);
+			return sz * type_size_r(r->ref, from, cacheable);
 		}
 	}
 
 	ucc_unreach(0);
 }
 
-static unsigned type_align_with_attr(type *r, const where *from, int with_attributes)
+static unsigned type_size_r(type *r, const where *from, int *const cacheable)
+{
+	int this_cacheable = 1;
+	unsigned sz;
+
+	if(r->size_cached){
+		layout_cache_hits++;
+		return r->size_cache;
+	}
+	layout_cache_misses++;
+
+	sz = type_size_uncached(r, from, &this_cacheable);
+
+	if(this_cacheable){
+		r->size_cache = sz;
+		r->size_cached = 1;
+	}else{
+		*cacheable = 0;
+	}
+
+	return sz;
+}
+
+unsigned type_size(type *r, const where *from)
+{
+	int cacheable;
+	return type_size_r(r, from, &cacheable);
+}
+
+static unsigned type_align_r(type *r, const where *from, int *const cacheable);
+
+static unsigned type_align_with_attr(
+		type *r, const where *from, int with_attributes,
+		int *const cacheable)
 {
 	struct_union_enum_st *sue;
 	type *test;
@@ -401,6 +460,8 @@ static unsigned type_align_with_attr(type *r, const where *from, int with_attrib
 	if((sue = type_is_s_or_u(r))){
 		/* safe - can't have an instance without a ->sue */
 		assert(sue->foldprog == SUE_FOLDED_FULLY);
+		if(!sue_layout_cacheable(sue))
+			*cacheable = 0;
 		return sue_align(sue, from);
 	}
 
@@ -410,23 +471,51 @@ static unsigned type_align_with_attr(type *r, const where *from, int with_attrib
 		return platform_word_size();
 	}
 
-	if((test = type_is(r, type_btype)))
+	if((test = type_is(r, type_btype))){
+		if(!sue_layout_cacheable(test->bits.type->sue))
+			*cacheable = 0;
 		return btype_align(test->bits.type, from);
+	}
 
 	if((test = type_is(r, type_array)))
-		return type_align(test->ref, from /* attributes apply from here on */);
+		return type_align_r(test->ref, from /* attributes apply from here on */, cacheable);
 
 	return 1;
 }
 
+static unsigned type_align_r(type *r, const where *from, int *const cacheable)
+{
+	int this_cacheable = 1;
+	unsigned align;
+
+	if(r->align_cached){
+		layout_cache_hits++;
+		return r->align_cache;
+	}
+	layout_cache_misses++;
+
+	align = type_align_with_attr(r, from, 1, &this_cacheable);
+
+	if(this_cacheable){
+		r->align_cache = align;
+		r->align_cached = 1;
+	}else{
+		*cacheable = 0;
+	}
+
+	return align;
+}
+
 unsigned type_align_no_attr(type *r, where const *from)
 {
-	return type_align_with_attr(r, from, 0);
+	int cacheable;
+	return type_align_with_attr(r, from, 0, &cacheable);
 }
 
 unsigned type_align(type *r, where const *from)
 {
-	return type_align_with_attr(r, from, 1);
+	int cacheable;
+	return type_align_r(r, from, &cacheable);
 }
 
 where *type_loc(type *t)
@@ -19,6 +19,11 @@ struct type
 
 	int folded;
 
+	/* layout cache, filled by type_size() and type_align() once the
+	 * layout is known not to change (i.e. not a VLA or incomplete sue) */
+	unsigned size_cache, align_cache;
+	unsigned size_cached : 1, align_cached : 1;
+
 	struct type_tree *uptree;
 
 	enum type_kind
@@ -116,6 +121,8 @@ unsigned type_size(type *r, where const *from);
 unsigned type_align(type *r, where const *from);
 unsigned type_align_no_attr(type *r, where const *from);
 
+void type_layout_cache_stats(unsigned long *hits, unsigned long *misses);
+
 const char *type_kind_to_str(enum type_kind);
 
 #define TYPE_STATIC_BUFSIZ 512
@@ -46,7 +46,7 @@ struct type_nav *type_nav_init(void)
 
 static type *type_new(enum type_kind t, type *of)
 {
-	type *r = umalloc(sizeof *r);
+	type *r = umalloc_tag(sizeof *r, UALLOC_TYPE);
 	r->type = t;
 	r->ref = of;
 	return r;
@@ -86,7 +86,7 @@ type *type_uptree_find_or_new(
 		if(TYPE_UNIQ_DEBUG)
 			fprintf(stderr, "no uptree for %s\n", type_to_str(to));
 
-		to->uptree = umalloc(sizeof *to->uptree);
+		to->uptree = umalloc_tag(sizeof *to->uptree, UALLOC_TYPE);
 	}
 
 	for(ent = &to->uptree->ups[idx]; *ent; ent = &(*ent)->next){
@@ -112,7 +112,7 @@ type *type_uptree_find_or_new(
 		if(init)
 			init(new_t, ctx);
 
-		*ent = umalloc(sizeof **ent);
+		*ent = umalloc_tag(sizeof **ent, UALLOC_TYPE);
 		(*ent)->t = new_t;
 
 		if(TYPE_UNIQ_DEBUG)
@@ -563,7 +563,7 @@ type *type_nav_int_enum(struct type_nav *root, struct_union_enum_st *enu)
 	if(ent)
 		return ent;
 
-	bt = umalloc(sizeof *bt);
+	bt = umalloc_tag(sizeof *bt, UALLOC_TYPE);
 	bt->primitive = type_int;
 	bt->sue = enu;
 	ent = type_new_btype(bt);
@@ -646,7 +646,7 @@ type *type_nav_btype(struct type_nav *root, enum type_primitive p)
 	assert(p < type_struct);
 
 	if(!root->btypes[p]){
-		btype *b = umalloc(sizeof *b);
+		btype *b = umalloc_tag(sizeof *b, UALLOC_TYPE);
 		b->primitive = p;
 		root->btypes[p] = type_new_btype(b);
 	}
@@ -677,7 +677,7 @@ type *type_nav_suetype(struct type_nav *root, struct_union_enum_st *sue)
 	if(ent)
 		return ent;
 
-	bt = umalloc(sizeof *bt);
+	bt = umalloc_tag(sizeof *bt, UALLOC_TYPE);
 	bt->primitive = sue->primitive;
 	bt->sue = sue;
 	ent = type_new_btype(bt);
@@ -793,6 +793,7 @@ void type_nav_dump(struct type_nav *nav)
 {
 	int i;
 	type *t;
+	unsigned long hits, misses;
 
 	for(i = 0; i < N_TYPE_KINDS; i++){
 		t = nav->btypes[i];
@@ -806,4 +807,9 @@ void type_nav_dump(struct type_nav *nav)
 	{
 		type_dump_t(t, stderr, 0);
 	}
+
+	type_layout_cache_stats(&hits, &misses);
+	fprintf(stderr, "layout cache: %lu hits, %lu misses (%.1f%% hit rate)\n",
+			hits, misses,
+			hits + misses ? 100.0 * hits / (hits + misses) : 0.0);
 }
@@ -1,8 +1,9 @@
 #ifndef FEAT_H
 #define FEAT_H
 
-#define UCC_HAS_ATOMICS 0
-#define UCC_HAS_THREADS 0
+#define UCC_HAS_ATOMICS 1
+#define UCC_HAS_THREADS 0 /* <threads.h> */
+#define UCC_HAS_THREAD_LOCAL 1
 #define UCC_HAS_COMPLEX 0
 #define UCC_HAS_VLA 1
 
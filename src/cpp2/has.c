@@ -60,7 +60,7 @@ static int has_feat_ext(const char *nam, int as_ext)
 		{ STD_C11, "c_generic_selections", 1 },
 		{ STD_C11, "c_static_assert", 1 },
 		{ STD_C11, "c_atomic", UCC_HAS_ATOMICS },
-		{ STD_C11, "c_thread_local", UCC_HAS_THREADS },
+		{ STD_C11, "c_thread_local", UCC_HAS_THREAD_LOCAL },
 		{ STD_C11, "c_complex", UCC_HAS_COMPLEX },
 
 		{ STD_C99, "c_vla", UCC_HAS_VLA },
@@ -120,5 +120,8 @@ static int has_builtin(const char *nam)
 #define BUILTIN(x, ty) if(!strcmp("__builtin_" x, nam)) return 1;
 	BUILTINS
 #undef BUILTIN
+#define ATOMIC_BUILTIN(x, kind, op, nargs, order_arg, implied) if(!strcmp(x, nam)) return 1;
+	ATOMIC_BUILTINS
+#undef ATOMIC_BUILTIN
 	return 0;
 }
@@ -38,7 +38,7 @@ static const struct
 	{ "__STDC_NO_ATOMICS__" , "1", 0 }, /* _Atomic */
 #endif
 #if !UCC_HAS_THREADS
-	{ "__STDC_NO_THREADS__" , "1", 0 }, /* _Thread_local */
+	{ "__STDC_NO_THREADS__" , "1", 0 }, /* <threads.h> */
 #endif
 #if !UCC_HAS_COMPLEX
 	{ "__STDC_NO_COMPLEX__", "1", 0 }, /* _Complex */
@@ -53,6 +53,14 @@ static const struct
 	TYPE(PTRDIFF, unsigned long),
 	TYPE(WINT, unsigned),
 
+	/* memory orders for __atomic_*, see enum out_memorder */
+	{ "__ATOMIC_RELAXED", "0", 0 },
+	{ "__ATOMIC_CONSUME", "1", 0 },
+	{ "__ATOMIC_ACQUIRE", "2", 0 },
+	{ "__ATOMIC_RELEASE", "3", 0 },
+	{ "__ATOMIC_ACQ_REL", "4", 0 },
+	{ "__ATOMIC_SEQ_CST", "5", 0 },
+
 	{ "__ORDER_LITTLE_ENDIAN__", "1234", 0 },
 	{ "__ORDER_BIG_ENDIAN__",    "4321", 0 },
 	{ "__ORDER_PDP_ENDIAN__",    "3412", 0 },
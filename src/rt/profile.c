@@ -0,0 +1,199 @@
+/* -fprofile-generate runtime
+ *
+ * each instrumented translation unit places a descriptor in the ucc_profile
+ * section. at exit, every profile file named by a descriptor is re-read, the
+ * counts for our functions added in and the file rewritten, one line per
+ * function:
+ *   <unit> <function> <ncounters> <counter>...
+ *
+ * libc is declared by hand, this is built before any headers are usable */
+
+#define NAME_MAX_ 4096
+#define NAME_FMT_ "%4095s"
+
+typedef struct profile_FILE FILE;
+typedef unsigned long size_t;
+
+FILE *fopen(const char *, const char *);
+int fclose(FILE *);
+int fscanf(FILE *, const char *, ...);
+int fprintf(FILE *, const char *, ...);
+size_t strlen(const char *);
+int strcmp(const char *, const char *);
+void *memcpy(void *, const void *, size_t);
+void *malloc(size_t);
+void free(void *);
+int atexit(void (*)(void));
+
+struct profile_func
+{
+	const char *name;
+	unsigned long ncounters;
+	unsigned long *counters;
+};
+
+struct profile_unit
+{
+	const char *path;
+	const char *unit;
+	unsigned long nfuncs;
+	struct profile_func *funcs;
+};
+
+/* lines from other programs or units, carried over when rewriting */
+struct foreign
+{
+	struct foreign *next;
+	char *unit, *func;
+	unsigned long n;
+	unsigned long counts[];
+};
+
+__attribute((weak, visibility("hidden")))
+extern const struct profile_unit __start_ucc_profile[];
+__attribute((weak, visibility("hidden")))
+extern const struct profile_unit __stop_ucc_profile[];
+
+static char *copy_str(const char *s)
+{
+	size_t n = strlen(s) + 1;
+	char *d = malloc(n);
+	if(d)
+		memcpy(d, s, n);
+	return d;
+}
+
+static struct profile_func *find(
+		const char *path, const char *unit, const char *func, unsigned long n)
+{
+	const struct profile_unit *u;
+	unsigned long i;
+
+	for(u = __start_ucc_profile; u < __stop_ucc_profile; u++){
+		if(strcmp(u->path, path) || strcmp(u->unit, unit))
+			continue;
+
+		for(i = 0; i < u->nfuncs; i++)
+			if(u->funcs[i].ncounters == n && !strcmp(u->funcs[i].name, func))
+				return &u->funcs[i];
+	}
+	return 0;
+}
+
+static struct foreign *merge(const char *path)
+{
+	static char unit[NAME_MAX_], func[NAME_MAX_];
+	struct foreign *head = 0, **tail = &head;
+	unsigned long n, i;
+	FILE *f = fopen(path, "r");
+
+	if(!f)
+		return 0;
+
+	while(fscanf(f, NAME_FMT_ " " NAME_FMT_ " %lu", unit, func, &n) == 3){
+		struct profile_func *ours = find(path, unit, func, n);
+		struct foreign *other = 0;
+
+		if(!ours){
+			other = malloc(sizeof *other + n * sizeof other->counts[0]);
+			if(!other)
+				break;
+			other->next = 0;
+			other->unit = copy_str(unit);
+			other->func = copy_str(func);
+			other->n = n;
+		}
+
+		for(i = 0; i < n; i++){
+			unsigned long count;
+
+			if(fscanf(f, "%lu", &count) != 1)
+				break;
+
+			if(ours)
+				ours->counters[i] += count;
+			else
+				other->counts[i] = count;
+		}
+
+		if(i < n){
+			/* truncated, drop the partial line */
+			if(other)
+				free(other->unit), free(other->func), free(other);
+			break;
+		}
+
+		if(other && other->unit && other->func){
+			*tail = other;
+			tail = &other->next;
+		}
+	}
+
+	fclose(f);
+	return head;
+}
+
+static void dump_path(const char *path)
+{
+	struct foreign *other = merge(path);
+	const struct profile_unit *u;
+	unsigned long i, j;
+	FILE *f = fopen(path, "w");
+
+	while(other){
+		struct foreign *next = other->next;
+
+		if(f){
+			fprintf(f, "%s %s %lu", other->unit, other->func, other->n);
+			for(i = 0; i < other->n; i++)
+				fprintf(f, " %lu", other->counts[i]);
+			fprintf(f, "\n");
+		}
+
+		free(other->unit);
+		free(other->func);
+		free(other);
+		other = next;
+	}
+
+	if(!f)
+		return;
+
+	for(u = __start_ucc_profile; u < __stop_ucc_profile; u++){
+		if(strcmp(u->path, path))
+			continue;
+
+		for(i = 0; i < u->nfuncs; i++){
+			const struct profile_func *fn = &u->funcs[i];
+
+			fprintf(f, "%s %s %lu", u->unit, fn->name, fn->ncounters);
+			for(j = 0; j < fn->ncounters; j++)
+				fprintf(f, " %lu", fn->counters[j]);
+			fprintf(f, "\n");
+		}
+	}
+
+	fclose(f);
+}
+
+static void dump(void)
+{
+	const struct profile_unit *u, *seen;
+
+	for(u = __start_ucc_profile; u < __stop_ucc_profile; u++){
+		/* each file once, for all the units writing to it */
+		for(seen = __start_ucc_profile; seen < u; seen++)
+			if(!strcmp(seen->path, u->path))
+				break;
+
+		if(seen == u)
+			dump_path(u->path);
+	}
+}
+
+__attribute((constructor))
+static void init(void)
+{
+	if(__start_ucc_profile != __stop_ucc_profile)
+		atexit(dump);
+}
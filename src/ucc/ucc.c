@@ -69,6 +69,7 @@ struct ucc
 	const char **isystems;
 
 	int syntax_only;
+	int integrated_as;
 	enum mode mode;
 
 	const char *as, *ld;
@@ -96,7 +97,7 @@ struct uccvars
 
 	int static_, shared, rdynamic;
 	int stdlibinc, builtininc, defaultlibs, startfiles;
-	int debug, profile;
+	int debug, profile, profile_generate;
 	enum tristate pie;
 	enum tristate multilib;
 	enum dyld dyld;
@@ -263,7 +264,8 @@ after_compile:
 }
 
 static void gen_obj_file(
-		struct cc_file *file, char **args[], enum mode mode, const char *as)
+		struct cc_file *file, char **args[], enum mode mode,
+		const char *as, int integrated_as)
 {
 	char *in = file->in.fname;
 
@@ -281,6 +283,24 @@ static void gen_obj_file(
 	if(mode == mode_preproc)
 		return;
 
+	if(file->compile.fname
+	&& integrated_as
+	&& mode != mode_compile
+	&& file->assemb.fname
+	&& !save_temps)
+	{
+		/* cc1 writes the object file directly, skipping as */
+		char **objargs = NULL;
+
+		dynarray_add_array(&objargs, args[mode_compile]);
+		dynarray_add(&objargs, "-emit=obj");
+
+		compile(in, file->assemb.fname, objargs, 0);
+
+		dynarray_free(char **, objargs, NULL);
+		return;
+	}
+
 	if(file->compile.fname){
 		compile(in, file->compile.fname, args[mode_compile], 0);
 
@@ -379,7 +399,7 @@ static void process_files(
 	for(i = 0; i < ninputs; i++){
 		create_file(&files[i], assumptions[i], state->mode, state->inputs[i]);
 
-		gen_obj_file(&files[i], state->args, state->mode, state->as);
+		gen_obj_file(&files[i], state->args, state->mode, state->as, state->integrated_as);
 
 		dynarray_add(&links, ustrdup(files[i].out.fname));
 	}
@@ -684,6 +704,10 @@ static void parse_argv(
 						state->syntax_only = 1;
 						continue;
 					}
+					if(!strcmp(arg, "-fintegrated-as") || !strcmp(arg, "-fno-integrated-as")){
+						state->integrated_as = !!strncmp(arg, "-fno-", 5);
+						continue;
+					}
 					if(!strncmp(argv[i], "-fuse-cpp", 9)){
 						const char *arg = argv[i] + 9;
 						switch(*arg){
@@ -701,6 +725,15 @@ static void parse_argv(
 					if(handle_spanning_fopt(argv[i], state))
 						continue;
 
+					/* instrumented programs need the profile runtime, cc1 gets it too */
+					if(!strncmp(argv[i], "-fprofile-generate", 18)
+					&& (argv[i][18] == '\0' || argv[i][18] == '='))
+					{
+						vars->profile_generate = 1;
+					}else if(!strcmp(argv[i], "-fno-profile-generate")){
+						vars->profile_generate = 0;
+					}
+
 					/* pull out some that cpp wants too: */
 					if(!strcmp(argv[i], "-ffreestanding")
 					|| !strncmp(argv[i], "-fmessage-length=", 17))
@@ -1078,6 +1111,9 @@ static void merge_states(struct ucc *state, struct ucc *append)
 	assert(!state->syntax_only);
 	state->syntax_only = append->syntax_only;
 
+	assert(!state->integrated_as);
+	state->integrated_as = append->integrated_as;
+
 	state->mode = append->mode;
 
 	if(!state->as)
@@ -1238,6 +1274,14 @@ static void state_from_triple(
 				}
 			}
 
+			if(vars->profile_generate){
+				/* dumps the -fprofile-generate counters at exit */
+				struct cmdpath prof;
+
+				cmdpath_initrelative(&prof, "../rt/profile.o", "../rt/profile.o");
+				dynarray_add(&state->ldflags_pre_user, cmdpath_resolve(&prof, NULL));
+			}
+
 			if(vars->stdlibinc){
 				dynarray_add(&state->args[mode_preproc], ustrdup("-isystem"));
 				dynarray_add(&state->args[mode_preproc], ustrprintf("/usr/include/%s", multilib_prefix));
@@ -1346,6 +1390,7 @@ static void usage(void)
 	fprintf(stderr, "  -S: Only run preprocessor and compiler\n");
 	fprintf(stderr, "  -c: Only run preprocessor, compiler and assembler\n");
 	fprintf(stderr, "  -fuse-cpp=...: Specify a preprocessor executable to use\n");
+	fprintf(stderr, "  -f[no-]integrated-as: Have the compiler write object files directly, instead of running as\n");
 	fprintf(stderr, "  -time: Output time for each stage\n");
 	fprintf(stderr, "  -wrapper exe,arg1,...: Prefix stage commands with this executable and arguments\n");
 	fprintf(stderr, "\n");
@@ -7,27 +7,71 @@
 #include "../util/util.h"
 #include "alloc.h"
 
-void *umalloc(size_t l)
+static struct
+{
+	unsigned long count, bytes;
+} alloc_stats[UALLOC_TAG_COUNT];
+
+static const char *const alloc_tag_names[] = {
+#define X(name, desc) desc,
+	UALLOC_TAGS
+#undef X
+};
+
+#define ACCOUNT(tag, n) (alloc_stats[tag].count++, alloc_stats[tag].bytes += (n))
+
+void ualloc_counts(unsigned long *count, unsigned long *bytes)
+{
+	int i;
+
+	*count = *bytes = 0;
+	for(i = 0; i < UALLOC_TAG_COUNT; i++){
+		*count += alloc_stats[i].count;
+		*bytes += alloc_stats[i].bytes;
+	}
+}
+
+void ualloc_tag_counts(enum ualloc_tag tag, unsigned long *count, unsigned long *bytes)
+{
+	*count = alloc_stats[tag].count;
+	*bytes = alloc_stats[tag].bytes;
+}
+
+const char *ualloc_tag_name(enum ualloc_tag tag)
+{
+	return alloc_tag_names[tag];
+}
+
+void *umalloc_tag(size_t l, enum ualloc_tag tag)
 {
 	void *p = calloc(1, l);
+	ACCOUNT(tag, l);
 	if(!p)
 		ICE("calloc %ld bytes:", (long)l);
 	return p;
 }
 
+void *umalloc(size_t l)
+{
+	return umalloc_tag(l, UALLOC_MISC);
+}
+
 void *ucalloc(size_t n, size_t sz)
 {
 	void *p = calloc(n, sz);
+	ACCOUNT(UALLOC_MISC, n * sz);
 	if(!p)
 		ICE("calloc(%ld, %ld):", n, sz);
 	return p;
 }
 
-void *urealloc(void *p, size_t new, size_t old)
+void *urealloc_tag(void *p, size_t new, size_t old, enum ualloc_tag tag)
 {
 	void *r = realloc(p, new);
 	size_t diff = new - old;
 
+	ACCOUNT(tag, !p ? new : new > old ? diff : 0);
+
 	if(!r)
 		ICE("realloc %p by %ld bytes:", p, (long)diff);
 
@@ -38,21 +82,32 @@ void *urealloc(void *p, size_t new, size_t old)
 	return r;
 }
 
+void *urealloc(void *p, size_t new, size_t old)
+{
+	return urealloc_tag(p, new, old, UALLOC_MISC);
+}
+
 void *urealloc1(void *p, size_t l)
 {
 	char *r = realloc(p, l);
+	ACCOUNT(UALLOC_MISC, l);
 	if(!r)
 		ICE("realloc %p by %ld bytes:", p, (long)l);
 	return r;
 }
 
-char *ustrdup(const char *s)
+char *ustrdup_tag(const char *s, enum ualloc_tag tag)
 {
-	char *r = umalloc(strlen(s) + 1);
+	char *r = umalloc_tag(strlen(s) + 1, tag);
 	strcpy(r, s);
 	return r;
 }
 
+char *ustrdup(const char *s)
+{
+	return ustrdup_tag(s, UALLOC_MISC);
+}
+
 char *ustrdup_or_null(const char *s)
 {
 	return s ? ustrdup(s) : NULL;
@@ -71,7 +126,7 @@ char *ustrdup2(const char *a, const char *b)
 	return ret;
 }
 
-char *ustrvprintf(const char *fmt, va_list l)
+char *ustrvprintf_tag(enum ualloc_tag tag, const char *fmt, va_list l)
 {
 	char *buf = NULL;
 	int len = 8, ret;
@@ -81,7 +136,7 @@ char *ustrvprintf(const char *fmt, va_list l)
 		int old = len;
 
 		len *= 2;
-		buf = urealloc(buf, len, old);
+		buf = urealloc_tag(buf, len, old, tag);
 
 		va_copy(lcp, l);
 		ret = vsnprintf(buf, len, fmt, lcp);
@@ -93,6 +148,21 @@ char *ustrvprintf(const char *fmt, va_list l)
 
 }
 
+char *ustrvprintf(const char *fmt, va_list l)
+{
+	return ustrvprintf_tag(UALLOC_MISC, fmt, l);
+}
+
+char *ustrprintf_tag(enum ualloc_tag tag, const char *fmt, ...)
+{
+	va_list l;
+	char *r;
+	va_start(l, fmt);
+	r = ustrvprintf_tag(tag, fmt, l);
+	va_end(l);
+	return r;
+}
+
 char *ustrprintf(const char *fmt, ...)
 {
 	va_list l;
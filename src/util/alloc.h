@@ -6,6 +6,28 @@
 
 #include "compiler.h"
 
+/* allocation accounting tags, see -fmem-report */
+#define UALLOC_TAGS \
+	X(UALLOC_MISC, "misc") \
+	X(UALLOC_TOKEN, "tokens") \
+	X(UALLOC_LINE, "source lines") \
+	X(UALLOC_TYPE, "types") \
+	X(UALLOC_DECL, "decls") \
+	X(UALLOC_EXPR, "exprs") \
+	X(UALLOC_STMT, "stmts") \
+	X(UALLOC_BLK, "blocks") \
+	X(UALLOC_INSN, "block insns") \
+	X(UALLOC_DWARF, "dwarf") \
+	X(UALLOC_OBJ, "object file")
+
+enum ualloc_tag
+{
+#define X(name, desc) name,
+	UALLOC_TAGS
+#undef X
+	UALLOC_TAG_COUNT
+};
+
 void *umalloc(size_t);
 void *urealloc1(void *, size_t new);
 void *urealloc(void *, size_t new, size_t old);
@@ -18,4 +40,16 @@ char *ustrdup2(const char *, const char *b); /* up to, but not including b */
 char *ustrprintf( const char *, ...) ucc_printflike(1, 2);
 char *ustrvprintf(const char *, va_list);
 
+/* as above, accounted to a specific tag (the above use UALLOC_MISC) */
+void *umalloc_tag(size_t, enum ualloc_tag);
+void *urealloc_tag(void *, size_t new, size_t old, enum ualloc_tag);
+char *ustrdup_tag(const char *, enum ualloc_tag);
+char *ustrprintf_tag(enum ualloc_tag, const char *, ...) ucc_printflike(2, 3);
+char *ustrvprintf_tag(enum ualloc_tag, const char *, va_list);
+
+/* number of allocation calls and bytes requested so far */
+void ualloc_counts(unsigned long *count, unsigned long *bytes);
+void ualloc_tag_counts(enum ualloc_tag, unsigned long *count, unsigned long *bytes);
+const char *ualloc_tag_name(enum ualloc_tag);
+
 #endif
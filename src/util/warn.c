@@ -124,7 +124,8 @@ static void warn_show_line(const struct where *w)
 
 	if(show_current_line && w->line_str){
 		static int buffed = 0;
-		char *line = ustrdup(w->line_str);
+		/* line_str may point into the (mapped) input, so stop at the newline */
+		char *line = ustrdup2(w->line_str, w->line_str + strcspn(w->line_str, "\n"));
 		char *p, *nonblank;
 
 		if(!buffed){
@@ -137,6 +138,7 @@ static void warn_show_line(const struct where *w)
 		for(p = line; *p; p++)
 			switch(*p){
 				case '\t':
+				case '\r':
 					*p = ' ';
 				case ' ':
 					break;
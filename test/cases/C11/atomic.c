@@ -0,0 +1,189 @@
+// RUN: %ocheck 0 %s
+// RUN: %ocheck 0 %s -O2 -fmem2reg
+// RUN: %ocheck 0 %s -fintegrated-as
+// RUN: %ocheck 0 %s -g
+// RUN: %ocheck 0 %s -O2 -g -fintegrated-as
+//
+// RUN: %ucc -target x86_64-linux -S -o %t %s
+// RUN:   grep -q 'lock xaddb' %t
+// RUN:   grep -q 'lock xaddq' %t
+// RUN:   grep -q 'lock cmpxchgl' %t
+// RUN:   grep -q 'xchgl' %t
+
+#include <stdatomic.h>
+
+#ifdef __STDC_NO_ATOMICS__
+#error atomics
+#endif
+
+void abort(void) __attribute__((noreturn));
+
+_Atomic int ai = 10;
+_Atomic(char) ac = 100;
+int arr[4];
+int *_Atomic ap = arr;
+_Atomic double ad;
+atomic_ulong aul = ATOMIC_VAR_INIT(0);
+atomic_flag flag = ATOMIC_FLAG_INIT;
+
+_Static_assert(_Generic(ai, int: 1, default: 0), "atomic qualifier dropped on rvalue conversion");
+_Static_assert(sizeof(_Atomic(long)) == sizeof(long), "");
+
+static void check_ops(void)
+{
+	int r;
+
+	r = (ai += 5);
+	if(r != 15 || ai != 15)
+		abort();
+	r = ai++;
+	if(r != 15 || ai != 16)
+		abort();
+	r = --ai;
+	if(r != 15 || ai != 15)
+		abort();
+	r = (ai &= 6);
+	if(r != 6 || ai != 6)
+		abort();
+	r = (ai |= 0x10);
+	if(r != 0x16 || ai != 0x16)
+		abort();
+	r = (ai ^= 0x11);
+	if(r != 7 || ai != 7)
+		abort();
+
+	/* wraps in the object's type */
+	ac += 30;
+	if(ac != (char)130)
+		abort();
+
+	/* scaled, unlike __atomic_fetch_add */
+	ap += 2;
+	ap++;
+	if(ap != &arr[3])
+		abort();
+
+	r = (ai = 42);
+	if(r != 42 || ai != 42)
+		abort();
+
+	ad = 1.5;
+	if(ad != 1.5)
+		abort();
+
+	aul -= 1;
+	if(aul != -1ul)
+		abort();
+}
+
+static void check_cas_ops(void)
+{
+	_Atomic _Bool ab = 0;
+	_Atomic float af = 1.5f;
+	_Atomic(unsigned short) aus = 7;
+	int r;
+
+	ai = 6;
+	r = (ai *= 7);
+	if(r != 42 || ai != 42)
+		abort();
+	r = (ai /= 5);
+	if(r != 8 || ai != 8)
+		abort();
+	r = (ai %= 5);
+	if(r != 3 || ai != 3)
+		abort();
+	r = (ai <<= 4);
+	if(r != 48 || ai != 48)
+		abort();
+	r = (ai >>= 3);
+	if(r != 6 || ai != 6)
+		abort();
+
+	/* converted back to the object's type */
+	ai += 1.75;
+	if(ai != 7)
+		abort();
+	aus *= 0x10001;
+	if(aus != 7)
+		abort();
+
+	ab += 2;
+	if(ab != 1)
+		abort();
+	ab ^= 1;
+	if(ab != 0)
+		abort();
+	if(ab++ != 0 || ab != 1)
+		abort();
+
+	af *= 3;
+	if(af != 4.5f)
+		abort();
+	if(af++ != 4.5f || af != 5.5f)
+		abort();
+	if(--af != 4.5f)
+		abort();
+
+	ad = 1;
+	if((ad /= 4) != 0.25)
+		abort();
+	ad -= 0.75;
+	if(ad != -0.5)
+		abort();
+}
+
+static void check_stdatomic(void)
+{
+	atomic_int x;
+	int expected = 3;
+
+	atomic_init(&x, 3);
+	if(atomic_fetch_add(&x, 2) != 3 || atomic_load(&x) != 5)
+		abort();
+	if(atomic_compare_exchange_strong(&x, &expected, 1) || expected != 5)
+		abort();
+	if(!atomic_compare_exchange_weak_explicit(&x, &expected, 1, memory_order_acq_rel, memory_order_acquire))
+		abort();
+	if(atomic_exchange(&x, 8) != 1)
+		abort();
+	atomic_store_explicit(&x, atomic_load_explicit(&x, memory_order_relaxed) + 1, memory_order_release);
+	if(x != 9 || atomic_fetch_sub(&x, 9) != 9 || x)
+		abort();
+
+	if(atomic_flag_test_and_set(&flag) || !atomic_flag_test_and_set(&flag))
+		abort();
+	atomic_flag_clear(&flag);
+	if(atomic_flag_test_and_set_explicit(&flag, memory_order_acquire))
+		abort();
+
+	if(!atomic_is_lock_free(&x))
+		abort();
+
+	atomic_thread_fence(memory_order_seq_cst);
+	atomic_signal_fence(memory_order_acquire);
+}
+
+/* not promoted to a register, despite never having its address taken */
+static int local_counter(int n)
+{
+	_Atomic int count = 0;
+	int i;
+
+	for(i = 0; i < n; i++)
+		count++;
+
+	return count;
+}
+
+int main(void)
+{
+	check_ops();
+	check_cas_ops();
+	check_stdatomic();
+
+	if(local_counter(5) != 5)
+		abort();
+
+	return 0;
+}
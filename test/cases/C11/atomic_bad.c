@@ -0,0 +1,20 @@
+// RUN: %check -e %s
+
+typedef int arr[2];
+_Atomic(arr) a; // CHECK: error: _Atomic() of array type
+_Atomic(const int) c; // CHECK: error: _Atomic() of qualified type
+
+_Atomic int i;
+_Atomic long double ld;
+
+struct big { char x[16]; } b;
+
+f(const int *cp)
+{
+	i *= 2; // CHECK: !/error/
+	ld += 1; // CHECK: error: unsupported += on _Atomic type 'long double _Atomic'
+
+	__atomic_load_n(&i); // CHECK: error: __atomic_load_n takes 2 arguments
+	__atomic_store_n(cp, 1, __ATOMIC_SEQ_CST); // CHECK: /error: .*const/
+	__atomic_load_n(&b, __ATOMIC_SEQ_CST); // CHECK: /error: /
+}
@@ -0,0 +1,88 @@
+// RUN: %ocheck 0 %s
+// RUN: %ocheck 0 %s -O2 -fmem2reg
+// RUN: %ocheck 0 %s -fpie
+// RUN: %ocheck 0 %s -fno-pic -no-pie
+// RUN: %ocheck 0 %s -fpic
+// RUN: %ocheck 0 %s -fintegrated-as
+// RUN: %ocheck 0 %s -fpic -fintegrated-as
+//
+// RUN: %ucc -S -o %t %s -fno-pic
+// RUN:   grep -F 'movq %%fs:0, %%' %t
+// RUN:   grep -F 'counter@tpoff(%%' %t
+// RUN:   grep -F '.section .tdata' %t
+// RUN:   grep -F '.section .tbss' %t
+// RUN:   grep -F '.type counter,@tls_object' %t
+// RUN: %ucc -S -o %t %s -fpic
+// RUN:   grep -F 'leaq counter@tlsgd(%%rip), %%rdi' %t
+// RUN:   grep -F 'callq __tls_get_addr@PLT' %t
+// RUN: %ucc -S -o %t %s -fpic -ftls-model=initial-exec
+// RUN:   grep -F 'counter@gottpoff(%%rip)' %t
+// RUN:   ! grep -F '__tls_get_addr' %t
+// RUN: %ucc -S -o %t %s -fpie -DUNDEF_EXT
+// RUN:   grep -F 'ext@gottpoff(%%rip)' %t
+
+void abort(void) __attribute__((noreturn));
+
+typedef unsigned long pthread_t;
+int pthread_create(pthread_t *, void *, void *(*)(void *), void *);
+int pthread_join(pthread_t, void **);
+
+__thread int counter = 5;
+_Thread_local long zeroed;
+static __thread char buf[16];
+
+extern __thread int ext;
+#ifndef UNDEF_EXT
+__thread int ext = 42;
+#endif
+
+int *local_addr(void)
+{
+	static _Thread_local int local = 7;
+	return &local;
+}
+
+static void *thr(void *arg)
+{
+	int i;
+
+	/* each thread starts with the initial image */
+	if(counter != 5 || zeroed != 0 || buf[3] || *local_addr() != 7 || ext != 42)
+		abort();
+
+	for(i = 0; i < 1000; i++)
+		counter++;
+	buf[3] = 'x';
+	zeroed += (long)arg;
+	++*local_addr();
+
+	return (void *)(counter + zeroed + (buf[3] == 'x') + *local_addr());
+}
+
+int main()
+{
+	pthread_t a, b;
+	void *ra, *rb;
+
+	counter = 1;
+	*local_addr() = 3;
+
+	if(pthread_create(&a, 0, thr, (void *)1) || pthread_create(&b, 0, thr, (void *)2))
+		abort();
+	pthread_join(a, &ra);
+	pthread_join(b, &rb);
+
+	if((long)ra != 1005 + 1 + 1 + 8)
+		abort();
+	if((long)rb != 1005 + 2 + 1 + 8)
+		abort();
+
+	/* the main thread's copies are untouched */
+	if(counter != 1 || zeroed != 0 || buf[3] || *local_addr() != 3)
+		abort();
+
+	if(local_addr() == &ext || (void *)&counter == (void *)&zeroed)
+		abort();
+
+	return 0;
+}
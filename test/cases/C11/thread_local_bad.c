@@ -0,0 +1,17 @@
+// RUN: %check -e %s
+
+__thread int t;
+int *p = &t; // CHECK: error: global scalar initialiser not constant
+
+__thread int f(void); // CHECK: error: _Thread_local on function "f"
+__thread typedef int td; // CHECK: error: _Thread_local on typedef "td"
+
+extern __thread int e;
+int e; // CHECK: error: non-thread-local declaration of "e" follows thread-local declaration
+
+void g(__thread int arg) // CHECK: error: _Thread_local on automatic variable "arg"
+{
+	__thread int local; // CHECK: error: _Thread_local on automatic variable "local"
+	static __thread int ok; // CHECK: !/error/
+	extern __thread int ok2; // CHECK: !/error/
+}
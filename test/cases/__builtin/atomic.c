@@ -0,0 +1,153 @@
+// RUN: %ocheck 0 %s
+// RUN: %ocheck 0 %s -O2 -fmem2reg
+// RUN: %ocheck 0 %s -fintegrated-as
+// RUN: %ocheck 0 %s -fpic -fno-const-fold
+// RUN: %ocheck 0 %s -g
+//
+// RUN: %ucc -target x86_64-linux -S -o %t %s
+// RUN:   grep -q 'lock xaddl' %t
+// RUN:   grep -q 'lock xaddq' %t
+// RUN:   grep -q 'lock cmpxchgl' %t
+// RUN:   grep -q 'lock cmpxchgw' %t
+// RUN:   grep -q 'xchgq' %t
+// RUN:   grep -q 'xchgb' %t
+// RUN:   grep -q 'mfence' %t
+// RUN:   grep -q 'negl' %t
+
+void abort(void) __attribute__((noreturn));
+
+_Static_assert(__atomic_always_lock_free(8, 0), "");
+_Static_assert(!__atomic_always_lock_free(16, 0), "");
+_Static_assert(__ATOMIC_RELAXED == 0 && __ATOMIC_SEQ_CST == 5, "");
+
+#if !__has_builtin(__atomic_fetch_add) || !__has_builtin(__sync_synchronize)
+#error no atomic builtins
+#endif
+
+static int i;
+static long l;
+static short s;
+static unsigned char c;
+static int *p;
+
+__attribute__((noinline)) static int order(void)
+{
+	/* not a constant - treated as seq_cst */
+	return __ATOMIC_ACQUIRE;
+}
+
+static void check_rmw(void)
+{
+	i = 5;
+	if(__atomic_fetch_add(&i, 3, __ATOMIC_SEQ_CST) != 5 || i != 8)
+		abort();
+	if(__atomic_sub_fetch(&i, 1, __ATOMIC_RELAXED) != 7 || i != 7)
+		abort();
+	if(__atomic_fetch_sub(&i, 10, order()) != 7 || i != -3)
+		abort();
+
+	i = 7;
+	if(__atomic_fetch_or(&i, 0x30, __ATOMIC_SEQ_CST) != 7 || i != 0x37)
+		abort();
+	if(__atomic_and_fetch(&i, 0x1c, __ATOMIC_ACQ_REL) != 0x14 || i != 0x14)
+		abort();
+	if(__atomic_fetch_xor(&i, 0xff, __ATOMIC_RELEASE) != 0x14 || i != 0xeb)
+		abort();
+	if(__atomic_nand_fetch(&i, 0xf, __ATOMIC_SEQ_CST) != ~0xb || i != ~0xb)
+		abort();
+
+	l = 1L << 40;
+	if(__sync_fetch_and_add(&l, 1) != 1L << 40 || l != (1L << 40) + 1)
+		abort();
+	if(__sync_or_and_fetch(&l, 6) != (1L << 40) + 7)
+		abort();
+
+	/* unscaled, as gcc */
+	p = &i;
+	__atomic_fetch_add(&p, sizeof(int), __ATOMIC_SEQ_CST);
+	if(p != &i + 1)
+		abort();
+}
+
+static void check_xchg(void)
+{
+	int expected = 5;
+
+	i = 5;
+	if(!__atomic_compare_exchange_n(&i, &expected, 9, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+		abort();
+	if(i != 9 || expected != 5)
+		abort();
+
+	/* failure writes back the current value */
+	if(__atomic_compare_exchange_n(&i, &expected, 7, 1, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+		abort();
+	if(i != 9 || expected != 9)
+		abort();
+
+	/* success leaves *expected alone, even when it's the target */
+	i = 5;
+	if(!__atomic_compare_exchange_n(&i, &i, 6, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+		abort();
+	if(i != 6)
+		abort();
+	i = 9;
+
+	if(__atomic_exchange_n(&i, 1, __ATOMIC_SEQ_CST) != 9 || i != 1)
+		abort();
+
+	s = 0;
+	if(__sync_val_compare_and_swap(&s, 0, 3) != 0 || s != 3)
+		abort();
+	if(__sync_bool_compare_and_swap(&s, 0, 4) || s != 3)
+		abort();
+	if(!__sync_bool_compare_and_swap(&s, 3, 4) || s != 4)
+		abort();
+
+	__atomic_store_n(&l, -2L, __ATOMIC_SEQ_CST);
+	__atomic_store_n(&l, __atomic_load_n(&l, __ATOMIC_ACQUIRE) * 2, __ATOMIC_RELEASE);
+	if(l != -4)
+		abort();
+}
+
+static void check_flag(void)
+{
+	c = 0;
+	if(__atomic_test_and_set(&c, __ATOMIC_SEQ_CST))
+		abort();
+	if(!__atomic_test_and_set(&c, __ATOMIC_SEQ_CST))
+		abort();
+	__atomic_clear(&c, __ATOMIC_RELEASE);
+	if(c)
+		abort();
+
+	if(__sync_lock_test_and_set(&i, 3) != 1 || i != 3)
+		abort();
+	__sync_lock_release(&i);
+	if(i)
+		abort();
+
+	__sync_synchronize();
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	__atomic_signal_fence(__ATOMIC_SEQ_CST);
+}
+
+/* flags live across the operation */
+__attribute__((noinline)) static int flag_across(int a, int b)
+{
+	int lt = a < b;
+	return __atomic_fetch_or(&i, b, __ATOMIC_SEQ_CST) + lt;
+}
+
+int main(void)
+{
+	check_rmw();
+	check_xchg();
+	check_flag();
+
+	i = 1;
+	if(flag_across(0, 2) != 2 || i != 3)
+		abort();
+
+	return 0;
+}
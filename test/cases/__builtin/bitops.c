@@ -0,0 +1,174 @@
+// RUN: %ocheck 0 %s
+// RUN: %ocheck 0 %s -O2 -fmem2reg
+// RUN: %ocheck 0 %s -mpopcnt -fintegrated-as
+// RUN: %ocheck 0 %s -mpopcnt -fno-const-fold
+//
+// RUN: %ucc -target x86_64-linux -S -o %t %s
+// RUN:   grep -q 'bsrl' %t
+// RUN:   grep -q 'bsfq' %t
+// RUN:   grep -q 'cmovzl' %t
+// RUN:   grep -q 'bswapq' %t
+// RUN:   grep -q 'rolw \$8' %t
+// RUN:   grep -q 'prefetcht0' %t
+// RUN:   grep -q 'prefetchnta' %t
+// RUN:   ! grep 'popcnt' %t
+// RUN: %ucc -target x86_64-linux -S -o %t %s -mpopcnt -mlzcnt -mbmi
+// RUN:   grep -q 'popcntl' %t
+// RUN:   grep -q 'lzcntl' %t
+// RUN:   grep -q 'tzcntq' %t
+// RUN:   ! grep 'bsr' %t
+
+void abort(void) __attribute__((noreturn));
+
+typedef unsigned short u16;
+typedef unsigned int u32;
+typedef unsigned long long u64;
+
+/* folded at compile time */
+_Static_assert(__builtin_popcount(0xf0f0) == 8, "");
+_Static_assert(__builtin_popcountll(~0ull) == 64, "");
+_Static_assert(__builtin_clz(1) == 31, "");
+_Static_assert(__builtin_clzll(1) == 63, "");
+_Static_assert(__builtin_ctzl(0x100) == 8, "");
+_Static_assert(__builtin_ffs(0) == 0, "");
+_Static_assert(__builtin_ffs(-1) == 1, "");
+_Static_assert(__builtin_ffsll(1ull << 40) == 41, "");
+_Static_assert(__builtin_bswap16(0x1234) == 0x3412, "");
+_Static_assert(__builtin_bswap32(0x12345678) == 0x78563412, "");
+_Static_assert(__builtin_bswap64(0x0102030405060708ull) == 0x0807060504030201ull, "");
+
+static int ref_popcount(u64 x)
+{
+	int n = 0;
+	for(; x; x >>= 1)
+		n += x & 1;
+	return n;
+}
+
+static int ref_clz(u64 x, int bits)
+{
+	int n = bits;
+	for(; x; x >>= 1)
+		n--;
+	return n;
+}
+
+static int ref_ctz(u64 x)
+{
+	int n = 0;
+	for(; !(x & 1); x >>= 1)
+		n++;
+	return n;
+}
+
+__attribute__((noinline)) static int popcount(u32 x) { return __builtin_popcount(x); }
+__attribute__((noinline)) static int popcountll(u64 x) { return __builtin_popcountll(x); }
+__attribute__((noinline)) static int clz(u32 x) { return __builtin_clz(x); }
+__attribute__((noinline)) static int clzll(u64 x) { return __builtin_clzll(x); }
+__attribute__((noinline)) static int ctz(u32 x) { return __builtin_ctz(x); }
+__attribute__((noinline)) static int ctzll(u64 x) { return __builtin_ctzll(x); }
+__attribute__((noinline)) static int ffs(int x) { return __builtin_ffs(x); }
+__attribute__((noinline)) static int ffsll(long long x) { return __builtin_ffsll(x); }
+__attribute__((noinline)) static u16 bswap16(u16 x) { return __builtin_bswap16(x); }
+__attribute__((noinline)) static u32 bswap32(u32 x) { return __builtin_bswap32(x); }
+__attribute__((noinline)) static u64 bswap64(u64 x) { return __builtin_bswap64(x); }
+
+/* operand from memory */
+__attribute__((noinline)) static int popcount_mem(const u64 *p) { return __builtin_popcountll(*p); }
+
+/* flags live across the builtin */
+__attribute__((noinline)) static int flag_across(u32 a, u32 b)
+{
+	int lt = a < b;
+	return __builtin_ctz(b) + lt;
+}
+
+__attribute__((noinline)) static long sum_prefetch(const long *p, int n)
+{
+	long t = 0;
+	int i;
+
+	for(i = 0; i < n; i++){
+		__builtin_prefetch(p + i + 8);
+		__builtin_prefetch(p + i + 16, 1, 0);
+		t += p[i];
+	}
+
+	return t;
+}
+
+static void check(u64 x)
+{
+	u32 lo = x;
+	u64 swapped = 0;
+	int i;
+
+	if(popcount(lo) != ref_popcount(lo))
+		abort();
+	if(popcountll(x) != ref_popcount(x))
+		abort();
+	if(popcount_mem(&x) != ref_popcount(x))
+		abort();
+
+	if(lo){
+		if(clz(lo) != ref_clz(lo, 32))
+			abort();
+		if(ctz(lo) != ref_ctz(lo))
+			abort();
+		if(ffs(lo) != ref_ctz(lo) + 1)
+			abort();
+		if(flag_across(0, lo) != ref_ctz(lo) + 1)
+			abort();
+	}else if(ffs(lo) != 0){
+		abort();
+	}
+
+	if(x){
+		if(clzll(x) != ref_clz(x, 64))
+			abort();
+		if(ctzll(x) != ref_ctz(x))
+			abort();
+		if(ffsll(x) != ref_ctz(x) + 1)
+			abort();
+	}else if(ffsll(x) != 0){
+		abort();
+	}
+
+	for(i = 0; i < 8; i++)
+		swapped |= ((x >> (i * 8)) & 0xff) << ((7 - i) * 8);
+
+	if(bswap64(x) != swapped)
+		abort();
+	if(bswap32(lo) != (u32)(swapped >> 32))
+		abort();
+	if(bswap16(x) != (u16)(swapped >> 48))
+		abort();
+}
+
+int main(void)
+{
+	static const u64 vals[] = {
+		0, 1, 2, 3, 0x80, 0x8000, 0x80000000, 0xffffffff,
+		0x100000000ull, 0x8000000000000000ull, ~0ull,
+		0x0123456789abcdefull, 0xf0f0f0f00f0f0f0full,
+	};
+	long arr[64];
+	unsigned i;
+
+	for(i = 0; i < sizeof vals / sizeof *vals; i++)
+		check(vals[i]);
+
+	for(i = 0; i < 64; i++)
+		arr[i] = i;
+	if(sum_prefetch(arr, 40) != 40 * 39 / 2)
+		abort();
+
+	{
+		int x[4] __attribute__((aligned(16))) = { 1, 2, 3, 4 };
+		int *p = __builtin_assume_aligned(x, 16);
+		if(p[3] != 4)
+			abort();
+	}
+
+	return 0;
+}
@@ -0,0 +1,13 @@
+// RUN: %check -e %s
+
+struct A { int i; } a;
+
+void f(int *p, int n)
+{
+	__builtin_popcount(a); // CHECK: error: __builtin_popcount requires an integral type (not "struct A")
+	__builtin_clz(1, 2); // CHECK: error: __builtin_clz takes a single argument
+	__builtin_prefetch(n); // CHECK: error: __builtin_prefetch expects a pointer argument
+	__builtin_prefetch(p, n); // CHECK: error: integral constant expected for __builtin_prefetch
+	__builtin_prefetch(p, 0, 4); // CHECK: error: __builtin_prefetch argument 3 out of range (0 - 3)
+	(void)__builtin_assume_aligned(p, 12); // CHECK: error: __builtin_assume_aligned alignment isn't a power of two
+}
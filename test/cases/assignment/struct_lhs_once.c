@@ -0,0 +1,35 @@
+// RUN: %ocheck 0 %s
+// RUN: %ocheck 0 %s -O2
+
+void abort(void) __attribute__((noreturn));
+
+struct S
+{
+	long a, b, c, d;
+};
+
+static struct S arr[4];
+static int n;
+
+static struct S *next(void)
+{
+	return &arr[n++];
+}
+
+int main(void)
+{
+	struct S s = { 1, 2, 3, 4 }, t;
+
+	*next() = s;
+	if(n != 1 || arr[0].d != 4)
+		abort();
+
+	t = *next() = s;
+	if(n != 2 || arr[1].c != 3 || t.b != 2)
+		abort();
+
+	if((*next() = s).a != 1 || n != 3)
+		abort();
+
+	return 0;
+}
@@ -0,0 +1,194 @@
+// RUN: %ocheck 0 %s
+// RUN: %ocheck 0 %s -O2
+// RUN: %ocheck 0 %s -O2 -fno-reorder-blocks
+// RUN: %ocheck 0 %s -freorder-blocks -fintegrated-as
+//
+// RUN: %ucc -target x86_64-linux -S -o %t %s -DASM_ONLY -O2
+// RUN:   sed -n '/^EXPECT_UNLIKELY:/,/^\.Lfuncend_EXPECT_UNLIKELY/p' %t | sed -n '/retq/,$p' | grep 'callq ERR'
+// RUN:   sed -n '/^EXPECT_LIKELY:/,/^\.Lfuncend_EXPECT_LIKELY/p' %t | sed -n '/retq/,$p' | grep 'callq ERR'
+// RUN:   sed -n '/^COLD_CALL:/,/^\.Lfuncend_COLD_CALL/p' %t | sed -n '/retq/,$p' | grep 'callq COLD_FN'
+// RUN:   sed -n '/^NORETURN:/,/^\.Lfuncend_NORETURN/p' %t | sed -n '/retq/,$p' | grep 'callq ABORT'
+// RUN:   grep -F '.section .text.unlikely' %t
+// RUN:   grep -F '.section .text.hot' %t
+//
+// RUN: %ucc -target x86_64-linux -S -o %t %s -DASM_ONLY -O2 -fverbose-asm
+// RUN:   sed -n '/^NORETURN:/,/^\.Lfuncend_NORETURN/p' %t | grep -F '(cold)'
+// RUN: ! sed -n '/^NORETURN_TAIL:/,/^\.Lfuncend_NORETURN_TAIL/p' %t | grep -F '(cold)'
+//
+// RUN: %ucc -target x86_64-linux -S -o %t %s -DASM_ONLY -O2 -ffunction-sections
+// RUN:   grep -F '.section .text.unlikely.COLD_DEF' %t
+// RUN:   grep -F '.section .text.hot.HOT_DEF' %t
+//
+// RUN: %ucc -target x86_64-linux -S -o %t %s -DASM_ONLY -O2 -fno-reorder-blocks
+// RUN: ! sed -n '/^NORETURN:/,/^\.Lfuncend_NORETURN/p' %t | sed -n '/retq/,$p' | grep 'callq ABORT'
+
+#ifdef ASM_ONLY
+// uppercase function names to avoid grep conflict when looking for instructions
+void ERR(void);
+int WORK(int);
+void COLD_FN(void) __attribute__((cold));
+void ABORT(void) __attribute__((noreturn));
+void EXIT(int) __attribute__((noreturn));
+
+int EXPECT_UNLIKELY(int x)
+{
+	if(__builtin_expect(x < 0, 0)){
+		ERR();
+		return -1;
+	}
+	return WORK(x) + 1;
+}
+
+int EXPECT_LIKELY(int x)
+{
+	if(__builtin_expect(x > 0, 1))
+		return WORK(x) + 1;
+	ERR();
+	return 0;
+}
+
+int COLD_CALL(int x)
+{
+	if(x)
+		COLD_FN();
+	return WORK(x) + 1;
+}
+
+int NORETURN(int x)
+{
+	if(x < 0)
+		ABORT();
+	return WORK(x) + 1;
+}
+
+/* the main path ending in a noreturn call isn't rare */
+void NORETURN_TAIL(int x)
+{
+	if(x)
+		x = WORK(x);
+	EXIT(WORK(x));
+}
+
+__attribute__((cold)) int COLD_DEF(void){ return 1; }
+__attribute__((hot)) int HOT_DEF(void){ return 2; }
+#else
+void abort(void) __attribute__((noreturn));
+
+static int errors;
+
+__attribute__((cold, noinline))
+static void report(void)
+{
+	errors++;
+}
+
+static int checked_div(int a, int b)
+{
+	if(__builtin_expect(b == 0, 0)){
+		report();
+		return 0;
+	}
+	return a / b;
+}
+
+static int sum_positive(const int *p, int n)
+{
+	int i, total = 0;
+
+	for(i = 0; __builtin_expect(i < n, 1); i++){
+		if(__builtin_expect(p[i] < 0, 0))
+			continue;
+		total += p[i];
+	}
+
+	return total;
+}
+
+static int classify(int x)
+{
+	switch(x){
+		case 0: return 10;
+		case 1: return 11;
+		case 2: report(); return 12;
+		case 3: return 13;
+		case 4: return 14;
+	}
+	return -1;
+}
+
+static int find(const char *s, char c)
+{
+	int i;
+	for(i = 0; s[i]; i++)
+		if(__builtin_expect(s[i] == c, 0))
+			goto found;
+	return -1;
+found:
+	return i;
+}
+
+static int likely_ptr(int *p)
+{
+	if(__builtin_expect(!!p, 1))
+		return *p;
+	report();
+	return -1;
+}
+
+static int likely_float(double d)
+{
+	if(__builtin_expect(d < 1.0, 1))
+		return 1;
+	return 2;
+}
+
+__attribute__((cold)) static int cold_fn(int x){ return x * 3; }
+__attribute__((hot)) static int hot_fn(int x){ return x + 3; }
+
+/* jumps must stay in the function's section */
+__attribute__((hot, noinline)) static int hot_branches(int x)
+{
+	int r;
+	if(x > 2)
+		r = x * 2;
+	else
+		r = x + 100;
+	return r;
+}
+
+int main()
+{
+	int values[] = { 1, -2, 3, -4, 5 };
+	int n = 5;
+
+	if(checked_div(10, 2) != 5 || errors)
+		abort();
+	if(checked_div(1, 0) != 0 || errors != 1)
+		abort();
+
+	if(sum_positive(values, 5) != 9)
+		abort();
+
+	if(classify(0) != 10 || classify(3) != 13 || classify(7) != -1)
+		abort();
+	if(classify(2) != 12 || errors != 2)
+		abort();
+
+	if(find("hello", 'l') != 2 || find("hello", 'z') != -1)
+		abort();
+
+	if(likely_ptr(&n) != 5 || likely_ptr(0) != -1 || errors != 3)
+		abort();
+
+	if(likely_float(0.5) != 1 || likely_float(2.0) != 2 || likely_float(__builtin_nan("")) != 2)
+		abort();
+
+	if(cold_fn(2) != 6 || hot_fn(2) != 5)
+		abort();
+
+	if(hot_branches(3) != 6 || hot_branches(1) != 101)
+		abort();
+
+	return 0;
+}
+#endif
@@ -0,0 +1,88 @@
+// RUN: %ocheck 0 %s -O2
+// RUN: %ocheck 0 %s -O2 -g
+// RUN: %ocheck 0 %s
+//
+// RUN: %ucc -target x86_64-linux -S -o %t %s -O2 -fdead-static-stats 2>%t.stats
+// RUN:   grep 'dead statics: 2 functions (~[0-9]* bytes), 2 objects (16 bytes) removed' %t.stats
+// (UNUSED_CHAIN and unused_ptr are never referenced, and dropped before this pass)
+// RUN: ! grep -E '^(UNUSED_CHAIN|UNUSED_LEAF|UNUSED_TAB|ONLY_INLINED|SHADOW_BUF):' %t
+// RUN:   grep '^VIA_TABLE:' %t
+// RUN:   grep '^TABLE:' %t
+// RUN:   grep '^KEPT_USED:' %t
+// RUN:   grep '^KEPT_CTOR:' %t
+// RUN:   grep '^NOT_INLINED:' %t
+//
+// RUN: %ucc -target x86_64-linux -S -o %t %s -O2 -fno-toplevel-reorder
+// RUN:   grep '^UNUSED_LEAF:' %t
+// RUN:   grep '^ONLY_INLINED:' %t
+// RUN: %ucc -target x86_64-linux -S -o %t %s
+// RUN:   grep '^UNUSED_LEAF:' %t
+
+void abort(void) __attribute__((noreturn));
+
+// uppercase names to avoid grep conflicts with instructions
+
+// only referenced by an unreferenced function
+static int SHADOW_BUF[2] = { 1, 2 };
+static int UNUSED_LEAF(int x)
+{
+	return x * 7 + SHADOW_BUF[x & 1];
+}
+static int UNUSED_CHAIN(int x)
+{
+	return UNUSED_LEAF(x) + 1;
+}
+
+static int UNUSED_TAB[2] = { 3, 4 };
+static int *unused_ptr = UNUSED_TAB;
+
+// every call inlined
+static int ONLY_INLINED(int x)
+{
+	return x + 1;
+}
+
+__attribute__((noinline))
+static int NOT_INLINED(int x)
+{
+	return x - 1;
+}
+
+// referenced through data only
+static int VIA_TABLE(int x)
+{
+	return x * 2;
+}
+static int (*const TABLE[])(int) = { VIA_TABLE, NOT_INLINED };
+
+__attribute__((used))
+static int KEPT_USED(void)
+{
+	return 5;
+}
+
+static int ctor_ran;
+
+__attribute__((constructor))
+static void KEPT_CTOR(void)
+{
+	ctor_ran = 1;
+}
+
+int call(int i, int x)
+{
+	return TABLE[i](x);
+}
+
+int main()
+{
+	if(ONLY_INLINED(2) != 3)
+		abort();
+	if(NOT_INLINED(2) != 1)
+		abort();
+	if(call(0, 4) != 8 || call(1, 4) != 3)
+		abort();
+	if(!ctor_ran)
+		abort();
+	return 0;
+}
@@ -0,0 +1,86 @@
+// RUN: %ocheck 0 %s
+// RUN: %ocheck 0 %s -O2 -fmem2reg
+// RUN: %ocheck 0 %s -fintegrated-as
+//
+// RUN: %ucc -target x86_64-linux -S -o %t %s -DASM_ONLY
+// RUN: ! grep 'div' %t
+// RUN:   grep 'mulq' %t
+// RUN:   grep 'imulq %%' %t
+//
+// constant divisors become multiplies, but not under -ftrapv
+// RUN: %ucc -target x86_64-linux -S -o- %s -DASM_ONLY -ftrapv | grep 'idiv'
+
+#ifdef ASM_ONLY
+// uppercase function names to avoid grep conflict when looking for instructions
+int SECONDS(int ms){ return ms / 1000; }
+unsigned BUCKET(unsigned h){ return h % 60; }
+long SLONG(long n){ return n / -7; }
+unsigned long ULONG(unsigned long n){ return n % 1000; }
+int SPOW2(int n){ return n / 16 + n % 8; }
+#else
+void abort(void) __attribute__((noreturn));
+
+typedef int si;
+typedef unsigned ui;
+typedef long sl;
+typedef unsigned long ul;
+
+#define FNS(T, D, N) \
+	T DIV_##T##_##N(T n){ return (T)(D) ? n / (T)(D) : 0; } \
+	T MOD_##T##_##N(T n){ return (T)(D) ? n % (T)(D) : 0; }
+
+#define DIVISORS(X) \
+	X(2, 2) X(3, 3) X(5, 5) X(6, 6) X(7, 7) X(10, 10) X(16, 16) X(25, 25) \
+	X(60, 60) X(641, 641) X(1000, 1000) X(3600, 3600) X(86400, 86400) \
+	X(-2, m2) X(-3, m3) X(-7, m7) X(-8, m8) X(-1000, m1000) \
+	X(0x7fffffff, imax) X(0x40000000, pow30) X(-0x80000000L, imin) \
+	X(0xffffffffu, umax) X(0x80000001u, uhalf) \
+	X(1000000007L, prime) X(0x7fffffffffffffffL, lmax) \
+	X(-0x7fffffffffffffffL - 1, lmin) X(0x4000000000000000L, pow62) \
+	X(0xfffffffffffffffbUL, ulmax) X(0x8000000000000001UL, ulhalf)
+
+#define FNS_ALL(D, N) FNS(si, D, N) FNS(ui, D, N) FNS(sl, D, N) FNS(ul, D, N)
+DIVISORS(FNS_ALL)
+
+static const long values[] = {
+	0, 1, 2, 3, 5, 7, 59, 60, 61, 99, 100, 999, 1000, 1001, 65535, 65536,
+	86399, 86400, 1000000006, 1000000007, 0x3fffffff, 0x40000000,
+	0x7ffffffe, 0x7fffffff, 0x80000000, 0x80000001, 0xfffffffe, 0xffffffff,
+	0x123456789a, 0x3fffffffffffffff, 0x4000000000000000,
+	0x7ffffffffffffffe, 0x7fffffffffffffff,
+};
+
+#define countof(a) (sizeof(a) / sizeof *(a))
+
+#define CHECK(T, D, N, v) do{ \
+		volatile unsigned long dv = (unsigned long)(D); \
+		T d = (T)dv; \
+		T n = (T)(v); \
+		if(d == 0 || (d == (T)-1 && n && (T)(n + n) == 0)) \
+			break; \
+		if(DIV_##T##_##N(n) != n / d) abort(); \
+		if(MOD_##T##_##N(n) != n % d) abort(); \
+	}while(0)
+
+#define CHECK_ALL(D, N) \
+	CHECK(si, D, N, v); CHECK(ui, D, N, v); \
+	CHECK(sl, D, N, v); CHECK(ul, D, N, v);
+
+int main()
+{
+	unsigned i;
+
+	for(i = 0; i < countof(values); i++){
+		long v;
+
+		v = values[i];
+		DIVISORS(CHECK_ALL)
+		v = -values[i];
+		DIVISORS(CHECK_ALL)
+		v = -values[i] - 1;
+		DIVISORS(CHECK_ALL)
+	}
+
+	return 0;
+}
+#endif
@@ -0,0 +1,82 @@
+// RUN: %ocheck 0 %s
+// RUN: %ocheck 0 %s -O2
+// RUN: %ocheck 0 %s -O2 -fno-if-conversion
+// RUN: %ocheck 0 %s -fif-conversion -fintegrated-as
+//
+// RUN: %ucc -target x86_64-linux -S -o %t %s -DASM_ONLY -O2
+// RUN:   grep 'cmovl' %t
+// RUN:   grep 'cmova' %t
+// RUN:   grep 'cmovne' %t
+// RUN: ! grep 'jmp' %t
+//
+// RUN: %ucc -target x86_64-linux -S -o %t %s -DASM_ONLY -O2 -fno-if-conversion
+// RUN: ! grep 'cmov' %t
+// RUN: %ucc -target x86_64-linux -S -o %t %s -DASM_ONLY
+// RUN: ! grep 'cmov' %t
+
+#ifdef ASM_ONLY
+// uppercase function names to avoid grep conflict when looking for instructions
+int MIN(int a, int b){ return a < b ? a : b; }
+unsigned CLAMP(unsigned x){ return x > 255 ? 255 : x; }
+char *PICK(char *a, char *b, int c){ return c ? a : b + 1; }
+#else
+void abort(void) __attribute__((noreturn));
+
+static int smin(int a, int b){ return a < b ? a : b; }
+static int smax(int a, int b){ return a > b ? a : b; }
+static unsigned umin(unsigned a, unsigned b){ return a < b ? a : b; }
+static long lclamp(long x, long lo, long hi){ return x < lo ? lo : x > hi ? hi : x; }
+static short sabs(short x){ return x < 0 ? -x : x; }
+static unsigned long ubias(unsigned long x){ return x & 1 ? x + 7 : x ^ 3; }
+static int fsel(double a, double b){ return a == b ? 10 : 20; }
+static int fnsel(double a, double b){ return a != b ? 10 : 20; }
+static const char *psel(const char *a, const char *b, int c){ return c ? a : b + 1; }
+static int enumsel(int c){ enum { A = 4, B = 9 }; return c ? A : B; }
+
+static int calls;
+static int tick(void){ return ++calls; }
+static int sidecond(int x){ return tick() > x ? 1 : 2; }
+
+static volatile int vol_a = 3, vol_b = 4;
+static int volsel(int c){ return c ? vol_a : vol_b; }
+
+static const long values[] = {
+	0, 1, -1, 2, -2, 7, 255, 256, -255, 32767, -32768,
+	0x7fffffff, -0x7fffffff - 1, 0x100000000, -0x100000000,
+};
+
+#define countof(a) (sizeof(a) / sizeof *(a))
+
+int main()
+{
+	unsigned i, j;
+	double nan = __builtin_nan("");
+
+	for(i = 0; i < countof(values); i++){
+		long a = values[i];
+
+		for(j = 0; j < countof(values); j++){
+			long b = values[j];
+
+			if(smin(a, b) != ((int)a < (int)b ? (int)a : (int)b)) abort();
+			if(smax(a, b) != ((int)a > (int)b ? (int)a : (int)b)) abort();
+			if(umin(a, b) != ((unsigned)a < (unsigned)b ? (unsigned)a : (unsigned)b)) abort();
+			if(lclamp(a, -300, b) != (a < -300 ? -300 : a > b ? b : a)) abort();
+		}
+
+		if(sabs(a) != (short)((short)a < 0 ? -(short)a : (short)a)) abort();
+		if(ubias(a) != ((unsigned long)a & 1 ? (unsigned long)a + 7 : (unsigned long)a ^ 3)) abort();
+	}
+
+	if(fsel(1, 1) != 10 || fsel(1, 2) != 20 || fsel(nan, nan) != 20) abort();
+	if(fnsel(1, 1) != 20 || fnsel(1, 2) != 10 || fnsel(nan, nan) != 10) abort();
+
+	if(*psel("ab", "cd", 1) != 'a' || *psel("ab", "cd", 0) != 'd') abort();
+	if(enumsel(1) != 4 || enumsel(0) != 9) abort();
+
+	if(sidecond(0) != 1 || sidecond(5) != 2 || calls != 2) abort();
+	if(volsel(1) != 3 || volsel(0) != 4) abort();
+
+	return 0;
+}
+#endif
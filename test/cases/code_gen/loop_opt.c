@@ -0,0 +1,288 @@
+// RUN: %ocheck 0 %s
+// RUN: %ocheck 0 %s -O2
+// RUN: %ocheck 0 %s -O2 -fno-ivopts
+// RUN: %ocheck 0 %s -O2 -fno-move-loop-invariants
+// RUN: %ocheck 0 %s -O2 -fsanitize=bounds -fsanitize-error=call=san_fail
+//
+// RUN: %ucc -target x86_64-linux -S -o %t %s -DASM_ONLY -O2 -fverbose-asm
+// RUN:   sed -n '/^SUM:/,/^\.Lfuncend_SUM/p' %t | grep -c 'induction pointer' | grep '^1$'
+// RUN: ! sed -n '/^SUM:/,/^\.Lfuncend_SUM/p' %t | sed -n '/# for_body/,/# for_end/p' | grep imul
+// RUN:   sed -n '/^SCALE:/,/^\.Lfuncend_SCALE/p' %t | grep -c 'loop invariant' | grep '^2$'
+// RUN: ! sed -n '/^SCALE:/,/^\.Lfuncend_SCALE/p' %t | sed -n '/# for_body/,/# for_end/p' | grep imul
+// RUN:   sed -n '/^COUNT:/,/^\.Lfuncend_COUNT/p' %t | grep -c 'call.*strlen' | grep '^1$'
+// RUN: ! sed -n '/^COUNT:/,/^\.Lfuncend_COUNT/p' %t | sed -n '/# for_test/,/# for_end/p' | grep 'call.*strlen'
+// RUN: ! sed -n '/^WRITTEN:/,/^\.Lfuncend_WRITTEN/p' %t | grep 'induction pointer'
+// RUN:   sed -n '/^WRITTEN:/,/^\.Lfuncend_WRITTEN/p' %t | sed -n '/# for_test/,/# for_end/p' | grep imul
+// RUN: ! sed -n '/^LABELLED:/,/^\.Lfuncend_LABELLED/p' %t | grep 'loop invariant\|induction pointer'
+//
+// RUN: %ucc -S -o /dev/null %s -DASM_ONLY -O2 -floop-opt-stats 2>&1 | grep 'loops: 4 optimised, 5 invariants hoisted, 3 induction pointers'
+// RUN: %ucc -S -o /dev/null %s -DASM_ONLY -O0 -floop-opt-stats 2>&1 | grep 'loops: 0 optimised'
+
+#ifdef ASM_ONLY
+typedef unsigned long size_t;
+size_t strlen(const char *);
+
+// uppercase function names to avoid grep conflict when looking for instructions
+int SUM(const int *a, int n)
+{
+	int t = 0;
+	for(int i = 0; i < n; i++)
+		t += a[i];
+	return t;
+}
+
+void SCALE(int *dst, int n, int stride, int k)
+{
+	for(int i = 0; i < n * stride; i += 2)
+		dst[i] = k * 3 + 1;
+}
+
+size_t COUNT(const char *s, char c)
+{
+	size_t n = 0;
+	for(size_t i = 0; i < strlen(s); i++)
+		n += s[i] == c;
+	return n;
+}
+
+int WRITTEN(int *a, int n)
+{
+	int t = 0;
+	for(int i = 0; i < n * 2; i++){
+		t += a[i];
+		n--;
+		i++;
+	}
+	return t;
+}
+
+int LABELLED(int *a, int n, int skip)
+{
+	int i = 0, t = 0;
+	if(skip)
+		goto in;
+	for(; i < n * 2; i++){
+in:
+		t += a[i] * (n + 4);
+	}
+	return t;
+}
+#else
+void abort(void) __attribute__((noreturn));
+typedef unsigned long size_t;
+size_t strlen(const char *);
+
+void san_fail(void)
+{
+	abort();
+}
+
+static int calls;
+
+__attribute__((pure, noinline))
+static int limit(const int *p)
+{
+	calls++; /* not really pure, but lets us count the hoisted calls */
+	return *p;
+}
+
+__attribute__((noinline))
+static void touch(int *p)
+{
+	(*p)++;
+}
+
+static int sum(const int *a, int n)
+{
+	int t = 0;
+	for(int i = 0; i < n; i++)
+		t += a[i];
+	return t;
+}
+
+static int sum_offset(const int *a, int n)
+{
+	int t = 0;
+	for(int i = 0; i < n - 1; i++)
+		t += a[i + 1] - a[i];
+	return t;
+}
+
+static int sum_down(const int *a, int n)
+{
+	int t = 0;
+	for(int i = n - 1; i >= 0; i--)
+		t = t * 3 + a[i];
+	return t;
+}
+
+static void fill(int *dst, int n, int stride, int k)
+{
+	for(int i = 0; i < n * stride; i += stride)
+		dst[i] = k * 3 + i;
+}
+
+static int matrix(int m[4][5])
+{
+	int t = 0;
+	for(int i = 0; i < 4; i++)
+		for(int j = 0; j < 5; j++)
+			t += m[i][j] * (i + 1);
+	return t;
+}
+
+static int skip_odd(const int *a, int n)
+{
+	int t = 0;
+	for(int i = 0; i < n; i++){
+		if(a[i] & 1)
+			continue;
+		t += a[i];
+	}
+	return t;
+}
+
+static size_t count(const char *s, char c)
+{
+	size_t n = 0;
+	for(size_t i = 0; i < strlen(s); i++)
+		n += s[i] == c;
+	return n;
+}
+
+/* the bound changes in the loop */
+static int shrinking(const int *a, int n)
+{
+	int t = 0;
+	for(int i = 0; i < n * 2; i++){
+		t += a[i];
+		n--;
+	}
+	return t;
+}
+
+/* *p is stored to through a */
+static int aliased(int *a, int *p, int n)
+{
+	int t = 0;
+	for(int i = 0; i < n; i++){
+		a[i] = i;
+		t += *p * 2;
+	}
+	return t;
+}
+
+/* g is changed by a call */
+static int g;
+static int global_changed(int n)
+{
+	int t = 0;
+	for(int i = 0; i < n; i++){
+		t += g * 2;
+		touch(&g);
+	}
+	return t;
+}
+
+static int pure_calls(const int *a)
+{
+	int bound = 5, t = 0, i;
+	for(i = 0; i < limit(&bound) * 2; i++)
+		t += a[i];
+	return t;
+}
+
+static int while_loop(const int *p, int n, int k)
+{
+	int t = 0;
+	while(n-- > 0)
+		t += *p++ + k * 7;
+	return t;
+}
+
+/* a trapping division is only hoisted from the test */
+static int guarded_div(const int *a, int n, int d)
+{
+	int t = 0;
+	for(int i = 0; i < n; i++)
+		if(d)
+			t += a[i] / d;
+	return t;
+}
+
+static int unsigned_index(const int *a, unsigned n)
+{
+	int t = 0;
+	for(unsigned i = 0; i < n; i++)
+		t += a[i];
+	return t;
+}
+
+static int labelled(const int *a, int n, int skip)
+{
+	int i = 0, t = 0;
+	if(skip)
+		goto in;
+	for(; i < n * 2; i++){
+in:
+		t += a[i] * (n + 4);
+	}
+	return t;
+}
+
+int main()
+{
+	int a[10] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+	int dst[12] = { 0 };
+	int m[4][5];
+	int i, j;
+
+	if(sum(a, 10) != 55 || sum(a, 0) != 0)
+		abort();
+	if(sum_offset(a, 10) != 9)
+		abort();
+	if(sum_down(a, 3) != 3 * 3 * 3 + 2 * 3 + 1)
+		abort();
+
+	fill(dst, 4, 3, 2);
+	if(dst[0] != 6 || dst[3] != 9 || dst[9] != 15 || dst[1] || dst[10])
+		abort();
+
+	for(i = 0; i < 4; i++)
+		for(j = 0; j < 5; j++)
+			m[i][j] = i * 5 + j;
+	if(matrix(m) != 10 + 35 * 2 + 60 * 3 + 85 * 4)
+		abort();
+
+	if(skip_odd(a, 10) != 30)
+		abort();
+	if(count("abcabca", 'a') != 3 || count("", 'a') != 0)
+		abort();
+	if(shrinking(a, 6) != 1 + 2 + 3 + 4)
+		abort();
+
+	if(aliased(dst, &dst[2], 4) != 2 * (0 + 0 + 2 + 2))
+		abort();
+
+	g = 1;
+	if(global_changed(3) != 2 + 4 + 6)
+		abort();
+
+	calls = 0;
+	if(pure_calls(a) != 55)
+		abort();
+	if(calls != 1 && calls != 11)
+		abort();
+
+	if(while_loop(a, 3, 1) != 6 + 21)
+		abort();
+	if(guarded_div(a, 4, 0) != 0 || guarded_div(a, 4, 2) != 0 + 1 + 1 + 2)
+		abort();
+	if(unsigned_index(a, 4) != 10)
+		abort();
+	if(labelled(a, 2, 0) != 10 * 6 || labelled(a, 2, 1) != 10 * 6)
+		abort();
+
+	return 0;
+}
+#endif
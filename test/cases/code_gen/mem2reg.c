@@ -0,0 +1,136 @@
+// RUN: %ocheck 0 %s -fmem2reg
+// RUN: %ocheck 0 %s -O1 -g
+// RUN: %ocheck 0 %s -O2 -fpic
+//
+// RUN: %ucc -target x86_64-linux -S -o %t %s -fmem2reg
+// RUN:   grep -q 'movq %%rbx, -[0-9]*(%%rbp)' %t
+// RUN:   grep -q 'movq %%r12, -[0-9]*(%%rbp)' %t
+// RUN: %ucc -target x86_64-linux -S -o %t %s
+// RUN:   ! grep '%%rbx' %t
+
+void abort(void) __attribute__((noreturn));
+
+typedef __builtin_va_list va_list;
+
+static int calls;
+
+__attribute__((noinline))
+static int twice(int x)
+{
+	calls++;
+	return x * 2;
+}
+
+static long sum(const int *p, int n)
+{
+	long t = 0;
+	int i;
+
+	/* t and i live across calls to twice() */
+	for(i = 0; i < n; i++)
+		t += twice(p[i]);
+
+	return t;
+}
+
+static int addressed(void)
+{
+	int x = 1, y = 2;
+	int *px = &x;
+
+	*px = 5;
+	y += x;
+
+	return x + y; /* 5 + 7 */
+}
+
+static int many(int a, int b)
+{
+	/* more candidates than callee-save registers */
+	int c = a + 1, d = b + 2, e = c * d, f = e - a, g = f ^ b, h = g | 1;
+	char k = 'x';
+	short s = -3;
+	unsigned long u = 0xfffffffff;
+
+	c += twice(d);
+	d -= twice(e);
+	k++;
+	s *= 7;
+	u += 1;
+
+	return c + d + e + f + g + h + k + s + (int)(u >> 32);
+}
+
+static int recurse(int n, int acc)
+{
+	int a = n, b = acc;
+
+	if(n == 0)
+		return acc;
+
+	b = recurse(n - 1, acc + a);
+
+	/* callee-save registers must survive the recursion */
+	if(a != n)
+		abort();
+
+	return b;
+}
+
+static int vsum(int n, ...)
+{
+	va_list l;
+	int t = 0;
+
+	__builtin_va_start(l, n);
+	while(n-- > 0)
+		t += __builtin_va_arg(l, int);
+	__builtin_va_end(l);
+
+	return t;
+}
+
+static const char *skip(const char *p, char c)
+{
+	while(*p == c)
+		p++;
+	return p;
+}
+
+int main(void)
+{
+	static const int vals[] = { 1, 2, 3, 4, 5 };
+	const char *str;
+	int i, r = 0;
+
+	if(sum(vals, 5) != 30)
+		abort();
+	if(calls != 5)
+		abort();
+
+	if(addressed() != 12)
+		abort();
+
+	if(many(3, 4) != 169)
+		abort();
+
+	if(recurse(10, 0) != 55)
+		abort();
+
+	if(vsum(4, 10, 20, 30, 40) != 100)
+		abort();
+
+	str = skip("   abc", ' ');
+	if(*str != 'a')
+		abort();
+
+	for(i = 0; i < 10; i++){
+		if(i & 1)
+			continue;
+		r += i;
+	}
+	if(r != 20)
+		abort();
+
+	return 0;
+}
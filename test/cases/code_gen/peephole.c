@@ -0,0 +1,79 @@
+// RUN: %ocheck 0 %s -fpeephole
+// RUN: %ocheck 0 %s -O2
+// RUN: %ucc -S -o- %s -fpeephole -fverbose-asm | grep -F '# peephole store-reload:'
+// RUN: %ucc -S -o- %s -fpeephole -fverbose-asm | grep -F '# peephole redundant-test:'
+// RUN: %ucc -S -o- %s -fno-peephole -fverbose-asm | grep -F '# peephole'; [ $? -ne 0 ]
+// RUN: %ocheck 0 %s -O2 -fno-const-fold
+//
+// 32-bit register writes zero-extend, so aren't no-ops
+// RUN: %ucc -target x86_64-linux -S -o %t %s -O2 -fno-const-fold -fverbose-asm
+// RUN:   grep -F '# peephole mov-back: movq' %t
+// RUN:   grep -F '# peephole mov-back: movl' %t; [ $? -ne 0 ]
+// RUN:   grep -F '# peephole arith-zero: orq $0' %t
+// RUN:   grep -F '# peephole arith-zero: orl' %t; [ $? -ne 0 ]
+// RUN:   grep -F 'orl $0, %%eax' %t
+void abort(void) __attribute__((noreturn));
+
+int reload(int a)
+{
+	int x = a + 1;
+	return x * 2;
+}
+
+int and_test(int a, int b)
+{
+	if(a & b)
+		return 1;
+	return 0;
+}
+
+/* the test must stay if its consumer needs OF/CF from it */
+int sub_sign(int a, int b)
+{
+	int d = a - b;
+	if(d < 0)
+		return -1;
+	return d > 0;
+}
+
+long sub_sign_l(long a, long b)
+{
+	long d = a - b;
+	if(d < 0)
+		return -1;
+	return d > 0;
+}
+
+unsigned or_zero(unsigned a)
+{
+	return a | 0;
+}
+
+long or_zero_l(long a)
+{
+	return a | 0L;
+}
+
+long reload_other(long a)
+{
+	long x = a;
+	long y = x;
+	return y + x;
+}
+
+main()
+{
+	if(reload(3) != 8)
+		abort();
+	if(and_test(1, 2) != 0 || and_test(3, 2) != 1)
+		abort();
+	if(sub_sign(1, 2) != -1 || sub_sign(2, 2) != 0 || sub_sign(3, 2) != 1)
+		abort();
+	if(reload_other(5) != 10)
+		abort();
+	if(sub_sign_l(1, 2) != -1 || sub_sign_l(3, 2) != 1)
+		abort();
+	if(or_zero(6) != 6 || or_zero_l(1L << 40) != 1L << 40)
+		abort();
+	return 0;
+}
@@ -0,0 +1,82 @@
+// RUN: rm -f %t.prof
+// RUN: %ucc -fprofile-generate=%t.prof %s -o %t
+// RUN: %t
+// RUN: %t
+// RUN:   grep ' NEVER 1 0$' %t.prof
+// RUN:   grep ' SKEWED 3 2000 2 1998$' %t.prof
+// RUN:   grep ' DISPATCH 7 2000 ' %t.prof
+//
+// inlined copies count towards the callee
+// RUN: %ucc -fprofile-generate=%t.prof2 %s -o %t -O2 -fintegrated-as
+// RUN: rm -f %t.prof2; %t
+// RUN:   grep ' SKEWED 3 1000 1 999$' %t.prof2
+//
+// RUN: %ucc -target x86_64-linux -S -o %t.s %s -O2 -fprofile-use=%t.prof
+// RUN:   grep -A4 'section .text.unlikely' %t.s | grep '^NEVER:'
+// RUN:   sed -n '/^SKEWED:/,/^\.Lfuncend_SKEWED/p' %t.s | sed -n '/retq/,$p' | grep 'callq NOTE'
+// RUN:   sed -n '/^DISPATCH:/,/^\.Lfuncend_DISPATCH/p' %t.s | grep -m1 'cmpl' | grep '\$3,'
+//
+// RUN: %ucc -target x86_64-linux -S -o %t.s %s -O2
+// RUN: ! grep 'section .text.unlikely' %t.s
+// RUN: ! sed -n '/^DISPATCH:/,/^\.Lfuncend_DISPATCH/p' %t.s | grep -m1 'cmpl' | grep '\$3,'
+//
+// RUN: %ucc -S -o %t.s %s -fprofile-use=%t.prof -DMISMATCH 2>&1 | grep "profile for 'SKEWED' doesn't match"
+// RUN: %ucc -S -o %t.s %s -fprofile-use=%t.missing 2>&1 | grep 'profile ".*missing" not found'
+
+void abort(void) __attribute__((noreturn));
+
+// uppercase function names to avoid grep conflict when looking for instructions
+__attribute__((noinline))
+int NOTE(int x)
+{
+	return x * 3;
+}
+
+int NEVER(int x)
+{
+	return x * 5;
+}
+
+int SKEWED(int x)
+{
+#ifdef MISMATCH
+	if(x < 0)
+		return 0;
+#endif
+	if(x == 500)
+		return NOTE(x) + 1;
+	return x + 1;
+}
+
+int DISPATCH(int x)
+{
+	switch(x){
+		case 0: return 1;
+		case 1: return 2;
+		case 2: return 3;
+		case 3: return 4;
+		case 4: return 5;
+		case 9: return 10;
+	}
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	int i, total = 0;
+
+	(void)argv;
+
+	for(i = 0; i < 1000; i++){
+		total += SKEWED(i);
+		total += DISPATCH(i % 100 ? 3 : i % 5);
+	}
+
+	if(argc > 1)
+		total = NEVER(total);
+
+	if(total != 501500 + 3960 + 10)
+		abort();
+
+	return 0;
+}
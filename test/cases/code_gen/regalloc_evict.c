@@ -0,0 +1,34 @@
+// RUN: %ocheck 0 %s
+// RUN: %ocheck 0 %s -fmem2reg
+//
+// RUN: %ucc -target x86_64-linux -S -o /dev/null %s -fdump-regalloc 2>%t
+// RUN:   grep -q '^regalloc: deep: alloc %%r' %t
+// RUN:   grep -q '^regalloc: deep: evict %%r[a-z0-9]* (was %%' %t
+// RUN: %ucc -target x86_64-linux -S -o /dev/null %s 2>&1 | grep regalloc; [ $? -ne 0 ]
+
+void abort(void) __attribute__((noreturn));
+
+/* every partial sum is held in a register while the right-hand side is
+ * evaluated, needing more registers than the scratch set has */
+__attribute__((noinline))
+static int deep(int *x)
+{
+	return x[0] * 3 + (x[1] * 3 + (x[2] * 3 + (x[3] * 3
+			+ (x[4] * 3 + (x[5] * 3 + (x[6] * 3 + (x[7] * 3
+			+ (x[8] * 3 + (x[9] * 3 + (x[10] * 3 + (x[11] * 3
+			+ (x[12] * 3 + (x[13] * 3 + (x[14] * 3 + x[15]))))))))))))));
+}
+
+int main(void)
+{
+	int x[16];
+	int i;
+
+	for(i = 0; i < 16; i++)
+		x[i] = i + 1;
+
+	if(deep(x) != 376)
+		abort();
+
+	return 0;
+}
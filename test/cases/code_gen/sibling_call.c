@@ -0,0 +1,153 @@
+// RUN: %ocheck 0 %s -O2
+// RUN: %ocheck 0 %s -foptimize-sibling-calls -fintegrated-as
+// RUN: %ocheck 0 %s -foptimize-sibling-calls -fpic
+//
+// RUN: %ucc -target x86_64-linux -S -o %t %s -DASM_ONLY -O2 -fverbose-asm
+// RUN:   grep 'jmp TAIL' %t
+// RUN:   grep 'jmp \*%%r11' %t
+// RUN:   grep 'callq ADDRESSED' %t
+// RUN:   grep 'callq ARRAY' %t
+// RUN:   grep 'callq STACK_ARGS' %t
+// RUN:   grep 'callq STRET' %t
+// RUN:   grep 'callq CONVERTED' %t
+// RUN:   grep 'sibling call' %t
+//
+// RUN: %ucc -target x86_64-linux -S -o %t %s -DASM_ONLY -O2 -fno-optimize-sibling-calls
+// RUN: ! grep 'jmp [A-Z*]' %t
+// RUN: %ucc -target x86_64-linux -S -o %t %s -DASM_ONLY -O1
+// RUN: ! grep 'jmp [A-Z*]' %t
+
+#ifdef ASM_ONLY
+// uppercase function names to avoid grep conflict when looking for instructions
+int TAIL(int);
+int ADDRESSED(int *);
+int ARRAY(char *);
+int STACK_ARGS(int, int, int, int, int, int, int);
+struct big { long a, b, c; } STRET(int);
+long CONVERTED(int);
+
+int (*fp)(int);
+
+int tail(int x){ return TAIL(x + 1); }
+int indirect(int x){ return fp(x); }
+int addressed(int x){ return ADDRESSED(&x); }
+int array(void){ char buf[8]; buf[0] = 0; return ARRAY(buf); }
+int stack_args(int x){ return STACK_ARGS(x, x, x, x, x, x, x); }
+struct big stret(int x){ return STRET(x); }
+int converted(int x){ return CONVERTED(x); }
+#else
+void abort(void) __attribute__((noreturn));
+int sprintf(char *, const char *, ...);
+
+/* deep enough to overflow the stack unless frames are reused */
+#define DEPTH 20000000L
+
+static long count(long n, long acc)
+{
+	if(!n)
+		return acc;
+	return count(n - 1, acc + n);
+}
+
+static int is_odd(unsigned long);
+
+static int is_even(unsigned long n)
+{
+	if(!n)
+		return 1;
+	return is_odd(n - 1);
+}
+
+static int is_odd(unsigned long n)
+{
+	if(!n)
+		return 0;
+	return is_even(n - 1);
+}
+
+__attribute((noinline))
+static double scale(double d, int n)
+{
+	if(n <= 0)
+		return d;
+	return scale(d * 1.5, n - 1);
+}
+
+static int (*volatile fp)(unsigned long) = is_even;
+
+static int via_ptr(unsigned long n)
+{
+	return fp(n);
+}
+
+static int sum3(int a, int b, int c)
+{
+	return a + b + c;
+}
+
+static int swap_args(int a, int b, int c)
+{
+	/* arguments permuted through the argument registers */
+	return sum3(c * 100, a, b * 10);
+}
+
+static int fmt(char *buf, const char *s, int x)
+{
+	return sprintf(buf, s, x);
+}
+
+static int tail_inlined(int a, int b)
+{
+	/* inlined into a tail call, this becomes one itself */
+	if(a)
+		return sum3(a, b, 1);
+	return 7;
+}
+
+static int via_inline(int a)
+{
+	return tail_inlined(a, 2);
+}
+
+static int escapes(int *p, int depth)
+{
+	return depth ? *p + 1 : 0;
+}
+
+static int no_escape(int x)
+{
+	int local = x;
+	return escapes(&local, 1);
+}
+
+int main()
+{
+	char buf[16];
+
+	if(count(DEPTH, 0) != DEPTH * (DEPTH + 1) / 2)
+		abort();
+
+	if(!is_even(DEPTH) || is_odd(DEPTH) || !is_odd(DEPTH + 1))
+		abort();
+
+	if(scale(2, 4) != 2 * 1.5 * 1.5 * 1.5 * 1.5)
+		abort();
+
+	if(!via_ptr(DEPTH))
+		abort();
+
+	if(swap_args(1, 2, 3) != 321)
+		abort();
+
+	if(fmt(buf, "%d", 42) != 2 || buf[0] != '4' || buf[1] != '2')
+		abort();
+
+	if(via_inline(0) != 7 || via_inline(3) != 6)
+		abort();
+
+	if(no_escape(5) != 6)
+		abort();
+
+	return 0;
+}
+#endif
@@ -0,0 +1,99 @@
+// RUN: %ocheck 0 %s
+// RUN: %ocheck 0 %s -O2
+// RUN: %ocheck 0 %s -fstack-reuse=none
+// RUN: %ocheck 0 %s -fstack-reuse=named_vars
+//
+// RUN: %ucc -target x86_64-linux -S -o %t %s -DASM_ONLY -fstack-reuse-stats 2>%t.stats
+// RUN:   sed -n '/^SIBLINGS:/,/^\.Lfuncend_SIBLINGS/p' %t | grep 'stack_sz{cur=[0-9]*,max=40[0-9][0-9],unshared=8[0-9][0-9][0-9]}'
+// RUN:   sed -n '/^TEMPS:/,/^\.Lfuncend_TEMPS/p' %t | grep 'stack_sz{cur=[0-9]*,max=2[0-9][0-9],'
+// RUN:   grep 'stack reuse: [0-9]* bytes of frames, [0-9]* without reuse ([1-9][0-9]* saved)' %t.stats
+//
+// temporaries only share with -fstack-reuse=all
+// RUN: %ucc -target x86_64-linux -S -o %t %s -DASM_ONLY -fstack-reuse=named_vars
+// RUN:   sed -n '/^SIBLINGS:/,/^\.Lfuncend_SIBLINGS/p' %t | grep 'stack_sz{cur=[0-9]*,max=40[0-9][0-9],'
+// RUN:   sed -n '/^TEMPS:/,/^\.Lfuncend_TEMPS/p' %t | grep 'stack_sz{cur=[0-9]*,max=5[0-9][0-9],'
+//
+// RUN: %ucc -target x86_64-linux -S -o %t %s -DASM_ONLY -fstack-reuse=none -fstack-reuse-stats 2>%t.stats
+// RUN:   sed -n '/^SIBLINGS:/,/^\.Lfuncend_SIBLINGS/p' %t | grep 'stack_sz{cur=[0-9]*,max=8[0-9][0-9][0-9],'
+// RUN:   grep '(0 saved)' %t.stats
+
+#ifdef ASM_ONLY
+// uppercase function names to avoid grep conflict when looking for instructions
+void use(char *);
+
+void SIBLINGS(void)
+{
+	{ char buf[4096]; use(buf); }
+	{ char other[4096]; use(other); }
+}
+
+int TEMPS(int x)
+{
+	return x * 3
+		+ ({ char buf[256]; use(buf); buf[0]; })
+		+ ({ char other[256]; use(other); other[0]; });
+}
+#else
+void abort(void) __attribute__((noreturn));
+
+static char *escaped;
+
+__attribute__((noinline))
+static void fill(char *p, int n, char c)
+{
+	int i;
+	for(i = 0; i < n; i++)
+		p[i] = c;
+}
+
+__attribute__((noinline))
+static int sum(const char *p, int n)
+{
+	int i, t = 0;
+	for(i = 0; i < n; i++)
+		t += p[i];
+	return t;
+}
+
+int scopes(int n)
+{
+	int keep = 7, *kp = &keep, t = 0;
+
+	{
+		char a[64];
+		fill(a, 64, 1);
+		t += sum(a, 64);
+	}
+	{
+		char b[64];
+		fill(b, 64, 2);
+		escaped = b; /* address-taken, but only used within the scope */
+		t += sum(escaped, 64);
+	}
+	{
+		char vla[n];
+		char c[32];
+		fill(vla, n, 3);
+		fill(c, 32, 4);
+		t += sum(vla, n) + sum(c, 32);
+	}
+
+	return t + *kp;
+}
+
+int temps(int x)
+{
+	return x * 3
+		+ ({ char a[16]; fill(a, 16, 1); sum(a, 16); })
+		+ ({ char b[16]; fill(b, 16, 2); sum(b, 16); });
+}
+
+int main()
+{
+	if(scopes(10) != 64 + 128 + 30 + 128 + 7)
+		abort();
+	if(temps(5) != 15 + 16 + 32)
+		abort();
+	return 0;
+}
+#endif
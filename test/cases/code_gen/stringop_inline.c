@@ -0,0 +1,76 @@
+// RUN: %ocheck 0 %s
+// RUN: %ocheck 0 %s -ffreestanding
+// RUN: %ocheck 0 %s -mstringop-strategy=loop
+// RUN: %ocheck 0 %s -mstringop-strategy=unrolled_loop
+// RUN: %ocheck 0 %s -mstringop-strategy=rep_8byte -fpic
+// RUN: %ocheck 0 %s -mstringop-strategy=rep_8byte -fintegrated-as -O2
+
+void abort(void) __attribute__((noreturn));
+
+#define SIZES(X) \
+	X(1) X(3) X(7) X(9) X(15) X(16) X(17) X(24) X(31) X(33) \
+	X(48) X(63) X(64) X(65) X(72) X(100) X(255)
+
+#define DEFINE(n) \
+	struct s ## n { unsigned char b[n]; }; \
+	\
+	__attribute__((noinline)) \
+	static void copy ## n(struct s ## n *d, const struct s ## n *s) \
+	{ \
+		*d = *s; \
+	} \
+	\
+	__attribute__((noinline)) \
+	static void zero ## n(struct s ## n *d) \
+	{ \
+		*d = (struct s ## n){ { 0 } }; \
+	}
+
+SIZES(DEFINE)
+
+static void fill(unsigned char *p, unsigned n, unsigned seed)
+{
+	unsigned i;
+	for(i = 0; i < n; i++)
+		p[i] = seed + i * 7;
+}
+
+static void check(const unsigned char *p, unsigned n, unsigned seed)
+{
+	unsigned i;
+	for(i = 0; i < n; i++)
+		if(p[i] != (unsigned char)(seed + i * 7))
+			abort();
+}
+
+static void check_zero(const unsigned char *p, unsigned n)
+{
+	unsigned i;
+	for(i = 0; i < n; i++)
+		if(p[i])
+			abort();
+}
+
+/* guard bytes either side catch overruns */
+#define TEST(n) \
+	{ \
+		struct { char pre[8]; struct s ## n v; char post[8]; } a, b; \
+		\
+		fill((unsigned char *)&a, sizeof a, 1); \
+		fill((unsigned char *)&b, sizeof b, 2); \
+		\
+		copy ## n(&b.v, &a.v); \
+		check(b.v.b, n, 1 + 8 * 7); \
+		check((unsigned char *)b.pre, 8, 2); \
+		check((unsigned char *)b.post, 8, 2 + (8 + n) * 7); \
+		\
+		zero ## n(&b.v); \
+		check_zero(b.v.b, n); \
+		check((unsigned char *)b.post, 8, 2 + (8 + n) * 7); \
+	}
+
+int main(void)
+{
+	SIZES(TEST)
+	return 0;
+}
@@ -0,0 +1,234 @@
+// RUN: %ocheck 0 %s -O3
+// RUN: %ocheck 0 %s -O3 -fintegrated-as
+// RUN: %ocheck 0 %s -O3 -fno-ivopts -fno-move-loop-invariants
+// RUN: %ocheck 0 %s -O2 -ftree-vectorize
+// RUN: %ocheck 0 %s -O3 -fsanitize=bounds -fsanitize-error=call=san_fail
+//
+// RUN: %ucc -target x86_64-linux -S -o %t %s -DASM_ONLY -O3
+// RUN:   sed -n '/^ADD:/,/^\.Lfuncend_ADD/p' %t | grep 'paddd'
+// RUN:   sed -n '/^SUM:/,/^\.Lfuncend_SUM/p' %t | grep 'pshufd'
+// RUN:   sed -n '/^SCALEF:/,/^\.Lfuncend_SCALEF/p' %t | grep 'mulps'
+// RUN:   sed -n '/^ADDD:/,/^\.Lfuncend_ADDD/p' %t | grep 'addpd'
+// RUN: ! sed -n '/^MUL:/,/^\.Lfuncend_MUL/p' %t | grep 'xmm'
+// RUN: ! sed -n '/^SHIFT:/,/^\.Lfuncend_SHIFT/p' %t | grep 'xmm'
+// RUN: ! sed -n '/^CALLS:/,/^\.Lfuncend_CALLS/p' %t | grep 'xmm'
+//
+// RUN: %ucc -target x86_64-linux -S -o %t %s -DASM_ONLY -O2
+// RUN: ! grep 'paddd\|mulps\|addpd\|pshufd' %t
+//
+// RUN: %ucc -target x86_64-linux -S -o /dev/null %s -DASM_ONLY -O3 -fopt-info-vec 2>&1 | grep -c 'note: loop vectorised using 16 byte vectors' | grep '^4$'
+// RUN: %ucc -target x86_64-linux -S -o /dev/null %s -DASM_ONLY -O3 -fopt-info-vec-missed >%t 2>&1
+// RUN:   grep 'loop not vectorised: no vector form of the operation' %t
+// RUN:   grep 'loop not vectorised: dependence between iterations' %t
+// RUN:   grep 'loop not vectorised: control flow in the loop' %t
+// RUN:   grep 'loop not vectorised: call in the loop' %t
+// RUN: ! grep 'note: loop vectorised' %t
+// RUN: %ucc -target x86_64-linux -S -o /dev/null %s -DASM_ONLY -O3 -floop-opt-stats 2>&1 | grep ', 4 vectorised'
+
+#ifdef ASM_ONLY
+int f(int);
+
+// uppercase function names to avoid grep conflict when looking for instructions
+void ADD(int *d, const int *a, const int *b, int n)
+{
+	for(int i = 0; i < n; i++)
+		d[i] = a[i] + b[i];
+}
+
+int SUM(const int *a, int n)
+{
+	int t = 0;
+	for(int i = 0; i < n; i++)
+		t += a[i];
+	return t;
+}
+
+void SCALEF(float *restrict d, const float *a, float k, int n)
+{
+	for(int i = 0; i < n; i++)
+		d[i] = a[i] * k;
+}
+
+void ADDD(double *d, const double *a, int n)
+{
+	for(int i = 0; i < n; i++)
+		d[i] += a[i];
+}
+
+void MUL(int *d, int n)
+{
+	for(int i = 0; i < n; i++)
+		d[i] *= 3; // no pmulld in SSE2
+}
+
+void SHIFT(int *d, int n)
+{
+	for(int i = 0; i < n; i++)
+		d[i + 1] = d[i] + 1;
+}
+
+void CALLS(int *d, int n)
+{
+	for(int i = 0; i < n; i++)
+		if(d[i])
+			d[i] = f(i);
+	for(int i = 0; i < n; i++)
+		f(d[i]);
+}
+#else
+void abort(void) __attribute__((noreturn));
+
+void san_fail(void)
+{
+	abort();
+}
+
+void add(int *d, const int *a, const int *b, int n)
+{
+	for(int i = 0; i < n; i++)
+		d[i] = a[i] + b[i];
+}
+
+unsigned checksum(const unsigned *a, long n)
+{
+	unsigned x = 0;
+	for(long i = 0; i < n; i++)
+		x ^= a[i];
+	return x;
+}
+
+int sum_from(const int *a, int from, int n)
+{
+	int t = 7;
+	for(int i = from; i < n; i++)
+		t += a[i];
+	return t;
+}
+
+void fill(int *d, int k, unsigned long n)
+{
+	for(unsigned long i = 0; i < n; i++)
+		d[i] = k * 2 + 1;
+}
+
+void axpy(float *restrict y, const float *restrict x, float a, int n)
+{
+	for(int i = 0; i < n; i++)
+		y[i] = a * x[i] + y[i];
+}
+
+void scale(double *d, int n)
+{
+	for(int i = 0; i < n; i++)
+		d[i] = d[i] / 2 - 1;
+}
+
+int g_a[37], g_b[37];
+
+void globals(int n)
+{
+	for(int i = 0; i < n; i++){
+		g_a[i] = g_b[i] | 1;
+		g_b[i] -= g_a[i];
+	}
+}
+
+void rows(int m[][9], int r)
+{
+	for(int j = 0; j < r; j++)
+		for(int i = 0; i < 9; i++)
+			m[j][i] += j;
+}
+
+void check(int cond)
+{
+	if(!cond)
+		abort();
+}
+
+int main()
+{
+	int a[23], b[23], d[24];
+	unsigned u[19];
+	float x[13], y[13];
+	double z[7];
+	int m[3][9];
+	int i, j;
+
+	for(i = 0; i < 23; i++)
+		a[i] = i, b[i] = 100 * i;
+
+	add(d, a, b, 23);
+	for(i = 0; i < 23; i++)
+		check(d[i] == 101 * i);
+
+	/* zero and short trip counts */
+	d[0] = -1;
+	add(d, a, b, 0);
+	check(d[0] == -1);
+	add(d, a, b, 3);
+	check(d[2] == 202);
+
+	/* in place, and overlapping by less than a vector */
+	add(a, a, a, 23);
+	for(i = 0; i < 23; i++)
+		check(a[i] == 2 * i);
+
+	for(i = 0; i < 23; i++)
+		a[i] = 1;
+	add(a + 1, a, a, 22);
+	for(i = 0; i < 23; i++)
+		check(a[i] == 1 << i);
+
+	for(i = 0; i < 23; i++)
+		a[i] = i;
+	add(a, a + 5, a + 5, 18);
+	for(i = 0; i < 18; i++)
+		check(a[i] == 2 * (i + 5));
+
+	check(sum_from(b, 0, 23) == 7 + 100 * 253);
+	check(sum_from(b, 3, 23) == 7 + 100 * (253 - 3));
+	check(sum_from(b, 30, 23) == 7);
+
+	for(i = 0; i < 19; i++)
+		u[i] = 0x80000001u << (i % 5);
+	{
+		unsigned expect = 0;
+		for(i = 0; i < 19; i++)
+			expect ^= u[i];
+		check(checksum(u, 19) == expect);
+	}
+
+	fill(d, 10, 21);
+	for(i = 0; i < 21; i++)
+		check(d[i] == 21);
+
+	for(i = 0; i < 13; i++)
+		x[i] = i, y[i] = 1;
+	axpy(y, x, 0.5f, 13);
+	for(i = 0; i < 13; i++)
+		check(y[i] == i * 0.5f + 1);
+
+	for(i = 0; i < 7; i++)
+		z[i] = i;
+	scale(z, 7);
+	for(i = 0; i < 7; i++)
+		check(z[i] == i / 2.0 - 1);
+
+	for(i = 0; i < 37; i++)
+		g_b[i] = i;
+	globals(37);
+	for(i = 0; i < 37; i++)
+		check(g_a[i] == (i | 1) && g_b[i] == i - (i | 1));
+
+	for(j = 0; j < 3; j++)
+		for(i = 0; i < 9; i++)
+			m[j][i] = i;
+	rows(m, 3);
+	for(j = 0; j < 3; j++)
+		for(i = 0; i < 9; i++)
+			check(m[j][i] == i + j);
+
+	return 0;
+}
+#endif
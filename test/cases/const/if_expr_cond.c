@@ -0,0 +1,19 @@
+// RUN: %ocheck 0 %s
+
+void abort(void) __attribute__((noreturn));
+
+/* the condition is tested as its own type, not truncated to int */
+static int half = 0.5 ? 1 : 2;
+static int zero = 0.0 ? 1 : 2;
+static int pow62 = (unsigned long)0x4000000000000000L ? 1 : 2;
+static int pow32 = 0x100000000L ? 1 : 2;
+static int lmin = (-0x7fffffffffffffffL - 1) ? 1 : 2;
+
+int main()
+{
+	if(half != 1 || zero != 2)
+		abort();
+	if(pow62 != 1 || pow32 != 1 || lmin != 1)
+		abort();
+	return 0;
+}
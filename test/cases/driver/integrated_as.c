@@ -0,0 +1,87 @@
+// RUN: %ocheck 0 %s -fintegrated-as
+// RUN: %ocheck 0 %s -fintegrated-as -O2 -g
+// RUN: %ocheck 0 %s -fintegrated-as -fpic -fstack-protector-all
+//
+// RUN: %ucc -### -fintegrated-as -c -o %t %s 2>&1 | grep -q -- '-emit=obj'
+// RUN: %ucc -### -fintegrated-as -c -o %t %s 2>&1 | grep '^as '; [ $? -ne 0 ]
+// RUN: %ucc -### -fintegrated-as -fno-integrated-as -c -o %t %s 2>&1 | grep -q '^as '
+
+typedef unsigned long size_t;
+
+void abort(void) __attribute__((noreturn));
+
+struct point
+{
+	long x;
+	short y;
+	char tag;
+};
+
+static const struct point pts[] = {
+	{ 1, 2, 'a' },
+	{ -300, 4000, 'b' },
+	{ 0x123456789, -5, 'c' },
+};
+
+static char buf[64];
+int counter = 3;
+double scale = 2.5;
+
+static long sum(const struct point *p, size_t n)
+{
+	long t = 0;
+	size_t i;
+
+	for(i = 0; i < n; i++)
+		t += p[i].x * p[i].y + p[i].tag;
+
+	return t;
+}
+
+static int classify(int x)
+{
+	switch(x){
+		case 0: return 10;
+		case 1: return 11;
+		case 2: return 12;
+		case 3: return 13;
+		case 4: return 14;
+		case 5: return 15;
+	}
+	return -1;
+}
+
+static unsigned char shifts(unsigned char c, int n)
+{
+	return (c << n) | (c >> (8 - n));
+}
+
+static double mix(int i, float f)
+{
+	return i * scale + f;
+}
+
+int main(void)
+{
+	size_t i;
+
+	if(sum(pts, 3) != 2 + 'a' - 1200000 + 'b' + 0x123456789 * -5 + 'c')
+		abort();
+
+	for(i = 0; i < sizeof buf; i++)
+		buf[i] = i ^ 0x5a;
+	for(i = 0; i < sizeof buf; i++)
+		if(buf[i] != (char)(i ^ 0x5a))
+			abort();
+
+	if(classify(counter) != 13 || classify(9) != -1)
+		abort();
+
+	if(shifts(0x81, 1) != 0x03)
+		abort();
+
+	if(mix(2, 0.5f) != 5.5)
+		abort();
+
+	return 0;
+}
@@ -0,0 +1,16 @@
+// RUN: %ucc -S -o /dev/null -g -fmem-report %s 2>%t
+// RUN: grep -q '^ types  *[1-9][0-9]*  *[1-9][0-9]*$' %t
+// RUN: grep -q '^ block insns  *[1-9][0-9]*  *[1-9][0-9]*$' %t
+// RUN: grep -q '^ dwarf  *[1-9][0-9]*  *[1-9][0-9]*$' %t
+// RUN: grep -q '^ peak RSS: [0-9]* KiB$' %t
+
+struct A
+{
+	int i;
+	char *p;
+};
+
+int f(struct A *a)
+{
+	return a->i + *a->p;
+}
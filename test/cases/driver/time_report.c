@@ -0,0 +1,18 @@
+// RUN: %ucc -S -o /dev/null -ftime-report %s 2>%t
+// RUN: grep -q '^ parse ' %t
+// RUN: grep -q '^ code generation ' %t
+// RUN: grep -q '^ TOTAL ' %t
+//
+// RUN: %ucc -S -o /dev/null -ftime-report-json=%t.json %s 2>/dev/null
+// RUN: grep -q '"name": "block flush"' %t.json
+// RUN: grep -q '"total": ' %t.json
+
+static int add(int a, int b)
+{
+	return a + b;
+}
+
+int main(void)
+{
+	return add(1, 2);
+}
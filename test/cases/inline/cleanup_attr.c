@@ -16,7 +16,7 @@ inline void clean_int_ai(int *p)
 main()
 {
 	__attribute((cleanup(clean_int_ai))) int i = 5; // CHECK: note: function inlined
-	__attribute((cleanup(clean_int_ni))) int j = 5; // CHECK: !/inline/
+	__attribute((cleanup(clean_int_ni))) int j = 5; // CHECK: function not inlined: function has noinline attribute
 
 	return i + j;
 }
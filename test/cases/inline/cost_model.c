@@ -0,0 +1,74 @@
+// RUN: %check --prefix=default %s -fshow-inlined -finline-functions -fno-semantic-interposition
+// RUN: %check --prefix=nolimit %s -fshow-inlined -finline-functions -fno-semantic-interposition -finline-limit=0
+// RUN: %ocheck 0 %s -O2
+// RUN: %ocheck 0 %s -O2 -finline-limit=0
+// RUN: %ocheck 0 %s -O2 -finline-limit=1000
+
+void abort(void) __attribute__((noreturn));
+
+struct s { int kind, x, y; };
+
+enum { A, B, C, D };
+
+static int weight(const struct s *p)
+{
+	switch(p->kind){
+		case A: return 1;
+		case B: return 4;
+		case C: return 9;
+		case D: return 16;
+	}
+	return 0;
+}
+
+int getx(const struct s *p)
+{
+	return p->x;
+}
+
+int clamp(int v, int lo, int hi)
+{
+	if(v < lo)
+		return lo;
+	if(v > hi)
+		return hi;
+	return v;
+}
+
+int sum(const int *a, int n)
+{
+	int i, t = 0;
+	for(i = 0; i < n; i++)
+		t += a[i];
+	return t;
+}
+
+int user(struct s *arr, int n, int *ints)
+{
+	int i, t = 0;
+
+	for(i = 0; i < n; i++){
+		t += weight(&arr[i]); // CHECK-default: /function inlined: .*\(single caller\) \(in loop\)/
+		// CHECK-nolimit: ^/function inlined: .*\(single caller\)/
+		t += getx(&arr[i]); // CHECK-default: /function inlined: .*\(in loop\)/
+		// saves more than it costs, even without a growth allowance
+		// CHECK-nolimit: ^^function inlined: cost 4, bonus 12 (in loop), limit 0,
+	}
+
+	t += sum(ints, n); // CHECK-default: function not inlined: cost 25, bonus 5, limit 16,
+	t = clamp(t, 0, 100); // CHECK-default: /function inlined: .*\(constant args\)/
+	// CHECK-nolimit: ^^function not inlined: cost 25, bonus 5, limit 0,
+
+	return t;
+}
+
+int main()
+{
+	struct s arr[] = { { A, 1, 0 }, { D, 2, 0 }, { 7, 3, 0 } };
+	int ints[] = { 5, 6, 7 };
+
+	if(user(arr, 3, ints) != 1 + 16 + 0 + 1 + 2 + 3 + 18)
+		abort();
+
+	return 0;
+}
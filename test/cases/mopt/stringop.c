@@ -3,6 +3,15 @@
 //
 // RUN:   %ucc -DSZ=16 -mstringop-strategy=libcall-threshold=16 -S -o- %s | grep memcpy
 // RUN: ! %ucc -DSZ=15 -mstringop-strategy=libcall-threshold=16 -S -o- %s | grep memcpy
+//
+// RUN:   %ucc -target x86_64-linux -DSZ=40 -mstringop-strategy=unrolled_loop -S -o- %s | grep -q movdqu
+// RUN: ! %ucc -target x86_64-linux -DSZ=400 -mstringop-strategy=unrolled_loop -S -o- %s | grep 'memcpy\|rep'
+// RUN:   %ucc -target x86_64-linux -DSZ=40 -mstringop-strategy=rep_8byte -S -o- %s | grep -q 'rep movsq'
+//
+// by default: moves, then rep, then a libcall
+// RUN: ! %ucc -target x86_64-linux -DSZ=64 -S -o- %s | grep 'memcpy\|rep'
+// RUN:   %ucc -target x86_64-linux -DSZ=72 -S -o- %s | grep -q 'rep movsq'
+// RUN:   %ucc -target x86_64-linux -DSZ=256 -S -o- %s | grep -q memcpy
 
 typedef struct A { char bytes[SZ]; } A;
 
@@ -1,4 +1,5 @@
 // RUN: %ocheck 0 %s
+// RUN: %ocheck 0 %s -mstringop-strategy=loop
 void abort(void) __attribute__((noreturn));
 
 struct A
@@ -21,6 +22,21 @@ chk(struct A *p)
 		abort();
 }
 
+struct B
+{
+	int i, j, k;
+};
+
+small()
+{
+	struct B x = { 1, 2, 3 }, y, z;
+
+	/* inline copy, its result is the assigned-to struct */
+	z = y = x;
+	if(z.i != 1 || z.j != 2 || z.k != 3)
+		abort();
+}
+
 main()
 {
 	struct A a, b, c, d, e = { 1, 2, 3, 4, 5 };
@@ -33,5 +49,7 @@ main()
 	chk(&d);
 	chk(&e);
 
+	small();
+
 	return 0;
 }
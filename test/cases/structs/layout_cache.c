@@ -0,0 +1,27 @@
+// RUN: %ucc -fsyntax-only %s
+// RUN: %ucc -fsyntax-only -fdump-type-tree %s 2>&1 | grep -q 'layout cache: [0-9]* hits, [0-9]* misses'
+
+struct late;
+typedef struct late late_t;
+struct late *p;
+
+struct late
+{
+	char c;
+	long l;
+};
+
+typedef late_t late_arr[4];
+
+// size and alignment are only cached once struct late is complete
+_Static_assert(sizeof(late_arr) == 4 * 16, "");
+_Static_assert(_Alignof(late_arr) == 8, "");
+_Static_assert(sizeof(*p) == 16, "");
+_Static_assert(sizeof(late_arr) == 64, "");
+
+f(int n)
+{
+	late_t vla[n];
+	_Static_assert(sizeof(vla[0]) == 16, "");
+	return sizeof(vla);
+}
@@ -1,7 +1,8 @@
-// RUN: %ucc -target x86_64-linux -S -o- %s -ffreestanding | grep -F 'movq (%%rax), %%rcx'
-// RUN: %ucc -target x86_64-linux -S -o- %s -DTO_VOID -ffreestanding | grep -F 'movq (%%rax), %%rcx'
-// RUN: %ucc -target x86_64-linux -S -o- %s -fno-freestanding | grep 'call.*memcpy'
-// RUN: %ucc -target x86_64-linux -S -o- %s -DTO_VOID -fno-freestanding | grep 'call.*memcpy'
+// RUN: %ucc -target x86_64-linux -S -o- %s -ffreestanding | grep -F 'movdqu (%%rax), %%xmm'
+// RUN: %ucc -target x86_64-linux -S -o- %s -DTO_VOID -ffreestanding | grep -F 'movdqu (%%rax), %%xmm'
+// RUN: %ucc -target x86_64-linux -S -o- %s -ffreestanding -mstringop-strategy=rep_8byte | grep -F 'rep movsq'
+// RUN: %ucc -target x86_64-linux -S -o- %s -fno-freestanding -mstringop-strategy=libcall | grep 'call.*memcpy'
+// RUN: %ucc -target x86_64-linux -S -o- %s -DTO_VOID -fno-freestanding -mstringop-strategy=libcall | grep 'call.*memcpy'
 
 struct A
 {
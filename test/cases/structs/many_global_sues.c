@@ -0,0 +1,20 @@
+// RUN: awk 'BEGIN { for(i = 0; i < 3000; i++) printf "struct s%%d { int a; char *b; struct s%%d *next; };\n", i, i; for(i = 0; i < 10000; i++) printf "extern struct s%%d *v%%d;\n", i %% 3000, i }' > %t.h
+// RUN: cat %t.h %s > %t.c
+// RUN: ulimit -t 30; %ucc -fsyntax-only %t.c
+//
+// each global struct should be laid out once, when it's complete,
+// rather than the whole global scope being revisited per declaration
+
+struct fwd *p;
+
+_Static_assert(sizeof(struct s0) == 24, "");
+_Static_assert(sizeof(struct s2999) == 24, "");
+_Static_assert(sizeof(*v9999) == 24, "");
+
+struct fwd
+{
+	struct s1500 a;
+	char b;
+};
+
+_Static_assert(sizeof(*p) == 32, "");
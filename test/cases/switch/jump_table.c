@@ -0,0 +1,16 @@
+// RUN: %ucc -S -o- %s | grep -F 'jmp *'
+// RUN: %ucc -S -o- %s | grep -F '.long .Lblk'
+// RUN: %ucc -S -o- %s -fno-jump-tables | grep -F 'jmp *'; [ $? -ne 0 ]
+
+f(int x)
+{
+	switch(x){
+		case 1: return 3;
+		case 2: return 1;
+		case 3: return 4;
+		case 4: return 1;
+		case 6: return 5;
+		case 7: return 9;
+	}
+	return 2;
+}
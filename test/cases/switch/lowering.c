@@ -0,0 +1,102 @@
+// RUN: %ocheck 0 %s
+// RUN: %ocheck 0 %s -fno-jump-tables
+void abort(void) __attribute__((noreturn));
+
+/* dense - jump table, with holes and a range */
+dense(int x)
+{
+	switch(x){
+		case 0: return 10;
+		case 1: return 11;
+		case 2: return 12;
+		case 3: return 13;
+		case 5: return 15;
+		case 6 ... 8: return 16;
+		default: return -1;
+	}
+}
+
+/* sparse - binary search */
+sparse(long x)
+{
+	switch(x){
+		case -100000: return 1;
+		case -5: return 2;
+		case 7: return 3;
+		case 1000 ... 1002: return 4;
+		case 99999: return 5;
+		case 123456789: return 6;
+	}
+	return 0;
+}
+
+/* signed ordering across zero */
+sch(signed char c)
+{
+	switch(c){
+		case -3: return 1;
+		case -2: return 2;
+		case -1: return 3;
+		case 0: return 4;
+		case 1: return 5;
+	}
+	return 0;
+}
+
+/* unsigned ordering, high values sort last */
+uns(unsigned x)
+{
+	switch(x){
+		case 0xfffffffe: return 1;
+		case 0xffffffff: return 2;
+		case 0: return 3;
+		case 1: return 4;
+		case 2: return 5;
+	}
+	return 0;
+}
+
+assert(_Bool b)
+{
+	if(!b)
+		abort();
+}
+
+main()
+{
+	assert(dense(-1) == -1);
+	assert(dense(0) == 10);
+	assert(dense(3) == 13);
+	assert(dense(4) == -1);
+	assert(dense(5) == 15);
+	assert(dense(7) == 16);
+	assert(dense(8) == 16);
+	assert(dense(9) == -1);
+	assert(dense(-2147483647 - 1) == -1);
+
+	assert(sparse(-100000) == 1);
+	assert(sparse(-5) == 2);
+	assert(sparse(-4) == 0);
+	assert(sparse(7) == 3);
+	assert(sparse(1001) == 4);
+	assert(sparse(1003) == 0);
+	assert(sparse(99999) == 5);
+	assert(sparse(123456789) == 6);
+	assert(sparse(0) == 0);
+
+	assert(sch(-4) == 0);
+	assert(sch(-3) == 1);
+	assert(sch(-1) == 3);
+	assert(sch(0) == 4);
+	assert(sch(1) == 5);
+	assert(sch(2) == 0);
+
+	assert(uns(0xfffffffe) == 1);
+	assert(uns(0xffffffff) == 2);
+	assert(uns(0) == 3);
+	assert(uns(2) == 5);
+	assert(uns(3) == 0);
+	assert(uns(0x80000000) == 0);
+
+	return 0;
+}
@@ -0,0 +1,28 @@
+// RUN: %ucc -fsyntax-only %s 2>%t
+// RUN: grep -qF '"int first = "first";"' %t
+// RUN: grep -qF '"int last = "last"; char c;"' %t
+// RUN: %ucc -fsyntax-only -fno-show-line %s 2>%t
+// RUN: ! grep -F '"int' %t
+
+// source lines shown in diagnostics are found on demand,
+// rather than every input line being retained
+
+void f(void)
+{
+	int first = "first";
+}
+
+struct A
+{
+	int i;
+};
+
+int g(struct A *p)
+{
+	return p->i;
+}
+
+void h(void)
+{
+	int last = "last"; char c;
+}
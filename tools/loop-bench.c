@@ -0,0 +1,115 @@
+/* array kernels for tools/loop-bench - each prints its time and a checksum,
+ * which must match across builds */
+
+/* no headers, so the in-tree preprocessor can build this */
+typedef unsigned long size_t;
+typedef long clock_t;
+#define CLOCKS_PER_SEC 1000000l /* XSI */
+
+int printf(const char *, ...);
+size_t strlen(const char *);
+clock_t clock(void);
+
+#define N 4096
+#define ROWS 64
+#define COLS 64
+#define REPEAT 20000
+
+static int a[N], b[N], c[N];
+static int m[ROWS][COLS];
+static char text[N + 1];
+
+static unsigned long sum(const int *p, int n)
+{
+	unsigned long t = 0;
+	for(int i = 0; i < n; i++)
+		t += p[i];
+	return t;
+}
+
+static unsigned long axpy(int *dst, const int *x, const int *y, int n, int k)
+{
+	for(int i = 0; i < n; i++)
+		dst[i] = x[i] * (k * 3 + 1) + y[i];
+	return dst[n / 2];
+}
+
+static unsigned long strided(const int *p, int n, int stride)
+{
+	unsigned long t = 0;
+	for(int i = 0; i < n / stride * stride; i += stride)
+		t += p[i];
+	return t;
+}
+
+static unsigned long matrix(int rows, int cols)
+{
+	unsigned long t = 0;
+	for(int i = 0; i < rows; i++)
+		for(int j = 0; j < cols; j++)
+			t += m[i][j] * (i + cols);
+	return t;
+}
+
+static unsigned long count(const char *s, char ch)
+{
+	unsigned long n = 0;
+	for(size_t i = 0; i < strlen(s); i++)
+		n += s[i] == ch;
+	return n;
+}
+
+static unsigned long reverse(int *dst, const int *src, int n)
+{
+	for(int i = n - 1; i >= 0; i--)
+		dst[n - 1 - i] = src[i];
+	return dst[0];
+}
+
+/* -O3 vectorises these */
+static unsigned long vadd(int *dst, const int *x, const int *y, int n)
+{
+	for(int i = 0; i < n; i++)
+		dst[i] = x[i] + y[i] - 1;
+	return dst[n - 1];
+}
+
+static unsigned long vsum(const int *p, int n)
+{
+	int t = 0;
+	for(int i = 0; i < n; i++)
+		t += p[i];
+	return t;
+}
+
+#define BENCH(name, expr) do{ \
+		unsigned long check = 0; \
+		clock_t start = clock(); \
+		for(int r = 0; r < REPEAT; r++) \
+			check += expr; \
+		printf("%-8s %8.3fs %lu\n", name, \
+				(double)(clock() - start) / CLOCKS_PER_SEC, check); \
+	}while(0)
+
+int main(void)
+{
+	for(int i = 0; i < N; i++){
+		a[i] = i * 7 % 13;
+		b[i] = i % 5 - 2;
+		text[i] = "abcab"[i % 5];
+	}
+	for(int i = 0; i < ROWS; i++)
+		for(int j = 0; j < COLS; j++)
+			m[i][j] = i ^ j;
+
+	BENCH("sum", sum(a, N));
+	BENCH("axpy", axpy(c, a, b, N, 5));
+	BENCH("strided", strided(a, N, 3));
+	BENCH("matrix", matrix(ROWS, COLS));
+	BENCH("count", count(text + N - 256, 'a'));
+	BENCH("reverse", reverse(c, a, N));
+	BENCH("vadd", vadd(c, a, b, N - 3));
+	BENCH("vsum", vsum(a, N - 3));
+
+	return 0;
+}